@@ -0,0 +1,175 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <arena.hh>
+#include <cstdlib>
+
+namespace DMSToolbox {
+
+// Create arena
+Arena::Arena(size_t capacity)
+    : m_mutex()
+    , m_blocks(nullptr)
+    , m_blockSize(capacity)
+    , m_free()
+    , m_capacity(0)
+    , m_used(0)
+    , m_peak(0)
+    , m_numBlocks(0)
+{
+    addBlock(capacity);
+}
+
+// Destroy arena
+Arena::~Arena()
+{
+    while (m_blocks != nullptr) {
+        Block* next = m_blocks->m_next;
+        free(m_blocks);
+        m_blocks = next;
+    }
+}
+
+// Allocate memory
+void* Arena::allocate(size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Reuse freed memory of the same size class
+    size_t index = sizeClass(size);
+    void* ptr = m_free[index];
+    if (ptr != nullptr) {
+        m_free[index] = *static_cast<void**>(ptr);
+    }
+    else {
+        // Take memory from current block
+        if (m_blocks->m_size - m_blocks->m_used < size) {
+            addBlock(size > m_blockSize ? size : m_blockSize);
+        }
+        ptr = reinterpret_cast<uint8_t*>(m_blocks) + sizeof(Block) + m_blocks->m_used;
+        m_blocks->m_used += size;
+    }
+
+    m_used += size;
+    if (m_used > m_peak) {
+        m_peak = m_used;
+    }
+    return ptr;
+}
+
+// Free memory
+void Arena::deallocate(void* ptr, size_t size)
+{
+    if (ptr == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t index = sizeClass(size);
+    *static_cast<void**>(ptr) = m_free[index];
+    m_free[index] = ptr;
+    m_used -= size;
+}
+
+// Get reserved bytes
+size_t Arena::getCapacity() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_capacity;
+}
+
+// Get allocated bytes
+size_t Arena::getUsed() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_used;
+}
+
+// Get peak allocated bytes
+size_t Arena::getPeak() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_peak;
+}
+
+// Get number of memory blocks
+size_t Arena::getNumBlocks() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_numBlocks;
+}
+
+// Get size class and round up size
+size_t Arena::sizeClass(size_t& size)
+{
+    if (size == 0) {
+        size = 1;
+    }
+    if (size <= NumSmallClasses * Alignment) {
+        size_t index = (size - 1) / Alignment;
+        size = (index + 1) * Alignment;
+        return index;
+    }
+
+    // Larger allocations use power of two classes
+    size_t index = NumSmallClasses;
+    size_t classSize = NumSmallClasses * Alignment * 2;
+    while (classSize < size) {
+        classSize *= 2;
+        ++index;
+    }
+    size = classSize;
+    return index;
+}
+
+// Reserve memory block
+void Arena::addBlock(size_t size)
+{
+    static_assert(sizeof(Block) % Alignment == 0, "Block header breaks alignment");
+    auto block = static_cast<Block*>(malloc(sizeof(Block) + size));
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    block->m_next = m_blocks;
+    block->m_size = size;
+    block->m_used = 0;
+    block->m_padding = 0;
+    m_blocks = block;
+    m_capacity += sizeof(Block) + size;
+    ++m_numBlocks;
+}
+
+} // namespace DMSToolbox
@@ -0,0 +1,288 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <memory>
+#include <mutex>
+#include <new>
+
+namespace DMSToolbox {
+
+/**
+  @ingroup common_group
+
+  Memory arena.
+
+  The arena reserves one memory block of the requested capacity up front and serves all allocations from it. Freed
+  memory is kept in free lists per size class and reused for allocations of the same class. If the capacity is
+  exceeded, another block is reserved, so allocations never fail as long as the system has memory left. All blocks
+  are released at once when the arena is destroyed. The arena statistics allow to measure the memory budget of
+  everything allocated from it.
+ */
+class Arena {
+    public:
+        /**
+          Create arena.
+
+          Creates an arena and reserves the initial memory block.
+
+          @param[in]    capacity    Initial capacity in bytes
+         */
+        explicit Arena(size_t capacity);
+
+        /**
+          Destroy arena.
+
+          Releases all memory blocks. All objects allocated from the arena must have been destroyed before.
+         */
+        ~Arena();
+
+        /**
+          Allocate memory.
+
+          Allocates memory from the arena, aligned to Alignment bytes.
+
+          @param[in]    size        Number of bytes to allocate
+
+          @return                   Pointer to allocated memory
+         */
+        void* allocate(size_t size);
+
+        /**
+          Free memory.
+
+          Returns memory to the arena for reuse.
+
+          @param[in]    ptr         Pointer returned by allocate()
+          @param[in]    size        Number of bytes passed to allocate()
+         */
+        void deallocate(void* ptr, size_t size);
+
+        /**
+          Get capacity.
+
+          Returns the number of bytes reserved from the system, including all memory blocks.
+
+          @return                   Reserved bytes
+         */
+        size_t getCapacity() const;
+
+        /**
+          Get used memory.
+
+          Returns the number of bytes currently allocated from the arena, rounded up to size classes.
+
+          @return                   Allocated bytes
+         */
+        size_t getUsed() const;
+
+        /**
+          Get peak memory.
+
+          Returns the maximum number of bytes allocated from the arena at the same time.
+
+          @return                   Peak allocated bytes
+         */
+        size_t getPeak() const;
+
+        /**
+          Get number of memory blocks.
+
+          Returns the number of memory blocks reserved from the system. A value above one means the initial capacity
+          has been exceeded.
+
+          @return                   Number of memory blocks
+         */
+        size_t getNumBlocks() const;
+
+        static const size_t Alignment = 16;         ///< Alignment of all allocations
+
+    private:
+        /// Memory block header, followed by the block data
+        struct Block {
+            Block*      m_next;                     ///< Next block
+            size_t      m_size;                     ///< Size of block data
+            size_t      m_used;                     ///< Used bytes of block data
+            size_t      m_padding;                  ///< Padding to keep block data aligned
+        };
+
+        static const size_t NumSmallClasses = 64;   ///< Size classes in steps of Alignment bytes
+        static const size_t NumClasses = NumSmallClasses + 48; ///< Small plus power of two size classes
+
+        mutable std::mutex  m_mutex;                ///< Lock for concurrent use, e.g. by shared copy-on-write data
+        Block*              m_blocks;               ///< Reserved memory blocks, current block first
+        size_t              m_blockSize;            ///< Size of initial memory block
+        void*               m_free[NumClasses];     ///< Free lists per size class
+        size_t              m_capacity;             ///< Reserved bytes
+        size_t              m_used;                 ///< Allocated bytes
+        size_t              m_peak;                 ///< Peak allocated bytes
+        size_t              m_numBlocks;            ///< Number of memory blocks
+
+        /**
+          Get size class.
+
+          Returns the size class for the given allocation size and rounds the size up to the class size.
+
+          @param[in,out]    size    Allocation size, rounded up on return
+
+          @return                   Size class index
+         */
+        static size_t sizeClass(size_t& size);
+
+        /**
+          Reserve memory block.
+
+          Reserves a new memory block from the system and makes it the current block.
+
+          @param[in]    size        Minimum size of block data
+         */
+        void addBlock(size_t size);
+
+        Arena(const Arena&);                        ///< Inhibit copying objects
+        Arena& operator=(const Arena&);             ///< Inhibit copying objects
+};
+
+/**
+  @ingroup common_group
+
+  Standard allocator using an arena.
+
+  Allocator for standard containers and shared pointers placing their memory in an arena. The allocator keeps the
+  arena alive, so objects may outlive the owner that created the arena. Without an arena, the global heap is used.
+ */
+template <typename T>
+class ArenaAllocator {
+    public:
+        typedef T value_type;                       ///< Allocated type
+
+        /**
+          Create heap allocator.
+
+          Creates an allocator using the global heap.
+         */
+        ArenaAllocator()
+            : m_arena() {
+        }
+
+        /**
+          Create arena allocator.
+
+          Creates an allocator using the given arena.
+
+          @param[in]    arena       Arena to allocate from, may be empty to use the global heap
+         */
+        explicit ArenaAllocator(const std::shared_ptr<Arena>& arena)
+            : m_arena(arena) {
+        }
+
+        /**
+          Create allocator by converting.
+
+          Creates an allocator for another type using the same arena.
+
+          @param[in]    source      Source allocator
+         */
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& source)
+            : m_arena(source.getArena()) {
+        }
+
+        /**
+          Allocate memory.
+
+          Allocates memory for the given number of objects.
+
+          @param[in]    n           Number of objects
+
+          @return                   Pointer to allocated memory
+         */
+        T* allocate(size_t n) {
+            if (m_arena) {
+                return static_cast<T*>(m_arena->allocate(n * sizeof(T)));
+            }
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+
+        /**
+          Free memory.
+
+          Frees memory previously allocated with this allocator or an equal one.
+
+          @param[in]    ptr         Pointer to allocated memory
+          @param[in]    n           Number of objects
+         */
+        void deallocate(T* ptr, size_t n) {
+            if (m_arena) {
+                m_arena->deallocate(ptr, n * sizeof(T));
+            }
+            else {
+                ::operator delete(ptr);
+            }
+        }
+
+        /**
+          Get arena.
+
+          Returns the arena used by this allocator.
+
+          @return                   Arena or empty pointer if using the global heap
+         */
+        const std::shared_ptr<Arena>& getArena() const {
+            return m_arena;
+        }
+
+    private:
+        std::shared_ptr<Arena>  m_arena;            ///< Arena to allocate from
+};
+
+/// Compare allocators, equal if they use the same arena
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return a.getArena() == b.getArena();
+}
+
+/// Compare allocators, different if they use different arenas
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return a.getArena() != b.getArena();
+}
+
+} // namespace DMSToolbox
@@ -0,0 +1,396 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <cowbuffer.hh>
+#include <exceptions.hh>
+#include <algorithm>
+#include <cstring>
+
+namespace DMSToolbox {
+
+// Create empty reference
+CowBuffer::Ref::Ref()
+    : m_buffer(nullptr)
+    , m_offset(0)
+    , m_size(0)
+{
+}
+
+// Create reference to mapped block
+CowBuffer::Ref::Ref(CowBuffer* buffer, size_t offset, size_t size)
+    : m_buffer(buffer)
+    , m_offset(offset)
+    , m_size(size)
+{
+}
+
+// Create reference by copying
+CowBuffer::Ref::Ref(const Ref& source)
+    : m_buffer(source.m_buffer)
+    , m_offset(source.m_offset)
+    , m_size(source.m_size)
+{
+}
+
+// Copy reference
+CowBuffer::Ref& CowBuffer::Ref::operator=(const Ref& source)
+{
+    if (this != &source) {
+        m_buffer = source.m_buffer;
+        m_offset = source.m_offset;
+        m_size = source.m_size;
+    }
+    return *this;
+}
+
+// Get block data
+const uint8_t* CowBuffer::Ref::data() const
+{
+    if (m_buffer == nullptr) {
+        return nullptr;
+    }
+    return m_buffer->data(m_offset);
+}
+
+// Get writable block data
+uint8_t* CowBuffer::Ref::writable()
+{
+    if (m_buffer == nullptr) {
+        return nullptr;
+    }
+    return m_buffer->writable(m_offset);
+}
+
+// Write block data if changed
+bool CowBuffer::Ref::write(const void* data, size_t size, size_t offset)
+{
+    if (m_buffer == nullptr || offset + size > m_size) {
+        return false;
+    }
+    return m_buffer->write(m_offset + offset, data, size);
+}
+
+// Create empty buffer
+CowBuffer::CowBuffer()
+    : m_arena()
+    , m_table(std::make_shared<Table>())
+    , m_size(0)
+{
+}
+
+// Create zero-filled buffer
+CowBuffer::CowBuffer(size_t size, const std::shared_ptr<Arena>& arena)
+    : m_arena(arena)
+    , m_table(std::allocate_shared<Table>(ArenaAllocator<Table>(arena), ArenaAllocator<Chunk>(arena)))
+    , m_size(size)
+{
+    if (size > 0) {
+        Chunk chunk = { 0, size, allocate(size), false };
+        memset(chunk.m_storage.get(), 0, size);
+        m_table->push_back(chunk);
+    }
+}
+
+// Create buffer from data
+CowBuffer::CowBuffer(const void* data, size_t size, const std::shared_ptr<Arena>& arena)
+    : m_arena(arena)
+    , m_table(std::allocate_shared<Table>(ArenaAllocator<Table>(arena), ArenaAllocator<Chunk>(arena)))
+    , m_size(size)
+{
+    if (size > 0) {
+        Chunk chunk = { 0, size, allocate(size), false };
+        memcpy(chunk.m_storage.get(), data, size);
+        m_table->push_back(chunk);
+    }
+}
+
+// Create buffer by sharing contents
+CowBuffer::CowBuffer(const CowBuffer& source)
+    : m_arena(source.m_arena)
+    , m_table(source.m_table)
+    , m_size(source.m_size)
+{
+}
+
+// Create buffer by sharing contents, allocating from another arena
+CowBuffer::CowBuffer(const CowBuffer& source, const std::shared_ptr<Arena>& arena)
+    : m_arena(arena)
+    , m_table(std::allocate_shared<Table>(ArenaAllocator<Table>(arena), source.m_table->begin(),
+                                          source.m_table->end(), ArenaAllocator<Chunk>(arena)))
+    , m_size(source.m_size)
+{
+}
+
+// Destroy buffer
+CowBuffer::~CowBuffer()
+{
+}
+
+// Share contents of other buffer
+CowBuffer& CowBuffer::operator=(const CowBuffer& source)
+{
+    if (this != &source) {
+        m_arena = source.m_arena;
+        m_table = source.m_table;
+        m_size = source.m_size;
+    }
+    return *this;
+}
+
+// Get data pointer
+const uint8_t* CowBuffer::data(size_t offset) const
+{
+    const Chunk& chunk = (*m_table)[findChunk(offset)];
+    return chunk.m_storage.get() + (offset - chunk.m_offset);
+}
+
+// Get writable data pointer
+uint8_t* CowBuffer::writable(size_t offset)
+{
+    Chunk& chunk = makeWritable(findChunk(offset));
+    return chunk.m_storage.get() + (offset - chunk.m_offset);
+}
+
+// Read data across chunks
+void CowBuffer::read(size_t offset, void* out, size_t size) const
+{
+    if (offset + size > m_size) {
+        throw DataFormatException("Read exceeds buffer size");
+    }
+    auto dst = static_cast<uint8_t*>(out);
+    while (size > 0) {
+        const Chunk& chunk = (*m_table)[findChunk(offset)];
+        size_t pos = offset - chunk.m_offset;
+        size_t len = std::min(size, chunk.m_size - pos);
+        memcpy(dst, chunk.m_storage.get() + pos, len);
+        dst += len;
+        offset += len;
+        size -= len;
+    }
+}
+
+// Write data across chunks
+bool CowBuffer::write(size_t offset, const void* data, size_t size)
+{
+    if (offset + size > m_size) {
+        throw DataFormatException("Write exceeds buffer size");
+    }
+    bool changed = false;
+    auto src = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        size_t index = findChunk(offset);
+        const Chunk& chunk = (*m_table)[index];
+        size_t pos = offset - chunk.m_offset;
+        size_t len = std::min(size, chunk.m_size - pos);
+        if (memcmp(chunk.m_storage.get() + pos, src, len) != 0) {
+            memcpy(makeWritable(index).m_storage.get() + pos, src, len);
+            changed = true;
+        }
+        src += len;
+        offset += len;
+        size -= len;
+    }
+    return changed;
+}
+
+// Map block to one contiguous chunk
+CowBuffer::Ref CowBuffer::map(size_t offset, size_t size)
+{
+    if (size == 0 || offset + size > m_size) {
+        throw DataFormatException("Block exceeds buffer size");
+    }
+    unshareTable();
+    Table& table = *m_table;
+
+    // Mapped chunks must not be cut, so extend the range to cover them completely
+    size_t begin = offset;
+    size_t end = offset + size;
+    const Chunk& first = table[findChunk(begin)];
+    if (first.m_mapped) {
+        begin = first.m_offset;
+    }
+    const Chunk& last = table[findChunk(end - 1)];
+    if (last.m_mapped) {
+        end = last.m_offset + last.m_size;
+    }
+
+    // Split unmapped chunks at the range boundaries
+    split(begin);
+    split(end);
+
+    // Merge all chunks inside the range
+    size_t from = findChunk(begin);
+    size_t to = findChunk(end - 1);
+    if (from != to) {
+        // Check if chunks are contiguous in the same storage, otherwise copy them together
+        bool contiguous = true;
+        for (size_t i = from + 1; i <= to && contiguous; ++i) {
+            const Chunk& prev = table[i - 1];
+            const Chunk& cur = table[i];
+            contiguous = cur.m_storage.get() == prev.m_storage.get() + prev.m_size &&
+                         !cur.m_storage.owner_before(prev.m_storage) && !prev.m_storage.owner_before(cur.m_storage);
+        }
+        if (!contiguous) {
+            auto storage = allocate(end - begin);
+            for (size_t i = from; i <= to; ++i) {
+                memcpy(storage.get() + (table[i].m_offset - begin), table[i].m_storage.get(), table[i].m_size);
+            }
+            table[from].m_storage = storage;
+        }
+        table[from].m_size = end - begin;
+        table.erase(table.begin() + from + 1, table.begin() + to + 1);
+    }
+    table[from].m_mapped = true;
+
+    return Ref(this, offset, size);
+}
+
+// Check for shared chunk storage
+bool CowBuffer::sharesChunk(const CowBuffer& other, size_t offset) const
+{
+    if (m_table == other.m_table) {
+        return true;
+    }
+    if (offset >= m_size || offset >= other.m_size) {
+        return false;
+    }
+    const Chunk& mine = (*m_table)[findChunk(offset)];
+    const Chunk& theirs = (*other.m_table)[other.findChunk(offset)];
+    return mine.m_offset == theirs.m_offset && mine.m_size == theirs.m_size &&
+           mine.m_storage.get() == theirs.m_storage.get();
+}
+
+// Copy whole buffer contents
+void CowBuffer::copyTo(void* out) const
+{
+    auto dst = static_cast<uint8_t*>(out);
+    for (auto& i : *m_table) {
+        memcpy(dst + i.m_offset, i.m_storage.get(), i.m_size);
+    }
+}
+
+// Find chunk holding offset
+size_t CowBuffer::findChunk(size_t offset) const
+{
+    if (offset >= m_size) {
+        throw DataFormatException("Offset exceeds buffer size");
+    }
+    const Table& table = *m_table;
+    size_t lo = 0;
+    size_t hi = table.size();
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (table[mid].m_offset <= offset) {
+            lo = mid;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Unshare chunk table
+void CowBuffer::unshareTable()
+{
+    if (m_table.use_count() > 1) {
+        m_table = std::allocate_shared<Table>(ArenaAllocator<Table>(m_arena), *m_table);
+    }
+}
+
+// Make chunk writable
+CowBuffer::Chunk& CowBuffer::makeWritable(size_t index)
+{
+    unshareTable();
+    Chunk& chunk = (*m_table)[index];
+    if (isShared(index)) {
+        auto storage = allocate(chunk.m_size);
+        memcpy(storage.get(), chunk.m_storage.get(), chunk.m_size);
+        chunk.m_storage = storage;
+    }
+    return chunk;
+}
+
+// Check for chunk storage used by other buffers
+bool CowBuffer::isShared(size_t index) const
+{
+    const Table& table = *m_table;
+    const std::shared_ptr<uint8_t>& storage = table[index].m_storage;
+    long count = storage.use_count();
+    if (count <= 1) {
+        return false;
+    }
+
+    // Subtract the references held by chunks split from the same storage in this table
+    for (auto& i : table) {
+        if (!i.m_storage.owner_before(storage) && !storage.owner_before(i.m_storage)) {
+            --count;
+        }
+    }
+    return count > 0;
+}
+
+// Split chunk at offset
+void CowBuffer::split(size_t offset)
+{
+    if (offset == 0 || offset >= m_size) {
+        return;
+    }
+    Table& table = *m_table;
+    size_t index = findChunk(offset);
+    Chunk& chunk = table[index];
+    if (chunk.m_offset == offset) {
+        return;
+    }
+
+    // Both parts keep sharing the same storage
+    size_t head = offset - chunk.m_offset;
+    Chunk tail = { offset, chunk.m_size - head, std::shared_ptr<uint8_t>(chunk.m_storage, chunk.m_storage.get() + head),
+                   false };
+    chunk.m_size = head;
+    table.insert(table.begin() + index + 1, tail);
+}
+
+// Allocate chunk storage
+std::shared_ptr<uint8_t> CowBuffer::allocate(size_t size) const
+{
+    ArenaAllocator<uint8_t> allocator(m_arena);
+    StorageDeleter deleter = { allocator, size };
+    return std::shared_ptr<uint8_t>(allocator.allocate(size), deleter, allocator);
+}
+
+} // namespace DMSToolbox
@@ -0,0 +1,468 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <arena.hh>
+#include <memory>
+#include <vector>
+
+namespace DMSToolbox {
+
+/**
+  @ingroup common_group
+
+  Reference-counted copy-on-write buffer.
+
+  The buffer content is kept in chunks with shared storage. Copying a buffer only shares the chunk table, so it is
+  O(1) regardless of the buffer size. Data blocks inside the buffer are registered using map(), which makes sure the
+  block is covered by exactly one chunk and can be accessed as contiguous memory. When a block is written, only the
+  chunk holding it is copied if its storage is shared with another buffer, all other chunks stay shared. Chunk
+  storage and the chunk table are allocated from the buffer's arena, if one is given, and copies of the buffer use
+  the same arena unless another one is given.
+ */
+class CowBuffer {
+    public:
+        /**
+          Reference to a mapped block.
+
+          This is a lightweight handle to a block previously registered with CowBuffer::map(). It stays valid as long
+          as the buffer object it refers to exists, even if the buffer contents are replaced by assignment.
+         */
+        class Ref {
+            public:
+                /**
+                  Create empty reference.
+
+                  Creates a reference not associated with any buffer.
+                 */
+                Ref();
+
+                /**
+                  Create reference.
+
+                  Creates a reference to a mapped block of the given buffer.
+
+                  @param[in]    buffer      Buffer holding the block
+                  @param[in]    offset      Block offset in buffer
+                  @param[in]    size        Block size
+                 */
+                Ref(CowBuffer* buffer, size_t offset, size_t size);
+
+                /**
+                  Create reference by copying.
+
+                  Copies the reference, both references refer to the same buffer and block.
+
+                  @param[in]    source      Source reference to copy from
+                 */
+                Ref(const Ref& source);
+
+                /**
+                  Copy reference.
+
+                  Copies the reference, both references refer to the same buffer and block.
+
+                  @param[in]    source      Source reference to copy from
+
+                  @return                   This object
+                 */
+                Ref& operator=(const Ref& source);
+
+                /**
+                  Get block data.
+
+                  Returns a pointer to the contiguous block data. The pointer is valid until the buffer is modified.
+
+                  @return                   Block data pointer or nullptr if not associated with a buffer
+                 */
+                const uint8_t* data() const;
+
+                /**
+                  Get writable block data.
+
+                  Returns a pointer to the contiguous block data for writing. If the block storage is shared with
+                  another buffer, the block is copied first. The pointer is valid until the buffer is modified.
+
+                  @return                   Writable block data pointer or nullptr if not associated with a buffer
+                 */
+                uint8_t* writable();
+
+                /**
+                  Write block data.
+
+                  Writes the given data to the block if it differs from the current contents. Unchanged blocks are
+                  not copied, so they stay shared with other buffers.
+
+                  @param[in]    data        Data to write
+                  @param[in]    size        Size of data, must not exceed the block size minus offset
+                  @param[in]    offset      Offset inside block to write data to
+
+                  @return                   True if the block contents have been changed
+                 */
+                bool write(const void* data, size_t size, size_t offset = 0);
+
+                /**
+                  Get block offset.
+
+                  Returns the offset of the block in the buffer.
+
+                  @return                   Block offset
+                 */
+                size_t offset() const {
+                    return m_offset;
+                }
+
+                /**
+                  Get block size.
+
+                  Returns the size of the block.
+
+                  @return                   Block size
+                 */
+                size_t size() const {
+                    return m_size;
+                }
+
+                /**
+                  Rebind reference.
+
+                  Associates the reference with the same block in another buffer. This is used when a buffer
+                  has been copied together with the objects referring to it.
+
+                  @param[in]    buffer      Buffer to associate the reference with
+                 */
+                void rebind(CowBuffer& buffer) {
+                    m_buffer = &buffer;
+                }
+
+            private:
+                CowBuffer*      m_buffer;       ///< Buffer holding the block
+                size_t          m_offset;       ///< Block offset
+                size_t          m_size;         ///< Block size
+        };
+
+        /**
+          Create empty buffer.
+
+          Creates a buffer of size zero.
+         */
+        CowBuffer();
+
+        /**
+          Create zero-filled buffer.
+
+          Creates a buffer of the given size with all bytes set to zero.
+
+          @param[in]    size        Buffer size
+          @param[in]    arena       Arena to allocate from, empty to use the global heap
+         */
+        explicit CowBuffer(size_t size, const std::shared_ptr<Arena>& arena = std::shared_ptr<Arena>());
+
+        /**
+          Create buffer from data.
+
+          Creates a buffer holding a copy of the given data.
+
+          @param[in]    data        Data to copy into the buffer
+          @param[in]    size        Size of data
+          @param[in]    arena       Arena to allocate from, empty to use the global heap
+         */
+        CowBuffer(const void* data, size_t size, const std::shared_ptr<Arena>& arena = std::shared_ptr<Arena>());
+
+        /**
+          Create buffer by copying.
+
+          Shares the contents of the source buffer. This is O(1), data is only copied when written.
+
+          @param[in]    source      Source buffer to copy from
+         */
+        CowBuffer(const CowBuffer& source);
+
+        /**
+          Create buffer by copying into another arena.
+
+          Shares the chunk storage of the source buffer, but takes a copy of the chunk table and allocates all
+          further storage from the given arena. Shared storage stays in the arena it was allocated from until the
+          last buffer using it releases it.
+
+          @param[in]    source      Source buffer to copy from
+          @param[in]    arena       Arena to allocate from, empty to use the global heap
+         */
+        CowBuffer(const CowBuffer& source, const std::shared_ptr<Arena>& arena);
+
+        /**
+          Destroy buffer.
+
+          Destroys the buffer, shared storage is released when it is not used anymore.
+         */
+        ~CowBuffer();
+
+        /**
+          Copy buffer.
+
+          Shares the contents of the source buffer. This is O(1), data is only copied when written. Mapped block
+          references into this buffer stay valid, they refer to the new contents afterwards.
+
+          @param[in]    source      Source buffer to copy from
+
+          @return                   This object
+         */
+        CowBuffer& operator=(const CowBuffer& source);
+
+        /**
+          Get buffer size.
+
+          Returns the size of the buffer.
+
+          @return                   Buffer size
+         */
+        size_t size() const {
+            return m_size;
+        }
+
+        /**
+          Get byte.
+
+          Returns the byte at the given offset.
+
+          @param[in]    offset      Offset of byte
+
+          @return                   Byte value
+         */
+        uint8_t operator[](size_t offset) const {
+            return *data(offset);
+        }
+
+        /**
+          Get data pointer.
+
+          Returns a pointer to the data at the given offset. The memory is contiguous up to the end of the chunk
+          holding the offset, so this is only safe for access within mapped blocks. The pointer is valid until the
+          buffer is modified.
+
+          @param[in]    offset      Offset in buffer
+
+          @return                   Data pointer
+         */
+        const uint8_t* data(size_t offset) const;
+
+        /**
+          Get writable data pointer.
+
+          Returns a pointer to the data at the given offset for writing. If the chunk holding the offset is shared
+          with another buffer, it is copied first. The same restrictions as for data() apply.
+
+          @param[in]    offset      Offset in buffer
+
+          @return                   Writable data pointer
+         */
+        uint8_t* writable(size_t offset);
+
+        /**
+          Read data.
+
+          Copies data from the buffer, regardless of chunk boundaries.
+
+          @param[in]    offset      Offset in buffer to read from
+          @param[out]   out         Destination memory
+          @param[in]    size        Number of bytes to read
+         */
+        void read(size_t offset, void* out, size_t size) const;
+
+        /**
+          Write data.
+
+          Copies data into the buffer, regardless of chunk boundaries. Only chunks whose contents actually change
+          are copied.
+
+          @param[in]    offset      Offset in buffer to write to
+          @param[in]    data        Source data
+          @param[in]    size        Number of bytes to write
+
+          @return                   True if the buffer contents have been changed
+         */
+        bool write(size_t offset, const void* data, size_t size);
+
+        /**
+          Map block.
+
+          Registers a block so it is held in one contiguous chunk and returns a reference to it. Overlapping blocks
+          share one chunk. If the block exceeds the buffer, a DataFormatException is thrown.
+
+          @param[in]    offset      Block offset
+          @param[in]    size        Block size
+
+          @return                   Reference to the block
+         */
+        Ref map(size_t offset, size_t size);
+
+        /**
+          Check for shared block storage.
+
+          Returns true if the chunk holding the given offset uses the same storage in both buffers, so the data is
+          known to be identical without comparing it.
+
+          @param[in]    other       Other buffer
+          @param[in]    offset      Offset in both buffers
+
+          @return                   True if storage is shared
+         */
+        bool sharesChunk(const CowBuffer& other, size_t offset) const;
+
+        /**
+          Copy whole buffer contents.
+
+          Copies the contents of the whole buffer to contiguous memory.
+
+          @param[out]   out         Destination memory, must hold size() bytes
+         */
+        void copyTo(void* out) const;
+
+        /**
+          Get number of chunks.
+
+          Returns the number of chunks the buffer is split into.
+
+          @return                   Number of chunks
+         */
+        size_t getNumChunks() const {
+            return m_table->size();
+        }
+
+        /**
+          Get arena.
+
+          Returns the arena used for allocations.
+
+          @return                   Arena or empty pointer if using the global heap
+         */
+        const std::shared_ptr<Arena>& getArena() const {
+            return m_arena;
+        }
+
+    private:
+        /// Chunk of buffer data
+        struct Chunk {
+            size_t                      m_offset;   ///< Offset of chunk in buffer
+            size_t                      m_size;     ///< Size of chunk
+            std::shared_ptr<uint8_t>    m_storage;  ///< Storage, pointing to first byte of chunk
+            bool                        m_mapped;   ///< True if chunk holds mapped blocks and must not be split
+        };
+
+        /// Chunk table type
+        typedef std::vector<Chunk, ArenaAllocator<Chunk>> Table;
+
+        /// Deleter returning chunk storage to the arena
+        struct StorageDeleter {
+            ArenaAllocator<uint8_t>     m_allocator;    ///< Allocator used for the storage
+            size_t                      m_size;         ///< Size of the storage
+
+            /// Free storage
+            void operator()(uint8_t* ptr) {
+                m_allocator.deallocate(ptr, m_size);
+            }
+        };
+
+        std::shared_ptr<Arena>  m_arena;            ///< Arena to allocate from
+        std::shared_ptr<Table>  m_table;            ///< Chunk table, shared between copies
+        size_t                  m_size;             ///< Buffer size
+
+        /**
+          Find chunk.
+
+          Returns the index of the chunk holding the given offset.
+
+          @param[in]    offset      Offset in buffer
+
+          @return                   Chunk index
+         */
+        size_t findChunk(size_t offset) const;
+
+        /**
+          Unshare chunk table.
+
+          Makes sure the chunk table is not shared with other buffers, copying it if needed.
+         */
+        void unshareTable();
+
+        /**
+          Make chunk writable.
+
+          Unshares the table and copies the chunk storage if it is shared.
+
+          @param[in]    index       Chunk index
+
+          @return                   Reference to the writable chunk
+         */
+        Chunk& makeWritable(size_t index);
+
+        /**
+          Check for shared chunk.
+
+          Returns true if the chunk storage is used by another buffer. Chunks split from the same storage in this
+          buffer's table don't count, they never overlap. The table must be unshared.
+
+          @param[in]    index       Chunk index
+
+          @return                   True if shared
+         */
+        bool isShared(size_t index) const;
+
+        /**
+          Split chunk.
+
+          Splits the chunk holding the given offset so a chunk starts at this offset. The table must be unshared.
+
+          @param[in]    offset      Offset to split at
+         */
+        void split(size_t offset);
+
+        /**
+          Allocate storage.
+
+          Allocates storage for a chunk from the buffer's arena.
+
+          @param[in]    size        Storage size
+
+          @return                   Storage pointer
+         */
+        std::shared_ptr<uint8_t> allocate(size_t size) const;
+};
+
+} // namespace DMSToolbox
@@ -0,0 +1,452 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/oscillatorbank.hh>
+#include <synth/wavetableset.hh>
+#include <synth/wavemipmap.hh>
+#include <synth/vcfbank.hh>
+#include <synth/noisebank.hh>
+#include <synth/wersivoice.hh>
+#include <synth/busmixer.hh>
+#include <synth/resampler.hh>
+#include <synth/wavespectrumcache.hh>
+#include <synth/wavesynthesizer.hh>
+#include <synth/instrumentmorph.hh>
+#include <wersi/icb.hh>
+#include <wersi/vcf.hh>
+#include <wersi/wave.hh>
+#include <cowbuffer.hh>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+using namespace std;
+using namespace DMSToolbox;
+using namespace DMSToolbox::Synth;
+
+// Sample rate of all benchmarks
+static const float SampleRate = 48000.0f;
+
+// Frames rendered per block
+static const size_t BlockSize = 64;
+
+// Length of rendered audio in seconds
+static const float Duration = 10.0f;
+
+// Number of distinct waves analyzed, more than a full library of cartridges
+static const size_t LibraryWaves = 4096;
+
+// Voice counts to benchmark
+static const size_t VoiceCounts[] = { 16, 64, 256, 1024 };
+
+// Print benchmark result
+static void report(const char* name, size_t voices, size_t frames, double seconds)
+{
+    double voiceSamples = double(voices) * double(frames);
+    cout << setw(12) << left << name << right
+         << " voices " << setw(5) << voices
+         << " " << setw(8) << fixed << setprecision(2) << seconds * 1e9 / voiceSamples << " ns/voice-sample"
+         << " " << setw(9) << setprecision(1) << double(frames) / SampleRate / seconds << "x realtime"
+         << endl;
+}
+
+// Fill raw wave block with a sawtooth in all ranges
+static void fillSawtooth(uint8_t* raw)
+{
+    const size_t lengths[] = { 64, 64, 32, 16 };
+    raw[0] = 0x7f;
+    size_t pos = 1;
+    for (size_t range = 0; range < 4; ++range) {
+        for (size_t i = 0; i < lengths[range]; ++i) {
+            raw[pos++] = uint8_t(i * 256 / lengths[range]);
+        }
+    }
+}
+
+// Benchmark oscillator bank, playing band-limited tables if given
+static void benchOscillators(const WaveTableSet& tables, const WaveMipmap* mipmap, size_t voices)
+{
+    OscillatorBank bank(voices, SampleRate);
+    for (size_t v = 0; v < voices; ++v) {
+        uint8_t note = uint8_t(36 + v % 60);
+        WaveTableSet::Range range = WaveTableSet::getRange(note);
+        float frequency = 440.0f * pow(2.0f, (float(note) - 69.0f) / 12.0f);
+        if (mipmap != nullptr) {
+            bank.start(v, mipmap->getTable(range, frequency / SampleRate), WaveMipmap::TableLength, frequency,
+                       1.0f / float(voices));
+        }
+        else {
+            bank.start(v, tables.getTable(range), WaveTableSet::getLength(range), frequency, 1.0f / float(voices));
+        }
+    }
+
+    vector<float> out(bank.getNumVoices() * BlockSize);
+    size_t frames = size_t(Duration * SampleRate);
+    auto begin = chrono::steady_clock::now();
+    for (size_t done = 0; done < frames; done += BlockSize) {
+        bank.render(out.data(), BlockSize);
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - begin;
+    report(mipmap != nullptr ? "mipmap" : "oscillator", voices, frames, elapsed.count());
+}
+
+// Start voices of an oscillator bank with one of the wave's tables per note
+template<typename Arith, typename GetTable>
+static void startVoices(BasicOscillatorBank<Arith>& bank, size_t voices, GetTable getTable)
+{
+    for (size_t v = 0; v < voices; ++v) {
+        uint8_t note = uint8_t(36 + v % 60);
+        WaveTableSet::Range range = WaveTableSet::getRange(note);
+        float frequency = 440.0f * pow(2.0f, (float(note) - 69.0f) / 12.0f);
+        bank.start(v, getTable(range), WaveTableSet::getLength(range), frequency, 1.0f / float(voices));
+    }
+}
+
+// Render mix of all voices of an oscillator bank, returns the render time
+template<typename Arith>
+static double renderMix(BasicOscillatorBank<Arith>& bank, vector<float>& mix)
+{
+    vector<float> out(bank.getNumVoices() * BlockSize);
+    chrono::duration<double> elapsed(0.0);
+    for (size_t done = 0; done + BlockSize <= mix.size(); done += BlockSize) {
+        auto begin = chrono::steady_clock::now();
+        bank.render(out.data(), BlockSize);
+        elapsed += chrono::steady_clock::now() - begin;
+        for (size_t i = 0; i < out.size(); ++i) {
+            mix[done + (i / 4) % BlockSize] += out[i];
+        }
+    }
+    return elapsed.count();
+}
+
+// Compare fixed and float oscillator kernels in speed and deviation of the mixed output
+static void compareArith(const Wersi::Wave& wave, const WaveTableSet& tables, size_t voices)
+{
+    size_t frames = size_t(Duration * SampleRate) / BlockSize * BlockSize;
+
+    OscillatorBank floatBank(voices, SampleRate);
+    startVoices(floatBank, voices, [&tables](WaveTableSet::Range range) { return tables.getTable(range); });
+    vector<float> floatMix(frames, 0.0f);
+    report("float", voices, frames, renderMix(floatBank, floatMix));
+
+    FixedOscillatorBank fixedBank(voices, SampleRate);
+    startVoices(fixedBank, voices, [&wave](WaveTableSet::Range range) {
+        return WaveTableSet::getRawTable(wave, range);
+    });
+    vector<float> fixedMix(frames, 0.0f);
+    report("fixed", voices, frames, renderMix(fixedBank, fixedMix));
+
+    double signal = 0.0;
+    double error = 0.0;
+    double peak = 0.0;
+    for (size_t i = 0; i < frames; ++i) {
+        double difference = double(fixedMix[i]) - double(floatMix[i]);
+        signal += double(floatMix[i]) * double(floatMix[i]);
+        error += difference * difference;
+        peak = max(peak, fabs(difference));
+    }
+    cout << setw(12) << left << "deviation" << right
+         << " voices " << setw(5) << voices
+         << " " << setw(8) << fixed << setprecision(1) << 10.0 * log10(error / signal) << " dB rms"
+         << " " << setw(9) << setprecision(5) << peak << " peak" << endl;
+}
+
+// Benchmark VCF bank with all filter types and envelope modes
+static void benchVcf(const WaveTableSet& tables, size_t voices)
+{
+    // LP 2 poles T1, LP 4 poles T1->T2, BP 2 poles T1->Release->T2, BP 4 poles rotor, with distortion on the last
+    uint8_t raw[4][10] = {
+        { 0x07, 0x00, 0x80, 0x00, 0x40, 0x40, 0x20, 0xf0, 0x00, 0x00 },
+        { 0x0f, 0x10, 0xc0, 0x20, 0x40, 0x80, 0x30, 0xe0, 0xf0, 0x10 },
+        { 0x03, 0xf0, 0x40, 0x40, 0x20, 0x60, 0x10, 0x00, 0xf0, 0x00 },
+        { 0x4b, 0x00, 0xe0, 0xe0, 0x30, 0x30, 0x18, 0xf4, 0xe8, 0x0c }
+    };
+    CowBuffer buffer(raw, sizeof(raw));
+    VcfSettings settings[4];
+    for (size_t i = 0; i < 4; ++i) {
+        settings[i] = VcfBank::compile(Wersi::Vcf(uint8_t(i), buffer.map(i * 10, 10)));
+    }
+
+    OscillatorBank bank(voices, SampleRate);
+    VcfBank vcf(voices, SampleRate);
+    for (size_t v = 0; v < voices; ++v) {
+        uint8_t note = uint8_t(36 + v % 60);
+        WaveTableSet::Range range = WaveTableSet::getRange(note);
+        float frequency = 440.0f * pow(2.0f, (float(note) - 69.0f) / 12.0f);
+        bank.start(v, tables.getTable(range), WaveTableSet::getLength(range), frequency, 1.0f / float(voices));
+        vcf.start(v, settings[v % 4], note);
+    }
+
+    // Only the filter is timed
+    vector<float> out(bank.getNumVoices() * BlockSize);
+    size_t frames = size_t(Duration * SampleRate);
+    chrono::duration<double> elapsed(0.0);
+    for (size_t done = 0; done < frames; done += BlockSize) {
+        bank.render(out.data(), BlockSize);
+        auto begin = chrono::steady_clock::now();
+        vcf.process(out.data(), BlockSize);
+        elapsed += chrono::steady_clock::now() - begin;
+        if (done == frames / 2) {
+            for (size_t v = 0; v < voices; ++v) {
+                vcf.release(v);
+            }
+        }
+    }
+    report("vcf", voices, frames, elapsed.count());
+}
+
+// Benchmark noise generators of all types
+static void benchNoise(size_t voices)
+{
+    NoiseBank noise(voices, SampleRate);
+    for (size_t v = 0; v < voices; ++v) {
+        noise.start(v, static_cast<Wersi::Vcf::NoiseType>(v % 3), 440.0f, uint32_t(v), 1.0f / float(voices));
+    }
+
+    vector<float> out(noise.getNumVoices() * BlockSize);
+    size_t frames = size_t(Duration * SampleRate);
+    auto begin = chrono::steady_clock::now();
+    for (size_t done = 0; done < frames; done += BlockSize) {
+        noise.mix(out.data(), BlockSize);
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - begin;
+    report("noise", voices, frames, elapsed.count());
+}
+
+// Benchmark WersiVoice processor in all modes, it runs once on the shared WV bus
+static void benchWersiVoice()
+{
+    vector<float> in(BlockSize);
+    vector<float> left(BlockSize);
+    vector<float> right(BlockSize);
+    for (size_t i = 0; i < BlockSize; ++i) {
+        in[i] = float(i) / float(BlockSize) - 0.5f;
+    }
+
+    const Wersi::Icb::WvMode modes[] = {
+        Wersi::Icb::WvMode::RotorSlow, Wersi::Icb::WvMode::RotorFast, Wersi::Icb::WvMode::Flanger,
+        Wersi::Icb::WvMode::Strings, Wersi::Icb::WvMode::Chorus
+    };
+    WersiVoice wv(SampleRate);
+    size_t frames = size_t(Duration * SampleRate);
+    chrono::duration<double> elapsed(0.0);
+    for (Wersi::Icb::WvMode mode : modes) {
+        wv.configure(mode, true, true, true, false);
+        auto begin = chrono::steady_clock::now();
+        for (size_t done = 0; done < frames; done += BlockSize) {
+            wv.process(in.data(), left.data(), right.data(), BlockSize);
+        }
+        elapsed += chrono::steady_clock::now() - begin;
+    }
+    report("wersivoice", 1, frames * (sizeof(modes) / sizeof(modes[0])), elapsed.count());
+}
+
+// Benchmark bus mixer with voices spread over all buses and both stages
+static void benchMixer(size_t voices)
+{
+    BusMixer mixer(voices, BlockSize);
+    for (size_t v = 0; v < voices; ++v) {
+        BusMixer::Route route = BusMixer::getSilentRoute();
+        route.m_gain[v % BusMixer::NumStages][v % BusMixer::NumBuses] = 1.0f;
+        route.m_gain[(v / 2) % BusMixer::NumStages][(v + 1) % BusMixer::NumBuses] = 0.5f;
+        mixer.setRoute(v, route);
+    }
+
+    vector<float> in(((voices + 3) & ~size_t(3)) * BlockSize, 0.25f);
+    size_t frames = size_t(Duration * SampleRate);
+    auto begin = chrono::steady_clock::now();
+    for (size_t done = 0; done < frames; done += BlockSize) {
+        mixer.clear(BlockSize);
+        mixer.mix(BusMixer::Stage::Direct, in.data(), BlockSize);
+        mixer.mix(BusMixer::Stage::Filtered, in.data(), BlockSize);
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - begin;
+    report("mixer", voices, frames, elapsed.count());
+}
+
+// Benchmark sample rate conversion of a stereo stream, channels are reported as voices
+static void benchResampler(const char* name, Resampler::Quality quality, float outputRate)
+{
+    vector<float> left(BlockSize);
+    vector<float> right(BlockSize);
+    for (size_t i = 0; i < BlockSize; ++i) {
+        left[i] = sinf(float(i) * 0.3f);
+        right[i] = -left[i];
+    }
+
+    Resampler resampler(SampleRate, outputRate, quality);
+    vector<float> outLeft(resampler.getMaxOutput(BlockSize));
+    vector<float> outRight(outLeft.size());
+    size_t frames = size_t(Duration * SampleRate);
+    auto begin = chrono::steady_clock::now();
+    for (size_t done = 0; done < frames; done += BlockSize) {
+        resampler.process(left.data(), right.data(), BlockSize, outLeft.data(), outRight.data());
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - begin;
+    report(name, 2, frames, elapsed.count());
+}
+
+// Benchmark spectrum analysis of a library of distinct waves, then of the same waves from the cache
+static void benchSpectrum()
+{
+    const size_t blockSize = 212;
+    vector<uint8_t> raw(LibraryWaves * blockSize);
+    for (size_t w = 0; w < LibraryWaves; ++w) {
+        fillSawtooth(&(raw[w * blockSize]));
+        raw[w * blockSize + 1 + w % 176] ^= uint8_t(1 + w / 176);
+    }
+    CowBuffer buffer(raw.data(), raw.size());
+    vector<Wersi::Wave> waves;
+    waves.reserve(LibraryWaves);
+    for (size_t w = 0; w < LibraryWaves; ++w) {
+        waves.push_back(Wersi::Wave(uint8_t(w), buffer.map(w * blockSize, blockSize), blockSize));
+    }
+
+    WaveSpectrumCache cache(LibraryWaves);
+    for (size_t pass = 0; pass < 2; ++pass) {
+        auto begin = chrono::steady_clock::now();
+        for (const Wersi::Wave& wave : waves) {
+            cache.get(wave);
+        }
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - begin;
+        cout << setw(12) << left << (pass == 0 ? "spectrum" : "spectrum-hit") << right
+             << " waves  " << setw(5) << LibraryWaves
+             << " " << setw(8) << fixed << setprecision(2) << elapsed.count() * 1e6 / double(LibraryWaves)
+             << " us/wave" << endl;
+    }
+}
+
+// Benchmark additive synthesis of a library of waves with noise shaping
+static void benchSynthesis()
+{
+    const size_t blockSize = 212;
+    vector<uint8_t> raw(blockSize, 0);
+    CowBuffer buffer(raw.data(), raw.size());
+    Wersi::Wave wave(0, buffer.map(0, blockSize), blockSize);
+
+    WaveSynthesizer synthesizer(WaveSynthesizer::Quantization::NoiseShaped, true);
+    vector<WaveSynthesizer::Harmonic> harmonics(WaveSpectrum::MaxHarmonics);
+    auto begin = chrono::steady_clock::now();
+    for (size_t w = 0; w < LibraryWaves; ++w) {
+        for (size_t h = 1; h < harmonics.size(); ++h) {
+            harmonics[h].m_magnitude = 1.0f / float(h + w % 7);
+            harmonics[h].m_phase = float(w % 5) * float(h);
+        }
+        synthesizer.synthesize(harmonics, wave);
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - begin;
+    cout << setw(12) << left << "synthesis" << right
+         << " waves  " << setw(5) << LibraryWaves
+         << " " << setw(8) << fixed << setprecision(2) << elapsed.count() * 1e6 / double(LibraryWaves)
+         << " us/wave" << endl;
+}
+
+// Benchmark rendering intermediate instruments of a morph
+static void benchMorph(const Wersi::Wave& from)
+{
+    const size_t numFrames = 100000;
+    vector<uint8_t> raw(2 * (16 + 10) + 212, 0);
+    CowBuffer buffer(raw.data(), raw.size());
+    Wersi::Icb icb(0, buffer.map(0, 16));
+    Wersi::Vcf vcf(0, buffer.map(16, 10));
+    Wersi::Icb toIcb(1, buffer.map(26, 16));
+    Wersi::Vcf toVcf(1, buffer.map(42, 10));
+    Wersi::Wave to(1, buffer.map(52, 212), 212);
+
+    InstrumentMorph morph(icb, vcf, from, toIcb, toVcf, to);
+    InstrumentMorph::Frame frame;
+    auto begin = chrono::steady_clock::now();
+    for (size_t i = 0; i < numFrames; ++i) {
+        morph.render(float(i) / float(numFrames), frame);
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - begin;
+    cout << setw(12) << left << "morph" << right
+         << " frames " << setw(6) << numFrames
+         << " " << setw(8) << fixed << setprecision(3) << elapsed.count() * 1e6 / double(numFrames)
+         << " us/frame" << endl;
+}
+
+// Main function
+int main()
+{
+    uint8_t raw[212] = { 0 };
+    fillSawtooth(raw);
+    CowBuffer buffer(raw, sizeof(raw));
+    Wersi::Wave wave(0, buffer.map(0, sizeof(raw)), sizeof(raw));
+    WaveTableSet tables(wave);
+    WaveMipmap mipmap(wave);
+
+    for (size_t voices : VoiceCounts) {
+        benchOscillators(tables, nullptr, voices);
+    }
+    for (size_t voices : VoiceCounts) {
+        benchOscillators(tables, &mipmap, voices);
+    }
+    for (size_t voices : VoiceCounts) {
+        compareArith(wave, tables, voices);
+    }
+    for (size_t voices : VoiceCounts) {
+        benchVcf(tables, voices);
+    }
+    for (size_t voices : VoiceCounts) {
+        benchNoise(voices);
+    }
+    benchWersiVoice();
+    for (size_t voices : VoiceCounts) {
+        benchMixer(voices);
+    }
+
+    benchSpectrum();
+    benchSynthesis();
+    benchMorph(wave);
+
+    // Conversion down to CD rate and up to 96 kHz
+    const Resampler::Quality qualities[] = {
+        Resampler::Quality::Fast, Resampler::Quality::Medium, Resampler::Quality::Best
+    };
+    const char* const downNames[] = { "down-fast", "down-medium", "down-best" };
+    const char* const upNames[] = { "up-fast", "up-medium", "up-best" };
+    for (size_t q = 0; q < sizeof(qualities) / sizeof(qualities[0]); ++q) {
+        benchResampler(downNames[q], qualities[q], 44100.0f);
+    }
+    for (size_t q = 0; q < sizeof(qualities) / sizeof(qualities[0]); ++q) {
+        benchResampler(upNames[q], qualities[q], 96000.0f);
+    }
+    return 0;
+}
@@ -39,25 +39,108 @@
 #include <wersi/dx10cartridge.hh>
 #include <wersi/icb.hh>
 #include <wersi/vcf.hh>
+#include <wersi/envelope.hh>
+#include <wersi/wave.hh>
+#include <synth/wavespectrumcache.hh>
 #include <exceptions.hh>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <string>
+#include <vector>
 
 using namespace std;
 using namespace DMSToolbox;
 using namespace DMSToolbox::Wersi;
+using namespace DMSToolbox::Synth;
+
+// Lowest printed harmonic level in dB, quieter harmonics are shown as this
+static const float FloorLevel = -99.0f;
+
+// Print disassembled envelope program
+static void printEnvelope(const char* name, const Envelope* env)
+{
+    if (env == nullptr) {
+        return;
+    }
+    cout << "   " << name << " A ";
+    if (env->getAttackEntry() != Envelope::NoTarget) {
+        cout << setw(2) << env->getAttackEntry();
+    }
+    else {
+        cout << "??";
+    }
+    cout << " R ";
+    if (env->getReleaseEntry() != Envelope::NoTarget) {
+        cout << setw(2) << env->getReleaseEntry();
+    }
+    else {
+        cout << "??";
+    }
+    cout << ":";
+    size_t idx = 0;
+    for (auto& i : env->getProgram()) {
+        cout << " " << idx << "=" << Envelope::getOpcodeName(i.m_opcode);
+        if (i.m_target != Envelope::NoTarget) {
+            cout << " @" << i.m_target;
+        }
+        for (size_t j = 1; j < Envelope::getInstructionSize(i.m_opcode); ++j) {
+            cout << " " << hex << setw(2) << setfill('0') << uint16_t(i.m_bytes[j]) << setfill(' ') << dec;
+        }
+        if (i.m_opcode == Envelope::Opcode::Raw) {
+            cout << " " << hex << setw(2) << setfill('0') << uint16_t(i.m_bytes[0]) << setfill(' ') << dec;
+        }
+        ++idx;
+    }
+    cout << endl;
+}
+
+// Print harmonic levels of all wave blocks, equal waves are analyzed once
+static void printSpectra(InstrumentStore& is)
+{
+    WaveSpectrumCache cache;
+    size_t numWaves = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (size_t block = 0; block < 256; ++block) {
+        const Wave* wave = is.getWave(uint8_t(block));
+        if (wave == nullptr) {
+            continue;
+        }
+        shared_ptr<const WaveSpectrum> spectrum = cache.get(*wave);
+        ++numWaves;
+
+        cout << "WAVE " << setw(3) << block << ": Level " << setw(3) << uint16_t(wave->getLevel())
+             << (wave->getFixedFormants() ? " fixed" : " relative") << " formants" << endl;
+        for (size_t r = 0; r < WaveTableSet::NumRanges; ++r) {
+            WaveTableSet::Range range = static_cast<WaveTableSet::Range>(r);
+            cout << "   " << setw(7) << left << WaveTableSet::getRangeName(range) << right << " dB";
+            for (size_t h = 1; h < WaveSpectrum::getNumHarmonics(range); ++h) {
+                float magnitude = spectrum->getMagnitude(range, h);
+                float level = magnitude > 0.0f ? 20.0f * log10(magnitude) : FloorLevel;
+                cout << " " << setw(3) << int(lround(max(level, FloorLevel)));
+            }
+            cout << endl;
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Analyzed " << numWaves << " wave(s), " << cache.getSize() << " distinct, in " << fixed
+         << setprecision(2) << seconds * 1000.0 << " ms" << endl;
+}
 
 int main(int argc, char** argv)
 {
     // Check arguments
-    if (argc != 2) {
-        cerr << "Usage: " << argv[0] << " <filename>" << endl;
+    bool spectra = argc == 3 && string(argv[1]) == "-s";
+    if (argc != 2 && !spectra) {
+        cerr << "Usage: " << argv[0] << " [-s] <filename>" << endl
+             << "  -s               Print harmonic levels of all waves" << endl;
         return 1;
     }
 
     // Open and check input file
-    ifstream f(argv[1], ios::binary);
+    ifstream f(argv[argc - 1], ios::binary);
     if (!f) {
         cerr << "Cannot open input file" << endl;
         return 2;
@@ -70,18 +153,18 @@ int main(int argc, char** argv)
         return 3;
     }
 
-    char* buf = new char[size];
-    f.read(buf, size);
+    vector<char> buf(size);
+    f.read(buf.data(), size);
 
     InstrumentStore* is = nullptr;
     try {
-        is = new Mk1Cartridge(buf);
+        is = new Mk1Cartridge(buf.data(), size);
         cout << "Detected MK1 cartridge" << endl;
     }
     catch (DataFormatException& e) {
         string mk1Error = e.what();
         try {
-            is = new Dx10Cartridge(buf, size);
+            is = new Dx10Cartridge(buf.data(), size);
             cout << "Detected DX10/DX5 cartridge" << endl;
         }
         catch (DataFormatException& e) {
@@ -144,12 +227,19 @@ int main(int argc, char** argv)
                      << " U " << hex << setw(2) << uint16_t(vcf->getUnknownBits()) << dec
                      << endl;
             }
+            printEnvelope("AMPL", is->getAmpl(icb.getAmplBlock()));
+            printEnvelope("FREQ", is->getFreq(icb.getFreqBlock()));
+        }
+        if (spectra) {
+            printSpectra(*is);
         }
 
+        const Arena& arena = is->getArena();
+        cout << "Memory: " << arena.getUsed() << " bytes used, " << arena.getPeak() << " bytes peak, "
+             << arena.getCapacity() << " bytes reserved in " << arena.getNumBlocks() << " block(s)" << endl;
+
         delete is;
     }
 
-    delete[] buf;
-
     return 0;
 }
@@ -0,0 +1,256 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/wavefitter.hh>
+#include <synth/wavreader.hh>
+#include <synth/threadpool.hh>
+#include <wersi/mk1cartridge.hh>
+#include <wersi/dx10cartridge.hh>
+#include <wersi/wave.hh>
+#include <exceptions.hh>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+using namespace std;
+using namespace DMSToolbox;
+using namespace DMSToolbox::Synth;
+using namespace DMSToolbox::Wersi;
+
+// Default start of the analyzed part in seconds
+static const float DefaultStart = 0.2f;
+
+// Default length of the analyzed part in seconds
+static const float DefaultLength = 1.0f;
+
+// Default number of periods per analysis frame
+static const size_t DefaultPeriods = 4;
+
+// Print usage
+static void usage(const char* name)
+{
+    cerr << "Usage: " << name << " [options] <cartridge> <wave> <recording.wav>..." << endl
+         << "Fits the tables and level of a WAVE block to recorded notes, each note range takes the recording" << endl
+         << "nearest in pitch" << endl
+         << "  -o <file>        Output cartridge, may be the input (default only report the fit)" << endl
+         << "  -s <seconds>     Start of analyzed part, skipping the attack (default " << DefaultStart << ")" << endl
+         << "  -l <seconds>     Length of analyzed part, 0 up to the end (default " << DefaultLength << ")" << endl
+         << "  -p <periods>     Periods per analysis frame (default " << DefaultPeriods << ")" << endl
+         << "  -f <hz>          Fundamental frequency (default detect per recording)" << endl
+         << "  -q <mode>        Quantization, round or shaped (default shaped)" << endl
+         << "  -j <threads>     Number of threads (default all cores)" << endl;
+}
+
+// Read whole file
+static bool readFile(const string& filename, vector<char>& buf)
+{
+    ifstream f(filename.c_str(), ios::binary);
+    if (!f) {
+        cerr << filename << ": Cannot open input file" << endl;
+        return false;
+    }
+    f.seekg(0, ios::end);
+    size_t size = size_t(f.tellg());
+    f.seekg(0, ios::beg);
+    if (size > 1024 * 1024) {
+        cerr << filename << ": Input file too large" << endl;
+        return false;
+    }
+
+    buf.resize(size);
+    f.read(buf.data(), size);
+    return true;
+}
+
+// Load cartridge file
+static InstrumentStore* loadCartridge(const string& filename)
+{
+    vector<char> buf;
+    if (!readFile(filename, buf)) {
+        return nullptr;
+    }
+
+    size_t size = buf.size();
+    try {
+        return new Mk1Cartridge(buf.data(), size);
+    }
+    catch (DataFormatException& e) {
+        string mk1Error = e.what();
+        try {
+            return new Dx10Cartridge(buf.data(), size);
+        }
+        catch (DataFormatException& e) {
+            cerr << filename << ": Cartridge is neither MK1 nor DX10/DX5 format" << endl;
+            cerr << "MK1 error: " << mk1Error << endl;
+            cerr << "DX10/DX5 error: " << e.what() << endl;
+        }
+    }
+    catch (Exception& e) {
+        cerr << filename << ": " << e.what() << endl;
+    }
+    return nullptr;
+}
+
+int main(int argc, char** argv)
+{
+    // Parse options
+    WaveFitter::Settings settings = { DefaultStart, DefaultLength, DefaultPeriods, 0.0f };
+    WaveSynthesizer::Quantization quantization = WaveSynthesizer::Quantization::NoiseShaped;
+    size_t numThreads = 0;
+    string outFile;
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+        string option = argv[arg];
+        if (option.size() != 2 || arg + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        string value = argv[++arg];
+        bool valid = true;
+        switch (option[1]) {
+            case 'o':
+                outFile = value;
+                break;
+            case 's':
+                settings.m_start = float(atof(value.c_str()));
+                valid = settings.m_start >= 0.0f;
+                break;
+            case 'l':
+                settings.m_length = float(atof(value.c_str()));
+                valid = settings.m_length >= 0.0f;
+                break;
+            case 'p':
+                settings.m_periods = size_t(atoi(value.c_str()));
+                valid = settings.m_periods >= 2;
+                break;
+            case 'f':
+                settings.m_frequency = float(atof(value.c_str()));
+                valid = settings.m_frequency > 0.0f;
+                break;
+            case 'q':
+                valid = value == "round" || value == "shaped";
+                quantization = value == "round" ? WaveSynthesizer::Quantization::Round
+                                                : WaveSynthesizer::Quantization::NoiseShaped;
+                break;
+            case 'j':
+                numThreads = size_t(atoi(value.c_str()));
+                valid = numThreads > 0;
+                break;
+            default:
+                valid = false;
+                break;
+        }
+        if (!valid) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - arg < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    string cartridgeFile = argv[arg];
+    int block = atoi(argv[arg + 1]);
+
+    unique_ptr<InstrumentStore> store(loadCartridge(cartridgeFile));
+    if (store == nullptr) {
+        return 2;
+    }
+    Wave* wave = block >= 0 && block < 256 ? store->getWave(uint8_t(block)) : nullptr;
+    if (wave == nullptr) {
+        cerr << cartridgeFile << ": No WAVE block " << argv[arg + 1] << endl;
+        return 2;
+    }
+
+    // Recordings are analyzed one after the other, each one on all threads
+    ThreadPool pool(numThreads);
+    WaveFitter fitter(pool, settings);
+    vector<WaveFitter::Analysis> analyses;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (arg += 2; arg < argc; ++arg) {
+        try {
+            WavReader reader(argv[arg]);
+            WaveFitter::Analysis analysis = fitter.analyze(reader.getMix(), float(reader.getSampleRate()));
+            cout << argv[arg] << ": " << fixed << setprecision(1) << analysis.m_frequency << " Hz, note "
+                 << unsigned(analysis.m_note) << ", " << analysis.m_harmonics.size() - 1 << " harmonics in "
+                 << analysis.m_numFrames << " frames, residual " << analysis.m_residual << " dB" << endl;
+            analyses.push_back(analysis);
+        }
+        catch (Exception& e) {
+            cerr << argv[arg] << ": " << e.what() << endl;
+            return 3;
+        }
+    }
+
+    WaveFitter::fit(analyses, quantization, *wave);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "WAVE " << block << ": level " << unsigned(wave->getLevel()) << ", fitted in " << setprecision(2)
+         << seconds << " s on " << pool.getNumThreads() << " thread(s)" << endl;
+
+    if (outFile.empty()) {
+        return 0;
+    }
+
+    // Write back the whole cartridge
+    try {
+        store->update();
+        vector<char> buf(store->getBuffer().size());
+        store->getBuffer().copyTo(buf.data());
+        ofstream f(outFile.c_str(), ios::binary | ios::trunc);
+        f.write(buf.data(), streamsize(buf.size()));
+        f.close();
+        if (!f) {
+            throw SystemException("Unable to write file " + outFile);
+        }
+    }
+    catch (Exception& e) {
+        cerr << outFile << ": " << e.what() << endl;
+        return 3;
+    }
+
+    // Make sure the written cartridge loads again
+    unique_ptr<InstrumentStore> written(loadCartridge(outFile));
+    if (written == nullptr) {
+        cerr << outFile << ": Written cartridge does not load" << endl;
+        return 3;
+    }
+    return 0;
+}
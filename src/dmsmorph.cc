@@ -0,0 +1,280 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/instrumentmorph.hh>
+#include <synth/morphstreamer.hh>
+#include <wersi/mk1cartridge.hh>
+#include <wersi/dx10cartridge.hh>
+#include <wersi/icb.hh>
+#include <wersi/vcf.hh>
+#include <wersi/wave.hh>
+#include <wersi/sysex.hh>
+#include <exceptions.hh>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#ifdef HAVE_RTMIDI
+#include <RtMidi.h>
+#endif // HAVE_RTMIDI
+
+using namespace std;
+using namespace DMSToolbox;
+using namespace DMSToolbox::Synth;
+using namespace DMSToolbox::Wersi;
+
+// Default morph duration in seconds
+static const double DefaultDuration = 4.0;
+
+// Default rate of morph position updates in Hz
+static const double DefaultUpdateRate = 100.0;
+
+// Default device type
+static const uint8_t DefaultDevice = 1;
+
+// Print usage
+static void usage(const char* name)
+{
+    cerr << "Usage: " << name << " [options] <cartridge> <from ICB> <to ICB>" << endl
+         << "Morphs from one instrument to another, streaming the intermediate blocks into the slots of the first" << endl
+         << "instrument at the rate the MIDI link allows" << endl
+#ifdef HAVE_RTMIDI
+         << "  -p <port>        MIDI output port number" << endl
+#endif // HAVE_RTMIDI
+         << "  -o <file>        Write the SysEx stream to a file instead, paced as on the link" << endl
+         << "  -d <type>        Device type (default " << unsigned(DefaultDevice) << ")" << endl
+         << "  -t <seconds>     Morph duration (default " << DefaultDuration << ")" << endl
+         << "  -u <hz>          Rate of morph position updates (default " << DefaultUpdateRate << ")" << endl;
+}
+
+// Read whole file
+static bool readFile(const string& filename, vector<char>& buf)
+{
+    ifstream f(filename.c_str(), ios::binary);
+    if (!f) {
+        cerr << filename << ": Cannot open input file" << endl;
+        return false;
+    }
+    f.seekg(0, ios::end);
+    size_t size = size_t(f.tellg());
+    f.seekg(0, ios::beg);
+    if (size > 1024 * 1024) {
+        cerr << filename << ": Input file too large" << endl;
+        return false;
+    }
+
+    buf.resize(size);
+    f.read(buf.data(), size);
+    return true;
+}
+
+// Load cartridge file
+static InstrumentStore* loadCartridge(const string& filename)
+{
+    vector<char> buf;
+    if (!readFile(filename, buf)) {
+        return nullptr;
+    }
+
+    size_t size = buf.size();
+    try {
+        return new Mk1Cartridge(buf.data(), size);
+    }
+    catch (DataFormatException& e) {
+        string mk1Error = e.what();
+        try {
+            return new Dx10Cartridge(buf.data(), size);
+        }
+        catch (DataFormatException& e) {
+            cerr << filename << ": Cartridge is neither MK1 nor DX10/DX5 format" << endl;
+            cerr << "MK1 error: " << mk1Error << endl;
+            cerr << "DX10/DX5 error: " << e.what() << endl;
+        }
+    }
+    catch (Exception& e) {
+        cerr << filename << ": " << e.what() << endl;
+    }
+    return nullptr;
+}
+
+// Look up ICB with its VCF and WAVE, print error if incomplete
+static bool findInstrument(InstrumentStore& store, const char* arg, Icb*& icb, Vcf*& vcf, Wave*& wave)
+{
+    int num = atoi(arg);
+    icb = num >= 0 && num < 256 ? store.getIcb(uint8_t(num)) : nullptr;
+    vcf = icb != nullptr ? store.getVcf(icb->getVcfBlock()) : nullptr;
+    wave = icb != nullptr ? store.getWave(icb->getWaveBlock()) : nullptr;
+    if (icb == nullptr || vcf == nullptr || wave == nullptr) {
+        cerr << "ICB " << arg << ": No instrument with VCF and WAVE block" << endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    // Parse options
+    double duration = DefaultDuration;
+    double updateRate = DefaultUpdateRate;
+    int device = DefaultDevice;
+    int port = -1;
+    string outFile;
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+        string option = argv[arg];
+        if (option.size() != 2 || arg + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        string value = argv[++arg];
+        bool valid = true;
+        switch (option[1]) {
+#ifdef HAVE_RTMIDI
+            case 'p':
+                port = atoi(value.c_str());
+                valid = port >= 0;
+                break;
+#endif // HAVE_RTMIDI
+            case 'o':
+                outFile = value;
+                break;
+            case 'd':
+                device = atoi(value.c_str());
+                valid = device > 0 && device < 128;
+                break;
+            case 't':
+                duration = atof(value.c_str());
+                valid = duration > 0.0;
+                break;
+            case 'u':
+                updateRate = atof(value.c_str());
+                valid = updateRate > 0.0;
+                break;
+            default:
+                valid = false;
+                break;
+        }
+        if (!valid) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - arg != 3 || (port < 0) == outFile.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    unique_ptr<InstrumentStore> store(loadCartridge(argv[arg]));
+    if (store == nullptr) {
+        return 2;
+    }
+    Icb* fromIcb;
+    Vcf* fromVcf;
+    Wave* fromWave;
+    Icb* toIcb;
+    Vcf* toVcf;
+    Wave* toWave;
+    if (!findInstrument(*store, argv[arg + 1], fromIcb, fromVcf, fromWave) ||
+            !findInstrument(*store, argv[arg + 2], toIcb, toVcf, toWave)) {
+        return 2;
+    }
+    InstrumentMorph morph(*fromIcb, *fromVcf, *fromWave, *toIcb, *toVcf, *toWave);
+
+    // Open output
+    MorphStreamer::Sender sender;
+    ofstream file;
+#ifdef HAVE_RTMIDI
+    RtMidiOut midi;
+#endif // HAVE_RTMIDI
+    if (!outFile.empty()) {
+        file.open(outFile.c_str(), ios::binary | ios::trunc);
+        if (!file) {
+            cerr << outFile << ": Cannot open output file" << endl;
+            return 2;
+        }
+        sender = [&file](vector<unsigned char>& message) {
+            file.write(reinterpret_cast<const char*>(message.data()), streamsize(message.size()));
+        };
+    }
+#ifdef HAVE_RTMIDI
+    else {
+        try {
+            midi.openPort(unsigned(port), "DMS-Toolbox:Morph");
+        }
+        catch (RtMidiError& e) {
+            cerr << "Cannot open MIDI port " << port << ": " << e.getMessage() << endl;
+            return 2;
+        }
+        sender = [&midi](vector<unsigned char>& message) {
+            midi.sendMessage(&message);
+        };
+    }
+#endif // HAVE_RTMIDI
+
+    // Sweep the morph position at the update rate, the streamer drops what the link can't carry
+    size_t posted = 0;
+    try {
+        MorphStreamer streamer(sender, uint8_t(device), uint8_t(atoi(argv[arg + 1])), fromIcb->getVcfBlock(),
+                               fromIcb->getWaveBlock(), morph.getWaveSize(), SysEx::LinkRate);
+        InstrumentMorph::Frame frame;
+        size_t numUpdates = size_t(duration * updateRate);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (size_t i = 0; i <= numUpdates; ++i) {
+            this_thread::sleep_until(start + chrono::duration_cast<chrono::steady_clock::duration>(
+                                         chrono::duration<double>(double(i) / updateRate)));
+            morph.render(float(double(i) / double(numUpdates)), frame);
+            streamer.post(frame);
+            ++posted;
+        }
+        streamer.flush();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        cout << posted << " updates, " << streamer.getNumSent() << " frames sent, " << streamer.getNumDropped()
+             << " dropped, " << streamer.getNumBytes() << " bytes in " << fixed << setprecision(2) << seconds
+             << " s (" << setprecision(0) << double(streamer.getNumBytes()) / seconds << " bytes/s)" << endl;
+    }
+    catch (Exception& e) {
+        cerr << e.what() << endl;
+        return 3;
+    }
+    return 0;
+}
@@ -0,0 +1,758 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/engine.hh>
+#include <synth/instrument.hh>
+#include <synth/envelopecache.hh>
+#include <synth/wavemipmapcache.hh>
+#include <synth/wavwriter.hh>
+#include <synth/threadpool.hh>
+#include <synth/midifile.hh>
+#include <synth/songrenderer.hh>
+#include <synth/bakedcache.hh>
+#include <synth/multisampler.hh>
+#include <synth/sfzwriter.hh>
+#include <synth/sf2writer.hh>
+#include <synth/resampler.hh>
+#include <wersi/mk1cartridge.hh>
+#include <wersi/dx10cartridge.hh>
+#include <wersi/icb.hh>
+#include <exceptions.hh>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+using namespace DMSToolbox;
+using namespace DMSToolbox::Synth;
+using namespace DMSToolbox::Wersi;
+
+// Default sample rate
+static const unsigned DefaultSampleRate = 48000;
+
+// Default notes, every C across the keyboard
+static const char* DefaultNotes = "24,36,48,60,72,84,96";
+
+// Default velocities
+static const char* DefaultVelocities = "100";
+
+// Default note length in seconds
+static const double DefaultLength = 2.0;
+
+// Default maximum release tail in seconds
+static const double DefaultTail = 2.0;
+
+// Number of voices per MIDI channel when playing songs
+static const size_t SongVoices = 32;
+
+// Export jobs in flight per thread, bounds memory however many cartridges are exported
+static const size_t JobsPerThread = 2;
+
+// Loaded cartridge with the caches its instruments are compiled with
+struct Cartridge {
+    string                          m_name;         ///< File name without directory and extension
+    unique_ptr<InstrumentStore>     m_store;        ///< Instrument store
+    unique_ptr<EnvelopeCache>       m_envelopes;    ///< Envelope programs of the store
+};
+
+// Render settings shared by all jobs
+struct Settings {
+    string          m_outDir;       ///< Output directory
+    unsigned        m_sampleRate;   ///< Sample rate in Hz
+    unsigned        m_engineRate;   ///< Sample rate the engine renders at in Hz
+    size_t          m_length;       ///< Note length in engine frames
+    size_t          m_tail;         ///< Maximum release tail in engine frames
+};
+
+// SoundFont bank shared by the export jobs of a cartridge
+struct Bank {
+    Bank(Sf2Writer* writer, size_t remaining) : m_writer(writer), m_remaining(remaining) {
+    }
+
+    unique_ptr<Sf2Writer>   m_writer;       ///< SoundFont writer, null if not exported
+    atomic<size_t>          m_remaining;    ///< Number of instruments still to be exported
+};
+
+// Counter limiting the number of jobs in flight
+class JobLimit {
+    public:
+        explicit JobLimit(size_t limit) : m_limit(limit), m_count(0), m_mutex(), m_cond() {
+        }
+
+        // Wait for a free slot and take it
+        void acquire() {
+            unique_lock<mutex> lock(m_mutex);
+            m_cond.wait(lock, [this] { return m_count < m_limit; });
+            ++m_count;
+        }
+
+        // Give back a slot
+        void release() {
+            lock_guard<mutex> lock(m_mutex);
+            --m_count;
+            m_cond.notify_one();
+        }
+
+    private:
+        size_t              m_limit;    ///< Maximum number of jobs in flight
+        size_t              m_count;    ///< Number of jobs in flight
+        mutex               m_mutex;    ///< Protects count
+        condition_variable  m_cond;     ///< Signals released slots
+};
+
+// Print usage
+static void usage(const char* name)
+{
+    cerr << "Usage: " << name << " [options] <cartridge>..." << endl
+         << "       " << name << " [options] -m <song.mid> <cartridge>" << endl
+         << "Renders notes of every ICB of the given cartridges to WAV files, or plays a MIDI file with the" << endl
+         << "ICBs of a cartridge, program n selecting the n-th ICB" << endl
+         << "  -o <dir>         Output directory (default .)" << endl
+         << "  -n <notes>       Comma separated MIDI notes (default " << DefaultNotes << ")" << endl
+         << "  -v <velocities>  Comma separated velocities (default " << DefaultVelocities << ")" << endl
+         << "  -l <seconds>     Note length (default " << DefaultLength << ")" << endl
+         << "  -t <seconds>     Maximum release tail (default " << DefaultTail << ")" << endl
+         << "  -r <rate>        Sample rate in Hz (default " << DefaultSampleRate << ")" << endl
+         << "  -i <rate>        Render at this rate in Hz and convert to the sample rate (default same)" << endl
+         << "  -j <threads>     Number of threads (default all cores)" << endl
+         << "  -m <file>        MIDI file to play" << endl
+         << "  -p <ch>=<icb>    Play ICB on MIDI channel 1..16 regardless of program changes" << endl
+         << "  -c <dir>         Take notes from baked instrument cache in existing directory" << endl
+         << "  -x <formats>     Export sample banks instead, sfz and/or sf2, notes are the root keys," << endl
+         << "                   velocity layers follow the ICB dynamics and cannot be given with -v" << endl;
+}
+
+// Parse comma separated list of MIDI values
+static bool parseList(const string& text, int lowest, vector<uint8_t>& values)
+{
+    values.clear();
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        char* end = nullptr;
+        long value = strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || value < lowest || value > 127) {
+            return false;
+        }
+        values.push_back(uint8_t(value));
+    }
+    return !values.empty();
+}
+
+// Strip directory and extension from file name
+static string getStem(const string& filename)
+{
+    size_t start = filename.find_last_of("/\\");
+    start = start == string::npos ? 0 : start + 1;
+    size_t end = filename.find_last_of('.');
+    if (end == string::npos || end < start) {
+        end = filename.size();
+    }
+    return filename.substr(start, end - start);
+}
+
+// Make instrument name usable in file names
+static string getFileName(const string& name)
+{
+    string result;
+    for (auto c : name) {
+        result += isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    }
+    while (!result.empty() && result[result.size() - 1] == '_') {
+        result.erase(result.size() - 1);
+    }
+    return result;
+}
+
+// Parse fixed channel assignment
+static bool parseChannel(const string& text, map<uint8_t, uint8_t>& channels)
+{
+    int channel;
+    int icb;
+    char end;
+    if (sscanf(text.c_str(), "%d=%d%c", &channel, &icb, &end) != 2 || channel < 1 || channel > 16
+        || icb < 0 || icb > 255) {
+        return false;
+    }
+    channels[uint8_t(channel - 1)] = uint8_t(icb);
+    return true;
+}
+
+// Read whole file
+static bool readFile(const string& filename, vector<char>& buf)
+{
+    ifstream f(filename.c_str(), ios::binary);
+    if (!f) {
+        cerr << filename << ": Cannot open input file" << endl;
+        return false;
+    }
+    f.seekg(0, ios::end);
+    size_t size = size_t(f.tellg());
+    f.seekg(0, ios::beg);
+    if (size > 16 * 1024 * 1024) {
+        cerr << filename << ": Input file too large" << endl;
+        return false;
+    }
+
+    buf.resize(size);
+    f.read(buf.data(), size);
+    return true;
+}
+
+// Load cartridge file
+static InstrumentStore* loadCartridge(const string& filename)
+{
+    vector<char> buf;
+    if (!readFile(filename, buf)) {
+        return nullptr;
+    }
+    if (buf.size() > 1024 * 1024) {
+        cerr << filename << ": Input file too large" << endl;
+        return nullptr;
+    }
+
+    size_t size = buf.size();
+    try {
+        return new Mk1Cartridge(buf.data(), size);
+    }
+    catch (DataFormatException& e) {
+        string mk1Error = e.what();
+        try {
+            return new Dx10Cartridge(buf.data(), size);
+        }
+        catch (DataFormatException& e) {
+            cerr << filename << ": Cartridge is neither MK1 nor DX10/DX5 format" << endl;
+            cerr << "MK1 error: " << mk1Error << endl;
+            cerr << "DX10/DX5 error: " << e.what() << endl;
+        }
+    }
+    catch (Exception& e) {
+        cerr << filename << ": " << e.what() << endl;
+    }
+    return nullptr;
+}
+
+// Create directory unless it exists
+static bool makeDirectory(const string& path)
+{
+#ifdef _WIN32
+    int result = _mkdir(path.c_str());
+#else
+    int result = mkdir(path.c_str(), 0777);
+#endif
+    return result == 0 || errno == EEXIST;
+}
+
+// Get WAV file name of a note
+static string getNoteFileName(const string& prefix, uint8_t note, uint8_t velocity)
+{
+    stringstream filename;
+    filename << prefix << "_n" << setw(3) << setfill('0') << unsigned(note)
+             << "_v" << setw(3) << unsigned(velocity) << ".wav";
+    return filename.str();
+}
+
+// Write baked note to a WAV file, returns the number of frames
+static size_t writeZone(const Settings& settings, const string& filename, const BakedInstrument::Zone& zone)
+{
+    vector<float> left(zone.m_frames);
+    vector<float> right(zone.m_frames);
+    for (size_t i = 0; i < zone.m_frames; ++i) {
+        left[i]  = zone.m_samples[2 * i]     * (1.0f / 32767.0f);
+        right[i] = zone.m_samples[2 * i + 1] * (1.0f / 32767.0f);
+    }
+
+    WavWriter writer(filename, settings.m_sampleRate);
+    writer.write(left.data(), right.data(), zone.m_frames);
+    writer.close();
+    return zone.m_frames;
+}
+
+// Render one note of an instrument to a WAV file, returns the number of rendered frames
+static size_t renderNote(const Settings& settings, const string& filename,
+                         const shared_ptr<const Instrument>& instrument, uint8_t note, uint8_t velocity)
+{
+    Engine engine(Patch::MaxLayers, float(settings.m_engineRate));
+    vector<float> left(settings.m_length + settings.m_tail);
+    vector<float> right(left.size());
+    size_t frames = engine.renderNote(instrument, note, velocity, settings.m_length,
+                                      left.data(), right.data(), left.size());
+    if (settings.m_engineRate != settings.m_sampleRate) {
+        Resampler resampler(float(settings.m_engineRate), float(settings.m_sampleRate), Resampler::Quality::Best);
+        vector<float> engineLeft;
+        vector<float> engineRight;
+        engineLeft.swap(left);
+        engineRight.swap(right);
+        left.resize(resampler.getMaxOutput(frames) + resampler.getMaxOutput(resampler.getLatency()));
+        right.resize(left.size());
+        size_t count = resampler.process(engineLeft.data(), engineRight.data(), frames, left.data(), right.data());
+        frames = count + resampler.flush(&left[count], &right[count]);
+    }
+
+    WavWriter writer(filename, settings.m_sampleRate);
+    writer.write(left.data(), right.data(), frames);
+    writer.close();
+    return frames;
+}
+
+// Export one instrument to an SFZ file with its samples and/or a SoundFont bank, returns the number of frames
+static size_t exportInstrument(const Settings& settings, const string& dir, const string& prefix,
+                               const shared_ptr<const Instrument>& instrument, const vector<uint8_t>& roots,
+                               bool sfz, Bank& bank, uint16_t preset)
+{
+    MultiSampler sampler(settings.m_sampleRate, settings.m_length, settings.m_tail);
+    unique_ptr<SfzWriter> sfzWriter(sfz ? new SfzWriter(dir + "/" + prefix + ".sfz", instrument->getName()) : nullptr);
+    vector<Sf2Writer::Zone> zones;
+    size_t frames = sampler.render(instrument, roots, [&](const MultiSampler::Region& region,
+                                                          const float* left, const float* right, size_t count) {
+        string name = getNoteFileName(prefix, region.m_rootKey, region.m_highVelocity);
+        if (sfzWriter != nullptr) {
+            WavWriter writer(dir + "/" + name, settings.m_sampleRate);
+            writer.write(left, right, count);
+            writer.close();
+            sfzWriter->addRegion(region, name);
+        }
+        if (bank.m_writer != nullptr) {
+            stringstream sampleName;
+            sampleName << instrument->getName() << "_" << unsigned(region.m_rootKey) << "_"
+                       << unsigned(region.m_highVelocity);
+            uint32_t sample = bank.m_writer->addSample(sampleName.str(), left, right, count, settings.m_sampleRate,
+                                                       region.m_rootKey);
+            Sf2Writer::Zone zone = {
+                region.m_lowKey, region.m_highKey, region.m_lowVelocity, region.m_highVelocity, sample
+            };
+            zones.push_back(zone);
+        }
+    });
+
+    if (sfzWriter != nullptr) {
+        sfzWriter->close();
+    }
+    if (bank.m_writer != nullptr) {
+        bank.m_writer->addInstrument(preset, instrument->getName(), zones);
+    }
+    if (--bank.m_remaining == 0 && bank.m_writer != nullptr) {
+        bank.m_writer->close();
+    }
+    return frames;
+}
+
+// Export cartridges as sample banks, one after another so only few are in memory at a time
+static int exportBanks(const Settings& settings, const vector<string>& files, const vector<uint8_t>& roots,
+                       bool sfz, bool sf2, ThreadPool& pool)
+{
+    WaveMipmapCache waves(1024);
+    JobLimit limit(pool.getNumThreads() * JobsPerThread);
+    mutex outputMutex;
+    atomic<size_t> totalFrames(0);
+    int result = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (auto& file : files) {
+        unique_ptr<InstrumentStore> store(loadCartridge(file));
+        if (store == nullptr) {
+            result = 2;
+            continue;
+        }
+
+        try {
+            string name = getStem(file);
+            string dir = settings.m_outDir + "/" + name;
+            if (sfz && !makeDirectory(dir)) {
+                throw SystemException("Unable to create directory " + dir);
+            }
+
+            // The bank is completed by the last of the cartridge's jobs
+            size_t numIcbs = size_t(distance(store->begin(), store->end()));
+            Sf2Writer* writer = sf2 ? new Sf2Writer(settings.m_outDir + "/" + name + ".sf2", name) : nullptr;
+            shared_ptr<Bank> bank = make_shared<Bank>(writer, numIcbs);
+            EnvelopeCache envelopes(*store);
+            uint16_t preset = 0;
+            for (auto& i : *store) {
+                shared_ptr<const Instrument> instrument = make_shared<Instrument>(*store, i.first, envelopes, waves);
+                stringstream prefix;
+                prefix << setw(3) << setfill('0') << unsigned(i.first);
+                string instrumentName = getFileName(instrument->getName());
+                if (!instrumentName.empty()) {
+                    prefix << "_" << instrumentName;
+                }
+
+                limit.acquire();
+                string base = prefix.str();
+                pool.submit([&settings, &roots, &limit, &outputMutex, &totalFrames, dir, base, instrument, sfz,
+                             bank, preset, file] {
+                    try {
+                        totalFrames += exportInstrument(settings, dir, base, instrument, roots, sfz, *bank, preset);
+                    }
+                    catch (...) {
+                        limit.release();
+                        throw;
+                    }
+                    limit.release();
+                    lock_guard<mutex> lock(outputMutex);
+                    cout << file << ": " << base << endl;
+                });
+                ++preset;
+            }
+        }
+        catch (Exception& e) {
+            cerr << file << ": " << e.what() << endl;
+            result = 3;
+        }
+    }
+
+    try {
+        pool.wait();
+    }
+    catch (Exception& e) {
+        cerr << e.what() << endl;
+        return 3;
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    double audio = double(totalFrames) / settings.m_sampleRate;
+    cout << "Exported " << files.size() << " cartridge(s), " << fixed << setprecision(1) << audio
+         << " s of audio in " << setprecision(2) << seconds << " s on " << pool.getNumThreads() << " thread(s), "
+         << setprecision(1) << audio / seconds << "x realtime" << endl;
+    return result;
+}
+
+// Play MIDI file with the ICBs of a cartridge
+static int renderSong(const Settings& settings, const string& filename, Cartridge& cartridge,
+                      const map<uint8_t, uint8_t>& channels, double tail, ThreadPool& pool)
+{
+    vector<char> buf;
+    if (!readFile(filename, buf)) {
+        return 2;
+    }
+
+    try {
+        MidiFile song(buf.data(), buf.size());
+        vector<uint8_t> icbs;
+        for (auto& i : *cartridge.m_store) {
+            icbs.push_back(i.first);
+        }
+        if (icbs.empty()) {
+            cerr << "Cartridge contains no ICBs" << endl;
+            return 2;
+        }
+
+        // Every ICB is compiled once, however many channels and programs select it
+        WaveMipmapCache waves;
+        map<uint8_t, shared_ptr<const Instrument>> instruments;
+        SongRenderer::Resolver resolver = [&](uint8_t channel, uint8_t program) {
+            map<uint8_t, uint8_t>::const_iterator fixed = channels.find(channel);
+            uint8_t icb = fixed != channels.end() ? fixed->second : icbs[program % icbs.size()];
+            shared_ptr<const Instrument>& instrument = instruments[icb];
+            if (instrument == nullptr) {
+                instrument = make_shared<Instrument>(*cartridge.m_store, icb, *cartridge.m_envelopes, waves);
+            }
+            return instrument;
+        };
+        SongRenderer renderer(song, resolver, float(settings.m_engineRate), SongVoices);
+
+        string output = settings.m_outDir + "/" + getStem(filename) + ".wav";
+        WavWriter writer(output, settings.m_sampleRate);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        uint64_t frames;
+        if (settings.m_engineRate != settings.m_sampleRate) {
+            // Blocks are converted in order on the calling thread
+            Resampler resampler(float(settings.m_engineRate), float(settings.m_sampleRate),
+                                Resampler::Quality::Best);
+            vector<float> left;
+            vector<float> right;
+            frames = 0;
+            renderer.render(pool, [&](const float* inLeft, const float* inRight, size_t count) {
+                size_t size = resampler.getMaxOutput(count);
+                if (left.size() < size) {
+                    left.resize(size);
+                    right.resize(size);
+                }
+                count = resampler.process(inLeft, inRight, count, left.data(), right.data());
+                writer.write(left.data(), right.data(), count);
+                frames += count;
+            }, tail);
+            left.resize(max(left.size(), resampler.getMaxOutput(resampler.getLatency())));
+            right.resize(left.size());
+            size_t count = resampler.flush(left.data(), right.data());
+            writer.write(left.data(), right.data(), count);
+            frames += count;
+        }
+        else {
+            frames = renderer.render(pool, [&writer](const float* left, const float* right, size_t count) {
+                writer.write(left, right, count);
+            }, tail);
+        }
+        writer.close();
+
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        double audio = double(frames) / settings.m_sampleRate;
+        cout << "Rendered " << output << ", " << fixed << setprecision(1) << audio << " s of audio in "
+             << setprecision(2) << seconds << " s on " << pool.getNumThreads() << " thread(s), "
+             << setprecision(1) << audio / seconds << "x realtime" << endl;
+    }
+    catch (Exception& e) {
+        cerr << filename << ": " << e.what() << endl;
+        return 3;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    // Parse options
+    Settings settings = { ".", DefaultSampleRate, 0, 0, 0 };
+    double length = DefaultLength;
+    double tail = DefaultTail;
+    size_t numThreads = 0;
+    string songFile;
+    string cacheDir;
+    bool sfz = false;
+    bool sf2 = false;
+    bool layered = false;
+    map<uint8_t, uint8_t> channels;
+    vector<uint8_t> notes;
+    vector<uint8_t> velocities;
+    parseList(DefaultNotes, 0, notes);
+    parseList(DefaultVelocities, 1, velocities);
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+        string option = argv[arg];
+        if (option.size() != 2 || arg + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        string value = argv[++arg];
+        bool valid = true;
+        switch (option[1]) {
+            case 'o':
+                settings.m_outDir = value;
+                break;
+            case 'n':
+                valid = parseList(value, 0, notes);
+                break;
+            case 'v':
+                valid = parseList(value, 1, velocities);
+                layered = true;
+                break;
+            case 'l':
+                length = atof(value.c_str());
+                valid = length > 0.0;
+                break;
+            case 't':
+                tail = atof(value.c_str());
+                valid = tail >= 0.0;
+                break;
+            case 'r':
+                settings.m_sampleRate = unsigned(atoi(value.c_str()));
+                valid = settings.m_sampleRate >= 8000 && settings.m_sampleRate <= 192000;
+                break;
+            case 'i':
+                settings.m_engineRate = unsigned(atoi(value.c_str()));
+                valid = settings.m_engineRate >= 8000 && settings.m_engineRate <= 192000;
+                break;
+            case 'j':
+                numThreads = size_t(atoi(value.c_str()));
+                valid = numThreads > 0;
+                break;
+            case 'm':
+                songFile = value;
+                break;
+            case 'p':
+                valid = parseChannel(value, channels);
+                break;
+            case 'c':
+                cacheDir = value;
+                break;
+            case 'x':
+                sfz = value.find("sfz") != string::npos;
+                sf2 = value.find("sf2") != string::npos;
+                valid = sfz || sf2;
+                break;
+            default:
+                valid = false;
+                break;
+        }
+        if (!valid) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (arg == argc || (!songFile.empty() && arg + 1 != argc)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (settings.m_engineRate == 0) {
+        settings.m_engineRate = settings.m_sampleRate;
+    }
+
+    // Baked and exported samples are stored at the sample rate they were rendered at
+    if (settings.m_engineRate != settings.m_sampleRate && (!cacheDir.empty() || sfz || sf2)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Exported velocity layers follow the ICB dynamics
+    if (layered && (sfz || sf2)) {
+        usage(argv[0]);
+        return 1;
+    }
+    settings.m_length = size_t(length * settings.m_engineRate);
+    settings.m_tail = size_t(tail * settings.m_engineRate);
+
+    // Exported cartridges are loaded one at a time
+    if (sfz || sf2) {
+        ThreadPool pool(numThreads);
+        sort(notes.begin(), notes.end());
+        notes.erase(unique(notes.begin(), notes.end()), notes.end());
+        return exportBanks(settings, vector<string>(argv + arg, argv + argc), notes, sfz, sf2, pool);
+    }
+
+    // Load cartridges
+    vector<Cartridge> cartridges;
+    for (; arg < argc; ++arg) {
+        InstrumentStore* store = loadCartridge(argv[arg]);
+        if (store == nullptr) {
+            return 2;
+        }
+        Cartridge cartridge = { getStem(argv[arg]), unique_ptr<InstrumentStore>(store), nullptr };
+        cartridge.m_envelopes.reset(new EnvelopeCache(*store));
+        cartridges.push_back(move(cartridge));
+    }
+
+    ThreadPool pool(numThreads);
+    if (!songFile.empty()) {
+        return renderSong(settings, songFile, cartridges[0], channels, tail, pool);
+    }
+
+    // Baked notes are rendered with the same settings as uncached ones
+    unique_ptr<BakedCache> cache;
+    if (!cacheDir.empty()) {
+        BakedInstrument::Settings bakeSettings = {
+            settings.m_sampleRate, settings.m_length, settings.m_tail, notes, velocities
+        };
+        cache.reset(new BakedCache(cacheDir, bakeSettings));
+    }
+
+    // Compile all instruments before rendering, the jobs don't touch the stores
+    WaveMipmapCache waves(1024);
+    mutex outputMutex;
+    atomic<size_t> totalFrames(0);
+    size_t numFiles = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (auto& cartridge : cartridges) {
+        for (auto& i : *cartridge.m_store) {
+            shared_ptr<const Instrument> instrument = make_shared<Instrument>(*cartridge.m_store, i.first,
+                                                                              *cartridge.m_envelopes, waves);
+            stringstream prefix;
+            prefix << settings.m_outDir << "/" << cartridge.m_name << "_" << setw(3) << setfill('0')
+                   << unsigned(i.first);
+            string name = getFileName(instrument->getName());
+            if (!name.empty()) {
+                prefix << "_" << name;
+            }
+
+            // One job per instrument plays back or bakes all its notes
+            if (cache != nullptr) {
+                uint64_t key = cache->getKey(*cartridge.m_store, i.first);
+                string base = prefix.str();
+                pool.submit([&settings, &outputMutex, &totalFrames, &cache, key, base, instrument] {
+                    shared_ptr<const BakedInstrument> baked = cache->find(key);
+                    if (baked == nullptr) {
+                        baked = cache->bake(key, instrument);
+                    }
+                    for (size_t zone = 0; zone < baked->getNumZones(); ++zone) {
+                        const BakedInstrument::Zone& data = baked->getZone(zone);
+                        string file = getNoteFileName(base, data.m_note, data.m_velocity);
+                        totalFrames += writeZone(settings, file, data);
+                        lock_guard<mutex> lock(outputMutex);
+                        cout << file << endl;
+                    }
+                });
+                numFiles += notes.size() * velocities.size();
+                continue;
+            }
+
+            for (auto note : notes) {
+                for (auto velocity : velocities) {
+                    string file = getNoteFileName(prefix.str(), note, velocity);
+                    pool.submit([&settings, &outputMutex, &totalFrames, file, instrument, note, velocity] {
+                        totalFrames += renderNote(settings, file, instrument, note, velocity);
+                        lock_guard<mutex> lock(outputMutex);
+                        cout << file << endl;
+                    });
+                    ++numFiles;
+                }
+            }
+        }
+    }
+
+    try {
+        pool.wait();
+    }
+    catch (Exception& e) {
+        cerr << e.what() << endl;
+        return 3;
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    double audio = double(totalFrames) / settings.m_sampleRate;
+    cout << "Rendered " << numFiles << " file(s), " << fixed << setprecision(1) << audio << " s of audio in "
+         << setprecision(2) << seconds << " s on " << pool.getNumThreads() << " thread(s), "
+         << setprecision(1) << audio / seconds << "x realtime" << endl;
+    if (cache != nullptr) {
+        cout << "Baked instrument cache: " << cache->getHits() << " hit(s), " << cache->getBakes() << " baked"
+             << endl;
+    }
+    return 0;
+}
@@ -37,8 +37,12 @@
 
 #include <gui/instpanel.hh>
 #include <wersi/instrumentstore.hh>
+#include <wersi/changeset.hh>
 #include <wersi/icb.hh>
 #include <wersi/vcf.hh>
+#include <synth/previewengine.hh>
+#include <synth/envelopecache.hh>
+#include <synth/instrument.hh>
 
 using namespace DMSToolbox::Wersi;
 
@@ -52,6 +56,8 @@ InstPanel::InstPanel(wxWindow* parent)
     , m_icbNum(0)
     , m_icb(nullptr)
     , m_vcf(nullptr)
+    , m_preview(nullptr)
+    , m_waves()
 {
 }
 
@@ -72,167 +78,255 @@ void InstPanel::setInstrument(Wersi::InstrumentStore* store, uint8_t icbNum)
 
     // Handle ICB
     if (m_icb != nullptr) {
-        // Set ICB name
-        m_nameInput->ChangeValue(wxString::From8BitData(m_icb->getName().c_str()));
-
-        // Get number of primary ICBs
-        size_t numIcb = store->getNumIcbs();
-
-        // Construct next ICB choice list
-        m_nextIcbChoice->Clear();
-        m_nextIcbChoice->Append(_("none"));
-        m_nextIcbChoice->SetSelection(0);
-        uint8_t tmp = m_icb->getNextIcb();
-        uint8_t offset = 0;
-        for (auto& i : *m_store) {
-            if (offset == 0) {
-                offset = i.first - 1;
-            }
-            wxString instName(wxT("("));
-            instName << uint16_t(i.first) << wxT(") ");
-            instName << wxString::From8BitData(i.second.getName().c_str());
-            m_nextIcbChoice->Append(instName);
-            if (i.first == tmp) {
-                m_nextIcbChoice->SetSelection(m_nextIcbChoice->GetCount() - 1);
-            }
-        }
+        updateIcbInputs();
+    }
+    else {
+        // TODO clear and disable inputs
+    }
 
-        // Construct VCF choice list
-        m_vcfChoice->Clear();
-        tmp = m_icb->getVcfBlock();
-        for (size_t i = 0; i < 10; ++i) {
-            uint16_t addr = i + offset;
-            wxString name;
-            name << addr;
-            m_vcfChoice->Append(name);
-            if (addr == tmp) {
-                m_vcfChoice->SetSelection(m_vcfChoice->GetCount() - 1);
-            }
-        }
+    // Handle VCF
+    if (m_vcf != nullptr) {
+        updateVcfInputs();
+    }
+    else {
+        // TODO clear and disable inputs
+    }
+
+    updatePreview();
+}
+
+// Refresh changed instrument data
+void InstPanel::refresh(InstrumentStore* store, const ChangeSet& changes)
+{
+    if (store == nullptr || store != m_store) {
+        return;
+    }
+
+    // Dissecting the store, e.g. after reading from a device, replaces all block objects, so look them up again
+    m_icb = m_store->getIcb(m_icbNum);
+    if (m_icb == nullptr) {
+        setInstrument(nullptr, 0);
+        return;
+    }
+    m_vcf = m_store->getVcf(m_icb->getVcfBlock());
 
-        // Construct AMPL choice list
-        m_amplChoice->Clear();
-        tmp = m_icb->getAmplBlock();
-        for (size_t i = 0; i < 20; ++i) {
-            uint16_t addr = i + offset;
-            if (i >= numIcb) {
-                ++addr;
-            }
-            wxString name;
-            name << addr;
-            m_amplChoice->Append(name);
-            if (addr == tmp) {
-                m_amplChoice->SetSelection(m_amplChoice->GetCount() - 1);
-            }
+    // Any block of the chain may have changed, recompiling is cheap
+    updatePreview();
+
+    if (changes.test(ChangeSet::BlockType::Icb, m_icbNum)) {
+        updateIcbInputs();
+        if (m_vcf != nullptr) {
+            updateVcfInputs();
         }
+        return;
+    }
 
-        // Construct FREQ choice list
-        m_freqChoice->Clear();
-        tmp = m_icb->getFreqBlock();
-        for (size_t i = 0; i < 20; ++i) {
-            uint16_t addr = i + offset;
-            if (i >= numIcb) {
-                ++addr;
-            }
-            wxString name;
-            name << addr;
-            m_freqChoice->Append(name);
-            if (addr == tmp) {
-                m_freqChoice->SetSelection(m_freqChoice->GetCount() - 1);
-            }
+    if (changes.any(ChangeSet::BlockType::Icb)) {
+        updateIcbNames();
+    }
+    if (m_vcf != nullptr && changes.test(ChangeSet::BlockType::Vcf, m_icb->getVcfBlock())) {
+        updateVcfInputs();
+    }
+}
+
+// Set preview engine
+void InstPanel::setPreview(Synth::PreviewEngine* preview)
+{
+    m_preview = preview;
+    updatePreview();
+}
+
+// Send edited instrument to preview engine
+void InstPanel::updatePreview()
+{
+    if (m_preview == nullptr) {
+        return;
+    }
+    m_preview->collect();
+    if (m_store == nullptr || m_icb == nullptr) {
+        m_preview->setInstrument(0, nullptr);
+        return;
+    }
+
+    // A fresh envelope cache can't be stale, other observers of the store may not have been notified yet
+    Synth::EnvelopeCache envelopes(*m_store);
+    m_preview->setInstrument(0, std::make_shared<Synth::Instrument>(*m_store, m_icbNum, envelopes, m_waves));
+}
+
+// Update ICB inputs
+void InstPanel::updateIcbInputs()
+{
+    // Set ICB name
+    m_nameInput->ChangeValue(wxString::From8BitData(m_icb->getName().c_str()));
+
+    // Get number of primary ICBs
+    size_t numIcb = m_store->getNumIcbs();
+
+    // Construct next ICB choice list
+    m_nextIcbChoice->Clear();
+    m_nextIcbChoice->Append(_("none"));
+    m_nextIcbChoice->SetSelection(0);
+    uint8_t tmp = m_icb->getNextIcb();
+    uint8_t offset = 0;
+    for (auto& i : *m_store) {
+        if (offset == 0) {
+            offset = i.first - 1;
+        }
+        wxString instName(wxT("("));
+        instName << uint16_t(i.first) << wxT(") ");
+        instName << wxString::From8BitData(i.second.getName().c_str());
+        m_nextIcbChoice->Append(instName);
+        if (i.first == tmp) {
+            m_nextIcbChoice->SetSelection(m_nextIcbChoice->GetCount() - 1);
         }
+    }
 
-        // Construct WAVE choice list
-        m_waveChoice->Clear();
-        tmp = m_icb->getWaveBlock();
-        for (size_t i = 0; i < 20; ++i) {
-            uint16_t addr = i + offset;
-            if (i >= numIcb) {
-                ++addr;
-            }
-            wxString name;
-            name << addr;
-            m_waveChoice->Append(name);
-            if (addr == tmp) {
-                m_waveChoice->SetSelection(m_waveChoice->GetCount() - 1);
-            }
+    // Construct VCF choice list
+    m_vcfChoice->Clear();
+    tmp = m_icb->getVcfBlock();
+    for (size_t i = 0; i < 10; ++i) {
+        uint16_t addr = i + offset;
+        wxString name;
+        name << addr;
+        m_vcfChoice->Append(name);
+        if (addr == tmp) {
+            m_vcfChoice->SetSelection(m_vcfChoice->GetCount() - 1);
         }
+    }
 
-        // Configure dynamics inputs
-        m_dynamicsChoice->SetSelection(m_icb->getDynamics());
-        m_lowSelCheckBox->SetValue(m_icb->getLowSelect());
-        m_highSelCheckBox->SetValue(m_icb->getHighSelect());
-
-        // Configure output inputs
-        m_leftCheckBox->SetValue(m_icb->getLeft());
-        m_rightCheckBox->SetValue(m_icb->getRight());
-        m_vcfCheckBox->SetValue(m_icb->getVcf());
-        m_wvCheckBox->SetValue(m_icb->getWersiVoice());
-
-        // Configure transpose/detune/bright
-        m_transposeInput->Clear();
-        *m_transposeInput << int16_t(m_icb->getTranspose());
-        m_detuneInput->Clear();
-        *m_detuneInput << int16_t(m_icb->getDetune());
-        m_brightCheckBox->SetValue(m_icb->getBright());
-
-        // Configure WersiVoice inputs
-        m_wvLeftCheckBox->SetValue(m_icb->getWvLeft());
-        m_wvRightCheckBox->SetValue(m_icb->getWvRight());
-        m_wvFbFlatCheckBox->SetValue(m_icb->getWvFbFlat());
-        m_wvFbDeepCheckBox->SetValue(m_icb->getWvFbDeep());
-        m_wvModeChoice->SetSelection(static_cast<uint8_t>(m_icb->getWvMode()));
+    // Construct AMPL choice list
+    m_amplChoice->Clear();
+    tmp = m_icb->getAmplBlock();
+    for (size_t i = 0; i < 20; ++i) {
+        uint16_t addr = i + offset;
+        if (i >= numIcb) {
+            ++addr;
+        }
+        wxString name;
+        name << addr;
+        m_amplChoice->Append(name);
+        if (addr == tmp) {
+            m_amplChoice->SetSelection(m_amplChoice->GetCount() - 1);
+        }
     }
-    else {
-        // TODO clear and disable inputs
+
+    // Construct FREQ choice list
+    m_freqChoice->Clear();
+    tmp = m_icb->getFreqBlock();
+    for (size_t i = 0; i < 20; ++i) {
+        uint16_t addr = i + offset;
+        if (i >= numIcb) {
+            ++addr;
+        }
+        wxString name;
+        name << addr;
+        m_freqChoice->Append(name);
+        if (addr == tmp) {
+            m_freqChoice->SetSelection(m_freqChoice->GetCount() - 1);
+        }
     }
 
-    // Handle VCF
-    if (m_vcf != nullptr) {
-        // Configure output inputs
-        m_vcfLeftCheckBox->SetValue(m_vcf->getLeft());
-        m_vcfRightCheckBox->SetValue(m_vcf->getRight());
-        m_vcfWvCheckBox->SetValue(m_vcf->getWersiVoice());
-
-        // Configure mode inputs
-        m_lowPassCheckBox->SetValue(m_vcf->getLowPass());
-        m_fourPolesCheckBox->SetValue(m_vcf->getFourPoles());
-        m_distortionCheckBox->SetValue(m_vcf->getDistortion());
-
-        // Configure cutoff/resonance inputs
-        m_cutoffInput->Clear();
-        *m_cutoffInput << int16_t(m_vcf->getFrequency());
-        m_resonanceInput->Clear();
-        *m_resonanceInput << uint16_t(m_vcf->getQuality());
-
-        // Configure noise inputs
-        m_noiseCheckBox->SetValue(m_vcf->getNoise());
-        m_noiseTypeChoice->SetSelection(static_cast<uint8_t>(m_vcf->getNoiseType()));
-
-        // Configure envelope inputs
-        m_envModeChoice->SetSelection(static_cast<uint8_t>(m_vcf->getEnvelopeMode()));
-        m_retriggerCheckBox->SetValue(m_vcf->getRetrigger());
-        m_trackingCheckBox->SetValue(m_vcf->getTracking());
-
-        // Configure envelope parameter inputs
-        m_t1TimeInput->Clear();
-        *m_t1TimeInput << uint16_t(m_vcf->getT1Time());
-        m_t1IntensityInput->Clear();
-        *m_t1IntensityInput << int16_t(m_vcf->getT1Intensity());
-        m_t1OffsetInput->Clear();
-        *m_t1OffsetInput << int16_t(m_vcf->getT1Offset());
-        m_t2TimeInput->Clear();
-        *m_t2TimeInput << uint16_t(m_vcf->getT2Time());
-        m_t2IntensityInput->Clear();
-        *m_t2IntensityInput << int16_t(m_vcf->getT2Intensity());
-        m_t2OffsetInput->Clear();
-        *m_t2OffsetInput << int16_t(m_vcf->getT2Offset());
+    // Construct WAVE choice list
+    m_waveChoice->Clear();
+    tmp = m_icb->getWaveBlock();
+    for (size_t i = 0; i < 20; ++i) {
+        uint16_t addr = i + offset;
+        if (i >= numIcb) {
+            ++addr;
+        }
+        wxString name;
+        name << addr;
+        m_waveChoice->Append(name);
+        if (addr == tmp) {
+            m_waveChoice->SetSelection(m_waveChoice->GetCount() - 1);
+        }
     }
-    else {
-        // TODO clear and disable inputs
+
+    // Configure dynamics inputs
+    m_dynamicsChoice->SetSelection(m_icb->getDynamics());
+    m_lowSelCheckBox->SetValue(m_icb->getLowSelect());
+    m_highSelCheckBox->SetValue(m_icb->getHighSelect());
+
+    // Configure output inputs
+    m_leftCheckBox->SetValue(m_icb->getLeft());
+    m_rightCheckBox->SetValue(m_icb->getRight());
+    m_vcfCheckBox->SetValue(m_icb->getVcf());
+    m_wvCheckBox->SetValue(m_icb->getWersiVoice());
+
+    // Configure transpose/detune/bright
+    m_transposeInput->Clear();
+    *m_transposeInput << int16_t(m_icb->getTranspose());
+    m_detuneInput->Clear();
+    *m_detuneInput << int16_t(m_icb->getDetune());
+    m_brightCheckBox->SetValue(m_icb->getBright());
+
+    // Configure WersiVoice inputs
+    m_wvLeftCheckBox->SetValue(m_icb->getWvLeft());
+    m_wvRightCheckBox->SetValue(m_icb->getWvRight());
+    m_wvFbFlatCheckBox->SetValue(m_icb->getWvFbFlat());
+    m_wvFbDeepCheckBox->SetValue(m_icb->getWvFbDeep());
+    m_wvModeChoice->SetSelection(static_cast<uint8_t>(m_icb->getWvMode()));
+}
+
+// Update instrument names in next ICB choice list
+void InstPanel::updateIcbNames()
+{
+    unsigned int idx = 1;
+    for (auto& i : *m_store) {
+        if (idx >= m_nextIcbChoice->GetCount()) {
+            break;
+        }
+        wxString instName(wxT("("));
+        instName << uint16_t(i.first) << wxT(") ");
+        instName << wxString::From8BitData(i.second.getName().c_str());
+        m_nextIcbChoice->SetString(idx, instName);
+        ++idx;
     }
 }
 
+// Update VCF inputs
+void InstPanel::updateVcfInputs()
+{
+    // Configure output inputs
+    m_vcfLeftCheckBox->SetValue(m_vcf->getLeft());
+    m_vcfRightCheckBox->SetValue(m_vcf->getRight());
+    m_vcfWvCheckBox->SetValue(m_vcf->getWersiVoice());
+
+    // Configure mode inputs
+    m_lowPassCheckBox->SetValue(m_vcf->getLowPass());
+    m_fourPolesCheckBox->SetValue(m_vcf->getFourPoles());
+    m_distortionCheckBox->SetValue(m_vcf->getDistortion());
+
+    // Configure cutoff/resonance inputs
+    m_cutoffInput->Clear();
+    *m_cutoffInput << int16_t(m_vcf->getFrequency());
+    m_resonanceInput->Clear();
+    *m_resonanceInput << uint16_t(m_vcf->getQuality());
+
+    // Configure noise inputs
+    m_noiseCheckBox->SetValue(m_vcf->getNoise());
+    m_noiseTypeChoice->SetSelection(static_cast<uint8_t>(m_vcf->getNoiseType()));
+
+    // Configure envelope inputs
+    m_envModeChoice->SetSelection(static_cast<uint8_t>(m_vcf->getEnvelopeMode()));
+    m_retriggerCheckBox->SetValue(m_vcf->getRetrigger());
+    m_trackingCheckBox->SetValue(m_vcf->getTracking());
+
+    // Configure envelope parameter inputs
+    m_t1TimeInput->Clear();
+    *m_t1TimeInput << uint16_t(m_vcf->getT1Time());
+    m_t1IntensityInput->Clear();
+    *m_t1IntensityInput << int16_t(m_vcf->getT1Intensity());
+    m_t1OffsetInput->Clear();
+    *m_t1OffsetInput << int16_t(m_vcf->getT1Offset());
+    m_t2TimeInput->Clear();
+    *m_t2TimeInput << uint16_t(m_vcf->getT2Time());
+    m_t2IntensityInput->Clear();
+    *m_t2IntensityInput << int16_t(m_vcf->getT2Intensity());
+    m_t2OffsetInput->Clear();
+    *m_t2OffsetInput << int16_t(m_vcf->getT2Offset());
+}
+
 void InstPanel::onIcbChoice(wxCommandEvent& /*event*/)
 {
     // TODO: Implement onIcbChoice
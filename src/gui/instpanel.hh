@@ -38,16 +38,23 @@
 #pragma once
 
 #include <gui/gui.hh>
+#include <synth/wavemipmapcache.hh>
 
 namespace DMSToolbox {
 
 namespace Wersi {
 // Forward declarations
 class InstrumentStore;
+class ChangeSet;
 class Icb;
 class Vcf;
 } // namespace Wersi
 
+namespace Synth {
+// Forward declarations
+class PreviewEngine;
+} // namespace Synth
+
 namespace Gui {
 
 /**
@@ -79,11 +86,64 @@ class InstPanel : public InstPanelBase {
          */
         void setInstrument(Wersi::InstrumentStore* store, uint8_t icbNum);
 
+        /**
+          Refresh changed instrument data.
+
+          Updates only the fields affected by the given change set if the panel currently shows an instrument of the
+          given store.
+
+          @param[in]    store       Instrument store that has been changed
+          @param[in]    changes     Set of changed blocks
+         */
+        void refresh(Wersi::InstrumentStore* store, const Wersi::ChangeSet& changes);
+
+        /**
+          Set preview engine.
+
+          Associates a preview engine with the panel. The edited instrument is compiled and sent to channel 0 of the
+          engine whenever it is selected or changed, so edits can be heard immediately. The owner of the engine has to
+          start it and call PreviewEngine::collect() regularly. Without an audio device sink, the main frame does not
+          create an engine yet.
+
+          @param[in]    preview     Preview engine, null to disable previewing
+         */
+        void setPreview(Synth::PreviewEngine* preview);
+
     protected:
         Wersi::InstrumentStore*     m_store;        ///< Instrument store data belongs to
         uint8_t                     m_icbNum;       ///< Block number of ICB being edited
         Wersi::Icb*                 m_icb;          ///< Pointer to ICB being edited
         Wersi::Vcf*                 m_vcf;          ///< Pointer to VCF being edited
+        Synth::PreviewEngine*       m_preview;      ///< Preview engine, may be null
+        Synth::WaveMipmapCache      m_waves;        ///< Band-limited waves for previewing
+
+        /**
+          Update ICB inputs.
+
+          Updates all inputs showing ICB data, including the block choice lists.
+         */
+        void updateIcbInputs();
+
+        /**
+          Update instrument names.
+
+          Updates the instrument names in the next ICB choice list.
+         */
+        void updateIcbNames();
+
+        /**
+          Update VCF inputs.
+
+          Updates all inputs showing VCF data.
+         */
+        void updateVcfInputs();
+
+        /**
+          Update preview.
+
+          Compiles the edited instrument and sends it to the preview engine.
+         */
+        void updatePreview();
 
         void onIcbChoice(wxCommandEvent& event);
         void onVcfChoice(wxCommandEvent& event);
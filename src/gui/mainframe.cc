@@ -45,6 +45,7 @@
 #include <wersi/dx10cartridge.hh>
 #include <wersi/dx10device.hh>
 #include <wersi/icb.hh>
+#include <wersi/history.hh>
 #include <wersi/sysex.hh>
 
 #include <wx/filedlg.h>
@@ -89,11 +90,15 @@ MainFrame::MainFrame(wxWindow* parent)
 MainFrame::~MainFrame()
 {
     for (auto& i : m_instrumentStores) {
-        // Delete store and associated buffer
+        // Delete history and store
         if (i.second.m_store != nullptr) {
-            auto buffer = static_cast<uint8_t*>(i.second.m_store->getBuffer());
+            i.second.m_store->removeObserver(this);
+            auto history = m_histories.find(i.second.m_store);
+            if (history != m_histories.end()) {
+                delete history->second;
+                m_histories.erase(history);
+            }
             delete i.second.m_store;
-            delete[] buffer;
         }
 
 #ifdef HAVE_RTMIDI
@@ -147,6 +152,38 @@ void MainFrame::applyConfiguration()
     m_instTree->Expand(m_cartridges);
 }
 
+// Handle instrument store changes
+void MainFrame::storeChanged(InstrumentStore& store, const ChangeSet& changes)
+{
+    // Relabel only the affected instruments
+    auto storeItem = findStoreItem(&store);
+    if (storeItem.IsOk() && changes.any(ChangeSet::BlockType::Icb)) {
+        wxTreeItemIdValue cookie;
+        auto child = m_instTree->GetFirstChild(storeItem, cookie);
+        while (child.IsOk()) {
+            auto inst = dynamic_cast<InstrumentHelper*>(m_instTree->GetItemData(child));
+            if (inst != nullptr && changes.test(ChangeSet::BlockType::Icb, inst->getIcb())) {
+                auto icb = store.getIcb(inst->getIcb());
+                if (icb != nullptr) {
+                    m_instTree->SetItemText(child, instrumentLabel(inst->getIcb(), *icb));
+                }
+            }
+            child = m_instTree->GetNextChild(storeItem, cookie);
+        }
+    }
+
+    // Refresh the instrument panel if it shows this store
+    m_instPanel->refresh(&store, changes);
+
+    // Remember changes on devices for the next device write
+    for (auto& i : m_instrumentStores) {
+        if (i.second.m_store == &store && i.second.m_type != 0) {
+            m_pendingSync[&store] |= changes;
+            break;
+        }
+    }
+}
+
 // Handle instrument deletion
 void MainFrame::onInstDelete(wxTreeEvent& event)
 {
@@ -252,13 +289,9 @@ void MainFrame::onInstSelect(wxTreeEvent& event)
             wxProgressDialog prog(_("Read from device"), _("Reading instruments from device..."), 6180, this,
                                   wxPD_APP_MODAL | wxPD_AUTO_HIDE | wxPD_CAN_ABORT | wxPD_ELAPSED_TIME | wxPD_REMAINING_TIME);
             store.m_store->readFromDevice(store.m_midiIn, store.m_midiOut, updateProgress, &prog);
-            m_instTree->DeleteChildren(item);
-            for (auto& i : *(store.m_store)) {
-                wxString instName(wxT("("));
-                instName << uint16_t(i.first) << wxT(") ");
-                instName << wxString::From8BitData(i.second.getName().c_str());
-                m_instTree->AppendItem(item, instName, -1, -1, new InstrumentHelper(store, i.first));
-            }
+
+            // The device already holds what has just been read, don't send it back
+            m_pendingSync.erase(store.m_store);
             //writeDevice();
         }
     }
@@ -296,14 +329,8 @@ void MainFrame::onInstEndDrag(wxTreeEvent& event)
         if (store.m_store != nullptr && m_dragStore != nullptr
                 &&store.m_store != m_dragStore && store.m_type != 0 && icbNum == 0) {
             // Instrument store drag from cartridge to device - allow it
+            // Tree items and device sync state are updated through the change notification
             store.m_store->copyContents(*m_dragStore);
-            m_instTree->DeleteChildren(item);
-            for (auto& i : *(store.m_store)) {
-                wxString instName(wxT("("));
-                instName << uint16_t(i.first) << wxT(") ");
-                instName << wxString::From8BitData(i.second.getName().c_str());
-                m_instTree->AppendItem(item, instName, -1, -1, new InstrumentHelper(store, i.first));
-            }
             event.Allow();
             return;
         }
@@ -339,6 +366,24 @@ void MainFrame::onEditRename(wxCommandEvent& /*event*/)
 {
 }
 
+// Handle edit/undo menu item
+void MainFrame::onEditUndo(wxCommandEvent& /*event*/)
+{
+    auto history = getSelectedHistory();
+    if (history != nullptr) {
+        history->undo();
+    }
+}
+
+// Handle edit/redo menu item
+void MainFrame::onEditRedo(wxCommandEvent& /*event*/)
+{
+    auto history = getSelectedHistory();
+    if (history != nullptr) {
+        history->redo();
+    }
+}
+
 // Create devices from configuration
 void MainFrame::createDevices()
 {
@@ -363,7 +408,7 @@ void MainFrame::createDevices()
             is.m_midiIn = new RtMidiIn;
             is.m_midiOut = new RtMidiOut;
 
-            is.m_store = new Dx10Device(new uint8_t[6180], 6180);
+            is.m_store = new Dx10Device();
             is.m_midiIn->setCallback(SysEx::rtMidiCallback, is.m_store);
 
             // Look up and open input port
@@ -413,19 +458,16 @@ void MainFrame::createDevices()
             // Create instrument store
             auto id = m_instTree->AppendItem(m_devices, name, -1, -1, new InstrumentHelper(is, 0));
             for (auto& i : *(is.m_store)) {
-                wxString instName(wxT("("));
-                instName << uint16_t(i.first) << wxT(") ");
-                instName << wxString::From8BitData(i.second.getName().c_str());
-                m_instTree->AppendItem(id, instName, -1, -1, new InstrumentHelper(is, i.first));
+                m_instTree->AppendItem(id, instrumentLabel(i.first, i.second), -1, -1, new InstrumentHelper(is, i.first));
             }
             m_instrumentStores.insert(std::pair<wxString, InstStore>(name, is));
+            is.m_store->addObserver(this);
+            m_histories[is.m_store] = new History(*is.m_store);
         }
         catch (Exception& e) {
             if (is.m_store != nullptr) {
-                auto buffer = static_cast<uint8_t*>(is.m_store->getBuffer());
                 delete is.m_store;
                 is.m_store = nullptr;
-                delete[] buffer;
             }
             if (is.m_midiOut != nullptr) {
                 delete is.m_midiOut;
@@ -463,15 +505,15 @@ void MainFrame::readCartridgeFile(const wxString& filePath, const wxString& cart
     wxFileInputStream fileStream(file);
     if (fileStream.IsOk()) {
         InstrumentStore* store(nullptr);
-        char* buffer(new char[size]);
+        std::vector<char> buffer(size);
         try {
-            fileStream.Read(buffer, size);
+            fileStream.Read(buffer.data(), size);
             if (fileStream.LastRead() != size_t(size)) {
                 throw DataFormatException("Could not read whole cartridge data");
             }
             if (store == nullptr) {
                 try {
-                    store = new Mk1Cartridge(buffer);
+                    store = new Mk1Cartridge(buffer.data(), size);
                 }
                 catch (DataFormatException&) {
                     // Ignore data format errors, try next type
@@ -479,7 +521,7 @@ void MainFrame::readCartridgeFile(const wxString& filePath, const wxString& cart
             }
             if (store == nullptr) {
                 try {
-                    store = new Dx10Cartridge(buffer, size);
+                    store = new Dx10Cartridge(buffer.data(), size);
                 }
                 catch (DataFormatException&) {
                     // Ignore data format errors, try next type
@@ -497,20 +539,16 @@ void MainFrame::readCartridgeFile(const wxString& filePath, const wxString& cart
             is.m_type = 0;
             auto id = m_instTree->AppendItem(m_cartridges, cartName, -1, -1, new InstrumentHelper(is, 0));
             for (auto& i : *store) {
-                wxString instName(wxT("("));
-                instName << uint16_t(i.first) << wxT(") ");
-                instName << wxString::From8BitData(i.second.getName().c_str());
-                m_instTree->AppendItem(id, instName, -1, -1, new InstrumentHelper(is, i.first));
+                m_instTree->AppendItem(id, instrumentLabel(i.first, i.second), -1, -1, new InstrumentHelper(is, i.first));
             }
             m_instrumentStores.insert(std::pair<wxString, InstStore>(cartName, is));
+            store->addObserver(this);
+            m_histories[store] = new History(*store);
         }
         catch (...) {
             if (store != nullptr) {
                 delete store;
             }
-            if (buffer != nullptr) {
-                delete[] buffer;
-            }
             throw;
         }
     }
@@ -614,14 +652,11 @@ void MainFrame::addDevice()
             is.m_type = dlg.getType();
 
             // Create instrument store
-            is.m_store = new Dx10Device(new uint8_t[6180], 6180);
+            is.m_store = new Dx10Device();
 
             auto id = m_instTree->AppendItem(m_devices, name, -1, -1, new InstrumentHelper(is, 0));
             for (auto& i : *(is.m_store)) {
-                wxString instName(wxT("("));
-                instName << uint16_t(i.first) << wxT(") ");
-                instName << wxString::From8BitData(i.second.getName().c_str());
-                m_instTree->AppendItem(id, instName, -1, -1, new InstrumentHelper(is, i.first));
+                m_instTree->AppendItem(id, instrumentLabel(i.first, i.second), -1, -1, new InstrumentHelper(is, i.first));
             }
             m_instrumentStores.insert(std::pair<wxString, InstStore>(name, is));
             m_config.SetPath(wxT("/Devices"));
@@ -631,14 +666,14 @@ void MainFrame::addDevice()
             m_config.Write(wxT("Channel"), long(is.m_channel));
             m_config.Write(wxT("Type"), long(is.m_type));
             m_config.Flush();
+            is.m_store->addObserver(this);
+            m_histories[is.m_store] = new History(*is.m_store);
             is.m_midiIn->setCallback(SysEx::rtMidiCallback, is.m_store);
         }
         catch (ConfigurationException& e) {
             if (is.m_store != nullptr) {
-                auto buffer = static_cast<uint8_t*>(is.m_store->getBuffer());
                 delete is.m_store;
                 is.m_store = nullptr;
-                delete[] buffer;
             }
             if (is.m_midiIn != nullptr) {
                 delete is.m_midiIn;
@@ -670,60 +705,54 @@ void MainFrame::addDevice()
 // Write MIDI device
 void MainFrame::writeDevice(const InstStore& store)
 {
-    uint8_t offset = 0;
+    // Only send blocks changed since the last write
+    auto pending = m_pendingSync.find(store.m_store);
+    if (pending == m_pendingSync.end()) {
+        return;
+    }
+    const ChangeSet& changes = pending->second;
 
     // Send ICBs
-    for (auto& i : *(store.m_store)) {
-        SysEx::sendIcb(store.m_midiOut, store.m_type, i.first, i.second);
-        if (offset == 0) {
-            offset = i.first - 1;
+    for (size_t i = 0; i < 256; ++i) {
+        auto icb = changes.test(ChangeSet::BlockType::Icb, i) ? store.m_store->getIcb(i) : nullptr;
+        if (icb != nullptr) {
+            SysEx::sendIcb(store.m_midiOut, store.m_type, i, *icb);
         }
     }
 
     // Send VCFs
-    for (size_t i = 0; i < 10; ++i) {
-        uint8_t addr = i + offset;
-        auto vcf = store.m_store->getVcf(addr);
+    for (size_t i = 0; i < 256; ++i) {
+        auto vcf = changes.test(ChangeSet::BlockType::Vcf, i) ? store.m_store->getVcf(i) : nullptr;
         if (vcf != nullptr) {
-            SysEx::sendVcf(store.m_midiOut, store.m_type, addr, *vcf);
+            SysEx::sendVcf(store.m_midiOut, store.m_type, i, *vcf);
         }
     }
 
     // Send AMPLs
-    for (size_t i = 0; i < 20; ++i) {
-        uint8_t addr = i + offset;
-        if (i >= 10) {
-            ++addr;
-        }
-        auto ampl = store.m_store->getAmpl(addr);
+    for (size_t i = 0; i < 256; ++i) {
+        auto ampl = changes.test(ChangeSet::BlockType::Ampl, i) ? store.m_store->getAmpl(i) : nullptr;
         if (ampl != nullptr) {
-            SysEx::sendAmpl(store.m_midiOut, store.m_type, addr, *ampl);
+            SysEx::sendAmpl(store.m_midiOut, store.m_type, i, *ampl);
         }
     }
 
     // Send FREQs
-    for (size_t i = 0; i < 20; ++i) {
-        uint8_t addr = i + offset;
-        if (i >= 10) {
-            ++addr;
-        }
-        auto freq = store.m_store->getFreq(addr);
+    for (size_t i = 0; i < 256; ++i) {
+        auto freq = changes.test(ChangeSet::BlockType::Freq, i) ? store.m_store->getFreq(i) : nullptr;
         if (freq != nullptr) {
-            SysEx::sendFreq(store.m_midiOut, store.m_type, addr, *freq);
+            SysEx::sendFreq(store.m_midiOut, store.m_type, i, *freq);
         }
     }
 
     // Send WAVEs
-    for (size_t i = 0; i < 20; ++i) {
-        uint8_t addr = i + offset;
-        if (i >= 10) {
-            ++addr;
-        }
-        auto wave = store.m_store->getWave(addr);
+    for (size_t i = 0; i < 256; ++i) {
+        auto wave = changes.test(ChangeSet::BlockType::Wave, i) ? store.m_store->getWave(i) : nullptr;
         if (wave != nullptr) {
-            SysEx::sendWave(store.m_midiOut, store.m_type, addr, *wave);
+            SysEx::sendWave(store.m_midiOut, store.m_type, i, *wave);
         }
     }
+
+    m_pendingSync.erase(pending);
 }
 #else // HAVE_RTMIDI
 void MainFrame::readDevice(const InstStore& /*store*/)
@@ -734,6 +763,51 @@ void MainFrame::writeDevice(const InstStore& /*store*/)
 }
 #endif // HAVE_RTMIDI
 
+// Find tree item of instrument store
+wxTreeItemId MainFrame::findStoreItem(InstrumentStore* store)
+{
+    wxTreeItemId parents[] = { m_devices, m_cartridges };
+    for (auto& parent : parents) {
+        wxTreeItemIdValue cookie;
+        auto child = m_instTree->GetFirstChild(parent, cookie);
+        while (child.IsOk()) {
+            auto inst = dynamic_cast<InstrumentHelper*>(m_instTree->GetItemData(child));
+            if (inst != nullptr && inst->getStore().m_store == store) {
+                return child;
+            }
+            child = m_instTree->GetNextChild(parent, cookie);
+        }
+    }
+    return wxTreeItemId();
+}
+
+// Find history of selected instrument store
+History* MainFrame::getSelectedHistory()
+{
+    auto item = m_instTree->GetSelection();
+    if (!item.IsOk()) {
+        return nullptr;
+    }
+    auto inst = dynamic_cast<InstrumentHelper*>(m_instTree->GetItemData(item));
+    if (inst == nullptr) {
+        return nullptr;
+    }
+    auto history = m_histories.find(inst->getStore().m_store);
+    if (history == m_histories.end()) {
+        return nullptr;
+    }
+    return history->second;
+}
+
+// Build instrument tree label
+wxString MainFrame::instrumentLabel(uint8_t icbNum, const Icb& icb)
+{
+    wxString instName(wxT("("));
+    instName << uint16_t(icbNum) << wxT(") ");
+    instName << wxString::From8BitData(icb.getName().c_str());
+    return instName;
+}
+
 // Update progress dialog
 bool MainFrame::updateProgress(void* object, uint32_t current, uint32_t /*max*/)
 {
@@ -38,6 +38,7 @@
 #pragma once
 
 #include <gui/gui.hh>
+#include <wersi/instrumentstore.hh>
 #include <wx/config.h>
 #include <map>
 #include <string>
@@ -50,9 +51,9 @@ class RtMidiOut;
 
 namespace DMSToolbox {
 
-namespace Wersi {
 // Forward declarations
-class InstrumentStore;
+namespace Wersi {
+class History;
 } // namespace Wersi
 
 namespace Gui {
@@ -69,7 +70,7 @@ class WavePanel;
 
   This class implements the parts of the main frame that are not included in the generated MainFrameBase class.
  */
-class MainFrame : public MainFrameBase {
+class MainFrame : public MainFrameBase, public Wersi::InstrumentStore::Observer {
     public:
         /**
           Create main frame.
@@ -95,6 +96,9 @@ class MainFrame : public MainFrameBase {
          */
         void applyConfiguration();
 
+        /// Implements Wersi::InstrumentStore::Observer::storeChanged()
+        virtual void storeChanged(Wersi::InstrumentStore& store, const Wersi::ChangeSet& changes);
+
     protected:
         /**
           Instrument deletion event handler.
@@ -168,6 +172,24 @@ class MainFrame : public MainFrameBase {
          */
         virtual void onEditRename(wxCommandEvent& event);
 
+        /**
+          Edit/undo menu event handler.
+
+          Handles the edit/undo menu item, undoing the last change of the selected instrument store.
+
+          @param[in]    event       Menu item command event
+         */
+        virtual void onEditUndo(wxCommandEvent& event);
+
+        /**
+          Edit/redo menu event handler.
+
+          Handles the edit/redo menu item, redoing the last undone change of the selected instrument store.
+
+          @param[in]    event       Menu item command event
+         */
+        virtual void onEditRedo(wxCommandEvent& event);
+
     private:
         /// Instrument store wrapper struct to hold MIDI information for physical devices
         struct InstStore {
@@ -220,6 +242,12 @@ class MainFrame : public MainFrameBase {
         /// Source storage on drag&drop copy action
         Wersi::InstrumentStore* m_dragStore;
 
+        /// Blocks changed on device stores since they were last written to the device
+        std::map<Wersi::InstrumentStore*, Wersi::ChangeSet> m_pendingSync;
+
+        /// Undo/redo histories of instrument stores
+        std::map<Wersi::InstrumentStore*, Wersi::History*> m_histories;
+
         /**
           Create devices from configuration.
 
@@ -248,12 +276,45 @@ class MainFrame : public MainFrameBase {
         /**
           Write device contents.
 
-          Writes all instrument data to a device using the given instrument store wrapper.
+          Writes the instrument data changed since the last write to a device using the given instrument store
+          wrapper.
 
           @param[in]    store       Instrument store with all necessary device data
          */
         void writeDevice(const InstStore& store);
 
+        /**
+          Find instrument store tree item.
+
+          Looks up the tree item representing the given instrument store.
+
+          @param[in]    store       Instrument store to look up
+
+          @return                   Tree item, invalid if not found
+         */
+        wxTreeItemId findStoreItem(Wersi::InstrumentStore* store);
+
+        /**
+          Find history of selected instrument store.
+
+          Looks up the undo/redo history of the instrument store the selected tree item belongs to.
+
+          @return                   History or nullptr if nothing suitable is selected
+         */
+        Wersi::History* getSelectedHistory();
+
+        /**
+          Build instrument tree label.
+
+          Builds the label used for an instrument in the instrument tree.
+
+          @param[in]    icbNum      ICB number
+          @param[in]    icb         ICB data
+
+          @return                   Instrument label
+         */
+        static wxString instrumentLabel(uint8_t icbNum, const Wersi::Icb& icb);
+
         /**
           Update a progress dialog.
 
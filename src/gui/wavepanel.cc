@@ -39,21 +39,34 @@
 #include <wersi/wave.hh>
 #include <wx/dcmemory.h>
 #include <wx/dcclient.h>
+#include <algorithm>
+#include <cmath>
 #include <memory>
 
 using namespace DMSToolbox::Wersi;
+using namespace DMSToolbox::Synth;
 
 namespace DMSToolbox {
 namespace Gui {
 
+// Height of the wave drawing
+static const int WaveHeight = 256;
+
+// Height of the harmonic bars below the wave
+static const int SpectrumHeight = 128;
+
+// Harmonic level range shown by the bars in dB
+static const float SpectrumRange = 60.0f;
+
 // Create wave panel
 WavePanel::WavePanel(wxWindow* parent)
     : WavePanelBase(parent)
-    , m_bassPanel(new wxPanel(this, wxID_ANY, wxDefaultPosition, wxSize(512, 256)))
-    , m_tenorPanel(new wxPanel(this, wxID_ANY, wxDefaultPosition, wxSize(512, 256)))
-    , m_altoPanel(new wxPanel(this, wxID_ANY, wxDefaultPosition, wxSize(512, 256)))
-    , m_sopranoPanel(new wxPanel(this, wxID_ANY, wxDefaultPosition, wxSize(512, 256)))
+    , m_bassPanel(new wxPanel(this, wxID_ANY, wxDefaultPosition, wxSize(512, WaveHeight + SpectrumHeight)))
+    , m_tenorPanel(new wxPanel(this, wxID_ANY, wxDefaultPosition, wxSize(512, WaveHeight + SpectrumHeight)))
+    , m_altoPanel(new wxPanel(this, wxID_ANY, wxDefaultPosition, wxSize(512, WaveHeight + SpectrumHeight)))
+    , m_sopranoPanel(new wxPanel(this, wxID_ANY, wxDefaultPosition, wxSize(512, WaveHeight + SpectrumHeight)))
     , m_wave(nullptr)
+    , m_spectra(16)
 {
     m_bassPanelSizer->Add(m_bassPanel, 1, wxALIGN_CENTER | wxALL, 10);
     m_bassPanel->Connect(wxEVT_PAINT, wxPaintEventHandler(WavePanel::onPaint), NULL, this);
@@ -85,6 +98,7 @@ void WavePanel::onPaint(wxPaintEvent& event)
     uint8_t* source = nullptr;
     size_t size = 0;
     wxPanel* target = nullptr;
+    WaveTableSet::Range range = WaveTableSet::Range::Bass;
     if (obj == m_bassPanel) {
         if (m_wave != nullptr) {
             source = m_wave->getBass();
@@ -98,6 +112,7 @@ void WavePanel::onPaint(wxPaintEvent& event)
             size = 64;
         }
         target = m_tenorPanel;
+        range = WaveTableSet::Range::Tenor;
     }
     else if (obj == m_altoPanel) {
         if (m_wave != nullptr) {
@@ -105,6 +120,7 @@ void WavePanel::onPaint(wxPaintEvent& event)
             size = 32;
         }
         target = m_altoPanel;
+        range = WaveTableSet::Range::Alto;
     }
     else if (obj == m_sopranoPanel) {
         if (m_wave != nullptr) {
@@ -112,6 +128,7 @@ void WavePanel::onPaint(wxPaintEvent& event)
             size = 16;
         }
         target = m_sopranoPanel;
+        range = WaveTableSet::Range::Soprano;
     }
 
     if (target != nullptr) {
@@ -125,6 +142,20 @@ void WavePanel::onPaint(wxPaintEvent& event)
             }
             points[size] = wxPoint(size * factor, 255 - source[0]);
             dc.DrawSpline(size + 1, points.get());
+
+            // Harmonic levels from the top of the bars down to the lower end of the range
+            std::shared_ptr<const WaveSpectrum> spectrum = m_spectra.get(*m_wave);
+            size_t harmonics = WaveSpectrum::getNumHarmonics(range) - 1;
+            int width = int(512 / harmonics);
+            dc.SetBrush(*wxGREY_BRUSH);
+            for (size_t h = 1; h <= harmonics; ++h) {
+                float magnitude = spectrum->getMagnitude(range, h);
+                float level = magnitude > 0.0f ? 20.0f * std::log10(magnitude) : -SpectrumRange;
+                int height = int(float(SpectrumHeight) * (1.0f + std::max(level, -SpectrumRange) / SpectrumRange));
+                if (height > 0) {
+                    dc.DrawRectangle(int(h - 1) * width + 1, WaveHeight + SpectrumHeight - height, width - 2, height);
+                }
+            }
         }
     }
 }
@@ -38,6 +38,7 @@
 #pragma once
 
 #include <gui/gui.hh>
+#include <synth/wavespectrumcache.hh>
 
 namespace DMSToolbox {
 
@@ -53,7 +54,8 @@ namespace Gui {
 
   Wave panel implementation.
 
-  This class implements the wave panel allowing viewing and editing WAVE blocks.
+  This class implements the wave panel allowing viewing and editing WAVE blocks. Below each wave, the levels of its
+  harmonics are drawn as bars.
  */
 class WavePanel : public WavePanelBase {
     public:
@@ -83,6 +85,7 @@ class WavePanel : public WavePanelBase {
         wxPanel*        m_sopranoPanel; ///< Bass wave drawing panel
 
         Wersi::Wave*    m_wave;         ///< Wave data being edited
+        Synth::WaveSpectrumCache    m_spectra;  ///< Spectra of displayed waves
 
         /**
           Handle paint event.
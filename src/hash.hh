@@ -0,0 +1,72 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+
+namespace DMSToolbox {
+
+/**
+  @ingroup common_group
+
+  Content hash.
+
+  Computes 64-bit FNV-1a hashes of raw data. Hashes are used as cache keys for data derived from instrument blocks,
+  so equal blocks share cached data, even across instrument stores. Several blocks can be hashed into one key by
+  passing the previous result as seed.
+ */
+class Hash {
+    public:
+        /// Initial seed
+        static const uint64_t Seed = 0xcbf29ce484222325ULL;
+
+        /**
+          Hash raw data.
+
+          Returns the hash of the given data.
+
+          @param[in]    data        Data to hash
+          @param[in]    size        Size of data in bytes
+          @param[in]    seed        Initial value, usually the hash of preceding data
+
+          @return                   Hash value
+         */
+        static uint64_t compute(const void* data, size_t size, uint64_t seed = Seed);
+};
+
+} // namespace DMSToolbox
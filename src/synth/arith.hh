@@ -0,0 +1,136 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <common.hh>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Floating point arithmetic policy.
+
+  Render kernels are templates on an arithmetic policy, which defines how samples, phases and gains are represented.
+  The policy is a compile-time parameter, so the inner loops of a kernel contain no runtime dispatch. With this
+  policy, kernels work on 32 bit floats, process four voices per SIMD register and interpolate between table
+  samples. This is the fast path used by the render engine.
+ */
+struct FloatArith {
+    typedef float       Sample;     ///< Table sample, -1..1
+    typedef float       Phase;      ///< Oscillator phase, 0..1
+    typedef float       Length;     ///< Table length
+
+    /**
+      Convert phase increment.
+
+      @param[in]    cycles      Periods per sample
+
+      @return                   Phase increment
+     */
+    static Phase getIncrement(float cycles) {
+        return cycles > 0.0f ? cycles : 0.0f;
+    }
+
+    /**
+      Convert table length.
+
+      @param[in]    length      Number of samples of one period
+
+      @return                   Table length
+     */
+    static Length getLength(size_t length) {
+        return float(length);
+    }
+};
+
+/**
+  @ingroup synth_group
+
+  Fixed point arithmetic policy.
+
+  Models the integer data path of the 8 bit DMS slaves for reference renders. Tables are the raw unsigned 8 bit wave
+  bytes with 128 as zero, played without interpolation from a 32 bit phase accumulator, and gains are quantized to
+  15 bits. Results only leave the integer domain when they are written to the float output of a kernel, so renders
+  are bit-exact on every platform. Slower than FloatArith, and aliasing like the original hardware.
+ */
+struct FixedArith {
+    typedef uint8_t     Sample;     ///< Raw table byte, 128 is zero
+    typedef uint32_t    Phase;      ///< Oscillator phase as 0.32 fixed point
+    typedef uint32_t    Length;     ///< Table length
+
+    /// Number of fractional gain bits
+    static const unsigned GainBits = 15;
+
+    /**
+      Convert phase increment.
+
+      @param[in]    cycles      Periods per sample
+
+      @return                   Phase increment
+     */
+    static Phase getIncrement(float cycles) {
+        return cycles > 0.0f && cycles < 1.0f ? Phase(double(cycles) * 4294967296.0) : 0;
+    }
+
+    /**
+      Convert table length.
+
+      @param[in]    length      Number of samples of one period
+
+      @return                   Table length
+     */
+    static Length getLength(size_t length) {
+        return Length(length);
+    }
+
+    /**
+      Convert gain.
+
+      @param[in]    gain        Gain, 0..1
+
+      @return                   Gain as fixed point
+     */
+    static int32_t getGain(float gain) {
+        float scaled = gain * float(1 << GainBits) + 0.5f;
+        return scaled > 0.0f ? (scaled < float(1 << GainBits) ? int32_t(scaled) : int32_t(1 << GainBits)) : 0;
+    }
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,75 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/audiosink.hh>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Destroy audio sink
+AudioSink::~AudioSink()
+{
+}
+
+// Create null sink
+NullSink::NullSink()
+    : AudioSink()
+    , m_frames(0)
+{
+}
+
+// Count samples
+void NullSink::consume(const float* /*left*/, const float* /*right*/, size_t frames)
+{
+    m_frames.fetch_add(frames, std::memory_order_relaxed);
+}
+
+// Create WAV file sink
+WavSink::WavSink(const std::string& filename, uint32_t sampleRate)
+    : AudioSink()
+    , m_writer(filename, sampleRate)
+{
+}
+
+// Write samples
+void WavSink::consume(const float* left, const float* right, size_t frames)
+{
+    m_writer.write(left, right, frames);
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
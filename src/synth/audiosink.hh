@@ -0,0 +1,149 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <synth/wavwriter.hh>
+#include <atomic>
+#include <string>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Audio sink interface.
+
+  Receives the output of a PreviewEngine one period at a time, called from the clock thread of the engine. Sinks
+  for audio devices pass the samples on, the sinks here are meant for testing and recording.
+ */
+class AudioSink {
+    public:
+        /**
+          Destroy audio sink.
+
+          Destroys the sink.
+         */
+        virtual ~AudioSink();
+
+        /**
+          Consume samples.
+
+          Receives one period of stereo samples.
+
+          @param[in]    left        Left samples
+          @param[in]    right       Right samples
+          @param[in]    frames      Number of frames
+         */
+        virtual void consume(const float* left, const float* right, size_t frames) = 0;
+};
+
+/**
+  @ingroup synth_group
+
+  Null audio sink.
+
+  Discards all samples, only counts them.
+ */
+class NullSink : public AudioSink {
+    public:
+        /**
+          Create null sink.
+
+          Creates a sink with no frames consumed.
+         */
+        NullSink();
+
+        /**
+          Get number of frames.
+
+          Returns the number of consumed frames.
+
+          @return                   Number of frames
+         */
+        uint64_t getFrames() const {
+            return m_frames.load(std::memory_order_relaxed);
+        }
+
+        /// Implements AudioSink::consume()
+        virtual void consume(const float* left, const float* right, size_t frames);
+
+    private:
+        std::atomic<uint64_t>   m_frames;       ///< Number of consumed frames
+};
+
+/**
+  @ingroup synth_group
+
+  WAV file audio sink.
+
+  Records all samples to a WAV file. File writes are not bounded in time, so this sink is meant for testing.
+ */
+class WavSink : public AudioSink {
+    public:
+        /**
+          Create WAV file sink.
+
+          Creates the WAV file.
+
+          @param[in]    filename    File name
+          @param[in]    sampleRate  Sample rate in Hz
+
+          @exception    SystemException     Cannot create the file
+         */
+        WavSink(const std::string& filename, uint32_t sampleRate);
+
+        /**
+          Close WAV file.
+
+          Completes the file, must not be called while the sink is in use.
+         */
+        void close() {
+            m_writer.close();
+        }
+
+        /// Implements AudioSink::consume()
+        virtual void consume(const float* left, const float* right, size_t frames);
+
+    private:
+        WavWriter               m_writer;       ///< WAV file writer
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
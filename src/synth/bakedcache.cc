@@ -0,0 +1,225 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+#include <synth/bakedcache.hh>
+#include <synth/instrument.hh>
+#include <synth/patch.hh>
+#include <wersi/instrumentstore.hh>
+#include <wersi/icb.hh>
+#include <wersi/vcf.hh>
+#include <wersi/envelope.hh>
+#include <wersi/wave.hh>
+#include <exceptions.hh>
+#include <hash.hh>
+#include <cstdio>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace DMSToolbox {
+namespace Synth {
+
+// ICB bytes holding the sound settings, following the block links and preceding the name
+static const size_t IcbSettingsOffset = 5;
+
+// Number of ICB sound setting bytes
+static const size_t IcbSettingsSize = 5;
+
+// Size of a VCF block
+static const size_t VcfSize = 10;
+
+// Bake file name extension
+static const char* Extension = ".dmsb";
+
+// Hash optional block, absent blocks hash differently from empty ones
+static uint64_t hashBlock(const void* data, size_t size, uint64_t seed)
+{
+    uint8_t present = data != nullptr ? 1 : 0;
+    seed = Hash::compute(&present, 1, seed);
+    return data != nullptr ? Hash::compute(data, size, seed) : seed;
+}
+
+// Get experimental build features changing the rendering, bakes of other builds must not be taken
+static uint64_t getFeatures()
+{
+    uint64_t features = 0;
+#ifdef EXPERIMENTAL_FORMANTS
+    features |= 1;
+#endif // EXPERIMENTAL_FORMANTS
+#ifdef EXPERIMENTAL_ENVELOPES
+    features |= 2;
+#endif // EXPERIMENTAL_ENVELOPES
+    return features;
+}
+
+// Create baked instrument cache
+BakedCache::BakedCache(const std::string& directory, const BakedInstrument::Settings& settings)
+    : m_directory(directory)
+    , m_settings(settings)
+    , m_seed(Hash::Seed)
+    , m_entries()
+    , m_mutex()
+    , m_hits(0)
+    , m_bakes(0)
+{
+    uint64_t values[] = {
+        BakedInstrument::Version, settings.m_sampleRate, settings.m_length, settings.m_tail,
+        settings.m_notes.size(), settings.m_velocities.size(), getFeatures()
+    };
+    m_seed = Hash::compute(values, sizeof(values), m_seed);
+    m_seed = Hash::compute(settings.m_notes.data(), settings.m_notes.size(), m_seed);
+    m_seed = Hash::compute(settings.m_velocities.data(), settings.m_velocities.size(), m_seed);
+}
+
+// Compute cache key of instrument
+uint64_t BakedCache::getKey(Wersi::InstrumentStore& store, uint8_t icb) const
+{
+    Patch patch(store, icb);
+    uint64_t numLayers = patch.getNumLayers();
+    uint64_t key = Hash::compute(&numLayers, sizeof(numLayers), m_seed);
+    for (size_t i = 0; i < patch.getNumLayers(); ++i) {
+        const Patch::Layer& layer = patch.getLayer(i);
+        Wersi::Icb* block = store.getIcb(layer.m_icb);
+        const uint8_t* settings = block != nullptr ? static_cast<const uint8_t*>(block->getBuffer()) : nullptr;
+        key = hashBlock(settings != nullptr ? settings + IcbSettingsOffset : nullptr, IcbSettingsSize, key);
+
+        Wersi::Vcf* vcf = store.getVcf(layer.m_vcf);
+        key = hashBlock(vcf != nullptr ? vcf->getBuffer() : nullptr, VcfSize, key);
+        Wersi::Envelope* ampl = store.getAmpl(layer.m_ampl);
+        key = hashBlock(ampl != nullptr ? ampl->getBuffer() : nullptr, ampl != nullptr ? ampl->getBufferSize() : 0,
+                        key);
+        Wersi::Envelope* freq = store.getFreq(layer.m_freq);
+        key = hashBlock(freq != nullptr ? freq->getBuffer() : nullptr, freq != nullptr ? freq->getBufferSize() : 0,
+                        key);
+        Wersi::Wave* wave = store.getWave(layer.m_wave);
+        uint64_t waveHash = wave != nullptr ? wave->getHash() : 0;
+        key = hashBlock(wave != nullptr ? &waveHash : nullptr, sizeof(waveHash), key);
+    }
+    return key;
+}
+
+// Find entry in memory or cache directory
+std::shared_ptr<const BakedInstrument> BakedCache::find(uint64_t key)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        EntryMap::iterator it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            std::shared_ptr<const BakedInstrument> entry = it->second.lock();
+            if (entry != nullptr) {
+                ++m_hits;
+                return entry;
+            }
+            m_entries.erase(it);
+        }
+    }
+
+    // Missing, damaged or outdated files are all misses
+    std::shared_ptr<const BakedInstrument> entry;
+    try {
+        entry = std::make_shared<BakedInstrument>(getFileName(key), key);
+    }
+    catch (Exception&) {
+        return nullptr;
+    }
+    ++m_hits;
+    return add(entry);
+}
+
+// Render entry and write bake file
+std::shared_ptr<const BakedInstrument> BakedCache::bake(uint64_t key,
+                                                        const std::shared_ptr<const Instrument>& instrument)
+{
+    std::string filename = getFileName(key);
+    std::stringstream temp;
+#ifdef _WIN32
+    int pid = _getpid();
+#else
+    pid_t pid = getpid();
+#endif
+
+    // Name the temporary file after process and thread, other processes may bake into the same directory
+    temp << filename << "." << std::hex << pid << "." << std::hash<std::thread::id>()(std::this_thread::get_id());
+    BakedInstrument::bake(temp.str(), key, instrument, m_settings);
+    if (std::rename(temp.str().c_str(), filename.c_str()) != 0) {
+        std::remove(temp.str().c_str());
+        throw SystemException("Unable to rename bake file to " + filename);
+    }
+    ++m_bakes;
+    return add(std::make_shared<BakedInstrument>(filename, key));
+}
+
+// Get entry, baking it if not cached
+std::shared_ptr<const BakedInstrument> BakedCache::get(Wersi::InstrumentStore& store, uint8_t icb,
+                                                       EnvelopeCache& envelopes, WaveMipmapCache& waves)
+{
+    uint64_t key = getKey(store, icb);
+    std::shared_ptr<const BakedInstrument> entry = find(key);
+    if (entry == nullptr) {
+        entry = bake(key, std::make_shared<Instrument>(store, icb, envelopes, waves));
+    }
+    return entry;
+}
+
+// Get bake file name
+std::string BakedCache::getFileName(uint64_t key) const
+{
+    std::stringstream filename;
+    filename << m_directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << Extension;
+    return filename.str();
+}
+
+// Add entry in use
+std::shared_ptr<const BakedInstrument> BakedCache::add(const std::shared_ptr<const BakedInstrument>& entry)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::weak_ptr<const BakedInstrument>& slot = m_entries[entry->getKey()];
+    std::shared_ptr<const BakedInstrument> current = slot.lock();
+    if (current != nullptr) {
+        return current;
+    }
+    slot = entry;
+    return entry;
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,202 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <common.hh>
+#include <synth/bakedinstrument.hh>
+#include <synth/wavemipmapcache.hh>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace DMSToolbox {
+
+// Forward declarations
+namespace Wersi {
+class InstrumentStore;
+} // namespace Wersi
+
+namespace Synth {
+
+// Forward declarations
+class EnvelopeCache;
+
+/**
+  @ingroup synth_group
+
+  Baked instrument cache.
+
+  Keeps pre-rendered notes of instruments in bake files in a cache directory, so instruments which have been
+  rendered before are just played back. Entries are keyed by a hash over the sound relevant settings of every ICB of
+  the chain and the contents of the VCF, AMPL, FREQ and wave blocks they reference, seeded with the render settings.
+  Changing any of these blocks changes the key, so stale entries are never found again. Block numbers and names are
+  not part of the key, so equal instruments share their entry even across cartridges. Bake files are written under a
+  temporary name and renamed, so several processes can share a cache directory. The cache may be used from several
+  threads.
+ */
+class BakedCache {
+    public:
+        /**
+          Create baked instrument cache.
+
+          Uses an existing directory as cache.
+
+          @param[in]    directory   Cache directory
+          @param[in]    settings    Render settings of all entries
+         */
+        BakedCache(const std::string& directory, const BakedInstrument::Settings& settings);
+
+        /**
+          Get cache key.
+
+          Computes the cache key of the instrument starting at the given ICB. The store must not be changed while
+          the key is computed.
+
+          @param[in]    store       Instrument store
+          @param[in]    icb         First ICB block number
+
+          @return                   Cache key
+         */
+        uint64_t getKey(Wersi::InstrumentStore& store, uint8_t icb) const;
+
+        /**
+          Find entry.
+
+          Returns the baked instrument with the given key if it is in use already or has a valid bake file.
+
+          @param[in]    key         Cache key
+
+          @return                   Baked instrument, null if not cached
+         */
+        std::shared_ptr<const BakedInstrument> find(uint64_t key);
+
+        /**
+          Bake entry.
+
+          Renders an instrument, writes its bake file and returns it.
+
+          @param[in]    key         Cache key of the instrument
+          @param[in]    instrument  Instrument to render
+
+          @return                   Baked instrument
+
+          @exception    SystemException     Bake file can't be written
+         */
+        std::shared_ptr<const BakedInstrument> bake(uint64_t key, const std::shared_ptr<const Instrument>& instrument);
+
+        /**
+          Get entry.
+
+          Returns the baked instrument starting at the given ICB, baking it if not cached. The caches must belong to
+          the given store and must not be used by other threads meanwhile.
+
+          @param[in]    store       Instrument store
+          @param[in]    icb         First ICB block number
+          @param[in]    envelopes   Envelope program cache of the store
+          @param[in]    waves       Band-limited wave table cache
+
+          @return                   Baked instrument
+
+          @exception    SystemException     Bake file can't be written
+         */
+        std::shared_ptr<const BakedInstrument> get(Wersi::InstrumentStore& store, uint8_t icb,
+                                                   EnvelopeCache& envelopes, WaveMipmapCache& waves);
+
+        /**
+          Get number of hits.
+
+          Returns how many entries have been found in memory or in the cache directory.
+
+          @return                   Number of hits
+         */
+        size_t getHits() const {
+            return m_hits;
+        }
+
+        /**
+          Get number of bakes.
+
+          Returns how many entries have been rendered.
+
+          @return                   Number of bakes
+         */
+        size_t getBakes() const {
+            return m_bakes;
+        }
+
+    private:
+        /// Map of entries in use by key
+        typedef std::map<uint64_t, std::weak_ptr<const BakedInstrument>> EntryMap;
+
+        std::string                 m_directory;    ///< Cache directory
+        BakedInstrument::Settings   m_settings;     ///< Render settings
+        uint64_t                    m_seed;         ///< Hash of the render settings
+        EntryMap                    m_entries;      ///< Entries in use
+        std::mutex                  m_mutex;        ///< Protects entries
+        std::atomic<size_t>         m_hits;         ///< Number of hits
+        std::atomic<size_t>         m_bakes;        ///< Number of bakes
+
+        /**
+          Get bake file name.
+
+          Returns the name of the bake file of an entry.
+
+          @param[in]    key         Cache key
+
+          @return                   File name
+         */
+        std::string getFileName(uint64_t key) const;
+
+        /**
+          Add entry.
+
+          Remembers an entry as in use, or returns the entry which another thread has added meanwhile.
+
+          @param[in]    entry       Entry to add
+
+          @return                   Entry in use
+         */
+        std::shared_ptr<const BakedInstrument> add(const std::shared_ptr<const BakedInstrument>& entry);
+
+        BakedCache(const BakedCache&);              ///< Inhibit copying objects
+        BakedCache& operator=(const BakedCache&);   ///< Inhibit copying objects
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,227 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+#include <synth/bakedinstrument.hh>
+#include <synth/engine.hh>
+#include <synth/instrument.hh>
+#include <synth/wavwriter.hh>
+#include <exceptions.hh>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Bake file format version
+const uint32_t BakedInstrument::Version;
+
+// File magic, reads differently on hosts with other byte order
+static const uint32_t Magic = 0x424d4444;
+
+// File header
+struct FileHeader {
+    uint32_t    m_magic;        ///< File magic
+    uint32_t    m_version;      ///< Format version
+    uint64_t    m_key;          ///< Cache key
+    uint32_t    m_sampleRate;   ///< Sample rate in Hz
+    uint32_t    m_numZones;     ///< Number of zone table entries following the header
+};
+
+// Zone table entry
+struct FileZone {
+    uint8_t     m_note;         ///< MIDI note
+    uint8_t     m_velocity;     ///< Note on velocity
+    uint16_t    m_reserved;     ///< Unused, zero
+    uint32_t    m_frames;       ///< Number of frames
+    uint64_t    m_offset;       ///< Offset of samples from start of file
+};
+
+// Open bake file
+BakedInstrument::BakedInstrument(const std::string& filename, uint64_t key)
+    : m_key(key)
+    , m_sampleRate(0)
+    , m_zones()
+    , m_map(nullptr)
+    , m_size(0)
+    , m_buffer()
+{
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw SystemException("Unable to open file " + filename);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw SystemException("Unable to stat file " + filename);
+    }
+    m_size = size_t(st.st_size);
+    if (m_size < sizeof(FileHeader)) {
+        ::close(fd);
+        throw DataFormatException("Bake file " + filename + " is truncated");
+    }
+    m_map = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (m_map == MAP_FAILED) {
+        m_map = nullptr;
+        throw SystemException("Unable to map file " + filename);
+    }
+    const char* data = static_cast<const char*>(m_map);
+#else
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    if (!file) {
+        throw SystemException("Unable to open file " + filename);
+    }
+    file.seekg(0, std::ios::end);
+    m_size = size_t(file.tellg());
+    file.seekg(0, std::ios::beg);
+    m_buffer.resize(m_size);
+    if (m_size < sizeof(FileHeader) || !file.read(m_buffer.data(), std::streamsize(m_size))) {
+        throw DataFormatException("Bake file " + filename + " is truncated");
+    }
+    const char* data = m_buffer.data();
+#endif
+
+    try {
+        FileHeader header;
+        memcpy(&header, data, sizeof(header));
+        if (header.m_magic != Magic || header.m_version != Version || header.m_key != key) {
+            throw DataFormatException("Bake file " + filename + " does not match");
+        }
+        size_t tableEnd = sizeof(FileHeader) + size_t(header.m_numZones) * sizeof(FileZone);
+        if (tableEnd > m_size) {
+            throw DataFormatException("Bake file " + filename + " is truncated");
+        }
+        m_sampleRate = header.m_sampleRate;
+
+        m_zones.reserve(header.m_numZones);
+        for (size_t i = 0; i < header.m_numZones; ++i) {
+            FileZone entry;
+            memcpy(&entry, data + sizeof(FileHeader) + i * sizeof(FileZone), sizeof(entry));
+            uint64_t bytes = uint64_t(entry.m_frames) * 2 * sizeof(int16_t);
+            if (entry.m_offset < tableEnd || (entry.m_offset & 1) != 0 || entry.m_offset > m_size
+                || bytes > m_size - entry.m_offset) {
+                throw DataFormatException("Bake file " + filename + " is damaged");
+            }
+            Zone zone = {
+                entry.m_note, entry.m_velocity, entry.m_frames,
+                reinterpret_cast<const int16_t*>(data + entry.m_offset)
+            };
+            m_zones.push_back(zone);
+        }
+    }
+    catch (...) {
+#ifndef _WIN32
+        munmap(m_map, m_size);
+#endif
+        throw;
+    }
+}
+
+// Close bake file
+BakedInstrument::~BakedInstrument()
+{
+#ifndef _WIN32
+    if (m_map != nullptr) {
+        munmap(m_map, m_size);
+    }
+#endif
+}
+
+// Render notes and write bake file
+void BakedInstrument::bake(const std::string& filename, uint64_t key,
+                           const std::shared_ptr<const Instrument>& instrument, const Settings& settings)
+{
+    std::vector<FileZone> table;
+    std::vector<int16_t> samples;
+    std::vector<float> left(settings.m_length + settings.m_tail);
+    std::vector<float> right(left.size());
+    uint64_t offset = sizeof(FileHeader)
+                    + uint64_t(settings.m_notes.size()) * settings.m_velocities.size() * sizeof(FileZone);
+
+    Engine engine(Patch::MaxLayers, float(settings.m_sampleRate));
+    for (auto note : settings.m_notes) {
+        for (auto velocity : settings.m_velocities) {
+            size_t frames = engine.renderNote(instrument, note, velocity, settings.m_length,
+                                              left.data(), right.data(), left.size());
+
+            FileZone entry = { note, velocity, 0, uint32_t(frames), offset + samples.size() * sizeof(int16_t) };
+            table.push_back(entry);
+            for (size_t i = 0; i < frames; ++i) {
+                samples.push_back(WavWriter::convert(left[i]));
+                samples.push_back(WavWriter::convert(right[i]));
+            }
+        }
+    }
+
+    FileHeader header = { Magic, Version, key, settings.m_sampleRate, uint32_t(table.size()) };
+    std::ofstream file(filename.c_str(), std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw SystemException("Unable to create file " + filename);
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(table.data()), std::streamsize(table.size() * sizeof(FileZone)));
+    file.write(reinterpret_cast<const char*>(samples.data()), std::streamsize(samples.size() * sizeof(int16_t)));
+    file.close();
+    if (!file) {
+        throw SystemException("Unable to write file " + filename);
+    }
+}
+
+// Find closest zone
+const BakedInstrument::Zone* BakedInstrument::find(uint8_t note, uint8_t velocity) const
+{
+    const Zone* best = nullptr;
+    for (auto& zone : m_zones) {
+        if (best == nullptr
+            || std::abs(zone.m_note - note) < std::abs(best->m_note - note)
+            || (zone.m_note == best->m_note
+                && std::abs(zone.m_velocity - velocity) < std::abs(best->m_velocity - velocity))) {
+            best = &zone;
+        }
+    }
+    return best;
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
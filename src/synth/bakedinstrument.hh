@@ -0,0 +1,190 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <common.hh>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Forward declarations
+class Instrument;
+
+/**
+  @ingroup synth_group
+
+  Baked instrument.
+
+  Pre-rendered notes of an instrument, read from a bake file. A bake file holds a short header, a table of zones
+  (one rendered note at one velocity each) and the interleaved 16 bit stereo samples of all zones. Files are
+  mapped into memory where the platform supports it, so opening one is cheap and the samples are paged in on
+  demand and shared between processes. Samples are stored in host byte order, files written on a host with
+  different byte order are rejected like damaged ones and simply baked again.
+ */
+class BakedInstrument {
+    public:
+        /// Bake file format version, increase whenever rendering changes audibly
+        static const uint32_t Version = 1;
+
+        /// Rendered note
+        struct Zone {
+            uint8_t         m_note;         ///< MIDI note
+            uint8_t         m_velocity;     ///< Note on velocity
+            size_t          m_frames;       ///< Number of frames
+            const int16_t*  m_samples;      ///< Interleaved stereo samples
+        };
+
+        /// Render settings
+        struct Settings {
+            unsigned                m_sampleRate;   ///< Sample rate in Hz
+            size_t                  m_length;       ///< Note length in frames
+            size_t                  m_tail;         ///< Maximum release tail in frames
+            std::vector<uint8_t>    m_notes;        ///< Notes to render
+            std::vector<uint8_t>    m_velocities;   ///< Velocities to render per note
+        };
+
+        /**
+          Open bake file.
+
+          Maps a bake file into memory and checks its structure.
+
+          @param[in]    filename    Bake file name
+          @param[in]    key         Expected cache key
+
+          @exception    SystemException         File can't be opened or mapped
+          @exception    DataFormatException     File is damaged, has another version or key
+         */
+        BakedInstrument(const std::string& filename, uint64_t key);
+
+        /**
+          Close bake file.
+
+          Unmaps the file, zones returned before must not be used any more.
+         */
+        ~BakedInstrument();
+
+        /**
+          Render bake file.
+
+          Renders every note at every velocity of the settings and writes them to a bake file. Each note is held for
+          the note length and released, the release tail is cut off as soon as the instrument is silent.
+
+          @param[in]    filename    Bake file name
+          @param[in]    key         Cache key to store in the file
+          @param[in]    instrument  Instrument to render
+          @param[in]    settings    Render settings
+
+          @exception    SystemException         File can't be written
+         */
+        static void bake(const std::string& filename, uint64_t key,
+                         const std::shared_ptr<const Instrument>& instrument, const Settings& settings);
+
+        /**
+          Get cache key.
+
+          Returns the cache key the file has been baked for.
+
+          @return                   Cache key
+         */
+        uint64_t getKey() const {
+            return m_key;
+        }
+
+        /**
+          Get sample rate.
+
+          Returns the sample rate the zones have been rendered at.
+
+          @return                   Sample rate in Hz
+         */
+        unsigned getSampleRate() const {
+            return m_sampleRate;
+        }
+
+        /**
+          Get number of zones.
+
+          Returns the number of rendered notes.
+
+          @return                   Number of zones
+         */
+        size_t getNumZones() const {
+            return m_zones.size();
+        }
+
+        /**
+          Get zone.
+
+          Returns a rendered note.
+
+          @param[in]    index       Zone index
+
+          @return                   Zone
+         */
+        const Zone& getZone(size_t index) const {
+            return m_zones[index];
+        }
+
+        /**
+          Find zone.
+
+          Returns the zone closest to the given note, and among those the one closest to the given velocity.
+
+          @param[in]    note        MIDI note
+          @param[in]    velocity    Note on velocity
+
+          @return                   Closest zone, null if there are no zones
+         */
+        const Zone* find(uint8_t note, uint8_t velocity) const;
+
+    private:
+        uint64_t            m_key;          ///< Cache key
+        unsigned            m_sampleRate;   ///< Sample rate in Hz
+        std::vector<Zone>   m_zones;        ///< Rendered notes
+        void*               m_map;          ///< Mapped file, null if read into the buffer
+        size_t              m_size;         ///< Size of mapped file
+        std::vector<char>   m_buffer;       ///< File contents where mapping is not available
+
+        BakedInstrument(const BakedInstrument&);            ///< Inhibit copying objects
+        BakedInstrument& operator=(const BakedInstrument&); ///< Inhibit copying objects
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
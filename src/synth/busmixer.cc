@@ -0,0 +1,199 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/busmixer.hh>
+#include <synth/simd.hh>
+#include <wersi/icb.hh>
+#include <wersi/vcf.hh>
+#include <exceptions.hh>
+#include <algorithm>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Number of buses and stages
+const size_t BusMixer::NumBuses;
+const size_t BusMixer::NumStages;
+
+// Create bus mixer
+BusMixer::BusMixer(size_t numVoices, size_t maxFrames)
+    : m_routes((numVoices + 3) & ~size_t(3), getSilentRoute())
+    , m_program()
+    , m_buses()
+    , m_accumulator(maxFrames * 4, 0.0f)
+    , m_dirty(false)
+{
+    for (size_t stage = 0; stage < NumStages; ++stage) {
+        for (size_t bus = 0; bus < NumBuses; ++bus) {
+            m_program[stage][bus].reserve(m_routes.size() / 4);
+        }
+    }
+    for (size_t bus = 0; bus < NumBuses; ++bus) {
+        m_buses[bus].resize(maxFrames, 0.0f);
+    }
+}
+
+// Get route of instrument
+BusMixer::Route BusMixer::getRoute(const Wersi::Icb& icb, const Wersi::Vcf* vcf)
+{
+    Route route = getSilentRoute();
+    const size_t direct = static_cast<size_t>(Stage::Direct);
+    const size_t filtered = static_cast<size_t>(Stage::Filtered);
+    route.m_gain[direct][static_cast<size_t>(Bus::Left)] = icb.getLeft() ? 1.0f : 0.0f;
+    route.m_gain[direct][static_cast<size_t>(Bus::Right)] = icb.getRight() ? 1.0f : 0.0f;
+    route.m_gain[direct][static_cast<size_t>(Bus::WersiVoice)] = icb.getWersiVoice() ? 1.0f : 0.0f;
+    if (icb.getVcf() && vcf != nullptr) {
+        route.m_gain[filtered][static_cast<size_t>(Bus::Left)] = vcf->getLeft() ? 1.0f : 0.0f;
+        route.m_gain[filtered][static_cast<size_t>(Bus::Right)] = vcf->getRight() ? 1.0f : 0.0f;
+        route.m_gain[filtered][static_cast<size_t>(Bus::WersiVoice)] = vcf->getWersiVoice() ? 1.0f : 0.0f;
+    }
+    return route;
+}
+
+// Get empty route
+BusMixer::Route BusMixer::getSilentRoute()
+{
+    Route route;
+    for (size_t stage = 0; stage < NumStages; ++stage) {
+        for (size_t bus = 0; bus < NumBuses; ++bus) {
+            route.m_gain[stage][bus] = 0.0f;
+        }
+    }
+    return route;
+}
+
+// Check for filtered route
+bool BusMixer::isFiltered(const Route& route)
+{
+    const size_t filtered = static_cast<size_t>(Stage::Filtered);
+    for (size_t bus = 0; bus < NumBuses; ++bus) {
+        if (route.m_gain[filtered][bus] != 0.0f) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Set route
+void BusMixer::setRoute(size_t voice, const Route& route)
+{
+    m_routes[voice] = route;
+    m_dirty = true;
+}
+
+// Clear route
+void BusMixer::clearRoute(size_t voice)
+{
+    setRoute(voice, getSilentRoute());
+}
+
+// Clear buses
+void BusMixer::clear(size_t frames)
+{
+    if (frames > m_buses[0].size()) {
+        throw Exception("Block exceeds bus mixer size");
+    }
+    for (size_t bus = 0; bus < NumBuses; ++bus) {
+        std::fill(m_buses[bus].begin(), m_buses[bus].begin() + frames, 0.0f);
+    }
+}
+
+// Mix voices of stage into buses
+void BusMixer::mix(Stage stage, const float* voices, size_t frames)
+{
+    if (frames > m_buses[0].size()) {
+        throw Exception("Block exceeds bus mixer size");
+    }
+    if (m_dirty) {
+        compile();
+    }
+
+    float* acc = m_accumulator.data();
+    for (size_t bus = 0; bus < NumBuses; ++bus) {
+        const std::vector<Entry>& program = m_program[static_cast<size_t>(stage)][bus];
+        if (program.empty()) {
+            continue;
+        }
+
+        // Accumulate all groups lane-wise, then reduce the lanes once per frame
+        for (size_t entry = 0; entry < program.size(); ++entry) {
+            const float* src = voices + program[entry].m_group * frames * 4;
+            Float4 gain = Float4::load(program[entry].m_gain);
+            if (entry == 0) {
+                for (size_t frame = 0; frame < frames; ++frame) {
+                    (Float4::load(src + frame * 4) * gain).store(acc + frame * 4);
+                }
+            }
+            else {
+                for (size_t frame = 0; frame < frames; ++frame) {
+                    (Float4::load(acc + frame * 4) + Float4::load(src + frame * 4) * gain).store(acc + frame * 4);
+                }
+            }
+        }
+        float* out = m_buses[bus].data();
+        for (size_t frame = 0; frame < frames; ++frame) {
+            out[frame] += Float4::load(acc + frame * 4).sum();
+        }
+    }
+}
+
+// Compile routing into group lists
+void BusMixer::compile()
+{
+    for (size_t stage = 0; stage < NumStages; ++stage) {
+        for (size_t bus = 0; bus < NumBuses; ++bus) {
+            std::vector<Entry>& program = m_program[stage][bus];
+            program.clear();
+            for (size_t group = 0; group < m_routes.size() / 4; ++group) {
+                Entry entry;
+                entry.m_group = group;
+                bool used = false;
+                for (size_t lane = 0; lane < 4; ++lane) {
+                    entry.m_gain[lane] = m_routes[group * 4 + lane].m_gain[stage][bus];
+                    used |= entry.m_gain[lane] != 0.0f;
+                }
+                if (used) {
+                    program.push_back(entry);
+                }
+            }
+        }
+    }
+    m_dirty = false;
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,228 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <vector>
+
+namespace DMSToolbox {
+
+// Forward declarations
+namespace Wersi {
+class Icb;
+class Vcf;
+} // namespace Wersi
+
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Stereo bus mixer.
+
+  Sums voices in the group layout of OscillatorBank into the left, right and WersiVoice buses. Each ICB routes its
+  voice directly to any of the buses and additionally through its VCF, which routes again. A renderer therefore
+  mixes twice per block: the direct stage reads the oscillator output before the VCF bank filters it in place, the
+  filtered stage reads it afterwards. Routing is compiled into per-bus lists of the groups that contribute, with a
+  gain vector per group, so mixing has no per-sample branches: each group costs one vector multiply-add per frame
+  into a vector accumulator, which is reduced once per frame and bus. Routing changes mark the lists dirty, they
+  are recompiled at the start of the next mix.
+
+  The banks do not write groups without active voices, so routes of stopped voices must be cleared.
+ */
+class BusMixer {
+    public:
+        /// Output bus
+        enum class Bus {
+            Left,                           ///< Left output
+            Right,                          ///< Right output
+            WersiVoice                      ///< WersiVoice processor input
+        };
+
+        /// Mixing stage
+        enum class Stage {
+            Direct,                         ///< Voice output before the VCF
+            Filtered                        ///< Voice output after the VCF
+        };
+
+        /// Number of buses
+        static const size_t NumBuses = 3;
+
+        /// Number of stages
+        static const size_t NumStages = 2;
+
+        /// Route of a voice, gains per stage and bus
+        struct Route {
+            float   m_gain[NumStages][NumBuses];    ///< Gains
+        };
+
+        /**
+          Create bus mixer.
+
+          Creates a bus mixer with all routes cleared.
+
+          @param[in]    numVoices   Number of voices, rounded up to a multiple of four
+          @param[in]    maxFrames   Largest number of frames per block
+         */
+        BusMixer(size_t numVoices, size_t maxFrames);
+
+        /**
+          Get route of instrument.
+
+          Derives the route of a voice from the output flags of its ICB and VCF.
+
+          @param[in]    icb         Instrument control block
+          @param[in]    vcf         VCF block of the ICB, may be null if missing
+
+          @return                   Route
+         */
+        static Route getRoute(const Wersi::Icb& icb, const Wersi::Vcf* vcf);
+
+        /**
+          Get empty route.
+
+          Returns a route that doesn't contribute to any bus.
+
+          @return                   Empty route
+         */
+        static Route getSilentRoute();
+
+        /**
+          Check for filtered route.
+
+          Returns true if the route passes the voice through the VCF.
+
+          @param[in]    route       Route to check
+
+          @return                   True if the route has a filtered stage
+         */
+        static bool isFiltered(const Route& route);
+
+        /**
+          Set route.
+
+          Sets the route of a voice.
+
+          @param[in]    voice       Voice index
+          @param[in]    route       Route
+         */
+        void setRoute(size_t voice, const Route& route);
+
+        /**
+          Clear route.
+
+          Removes a voice from all buses.
+
+          @param[in]    voice       Voice index
+         */
+        void clearRoute(size_t voice);
+
+        /**
+          Clear buses.
+
+          Sets the given number of frames of all buses to zero, to be called at the start of every block.
+
+          @param[in]    frames      Number of frames, at most the maximum given on creation
+
+          @exception    Exception   Block larger than the maximum
+         */
+        void clear(size_t frames);
+
+        /**
+          Mix voices.
+
+          Adds the voices routed to the given stage to the buses. Mixing never allocates, so it may be called on a
+          render thread.
+
+          @param[in]    stage       Mixing stage
+          @param[in]    voices      Voice samples in group layout
+          @param[in]    frames      Number of frames, at most the maximum given on creation
+
+          @exception    Exception   Block larger than the maximum
+         */
+        void mix(Stage stage, const float* voices, size_t frames);
+
+        /**
+          Get bus.
+
+          Returns the samples of a bus.
+
+          @param[in]    bus         Bus
+
+          @return                   Bus samples
+         */
+        float* getBus(Bus bus) {
+            return m_buses[static_cast<size_t>(bus)].data();
+        }
+
+        /**
+          Get bus.
+
+          Returns the samples of a bus.
+
+          @param[in]    bus         Bus
+
+          @return                   Bus samples
+         */
+        const float* getBus(Bus bus) const {
+            return m_buses[static_cast<size_t>(bus)].data();
+        }
+
+    private:
+        /// Compiled contribution of one group to a bus
+        struct Entry {
+            size_t  m_group;                ///< Group index
+            float   m_gain[4];              ///< Gain per lane
+        };
+
+        std::vector<Route>  m_routes;                           ///< Route per voice
+        std::vector<Entry>  m_program[NumStages][NumBuses];     ///< Contributing groups per stage and bus
+        std::vector<float>  m_buses[NumBuses];                  ///< Bus samples
+        std::vector<float>  m_accumulator;                      ///< Vector accumulator, four lanes per frame
+        bool                m_dirty;                            ///< Routing changed since last compile
+
+        /**
+          Compile routing.
+
+          Rebuilds the contributing group lists from the routes.
+         */
+        void compile();
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,300 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/engine.hh>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Default number of frames per block
+const size_t Engine::DefaultBlockSize;
+
+// Voice gain at full velocity and wave level, leaves headroom for several layers and voices
+static const float VoiceGain = 0.25f;
+
+// Pitch deviation of a full-scale FREQ envelope level in semitones
+static const float FreqRange = 12.0f;
+
+// AMPL envelope level below which a finished voice is stopped
+static const float SilenceLevel = 1.0e-4f;
+
+// Frames rendered per call while the release tail is checked for silence
+static const size_t TailBlock = 1024;
+
+// Create render engine
+Engine::Engine(size_t numVoices, float sampleRate, size_t blockSize)
+    : m_sampleRate(sampleRate)
+    , m_blockSize(blockSize)
+    , m_allocator(numVoices)
+    , m_oscillators(numVoices, sampleRate)
+    , m_formants(numVoices, sampleRate)
+    , m_noise(numVoices, sampleRate)
+    , m_filters(numVoices, sampleRate)
+    , m_mixer(numVoices, blockSize)
+    , m_wersiVoice(sampleRate)
+    , m_states()
+    , m_voices(m_oscillators.getNumVoices() * blockSize, 0.0f)
+    , m_indices(numVoices, 0)
+    , m_seed(1)
+{
+    float controlRate = sampleRate / float(blockSize);
+    VoiceState state = {
+        nullptr, nullptr, EnvelopeGenerator(controlRate), EnvelopeGenerator(controlRate),
+        WaveTableSet::Range::Bass, 0.0f, 0.0f
+    };
+    m_states.assign(numVoices, state);
+}
+
+// Start layers of instrument
+void Engine::noteOn(uint8_t channel, uint8_t note, uint8_t velocity, const std::shared_ptr<const Instrument>& instrument)
+{
+    if (instrument == nullptr) {
+        return;
+    }
+    size_t count = m_allocator.noteOn(channel, note, velocity, instrument->getPatch(), m_indices.data());
+    for (size_t i = 0; i < count; ++i) {
+        startVoice(m_indices[i], instrument);
+    }
+}
+
+// Release voices of note
+void Engine::noteOff(uint8_t channel, uint8_t note)
+{
+    size_t count = m_allocator.noteOff(channel, note, m_indices.data());
+    for (size_t i = 0; i < count; ++i) {
+        releaseVoice(m_indices[i]);
+    }
+}
+
+// Release all voices
+void Engine::allNotesOff()
+{
+    for (size_t voice = 0; voice < m_states.size(); ++voice) {
+        const VoiceAllocator::Voice& state = m_allocator.getVoice(voice);
+        if (state.m_active && !state.m_released) {
+            noteOff(state.m_channel, state.m_note);
+        }
+    }
+}
+
+// Stop all voices
+void Engine::reset()
+{
+    for (size_t voice = 0; voice < m_states.size(); ++voice) {
+        if (m_allocator.getVoice(voice).m_active) {
+            stopVoice(voice);
+        }
+    }
+    m_wersiVoice.clear();
+}
+
+// Render audio in blocks
+void Engine::render(float* left, float* right, size_t frames)
+{
+    size_t done = 0;
+    while (done < frames) {
+        size_t count = std::min(frames - done, m_blockSize);
+        renderBlock(left + done, right + done, count);
+        done += count;
+    }
+}
+
+// Render single note until its release has faded out
+size_t Engine::renderNote(const std::shared_ptr<const Instrument>& instrument, uint8_t note, uint8_t velocity,
+                          size_t length, float* left, float* right, size_t frames)
+{
+    reset();
+    length = std::min(length, frames);
+    noteOn(0, note, velocity, instrument);
+    render(left, right, length);
+    noteOff(0, note);
+
+    size_t done = length;
+    while (done < frames && getNumActive() != 0) {
+        size_t count = std::min(TailBlock, frames - done);
+        render(left + done, right + done, count);
+        done += count;
+    }
+    return done;
+}
+
+// Start banks of voice
+void Engine::startVoice(size_t voice, const std::shared_ptr<const Instrument>& instrument)
+{
+    const VoiceAllocator::Voice& allocated = m_allocator.getVoice(voice);
+    const Patch& patch = instrument->getPatch();
+
+    // ICBs are unique within a patch, so the ICB identifies the layer
+    size_t layer = 0;
+    while (layer < patch.getNumLayers() && patch.getLayer(layer).m_icb != allocated.m_layer.m_icb) {
+        ++layer;
+    }
+    if (layer == patch.getNumLayers() || instrument->getLayerData(layer).m_wave == nullptr) {
+        stopVoice(voice);
+        return;
+    }
+
+    VoiceState& state = m_states[voice];
+    const Instrument::LayerData& data = instrument->getLayerData(layer);
+    state.m_instrument = instrument;
+    state.m_data = &data;
+    state.m_ampl.start(data.m_ampl.get());
+    state.m_freq.start(data.m_freq.get());
+    state.m_range = WaveTableSet::getRange(allocated.m_pitch);
+    state.m_frequency = allocated.m_frequency;
+    state.m_gain = VoiceGain * data.m_level * float(allocated.m_velocity & 0x7f) / 127.0f;
+
+    // Start silent, the first block ramps to the envelope level
+    const float* table = data.m_wave->getTable(state.m_range, state.m_frequency / m_sampleRate);
+    m_oscillators.start(voice, table, WaveMipmap::TableLength, state.m_frequency, 0.0f);
+    m_mixer.setRoute(voice, allocated.m_layer.m_route);
+    if (data.m_fixedFormants) {
+        m_formants.start(voice, data.m_formants);
+    }
+    else {
+        m_formants.stop(voice);
+    }
+    if (data.m_filtered) {
+        m_filters.start(voice, data.m_vcf, allocated.m_pitch);
+    }
+    else {
+        m_filters.stop(voice);
+    }
+    if (data.m_noise) {
+        m_noise.start(voice, data.m_noiseType, state.m_frequency, m_seed++, 0.0f);
+    }
+    else {
+        m_noise.stop(voice);
+    }
+
+    // The WersiVoice processor is shared, the last started layer feeding it selects its mode
+    const BusMixer::Route& route = allocated.m_layer.m_route;
+    size_t wv = static_cast<size_t>(BusMixer::Bus::WersiVoice);
+    for (size_t stage = 0; stage < BusMixer::NumStages; ++stage) {
+        if (route.m_gain[stage][wv] != 0.0f) {
+            const Patch::Layer& played = allocated.m_layer;
+            m_wersiVoice.configure(played.m_wvMode, played.m_wvLeft, played.m_wvRight,
+                                   played.m_wvFbFlat, played.m_wvFbDeep);
+            break;
+        }
+    }
+}
+
+// Release envelopes of voice
+void Engine::releaseVoice(size_t voice)
+{
+    VoiceState& state = m_states[voice];
+    state.m_ampl.release();
+    state.m_freq.release();
+    m_filters.release(voice);
+}
+
+// Stop banks of voice
+void Engine::stopVoice(size_t voice)
+{
+    VoiceState& state = m_states[voice];
+    m_oscillators.stop(voice);
+    m_formants.stop(voice);
+    m_noise.stop(voice);
+    m_filters.stop(voice);
+    m_mixer.clearRoute(voice);
+    m_allocator.free(voice);
+    state.m_data = nullptr;
+    state.m_instrument.reset();
+}
+
+// Advance envelopes by one block
+void Engine::updateVoices()
+{
+    for (size_t voice = 0; voice < m_states.size(); ++voice) {
+        if (!m_allocator.getVoice(voice).m_active) {
+            continue;
+        }
+
+        VoiceState& state = m_states[voice];
+        float ampl;
+        float freq;
+        state.m_ampl.render(&ampl, 1);
+        state.m_freq.render(&freq, 1);
+        if (state.m_ampl.isFinished() && (ampl < SilenceLevel || state.m_ampl.isReleased())) {
+            stopVoice(voice);
+            continue;
+        }
+
+        float frequency = state.m_frequency;
+        if (freq != 0.0f) {
+            frequency *= std::pow(2.0f, freq * FreqRange / 12.0f);
+            m_oscillators.setFrequency(voice, frequency);
+            m_oscillators.setTable(voice, state.m_data->m_wave->getTable(state.m_range, frequency / m_sampleRate),
+                                   WaveMipmap::TableLength);
+        }
+        else {
+            m_oscillators.setFrequency(voice, frequency);
+        }
+        float gain = ampl > 0.0f ? ampl * state.m_gain : 0.0f;
+        m_oscillators.setGain(voice, gain);
+        if (state.m_data->m_noise) {
+            m_noise.setGain(voice, gain);
+        }
+    }
+}
+
+// Render one block
+void Engine::renderBlock(float* left, float* right, size_t frames)
+{
+    updateVoices();
+
+    m_oscillators.render(m_voices.data(), frames);
+    m_formants.process(m_voices.data(), frames);
+    m_mixer.clear(frames);
+    m_mixer.mix(BusMixer::Stage::Direct, m_voices.data(), frames);
+    m_noise.mix(m_voices.data(), frames);
+    m_filters.process(m_voices.data(), frames);
+    m_mixer.mix(BusMixer::Stage::Filtered, m_voices.data(), frames);
+
+    float* busLeft = m_mixer.getBus(BusMixer::Bus::Left);
+    float* busRight = m_mixer.getBus(BusMixer::Bus::Right);
+    m_wersiVoice.process(m_mixer.getBus(BusMixer::Bus::WersiVoice), busLeft, busRight, frames);
+    memcpy(left, busLeft, frames * sizeof(float));
+    memcpy(right, busRight, frames * sizeof(float));
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
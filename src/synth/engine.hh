@@ -0,0 +1,271 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <synth/instrument.hh>
+#include <synth/voiceallocator.hh>
+#include <synth/oscillatorbank.hh>
+#include <synth/noisebank.hh>
+#include <synth/vcfbank.hh>
+#include <synth/formantbank.hh>
+#include <synth/busmixer.hh>
+#include <synth/wersivoice.hh>
+#include <synth/envelopegenerator.hh>
+#include <synth/wavetableset.hh>
+#include <memory>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Polyphonic render engine.
+
+  Plays instruments on a fixed pool of voices and renders them to a stereo signal. Note events are passed to the
+  VoiceAllocator, which assigns the layers of the played instrument to voices. Rendering runs in blocks: once per
+  block the envelopes of all voices are advanced and applied to the oscillators, then the banks render all voices
+  and the BusMixer collects them into the output buses. Envelope blocks only shape the notes with the
+  EXPERIMENTAL_ENVELOPES build option, otherwise notes are gated:
+
+  -# OscillatorBank renders the waves
+  -# FormantBank shapes the waves using fixed formants, only with the EXPERIMENTAL_FORMANTS build option
+  -# the direct stage is mixed
+  -# NoiseBank adds the VCF noise
+  -# VcfBank filters the voices
+  -# the filtered stage is mixed
+  -# WersiVoice processes the WV bus into the stereo buses
+
+  All memory is reserved on construction and the output only depends on the sequence of calls, so renders are
+  reproducible. Voices keep a reference to their instrument, the last voice of a replaced instrument releases it.
+ */
+class Engine {
+    public:
+        /// Default number of frames per block
+        static const size_t DefaultBlockSize = 64;
+
+        /**
+          Create render engine.
+
+          Creates an engine with all voices stopped.
+
+          @param[in]    numVoices   Number of voices
+          @param[in]    sampleRate  Sample rate in Hz
+          @param[in]    blockSize   Number of frames per block, envelopes are advanced once per block
+         */
+        Engine(size_t numVoices, float sampleRate, size_t blockSize = DefaultBlockSize);
+
+        /**
+          Get sample rate.
+
+          Returns the sample rate.
+
+          @return                   Sample rate in Hz
+         */
+        float getSampleRate() const {
+            return m_sampleRate;
+        }
+
+        /**
+          Get number of active voices.
+
+          Returns the number of sounding voices.
+
+          @return                   Number of active voices
+         */
+        size_t getNumActive() const {
+            return m_allocator.getNumActive();
+        }
+
+        /**
+          Set steal mode.
+
+          Selects how voices are stolen when the pool is exhausted.
+
+          @param[in]    mode        Steal mode
+         */
+        void setStealMode(VoiceAllocator::StealMode mode) {
+            m_allocator.setStealMode(mode);
+        }
+
+        /**
+          Note on.
+
+          Starts the playing layers of an instrument.
+
+          @param[in]    channel     MIDI channel
+          @param[in]    note        MIDI note number
+          @param[in]    velocity    Note velocity 1..127
+          @param[in]    instrument  Played instrument
+         */
+        void noteOn(uint8_t channel, uint8_t note, uint8_t velocity, const std::shared_ptr<const Instrument>& instrument);
+
+        /**
+          Note off.
+
+          Releases the voices of a note.
+
+          @param[in]    channel     MIDI channel
+          @param[in]    note        MIDI note number
+         */
+        void noteOff(uint8_t channel, uint8_t note);
+
+        /**
+          All notes off.
+
+          Releases all voices, they fade out with their release envelopes.
+         */
+        void allNotesOff();
+
+        /**
+          Reset engine.
+
+          Stops all voices immediately and clears the effect state.
+         */
+        void reset();
+
+        /**
+          Render audio.
+
+          Renders the given number of frames, in as many blocks as needed.
+
+          @param[out]   left        Left output samples
+          @param[out]   right       Right output samples
+          @param[in]    frames      Number of frames to render
+         */
+        void render(float* left, float* right, size_t frames);
+
+        /**
+          Render single note.
+
+          Resets the engine, plays a note on channel 0 for the given length and releases it. Rendering stops early
+          once the release has faded out, so the output is never longer than needed.
+
+          @param[in]    instrument  Instrument to play
+          @param[in]    note        MIDI note
+          @param[in]    velocity    Note on velocity
+          @param[in]    length      Frames to hold the note
+          @param[out]   left        Left output samples
+          @param[out]   right       Right output samples
+          @param[in]    frames      Maximum number of frames including the release
+
+          @return                   Number of rendered frames
+         */
+        size_t renderNote(const std::shared_ptr<const Instrument>& instrument, uint8_t note, uint8_t velocity,
+                          size_t length, float* left, float* right, size_t frames);
+
+    private:
+        /// Render state of a voice
+        struct VoiceState {
+            std::shared_ptr<const Instrument>   m_instrument;   ///< Played instrument
+            const Instrument::LayerData*        m_data;         ///< Resources of the played layer
+            EnvelopeGenerator       m_ampl;         ///< AMPL envelope
+            EnvelopeGenerator       m_freq;         ///< FREQ envelope
+            WaveTableSet::Range     m_range;        ///< Note range
+            float                   m_frequency;    ///< Frequency without FREQ envelope in Hz
+            float                   m_gain;         ///< Gain without AMPL envelope
+        };
+
+        float                   m_sampleRate;   ///< Sample rate in Hz
+        size_t                  m_blockSize;    ///< Number of frames per block
+        VoiceAllocator          m_allocator;    ///< Voice allocator
+        OscillatorBank          m_oscillators;  ///< Wave oscillators
+        FormantBank             m_formants;     ///< Fixed formant filters
+        NoiseBank               m_noise;        ///< VCF noise generators
+        VcfBank                 m_filters;      ///< VCF filters
+        BusMixer                m_mixer;        ///< Output buses
+        WersiVoice              m_wersiVoice;   ///< WersiVoice processor
+        std::vector<VoiceState> m_states;       ///< Render state per voice
+        std::vector<float>      m_voices;       ///< Voice samples of one block in group layout
+        std::vector<size_t>     m_indices;      ///< Voice indices reported by the allocator
+        uint32_t                m_seed;         ///< Next noise seed
+
+        /**
+          Start voice.
+
+          Starts all banks of a voice allocated for a layer.
+
+          @param[in]    voice       Voice index
+          @param[in]    instrument  Played instrument
+         */
+        void startVoice(size_t voice, const std::shared_ptr<const Instrument>& instrument);
+
+        /**
+          Release voice.
+
+          Signals note-off to the envelopes of a voice.
+
+          @param[in]    voice       Voice index
+         */
+        void releaseVoice(size_t voice);
+
+        /**
+          Stop voice.
+
+          Stops all banks of a voice and returns it to the allocator.
+
+          @param[in]    voice       Voice index
+         */
+        void stopVoice(size_t voice);
+
+        /**
+          Update voices.
+
+          Advances the envelopes of all voices by one block and stops finished voices.
+         */
+        void updateVoices();
+
+        /**
+          Render block.
+
+          Renders one block of at most m_blockSize frames.
+
+          @param[out]   left        Left output samples
+          @param[out]   right       Right output samples
+          @param[in]    frames      Number of frames to render
+         */
+        void renderBlock(float* left, float* right, size_t frames);
+
+        Engine(const Engine&);              ///< Inhibit copying objects
+        Engine& operator=(const Engine&);   ///< Inhibit copying objects
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
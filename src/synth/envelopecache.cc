@@ -0,0 +1,120 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/envelopecache.hh>
+#include <wersi/envelope.hh>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Create envelope cache
+EnvelopeCache::EnvelopeCache(Wersi::InstrumentStore& store)
+    : m_store(store)
+    , m_ampl()
+    , m_freq()
+    , m_mutex()
+{
+    m_store.addObserver(this);
+}
+
+// Destroy envelope cache
+EnvelopeCache::~EnvelopeCache()
+{
+    m_store.removeObserver(this);
+}
+
+// Get AMPL program
+std::shared_ptr<const EnvelopeProgram> EnvelopeCache::getAmpl(uint8_t block)
+{
+    return get(m_ampl, m_store.getAmpl(block), block, EnvelopeProgram::Kind::Amplitude);
+}
+
+// Get FREQ program
+std::shared_ptr<const EnvelopeProgram> EnvelopeCache::getFreq(uint8_t block)
+{
+    return get(m_freq, m_store.getFreq(block), block, EnvelopeProgram::Kind::Frequency);
+}
+
+// Drop programs of changed blocks
+void EnvelopeCache::storeChanged(Wersi::InstrumentStore& /*store*/, const Wersi::ChangeSet& changes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    drop(m_ampl, changes, Wersi::ChangeSet::BlockType::Ampl);
+    drop(m_freq, changes, Wersi::ChangeSet::BlockType::Freq);
+}
+
+// Get program, compile if needed
+std::shared_ptr<const EnvelopeProgram> EnvelopeCache::get(ProgramMap& map, const Wersi::Envelope* envelope,
+                                                          uint8_t block, EnvelopeProgram::Kind kind)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ProgramMap::const_iterator it = map.find(block);
+    if (it != map.end()) {
+        return it->second;
+    }
+    std::shared_ptr<const EnvelopeProgram> program;
+    if (envelope != nullptr && EnvelopeProgram::Interpreted) {
+        program = std::make_shared<EnvelopeProgram>(*envelope, kind);
+    }
+    else if (envelope != nullptr) {
+        program = std::make_shared<EnvelopeProgram>(kind);
+    }
+    else {
+        program = std::make_shared<EnvelopeProgram>();
+    }
+    map[block] = program;
+    return program;
+}
+
+// Drop programs of changed blocks
+void EnvelopeCache::drop(ProgramMap& map, const Wersi::ChangeSet& changes, Wersi::ChangeSet::BlockType type)
+{
+    if (!changes.any(type)) {
+        return;
+    }
+    for (ProgramMap::iterator it = map.begin(); it != map.end(); ) {
+        if (changes.test(type, it->first)) {
+            it = map.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
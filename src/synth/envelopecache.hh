@@ -0,0 +1,146 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <synth/envelopeprogram.hh>
+#include <wersi/instrumentstore.hh>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Envelope program cache.
+
+  Keeps the compiled form of the envelopes of one instrument store. Programs are compiled on first use and dropped
+  when the store reports a change of their block, so editing an envelope takes effect with the next note. Programs
+  are handed out as shared pointers, a voice may keep playing an outdated program while a new one is compiled.
+  Unless built with the EXPERIMENTAL_ENVELOPES option, existing blocks get neutral programs instead of interpreted
+  ones, see EnvelopeProgram.
+ */
+class EnvelopeCache : public Wersi::InstrumentStore::Observer {
+    public:
+        /**
+          Create envelope cache.
+
+          Creates an empty cache and registers it with the given store. The store must outlive the cache.
+
+          @param[in]    store       Instrument store to cache envelopes of
+         */
+        explicit EnvelopeCache(Wersi::InstrumentStore& store);
+
+        /**
+          Destroy envelope cache.
+
+          Unregisters the cache from its store.
+         */
+        virtual ~EnvelopeCache();
+
+        /**
+          Get AMPL program.
+
+          Returns the compiled program of the given AMPL block, compiling it if needed. Missing blocks yield an empty
+          program.
+
+          @param[in]    block       AMPL block number
+
+          @return                   Compiled program
+         */
+        std::shared_ptr<const EnvelopeProgram> getAmpl(uint8_t block);
+
+        /**
+          Get FREQ program.
+
+          Returns the compiled program of the given FREQ block, compiling it if needed. Missing blocks yield an empty
+          program.
+
+          @param[in]    block       FREQ block number
+
+          @return                   Compiled program
+         */
+        std::shared_ptr<const EnvelopeProgram> getFreq(uint8_t block);
+
+        /// Implements Wersi::InstrumentStore::Observer::storeChanged()
+        virtual void storeChanged(Wersi::InstrumentStore& store, const Wersi::ChangeSet& changes);
+
+    private:
+        /// Map of compiled programs by block number
+        typedef std::map<uint8_t, std::shared_ptr<const EnvelopeProgram>> ProgramMap;
+
+        Wersi::InstrumentStore& m_store;    ///< Cached instrument store
+        ProgramMap              m_ampl;     ///< Compiled AMPL programs
+        ProgramMap              m_freq;     ///< Compiled FREQ programs
+        std::mutex              m_mutex;    ///< Protects the program maps
+
+        /**
+          Get program.
+
+          Returns a program from the given map, compiling it if needed.
+
+          @param[in]    map         Program map
+          @param[in]    envelope    Envelope to compile, null if missing
+          @param[in]    block       Block number
+          @param[in]    kind        Envelope type
+
+          @return                   Compiled program
+         */
+        std::shared_ptr<const EnvelopeProgram> get(ProgramMap& map, const Wersi::Envelope* envelope, uint8_t block,
+                                                   EnvelopeProgram::Kind kind);
+
+        /**
+          Drop programs.
+
+          Drops all programs of changed blocks from the given map.
+
+          @param[in]    map         Program map
+          @param[in]    changes     Set of changed blocks
+          @param[in]    type        Block type of the map
+         */
+        static void drop(ProgramMap& map, const Wersi::ChangeSet& changes, Wersi::ChangeSet::BlockType type);
+
+        EnvelopeCache(const EnvelopeCache&);                ///< Inhibit copying objects
+        EnvelopeCache& operator=(const EnvelopeCache&);     ///< Inhibit copying objects
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,228 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/envelopegenerator.hh>
+#include <cmath>
+#include <cstring>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Create envelope generator
+EnvelopeGenerator::EnvelopeGenerator(float controlRate)
+    : m_program(nullptr)
+    , m_samplesPerTick(controlRate / EnvelopeProgram::TickRate)
+    , m_state(State::Finished)
+    , m_released(false)
+    , m_pc(0)
+    , m_level(0.0f)
+    , m_increment(0.0f)
+    , m_targetLevel(0.0f)
+    , m_remaining(0)
+    , m_loops()
+{
+}
+
+// Create envelope generator by copying
+EnvelopeGenerator::EnvelopeGenerator(const EnvelopeGenerator& source)
+    : m_program(nullptr)
+    , m_samplesPerTick(1.0f)
+    , m_state(State::Finished)
+    , m_released(false)
+    , m_pc(0)
+    , m_level(0.0f)
+    , m_increment(0.0f)
+    , m_targetLevel(0.0f)
+    , m_remaining(0)
+    , m_loops()
+{
+    *this = source;
+}
+
+// Copy envelope generator
+EnvelopeGenerator& EnvelopeGenerator::operator=(const EnvelopeGenerator& source)
+{
+    if (this != &source) {
+        m_program           = source.m_program;
+        m_samplesPerTick    = source.m_samplesPerTick;
+        m_state             = source.m_state;
+        m_released          = source.m_released;
+        m_pc                = source.m_pc;
+        m_level             = source.m_level;
+        m_increment         = source.m_increment;
+        m_targetLevel       = source.m_targetLevel;
+        m_remaining         = source.m_remaining;
+        memcpy(m_loops, source.m_loops, sizeof(m_loops));
+    }
+    return *this;
+}
+
+// Set control rate
+void EnvelopeGenerator::setControlRate(float controlRate)
+{
+    m_samplesPerTick = controlRate / EnvelopeProgram::TickRate;
+}
+
+// Start envelope
+void EnvelopeGenerator::start(const EnvelopeProgram* program)
+{
+    m_program = program;
+    m_released = false;
+    m_level = 0.0f;
+    m_increment = 0.0f;
+    m_targetLevel = 0.0f;
+    enter(program != nullptr ? program->getAttack() : 0);
+}
+
+// Release envelope
+void EnvelopeGenerator::release()
+{
+    if (m_released || m_program == nullptr) {
+        return;
+    }
+    m_released = true;
+    m_level = m_targetLevel - m_increment * float(m_remaining);
+    enter(m_program->getRelease());
+}
+
+// Render control values
+void EnvelopeGenerator::render(float* out, size_t count)
+{
+    size_t done = 0;
+    while (done < count) {
+        if (m_remaining > 0) {
+            // Continue ramp or hold
+            size_t n = count - done < m_remaining ? count - done : m_remaining;
+            float level = m_level;
+            for (size_t i = 0; i < n; ++i) {
+                level += m_increment;
+                out[done + i] = level;
+            }
+            m_remaining -= n;
+            m_level = m_remaining == 0 ? m_targetLevel : level;
+            done += n;
+        }
+        else if (m_state == State::Running) {
+            execute();
+        }
+        else {
+            // Level stays until release or forever
+            for (size_t i = done; i < count; ++i) {
+                out[i] = m_level;
+            }
+            done = count;
+        }
+    }
+}
+
+// Execute steps until one takes time
+void EnvelopeGenerator::execute()
+{
+    const auto& steps = m_program->getSteps();
+    for (size_t n = 0; n < MaxZeroTimeSteps; ++n) {
+        if (m_pc >= steps.size()) {
+            m_state = State::Finished;
+            return;
+        }
+        const EnvelopeProgram::Step& step = steps[m_pc];
+        switch (step.m_op) {
+            case EnvelopeProgram::Op::End:
+                m_state = State::Finished;
+                return;
+                break;
+            case EnvelopeProgram::Op::Ramp:
+            case EnvelopeProgram::Op::Hold: {
+                ++m_pc;
+                m_targetLevel = step.m_op == EnvelopeProgram::Op::Ramp ? step.m_level : m_level;
+                m_remaining = size_t(std::floor(float(step.m_ticks) * m_samplesPerTick + 0.5f));
+                if (m_remaining > 0) {
+                    m_increment = (m_targetLevel - m_level) / float(m_remaining);
+                    return;
+                }
+                m_level = m_targetLevel;
+                break;
+            }
+            case EnvelopeProgram::Op::Jump:
+                m_pc = step.m_target;
+                break;
+            case EnvelopeProgram::Op::Loop:
+                if (m_pc < MaxLoops && m_loops[m_pc] < step.m_count) {
+                    ++m_loops[m_pc];
+                    m_pc = step.m_target;
+                }
+                else {
+                    if (m_pc < MaxLoops) {
+                        m_loops[m_pc] = 0;
+                    }
+                    ++m_pc;
+                }
+                break;
+            case EnvelopeProgram::Op::SetLevel:
+                m_level = step.m_level;
+                m_targetLevel = m_level;
+                ++m_pc;
+                break;
+            case EnvelopeProgram::Op::Sustain:
+                if (!m_released) {
+                    m_state = State::Sustaining;
+                    return;
+                }
+                ++m_pc;
+                break;
+            default:
+                ++m_pc;
+                break;
+        }
+    }
+
+    // Program loops without spending time
+    m_state = State::Finished;
+}
+
+// Continue at step
+void EnvelopeGenerator::enter(size_t pc)
+{
+    m_pc = pc;
+    m_remaining = 0;
+    m_increment = 0.0f;
+    m_targetLevel = m_level;
+    m_state = m_program != nullptr ? State::Running : State::Finished;
+    memset(m_loops, 0, sizeof(m_loops));
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
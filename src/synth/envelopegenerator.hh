@@ -0,0 +1,199 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <synth/envelopeprogram.hh>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Envelope generator.
+
+  Executes a precompiled envelope program the way the DMS slaves do: starting at the attack entry on note-on and
+  continuing at the release entry on note-off. Control values are emitted at a configurable control rate, ramps
+  are interpolated linearly per control sample. The generator does not allocate memory, so it can be used in
+  real-time rendering.
+ */
+class EnvelopeGenerator {
+    public:
+        /**
+          Create envelope generator.
+
+          Creates an idle envelope generator.
+
+          @param[in]    controlRate Control rate in Hz
+         */
+        explicit EnvelopeGenerator(float controlRate = 1000.0f);
+
+        /**
+          Create envelope generator by copying.
+
+          Copies the complete generator state, both generators refer to the same program.
+
+          @param[in]    source      Source generator to copy from
+         */
+        EnvelopeGenerator(const EnvelopeGenerator& source);
+
+        /**
+          Copy envelope generator.
+
+          Copies the complete generator state, both generators refer to the same program.
+
+          @param[in]    source      Source generator to copy from
+
+          @return                   This object
+         */
+        EnvelopeGenerator& operator=(const EnvelopeGenerator& source);
+
+        /**
+          Set control rate.
+
+          Sets the rate control values are emitted with. Takes effect with the next program step.
+
+          @param[in]    controlRate Control rate in Hz
+         */
+        void setControlRate(float controlRate);
+
+        /**
+          Start envelope.
+
+          Starts the given program at its attack entry, beginning at level zero. The program must stay valid
+          until the generator is started again or destroyed.
+
+          @param[in]    program     Program to execute
+         */
+        void start(const EnvelopeProgram* program);
+
+        /**
+          Release envelope.
+
+          Continues the program at its release entry. Calling this more than once has no further effect.
+         */
+        void release();
+
+        /**
+          Render control values.
+
+          Executes the program and writes the given number of control values.
+
+          @param[out]   out         Destination buffer
+          @param[in]    count       Number of control values to render
+         */
+        void render(float* out, size_t count);
+
+        /**
+          Get current level.
+
+          Returns the level of the last rendered control value.
+
+          @return                   Current level
+         */
+        float getLevel() const {
+            return m_level;
+        }
+
+        /**
+          Check for finished envelope.
+
+          Returns true if the program has ended, the level won't change anymore.
+
+          @return                   True if finished
+         */
+        bool isFinished() const {
+            return m_state == State::Finished;
+        }
+
+        /**
+          Check for released envelope.
+
+          Returns true if release() has been called since the last start().
+
+          @return                   True if released
+         */
+        bool isReleased() const {
+            return m_released;
+        }
+
+    private:
+        /// Execution state
+        enum class State {
+            Running,                        ///< Executing program steps
+            Sustaining,                     ///< Waiting for release
+            Finished                        ///< Program ended
+        };
+
+        /// Maximum number of consecutive steps without duration, more are treated as endless loop
+        static const size_t MaxZeroTimeSteps = 256;
+
+        /// Maximum number of program steps with loop counters
+        static const size_t MaxLoops = 64;
+
+        const EnvelopeProgram*  m_program;          ///< Executed program
+        float                   m_samplesPerTick;   ///< Control samples per hardware tick
+        State                   m_state;            ///< Execution state
+        bool                    m_released;         ///< True if released
+        size_t                  m_pc;               ///< Index of next step
+        float                   m_level;            ///< Current level
+        float                   m_increment;        ///< Level increment per control sample
+        float                   m_targetLevel;      ///< Level at the end of the current step
+        size_t                  m_remaining;        ///< Control samples left in the current step
+        uint8_t                 m_loops[MaxLoops];  ///< Loop counters per step
+
+        /**
+          Execute steps.
+
+          Executes program steps until a step with a duration starts or the program waits or ends.
+         */
+        void execute();
+
+        /**
+          Jump to step.
+
+          Continues execution at the given step and resets the loop counters.
+
+          @param[in]    pc          Step index
+         */
+        void enter(size_t pc);
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
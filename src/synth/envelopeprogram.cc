@@ -0,0 +1,150 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/envelopeprogram.hh>
+#include <wersi/envelope.hh>
+
+namespace DMSToolbox {
+namespace Synth {
+
+const float EnvelopeProgram::TickRate = 500.0f;
+
+#ifdef EXPERIMENTAL_ENVELOPES
+const bool EnvelopeProgram::Interpreted = true;
+#else
+const bool EnvelopeProgram::Interpreted = false;
+#endif // EXPERIMENTAL_ENVELOPES
+
+// Ticks of the attack and release ramps of the neutral program, about 10 ms
+static const uint32_t DeclickTicks = uint32_t(EnvelopeProgram::TickRate * 0.01f + 0.5f);
+
+// Create empty program
+EnvelopeProgram::EnvelopeProgram()
+    : m_steps()
+    , m_attack(0)
+    , m_release(0)
+    , m_kind(Kind::Amplitude)
+{
+}
+
+// Create neutral program
+EnvelopeProgram::EnvelopeProgram(Kind kind)
+    : m_steps()
+    , m_attack(0)
+    , m_release(0)
+    , m_kind(kind)
+{
+    // Amplitude gates the note, frequency stays at pitch
+    Step end = { Op::End, 0, 0, 0.0f, 0 };
+    if (kind == Kind::Amplitude) {
+        Step attack = { Op::Ramp, 0, 0, 1.0f, DeclickTicks };
+        Step sustain = { Op::Sustain, 0, 0, 0.0f, 0 };
+        Step release = { Op::Ramp, 0, 0, 0.0f, DeclickTicks };
+        m_steps.push_back(attack);
+        m_steps.push_back(sustain);
+        m_steps.push_back(release);
+        m_steps.push_back(end);
+        m_release = 2;
+    }
+    else {
+        m_steps.push_back(end);
+        m_release = m_steps.size();
+    }
+}
+
+// Compile envelope program
+EnvelopeProgram::EnvelopeProgram(const Wersi::Envelope& envelope, Kind kind)
+    : m_steps()
+    , m_attack(0)
+    , m_release(0)
+    , m_kind(kind)
+{
+    typedef Wersi::Envelope::Opcode Opcode;
+    const auto& program = envelope.getProgram();
+    size_t end = program.size();
+    m_steps.reserve(end);
+
+    for (auto& i : program) {
+        Step step = { Op::Nop, 0, uint16_t(end), 0.0f, 0 };
+        switch (i.m_opcode) {
+            case Opcode::End:
+                step.m_op = Op::End;
+                break;
+            case Opcode::Ramp:
+                step.m_op = Op::Ramp;
+                step.m_ticks = i.m_bytes[2];
+                break;
+            case Opcode::Hold:
+                step.m_op = Op::Hold;
+                step.m_ticks = i.m_bytes[1];
+                break;
+            case Opcode::Jump:
+                step.m_op = Op::Jump;
+                break;
+            case Opcode::Loop:
+                step.m_op = Op::Loop;
+                step.m_count = i.m_bytes[1];
+                break;
+            case Opcode::SetLevel:
+                step.m_op = Op::SetLevel;
+                break;
+            case Opcode::Sustain:
+                step.m_op = Op::Sustain;
+                break;
+            default:
+                break;
+        }
+        if (step.m_op == Op::Ramp || step.m_op == Op::SetLevel) {
+            if (kind == Kind::Amplitude) {
+                step.m_level = float(i.m_bytes[1] & 0x7f) / 127.0f;
+            }
+            else {
+                step.m_level = float(int8_t(i.m_bytes[1])) / 128.0f;
+            }
+        }
+        if (i.m_target != Wersi::Envelope::NoTarget) {
+            step.m_target = uint16_t(i.m_target);
+        }
+        m_steps.push_back(step);
+    }
+
+    m_attack = envelope.getAttackEntry() != Wersi::Envelope::NoTarget ? envelope.getAttackEntry() : end;
+    m_release = envelope.getReleaseEntry() != Wersi::Envelope::NoTarget ? envelope.getReleaseEntry() : end;
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
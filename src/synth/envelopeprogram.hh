@@ -0,0 +1,180 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <vector>
+
+namespace DMSToolbox {
+
+// Forward declarations
+namespace Wersi {
+class Envelope;
+} // namespace Wersi
+
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Precompiled envelope program.
+
+  This is the form of a Wersi envelope program executed by EnvelopeGenerator. Levels are converted to floating point,
+  times are given in hardware envelope ticks and all targets are resolved to step indices, so starting a note needs
+  no decoding at all. Targets that could not be resolved point to the end of the program.
+
+  The operations follow the speculative instruction set of Wersi::Envelope, the rendered envelopes are a best guess
+  of what the slaves do and will change as long as that instruction set isn't confirmed. Envelope blocks are
+  therefore only interpreted when built with the EXPERIMENTAL_ENVELOPES option, otherwise EnvelopeCache hands out
+  neutral programs.
+ */
+class EnvelopeProgram {
+    public:
+        /// Envelope type, determines level scaling
+        enum class Kind {
+            Amplitude,                      ///< AMPL envelope, levels 0..127 scaled to 0..1
+            Frequency                       ///< FREQ envelope, signed levels scaled to -1..1
+        };
+
+        /// Step operation
+        enum class Op : uint8_t {
+            End,                            ///< Stop, keep level
+            Ramp,                           ///< Ramp linearly to level within ticks
+            Hold,                           ///< Keep level for ticks
+            Jump,                           ///< Continue at target
+            Loop,                           ///< Continue at target count times, then fall through
+            SetLevel,                       ///< Set level immediately
+            Sustain,                        ///< Keep level until release
+            Nop                             ///< Unknown instruction, ignored
+        };
+
+        /// Program step
+        struct Step {
+            Op          m_op;               ///< Operation
+            uint8_t     m_count;            ///< Loop count
+            uint16_t    m_target;           ///< Target step index
+            float       m_level;            ///< Target level
+            uint32_t    m_ticks;            ///< Duration in hardware envelope ticks
+        };
+
+        /// Rate of the hardware envelope clock in Hz, used to convert ticks to control samples, a guess as well
+        static const float TickRate;
+
+        /// True if envelope blocks are interpreted, only with the EXPERIMENTAL_ENVELOPES build option
+        static const bool Interpreted;
+
+        /**
+          Create empty program.
+
+          Creates a program that ends immediately at level zero.
+         */
+        EnvelopeProgram();
+
+        /**
+          Create neutral program.
+
+          Creates a program that doesn't depend on the instruction set: amplitude envelopes ramp up within about
+          10 ms, sustain until release and ramp down again, frequency envelopes keep the pitch.
+
+          @param[in]    kind        Envelope type
+         */
+        explicit EnvelopeProgram(Kind kind);
+
+        /**
+          Compile envelope program.
+
+          Compiles the decoded program of the given envelope.
+
+          @param[in]    envelope    Envelope to compile
+          @param[in]    kind        Envelope type
+         */
+        EnvelopeProgram(const Wersi::Envelope& envelope, Kind kind);
+
+        /**
+          Get steps.
+
+          Returns the compiled program steps.
+
+          @return                   Program steps
+         */
+        const std::vector<Step>& getSteps() const {
+            return m_steps;
+        }
+
+        /**
+          Get attack entry.
+
+          Returns the index of the step the attack phase starts with.
+
+          @return                   Attack step index, equal to the number of steps if the program is empty
+         */
+        size_t getAttack() const {
+            return m_attack;
+        }
+
+        /**
+          Get release entry.
+
+          Returns the index of the step the release phase starts with.
+
+          @return                   Release step index, equal to the number of steps if there is no release phase
+         */
+        size_t getRelease() const {
+            return m_release;
+        }
+
+        /**
+          Get envelope type.
+
+          Returns the type of envelope the program has been compiled for.
+
+          @return                   Envelope type
+         */
+        Kind getKind() const {
+            return m_kind;
+        }
+
+    private:
+        std::vector<Step>   m_steps;        ///< Program steps
+        size_t              m_attack;       ///< Attack step index
+        size_t              m_release;      ///< Release step index
+        Kind                m_kind;         ///< Envelope type
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
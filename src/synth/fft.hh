@@ -0,0 +1,150 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <cmath>
+#include <complex>
+#include <utility>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Radix-2 FFT.
+
+  In-place complex FFT with the size fixed at compile time, so loop bounds and bit reversal are known to the
+  compiler. Twiddle factors are computed once per object, keep objects around instead of recreating them per
+  transform. The forward transform is unscaled, the inverse transform scales by 1 / N.
+
+  @tparam       N           Transform size, must be a power of two
+ */
+template<size_t N> class Fft {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "FFT size must be a power of two");
+
+    public:
+        /// Transform size
+        static const size_t Size = N;
+
+        /**
+          Create FFT.
+
+          Creates the FFT and computes the twiddle factors.
+         */
+        Fft()
+            : m_twiddle()
+        {
+            const double pi = 3.14159265358979323846;
+            for (size_t i = 0; i < N / 2; ++i) {
+                double angle = -2.0 * pi * double(i) / double(N);
+                m_twiddle[i] = std::complex<float>(float(std::cos(angle)), float(std::sin(angle)));
+            }
+        }
+
+        /**
+          Forward transform.
+
+          Transforms N time domain samples to N frequency bins in place.
+
+          @param[in,out] data       Data to transform
+         */
+        void forward(std::complex<float>* data) const {
+            transform(data, false);
+        }
+
+        /**
+          Inverse transform.
+
+          Transforms N frequency bins to N time domain samples in place.
+
+          @param[in,out] data       Data to transform
+         */
+        void inverse(std::complex<float>* data) const {
+            transform(data, true);
+            const float scale = 1.0f / float(N);
+            for (size_t i = 0; i < N; ++i) {
+                data[i] *= scale;
+            }
+        }
+
+    private:
+        std::complex<float> m_twiddle[N / 2];   ///< Twiddle factors
+
+        /**
+          Transform data.
+
+          Runs the unscaled transform in the given direction.
+
+          @param[in,out] data       Data to transform
+          @param[in]    inverse     True for the inverse direction
+         */
+        void transform(std::complex<float>* data, bool inverse) const {
+            // Bit reversal permutation
+            for (size_t i = 1, j = 0; i < N; ++i) {
+                size_t bit = N >> 1;
+                for (; (j & bit) != 0; bit >>= 1) {
+                    j ^= bit;
+                }
+                j |= bit;
+                if (i < j) {
+                    std::swap(data[i], data[j]);
+                }
+            }
+
+            // Butterflies
+            for (size_t length = 2; length <= N; length <<= 1) {
+                size_t step = N / length;
+                for (size_t start = 0; start < N; start += length) {
+                    for (size_t k = 0; k < length / 2; ++k) {
+                        std::complex<float> w = inverse ? std::conj(m_twiddle[k * step]) : m_twiddle[k * step];
+                        std::complex<float> a = data[start + k];
+                        std::complex<float> b = data[start + k + length / 2] * w;
+                        data[start + k] = a + b;
+                        data[start + k + length / 2] = a - b;
+                    }
+                }
+            }
+        }
+};
+
+template<size_t N> const size_t Fft<N>::Size;
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,202 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/formantbank.hh>
+#include <synth/simd.hh>
+#include <algorithm>
+#include <cmath>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Pi
+static const float Pi = 3.14159265358979f;
+
+// Number of bands
+static const size_t NumBands = Wersi::Wave::NumFormants;
+
+// Bandwidth of one step of the band width value in Hz
+static const float WidthStep = 10.0f;
+
+// State values below this are flushed to zero, avoiding denormals in decaying resonators
+static const float StateThreshold = 1e-20f;
+
+// Create fixed formant filter bank
+FormantBank::FormantBank(size_t numVoices, float sampleRate)
+    : m_sampleRate(sampleRate)
+    , m_dry((numVoices + 3) & ~size_t(3), 1.0f)
+    , m_b0(m_dry.size() * NumBands, 0.0f)
+    , m_a1(m_b0.size(), 0.0f)
+    , m_a2(m_b0.size(), 0.0f)
+    , m_gain(m_b0.size(), 0.0f)
+    , m_state(m_b0.size() * 2, 0.0f)
+    , m_numBands(m_dry.size(), 0)
+    , m_active(m_dry.size(), 0)
+    , m_groupVoices(m_dry.size() / 4, 0)
+{
+}
+
+// Compile fixed formant settings
+FormantSettings FormantBank::compile(const Wersi::Wave& wave)
+{
+    FormantSettings settings;
+    bool used = false;
+    for (size_t band = 0; band < NumBands; ++band) {
+        const Wersi::Wave::Formant& formant = wave.getFormant(band);
+        settings.m_frequency[band] = float(formant.m_frequency);
+        settings.m_bandwidth[band] = float(formant.m_width > 0 ? formant.m_width : 1) * WidthStep;
+        settings.m_level[band] = float(formant.m_level) / 127.0f;
+        used |= formant.m_frequency != 0 && formant.m_level != 0;
+    }
+    settings.m_dry = used ? float(wave.getDryLevel()) / 127.0f : 1.0f;
+    return settings;
+}
+
+// Start voice
+void FormantBank::start(size_t voice, const FormantSettings& settings)
+{
+    if (m_active[voice] == 0) {
+        ++m_groupVoices[voice / 4];
+    }
+    m_active[voice] = 1;
+    m_dry[voice] = settings.m_dry;
+    m_numBands[voice] = 0;
+
+    // Constant peak gain band pass, the coefficients only depend on the fixed band frequencies
+    const size_t stride = m_dry.size();
+    for (size_t band = 0; band < NumBands; ++band) {
+        size_t index = band * stride + voice;
+        float frequency = settings.m_frequency[band];
+        m_state[2 * band * stride + voice] = 0.0f;
+        m_state[(2 * band + 1) * stride + voice] = 0.0f;
+        if (frequency <= 0.0f || frequency >= 0.45f * m_sampleRate || settings.m_level[band] == 0.0f) {
+            m_b0[index] = 0.0f;
+            m_a1[index] = 0.0f;
+            m_a2[index] = 0.0f;
+            m_gain[index] = 0.0f;
+            continue;
+        }
+
+        float w0 = 2.0f * Pi * frequency / m_sampleRate;
+        float alpha = std::sin(w0) * settings.m_bandwidth[band] / (2.0f * frequency);
+        float norm = 1.0f / (1.0f + alpha);
+        m_b0[index] = alpha * norm;
+        m_a1[index] = -2.0f * std::cos(w0) * norm;
+        m_a2[index] = (1.0f - alpha) * norm;
+        m_gain[index] = settings.m_level[band];
+        m_numBands[voice] = uint8_t(band + 1);
+    }
+}
+
+// Stop voice
+void FormantBank::stop(size_t voice)
+{
+    if (m_active[voice] != 0) {
+        --m_groupVoices[voice / 4];
+        m_active[voice] = 0;
+        m_dry[voice] = 1.0f;
+        m_numBands[voice] = 0;
+        const size_t stride = m_dry.size();
+        for (size_t band = 0; band < NumBands; ++band) {
+            m_gain[band * stride + voice] = 0.0f;
+        }
+    }
+}
+
+// Filter all active groups
+void FormantBank::process(float* data, size_t frames)
+{
+    for (size_t group = 0; group < m_groupVoices.size(); ++group) {
+        if (m_groupVoices[group] != 0) {
+            processGroup(group, data + group * frames * 4, frames);
+        }
+    }
+}
+
+// Filter the four voices of a group
+void FormantBank::processGroup(size_t group, float* data, size_t frames)
+{
+    const size_t base = group * 4;
+    const size_t stride = m_dry.size();
+    size_t numBands = 0;
+    for (size_t lane = 0; lane < 4; ++lane) {
+        numBands = std::max(numBands, size_t(m_numBands[base + lane]));
+    }
+
+    Float4 dry = Float4::load(&(m_dry[base]));
+    Float4 b0[NumBands], a1[NumBands], a2[NumBands], gain[NumBands], s1[NumBands], s2[NumBands];
+    for (size_t band = 0; band < numBands; ++band) {
+        size_t v = band * stride + base;
+        b0[band] = Float4::load(&(m_b0[v]));
+        a1[band] = Float4::load(&(m_a1[v]));
+        a2[band] = Float4::load(&(m_a2[v]));
+        gain[band] = Float4::load(&(m_gain[v]));
+        s1[band] = Float4::load(&(m_state[2 * band * stride + base]));
+        s2[band] = Float4::load(&(m_state[(2 * band + 1) * stride + base]));
+    }
+
+    // Transposed direct form II resonators, b1 is zero and b2 is -b0 for the band pass
+    for (size_t frame = 0; frame < frames; ++frame) {
+        float* ptr = data + frame * 4;
+        Float4 x = Float4::load(ptr);
+        Float4 y = x * dry;
+        for (size_t band = 0; band < numBands; ++band) {
+            Float4 bx = b0[band] * x;
+            Float4 out = bx + s1[band];
+            s1[band] = s2[band] - a1[band] * out;
+            s2[band] = Float4(0.0f) - bx - a2[band] * out;
+            y += out * gain[band];
+        }
+        y.store(ptr);
+    }
+
+    for (size_t band = 0; band < numBands; ++band) {
+        s1[band].store(&(m_state[2 * band * stride + base]));
+        s2[band].store(&(m_state[(2 * band + 1) * stride + base]));
+    }
+    for (size_t i = 0; i < 2 * numBands; ++i) {
+        for (size_t lane = 0; lane < 4; ++lane) {
+            float& state = m_state[i * stride + base + lane];
+            if (std::fabs(state) < StateThreshold) {
+                state = 0.0f;
+            }
+        }
+    }
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,178 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <wersi/wave.hh>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Compiled fixed formant settings.
+
+  The bands of a fixed formant wave converted to the units used by FormantBank.
+ */
+struct FormantSettings {
+    float   m_dry;                                      ///< Gain of the unfiltered wave
+    float   m_frequency[Wersi::Wave::NumFormants];      ///< Center frequencies in Hz, 0 for unused bands
+    float   m_bandwidth[Wersi::Wave::NumFormants];      ///< Bandwidths in Hz
+    float   m_level[Wersi::Wave::NumFormants];          ///< Band gains
+};
+
+/**
+  @ingroup synth_group
+
+  Fixed formant filter bank.
+
+  Fixed formant waves are shaped by resonances which stay at the same frequencies whatever note is played. Each voice
+  passes its oscillator output through a parallel bank of band pass resonators and mixes their outputs with the dry
+  signal. As the band frequencies do not depend on the note, the resonator coefficients are computed once when a
+  voice starts and only the filter states run per sample. Voices are processed four at a time, one voice per SIMD
+  lane, using the same group-interleaved layout as OscillatorBank, bands unused by all lanes of a group are skipped.
+
+  The bands come from the unconfirmed fixed formant layout of Wersi::Wave, so instruments only use the bank when
+  built with the EXPERIMENTAL_FORMANTS option.
+ */
+class FormantBank {
+    public:
+        /**
+          Create fixed formant filter bank.
+
+          Creates a filter bank with all voices stopped.
+
+          @param[in]    numVoices   Number of voices, rounded up to a multiple of four
+          @param[in]    sampleRate  Sample rate in Hz
+         */
+        FormantBank(size_t numVoices, float sampleRate);
+
+        /**
+          Compile fixed formant settings.
+
+          Converts the fixed formant bands of a wave. A wave without any used band passes unchanged.
+
+          @param[in]    wave        Fixed formant wave
+
+          @return                   Compiled settings
+         */
+        static FormantSettings compile(const Wersi::Wave& wave);
+
+        /**
+          Get number of voices.
+
+          Returns the number of voices, which is always a multiple of four.
+
+          @return                   Number of voices
+         */
+        size_t getNumVoices() const {
+            return m_dry.size();
+        }
+
+        /**
+          Start voice.
+
+          Clears the filter state of the voice and computes its resonator coefficients. Bands at or above 0.45 times
+          the sample rate are muted.
+
+          @param[in]    voice       Voice index
+          @param[in]    settings    Compiled fixed formant settings
+         */
+        void start(size_t voice, const FormantSettings& settings);
+
+        /**
+          Stop voice.
+
+          Stops filtering the voice, its samples pass unchanged while other voices of its group are active.
+
+          @param[in]    voice       Voice index
+         */
+        void stop(size_t voice);
+
+        /**
+          Check for active voice.
+
+          Returns true if the voice is being filtered.
+
+          @param[in]    voice       Voice index
+
+          @return                   True if active
+         */
+        bool isActive(size_t voice) const {
+            return m_active[voice] != 0;
+        }
+
+        /**
+          Process voices.
+
+          Filters the given number of frames in place. The buffer layout is the one written by
+          OscillatorBank::render(), groups without active voices are left untouched.
+
+          @param[in,out] data       Sample buffer
+          @param[in]    frames      Number of frames to process
+         */
+        void process(float* data, size_t frames);
+
+    private:
+        float                   m_sampleRate;   ///< Sample rate in Hz
+        std::vector<float>      m_dry;          ///< Dry gain per voice
+        std::vector<float>      m_b0;           ///< Resonator input coefficient per band and voice
+        std::vector<float>      m_a1;           ///< Resonator first feedback coefficient per band and voice
+        std::vector<float>      m_a2;           ///< Resonator second feedback coefficient per band and voice
+        std::vector<float>      m_gain;         ///< Resonator output gain per band and voice
+        std::vector<float>      m_state;        ///< Resonator states, two per band, per voice
+        std::vector<uint8_t>    m_numBands;     ///< Number of bands up to the last used one per voice
+        std::vector<uint8_t>    m_active;       ///< Voice active flags
+        std::vector<uint8_t>    m_groupVoices;  ///< Number of active voices per group
+
+        /**
+          Process group.
+
+          Filters the four voices of one group.
+
+          @param[in]    group       Group index
+          @param[in,out] data       Sample buffer of the group
+          @param[in]    frames      Number of frames to process
+         */
+        void processGroup(size_t group, float* data, size_t frames);
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,154 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Content hash cache.
+
+  Computes objects from source blocks on first use and keeps them keyed by the content hash of the source block.
+  Since updating a block changes its hash, edited blocks get new objects automatically, and equal blocks share their
+  objects even across instrument stores. The least recently used entries are dropped when the capacity is exceeded.
+  Objects are handed out as shared pointers, so users can keep dropped objects. The cache may be used from several
+  threads.
+
+  @tparam       T           Cached type, constructible from the source block
+ */
+template<typename T> class HashCache {
+    public:
+        /**
+          Create content hash cache.
+
+          Creates an empty cache.
+
+          @param[in]    capacity    Maximum number of cached objects
+         */
+        explicit HashCache(size_t capacity = 256)
+            : m_capacity(capacity > 0 ? capacity : 1)
+            , m_entries()
+            , m_useCounter(0)
+            , m_mutex()
+        {
+        }
+
+        /**
+          Get object.
+
+          Returns the object computed from the given source block, computing it if not yet cached.
+
+          @param[in]    source      Source block, providing getHash()
+
+          @return                   Cached object
+         */
+        template<typename S> std::shared_ptr<const T> get(const S& source) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_useCounter;
+            typename EntryMap::iterator it = m_entries.find(source.getHash());
+            if (it != m_entries.end()) {
+                it->second.m_lastUse = m_useCounter;
+                return it->second.m_object;
+            }
+
+            // Drop least recently used entry
+            if (m_entries.size() >= m_capacity) {
+                typename EntryMap::iterator oldest = m_entries.begin();
+                for (typename EntryMap::iterator i = m_entries.begin(); i != m_entries.end(); ++i) {
+                    if (i->second.m_lastUse < oldest->second.m_lastUse) {
+                        oldest = i;
+                    }
+                }
+                m_entries.erase(oldest);
+            }
+
+            Entry entry = { std::make_shared<T>(source), m_useCounter };
+            m_entries.insert(std::make_pair(source.getHash(), entry));
+            return entry.m_object;
+        }
+
+        /**
+          Get number of cached objects.
+
+          Returns the number of objects currently cached.
+
+          @return                   Number of cached objects
+         */
+        size_t getSize() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_entries.size();
+        }
+
+        /**
+          Clear cache.
+
+          Drops all cached objects.
+         */
+        void clear() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_entries.clear();
+        }
+
+    private:
+        /// Cache entry
+        struct Entry {
+            std::shared_ptr<const T>    m_object;   ///< Cached object
+            uint64_t                    m_lastUse;  ///< Use counter value of last access
+        };
+
+        /// Map of cache entries by content hash
+        typedef std::map<uint64_t, Entry> EntryMap;
+
+        size_t              m_capacity;     ///< Maximum number of cached objects
+        EntryMap            m_entries;      ///< Cache entries
+        uint64_t            m_useCounter;   ///< Counter of accesses
+        mutable std::mutex  m_mutex;        ///< Protects entries and counter
+
+        HashCache(const HashCache&);                ///< Inhibit copying objects
+        HashCache& operator=(const HashCache&);     ///< Inhibit copying objects
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
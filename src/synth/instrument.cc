@@ -0,0 +1,93 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/instrument.hh>
+#include <synth/envelopecache.hh>
+#include <synth/wavemipmapcache.hh>
+#include <wersi/instrumentstore.hh>
+#include <wersi/icb.hh>
+#include <wersi/vcf.hh>
+#include <wersi/wave.hh>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Create instrument
+Instrument::Instrument(Wersi::InstrumentStore& store, uint8_t icb, EnvelopeCache& envelopes, WaveMipmapCache& waves)
+    : m_patch(store, icb)
+    , m_layers()
+    , m_name()
+{
+    Wersi::Icb* first = store.getIcb(icb);
+    if (first != nullptr) {
+        m_name = first->getName();
+    }
+
+    m_layers.reserve(m_patch.getNumLayers());
+    for (size_t i = 0; i < m_patch.getNumLayers(); ++i) {
+        const Patch::Layer& layer = m_patch.getLayer(i);
+        LayerData data = {
+            envelopes.getAmpl(layer.m_ampl), envelopes.getFreq(layer.m_freq), nullptr, 0.0f,
+            false, FormantSettings(), false, VcfSettings(), false, Wersi::Vcf::NoiseType::Invalid
+        };
+
+        Wersi::Wave* wave = store.getWave(layer.m_wave);
+        if (wave != nullptr) {
+            data.m_wave = waves.get(*wave);
+            data.m_level = float(wave->getLevel()) / 127.0f;
+#ifdef EXPERIMENTAL_FORMANTS
+            // The fixed formant layout is unconfirmed, so the bands are only rendered on request
+            if (wave->getFixedFormants()) {
+                data.m_fixedFormants = true;
+                data.m_formants = FormantBank::compile(*wave);
+            }
+#endif // EXPERIMENTAL_FORMANTS
+        }
+
+        Wersi::Vcf* vcf = store.getVcf(layer.m_vcf);
+        if (vcf != nullptr && BusMixer::isFiltered(layer.m_route)) {
+            data.m_filtered = true;
+            data.m_vcf = VcfBank::compile(*vcf);
+            data.m_noise = vcf->getNoise();
+            data.m_noiseType = vcf->getNoiseType();
+        }
+        m_layers.push_back(data);
+    }
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,144 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <synth/patch.hh>
+#include <synth/envelopeprogram.hh>
+#include <synth/wavemipmapcache.hh>
+#include <synth/vcfbank.hh>
+#include <synth/formantbank.hh>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace DMSToolbox {
+
+// Forward declarations
+namespace Wersi {
+class InstrumentStore;
+} // namespace Wersi
+
+namespace Synth {
+
+// Forward declarations
+class EnvelopeCache;
+
+/**
+  @ingroup synth_group
+
+  Playable instrument.
+
+  Bundles a compiled patch with everything its layers need to sound: envelope programs, band-limited wave tables
+  and VCF settings. Instruments are immutable once created, so a render engine can play them without touching the
+  instrument store, and several engines on different threads can share one instrument. Resources are taken from the
+  given caches, so instruments using the same blocks share them. Editing the store does not change existing
+  instruments, a new instrument has to be created to hear the changes.
+ */
+class Instrument {
+    public:
+        /// Resources of one layer
+        struct LayerData {
+            std::shared_ptr<const EnvelopeProgram>  m_ampl;     ///< AMPL envelope program
+            std::shared_ptr<const EnvelopeProgram>  m_freq;     ///< FREQ envelope program
+            std::shared_ptr<const WaveMipmap>       m_wave;     ///< Band-limited tables, null if the wave is missing
+            float                   m_level;        ///< Wave level as gain 0..1
+            bool                    m_fixedFormants;    ///< Wave uses fixed formants
+            FormantSettings         m_formants;     ///< Compiled fixed formants, valid if fixed formants
+            bool                    m_filtered;     ///< Layer is routed through the VCF
+            VcfSettings             m_vcf;          ///< Compiled VCF settings, valid if filtered
+            bool                    m_noise;        ///< VCF noise enabled, only if filtered
+            Wersi::Vcf::NoiseType   m_noiseType;    ///< VCF noise type
+        };
+
+        /**
+          Create instrument.
+
+          Compiles the patch starting at the given ICB and fetches the resources of all its layers. The envelope
+          cache must belong to the given store.
+
+          @param[in]    store       Instrument store
+          @param[in]    icb         First ICB block number
+          @param[in]    envelopes   Envelope program cache of the store
+          @param[in]    waves       Band-limited wave table cache
+         */
+        Instrument(Wersi::InstrumentStore& store, uint8_t icb, EnvelopeCache& envelopes, WaveMipmapCache& waves);
+
+        /**
+          Get patch.
+
+          Returns the compiled patch.
+
+          @return                   Patch
+         */
+        const Patch& getPatch() const {
+            return m_patch;
+        }
+
+        /**
+          Get layer resources.
+
+          Returns the resources of a layer of the patch.
+
+          @param[in]    index       Layer index
+
+          @return                   Layer resources
+         */
+        const LayerData& getLayerData(size_t index) const {
+            return m_layers[index];
+        }
+
+        /**
+          Get name.
+
+          Returns the name of the first ICB.
+
+          @return                   Instrument name
+         */
+        const std::string& getName() const {
+            return m_name;
+        }
+
+    private:
+        Patch                   m_patch;        ///< Compiled patch
+        std::vector<LayerData>  m_layers;       ///< Resources per layer
+        std::string             m_name;         ///< Name of the first ICB
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,147 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/instrumentmorph.hh>
+#include <synth/simd.hh>
+#include <wersi/icb.hh>
+#include <wersi/vcf.hh>
+#include <wersi/wave.hh>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Definitions of constants used by reference
+const size_t InstrumentMorph::IcbSize;
+const size_t InstrumentMorph::VcfSize;
+const size_t InstrumentMorph::WaveSize;
+const size_t InstrumentMorph::TableSize;
+
+// Interpolate unsigned field
+static inline uint8_t interpolate(uint8_t from, uint8_t to, float position)
+{
+    return uint8_t(lrintf(float(from) + (float(to) - float(from)) * position));
+}
+
+// Interpolate signed field
+static inline uint8_t interpolateSigned(uint8_t from, uint8_t to, float position)
+{
+    float a = float(int8_t(from));
+    float b = float(int8_t(to));
+    return uint8_t(int8_t(lrintf(a + (b - a) * position)));
+}
+
+// Create instrument morph
+InstrumentMorph::InstrumentMorph(const Wersi::Icb& fromIcb, const Wersi::Vcf& fromVcf, const Wersi::Wave& fromWave,
+                                 const Wersi::Icb& toIcb, const Wersi::Vcf& toVcf, const Wersi::Wave& toWave)
+    : m_icb()
+    , m_vcf()
+    , m_wave()
+    , m_waveSize(std::min(fromWave.getBufferSize(), WaveSize))
+    , m_table()
+    , m_delta()
+{
+    memcpy(m_icb[0], fromIcb.getBuffer(), IcbSize);
+    memcpy(m_icb[1], toIcb.getBuffer(), IcbSize);
+    memcpy(m_vcf[0], fromVcf.getBuffer(), VcfSize);
+    memcpy(m_vcf[1], toVcf.getBuffer(), VcfSize);
+    memcpy(m_wave[0], fromWave.getBuffer(), m_waveSize);
+    memcpy(m_wave[1], toWave.getBuffer(), std::min(toWave.getBufferSize(), WaveSize));
+
+    // Tables start after the level byte
+    for (size_t i = 0; i < TableSize; ++i) {
+        m_table[i] = float(m_wave[0][i + 1]);
+        m_delta[i] = float(m_wave[1][i + 1]) - m_table[i];
+    }
+}
+
+// Render intermediate instrument
+void InstrumentMorph::render(float position, Frame& frame) const
+{
+    position = std::min(std::max(position, 0.0f), 1.0f);
+    size_t nearest = position < 0.5f ? 0 : 1;
+
+    // ICB: links and name from the source, switches from the nearest instrument
+    const uint8_t* from = m_icb[0];
+    const uint8_t* to = m_icb[1];
+    uint8_t* icb = frame.m_icb;
+    memcpy(icb, from, IcbSize);
+    icb[5] = (m_icb[nearest][5] & 0xfc) | (interpolate(from[5] & 3, to[5] & 3, position) & 3);
+    icb[6] = m_icb[nearest][6];
+    icb[7] = interpolateSigned(from[7], to[7], position);
+    icb[8] = interpolateSigned(from[8], to[8], position);
+    icb[9] = m_icb[nearest][9];
+
+    // VCF: frequency, quality and envelope interpolated, switches and modes from the nearest instrument
+    from = m_vcf[0];
+    to = m_vcf[1];
+    uint8_t* vcf = frame.m_vcf;
+    vcf[0] = m_vcf[nearest][0];
+    vcf[1] = interpolateSigned(from[1], to[1], position);
+    vcf[2] = interpolate(from[2], to[2], position);
+    vcf[3] = m_vcf[nearest][3];
+    vcf[4] = interpolate(from[4], to[4], position);
+    vcf[5] = interpolate(from[5], to[5], position);
+    for (size_t i = 6; i < VcfSize; ++i) {
+        vcf[i] = interpolateSigned(from[i], to[i], position);
+    }
+
+    // WAVE: level interpolated, fixed formants from the nearest instrument if the source wave has room for them
+    from = m_wave[0];
+    to = m_wave[1];
+    uint8_t* wave = frame.m_wave;
+    uint8_t formants = m_waveSize == WaveSize ? (m_wave[nearest][0] & 0x80) : 0x00;
+    wave[0] = formants | (interpolate(from[0] & 0x7f, to[0] & 0x7f, position) & 0x7f);
+    memcpy(wave + 1 + TableSize, m_wave[nearest] + 1 + TableSize, WaveSize - 1 - TableSize);
+
+    // Crossfade tables, samples are unsigned so rounding is adding one half before truncation
+    Float4 fade(position);
+    Float4 half(0.5f);
+    int32_t ints[Float4::Lanes];
+    for (size_t i = 0; i < TableSize; i += Float4::Lanes) {
+        Float4 sample = Float4::load(m_table + i) + Float4::load(m_delta + i) * fade + half;
+        sample.truncate(ints);
+        for (size_t j = 0; j < Float4::Lanes; ++j) {
+            wave[1 + i + j] = uint8_t(ints[j]);
+        }
+    }
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
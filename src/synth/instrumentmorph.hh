@@ -0,0 +1,133 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+
+namespace DMSToolbox {
+
+// Forward declarations
+namespace Wersi {
+class Icb;
+class Vcf;
+class Wave;
+} // namespace Wersi
+
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Instrument morph.
+
+  Computes intermediate ICB, VCF and WAVE blocks between two instruments, meant to be streamed to the device while a
+  note is held. Numeric fields like transpose, detune, filter frequency, quality, envelope times and intensities and
+  the wave level are interpolated linearly. Switches and modes can't be interpolated, they are taken from the
+  instrument nearer to the morph position. Block links and the name always come from the source instrument, as the
+  intermediate blocks are written into its slots on the device, so a source wave without room for fixed formants never
+  gets the fixed formant flag. The four wave tables are crossfaded with Float4 lanes from float copies of both waves
+  prepared once, so rendering a frame is cheap enough to be done for every control change.
+ */
+class InstrumentMorph {
+    public:
+        /// Raw ICB size
+        static const size_t IcbSize = 16;
+
+        /// Raw VCF size
+        static const size_t VcfSize = 10;
+
+        /// Raw WAVE size, a block with fixed formants
+        static const size_t WaveSize = 212;
+
+        /// Size of the four wave tables following the level byte
+        static const size_t TableSize = 176;
+
+        /// Raw blocks of an intermediate instrument
+        struct Frame {
+            uint8_t m_icb[IcbSize];         ///< ICB
+            uint8_t m_vcf[VcfSize];         ///< VCF
+            uint8_t m_wave[WaveSize];       ///< WAVE, only the size of the source wave is used
+        };
+
+        /**
+          Create instrument morph.
+
+          Copies the raw blocks of both instruments, the blocks may be changed or destroyed afterwards.
+
+          @param[in]    fromIcb     ICB of the source instrument, at morph position 0
+          @param[in]    fromVcf     VCF of the source instrument
+          @param[in]    fromWave    WAVE of the source instrument
+          @param[in]    toIcb       ICB of the destination instrument, at morph position 1
+          @param[in]    toVcf       VCF of the destination instrument
+          @param[in]    toWave      WAVE of the destination instrument
+         */
+        InstrumentMorph(const Wersi::Icb& fromIcb, const Wersi::Vcf& fromVcf, const Wersi::Wave& fromWave,
+                        const Wersi::Icb& toIcb, const Wersi::Vcf& toVcf, const Wersi::Wave& toWave);
+
+        /**
+          Get wave size.
+
+          Returns the raw size of the intermediate WAVE blocks, the size of the source wave.
+
+          @return                   Raw WAVE size in bytes
+         */
+        size_t getWaveSize() const {
+            return m_waveSize;
+        }
+
+        /**
+          Render intermediate instrument.
+
+          Computes the raw blocks at the given morph position.
+
+          @param[in]    position    Morph position, 0 for the source and 1 for the destination instrument
+          @param[out]   frame       Raw blocks
+         */
+        void render(float position, Frame& frame) const;
+
+    private:
+        uint8_t     m_icb[2][IcbSize];      ///< Raw ICBs of source and destination
+        uint8_t     m_vcf[2][VcfSize];      ///< Raw VCFs of source and destination
+        uint8_t     m_wave[2][WaveSize];    ///< Raw WAVEs of source and destination, zero padded
+        size_t      m_waveSize;             ///< Raw size of the source WAVE
+        float       m_table[TableSize];     ///< Source wave tables
+        float       m_delta[TableSize];     ///< Destination minus source wave tables
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
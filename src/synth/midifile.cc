@@ -0,0 +1,217 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/midifile.hh>
+#include <exceptions.hh>
+#include <algorithm>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Default tempo
+const uint32_t MidiFile::DefaultTempo;
+
+// Read big endian value
+static uint32_t getBigEndian(const uint8_t* data, size_t bytes)
+{
+    uint32_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+// Read variable length quantity
+static uint32_t getVariable(const uint8_t* data, size_t size, size_t& pos)
+{
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        if (pos >= size) {
+            break;
+        }
+        uint8_t byte = data[pos++];
+        value = (value << 7) | (byte & 0x7f);
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw DataFormatException("Invalid variable length quantity in MIDI track");
+}
+
+// Parse MIDI file
+MidiFile::MidiFile(const void* data, size_t size)
+    : m_events()
+    , m_duration(0.0)
+{
+    const uint8_t* buf = static_cast<const uint8_t*>(data);
+    if (size < 14 || !std::equal(buf, buf + 4, "MThd") || getBigEndian(buf + 4, 4) < 6) {
+        throw DataFormatException("Not a standard MIDI file");
+    }
+    uint16_t format = uint16_t(getBigEndian(buf + 8, 2));
+    uint16_t numTracks = uint16_t(getBigEndian(buf + 10, 2));
+    uint16_t division = uint16_t(getBigEndian(buf + 12, 2));
+    if (format > 1) {
+        throw DataFormatException("Only MIDI file formats 0 and 1 are supported");
+    }
+    if (division == 0) {
+        throw DataFormatException("Invalid MIDI file time division");
+    }
+
+    // Collect events of all tracks, unknown chunks are skipped
+    std::vector<TickEvent> events;
+    uint64_t lastTick = 0;
+    size_t pos = 8 + getBigEndian(buf + 4, 4);
+    size_t track = 0;
+    while (track < numTracks && pos + 8 <= size) {
+        size_t length = getBigEndian(buf + pos + 4, 4);
+        if (length > size - pos - 8) {
+            throw DataFormatException("Truncated MIDI file chunk");
+        }
+        if (std::equal(buf + pos, buf + pos + 4, "MTrk")) {
+            lastTick = std::max(lastTick, parseTrack(buf + pos + 8, length, events));
+            ++track;
+        }
+        pos += 8 + length;
+    }
+
+    // Merge tracks, events at the same tick keep their track order
+    std::stable_sort(events.begin(), events.end(), [](const TickEvent& a, const TickEvent& b) {
+        return a.m_tick < b.m_tick;
+    });
+
+    // Apply tempo map, SMPTE divisions have a fixed number of ticks per second
+    double tickTime;
+    bool smpte = (division & 0x8000) != 0;
+    if (smpte) {
+        int framesPerSecond = -int(int8_t(division >> 8));
+        int ticksPerFrame = division & 0xff;
+        if (framesPerSecond <= 0 || ticksPerFrame == 0) {
+            throw DataFormatException("Invalid MIDI file time division");
+        }
+        tickTime = 1.0 / (double(framesPerSecond) * double(ticksPerFrame));
+    }
+    else {
+        tickTime = double(DefaultTempo) * 1.0e-6 / double(division);
+    }
+    double time = 0.0;
+    uint64_t tick = 0;
+    for (auto& i : events) {
+        time += double(i.m_tick - tick) * tickTime;
+        tick = i.m_tick;
+        if (i.m_tempo != 0) {
+            if (!smpte) {
+                tickTime = double(i.m_tempo) * 1.0e-6 / double(division);
+            }
+        }
+        else {
+            i.m_event.m_time = time;
+            m_events.push_back(i.m_event);
+        }
+    }
+    m_duration = time + double(lastTick - tick) * tickTime;
+}
+
+// Parse track chunk
+uint64_t MidiFile::parseTrack(const uint8_t* data, size_t size, std::vector<TickEvent>& events)
+{
+    uint64_t tick = 0;
+    uint8_t status = 0;
+    size_t pos = 0;
+    while (pos < size) {
+        tick += getVariable(data, size, pos);
+        if (pos >= size) {
+            break;
+        }
+
+        // Running status applies to channel messages only
+        if ((data[pos] & 0x80) != 0) {
+            status = data[pos++];
+        }
+        else if (status < 0x80 || status >= 0xf0) {
+            throw DataFormatException("Invalid running status in MIDI track");
+        }
+
+        if (status == 0xff) {
+            // Meta event
+            if (pos >= size) {
+                break;
+            }
+            uint8_t type = data[pos++];
+            size_t length = getVariable(data, size, pos);
+            if (length > size - pos) {
+                throw DataFormatException("Truncated meta event in MIDI track");
+            }
+            if (type == 0x2f) {
+                break;
+            }
+            if (type == 0x51 && length == 3) {
+                TickEvent event = { tick, getBigEndian(data + pos, 3), { 0.0, 0, 0, 0 } };
+                if (event.m_tempo != 0) {
+                    events.push_back(event);
+                }
+            }
+            pos += length;
+        }
+        else if (status == 0xf0 || status == 0xf7) {
+            // System exclusive message
+            size_t length = getVariable(data, size, pos);
+            if (length > size - pos) {
+                throw DataFormatException("Truncated system exclusive message in MIDI track");
+            }
+            pos += length;
+        }
+        else if (status >= 0x80 && status < 0xf0) {
+            // Channel message, program change and channel pressure have one data byte
+            size_t length = (status & 0xe0) == 0xc0 ? 1 : 2;
+            if (length > size - pos) {
+                throw DataFormatException("Truncated channel message in MIDI track");
+            }
+            TickEvent event = {
+                tick, 0, { 0.0, status, uint8_t(data[pos] & 0x7f), uint8_t(length == 2 ? data[pos + 1] & 0x7f : 0) }
+            };
+            events.push_back(event);
+            pos += length;
+        }
+        else {
+            throw DataFormatException("Unsupported system message in MIDI track");
+        }
+    }
+    return tick;
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,128 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Standard MIDI file.
+
+  Parses format 0 and 1 Standard MIDI files. The channel messages of all tracks are merged into one list ordered by
+  time, with the tempo map already applied, so players only need to compare timestamps. Meta events other than tempo
+  changes and system exclusive messages are skipped.
+ */
+class MidiFile {
+    public:
+        /// Channel message
+        struct Event {
+            double      m_time;             ///< Time in seconds from the start
+            uint8_t     m_status;           ///< Status byte including channel
+            uint8_t     m_data1;            ///< First data byte
+            uint8_t     m_data2;            ///< Second data byte, 0 for messages with one data byte
+        };
+
+        /**
+          Parse MIDI file.
+
+          Parses the file contents from the given buffer.
+
+          @param[in]    data        File contents
+          @param[in]    size        File size
+
+          @exception    DataFormatException     Not a valid format 0 or 1 MIDI file
+         */
+        MidiFile(const void* data, size_t size);
+
+        /**
+          Get events.
+
+          Returns the channel messages of all tracks ordered by time.
+
+          @return                   Events
+         */
+        const std::vector<Event>& getEvents() const {
+            return m_events;
+        }
+
+        /**
+          Get duration.
+
+          Returns the time of the last event of any track, including meta events.
+
+          @return                   Duration in seconds
+         */
+        double getDuration() const {
+            return m_duration;
+        }
+
+    private:
+        /// Default tempo in microseconds per quarter note
+        static const uint32_t DefaultTempo = 500000;
+
+        /// Event with time in ticks, used while merging tracks
+        struct TickEvent {
+            uint64_t    m_tick;             ///< Time in ticks
+            uint32_t    m_tempo;            ///< New tempo for tempo changes, 0 for channel messages
+            Event       m_event;            ///< Channel message
+        };
+
+        std::vector<Event>  m_events;       ///< Channel messages ordered by time
+        double              m_duration;     ///< Time of the last event in seconds
+
+        /**
+          Parse track.
+
+          Appends the channel messages and tempo changes of a track chunk.
+
+          @param[in]    data        Track chunk data
+          @param[in]    size        Track chunk size
+          @param[out]   events      Parsed events
+
+          @return                   Time of the last event in ticks
+         */
+        static uint64_t parseTrack(const uint8_t* data, size_t size, std::vector<TickEvent>& events);
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
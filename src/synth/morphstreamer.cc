@@ -0,0 +1,220 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/morphstreamer.hh>
+#include <wersi/sysex.hh>
+#include <algorithm>
+#include <cstring>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Create morph streamer
+MorphStreamer::MorphStreamer(const Sender& sender, uint8_t device, uint8_t icbNum, uint8_t vcfNum, uint8_t waveNum,
+                             size_t waveSize, size_t linkRate)
+    : m_sender(sender)
+    , m_device(device)
+    , m_icbNum(icbNum)
+    , m_vcfNum(vcfNum)
+    , m_waveNum(waveNum)
+    , m_waveSize(std::min(waveSize, InstrumentMorph::WaveSize))
+    , m_linkRate(std::max(linkRate, size_t(1)))
+    , m_pending()
+    , m_sent()
+    , m_hasPending(false)
+    , m_hasSent(false)
+    , m_busy(false)
+    , m_stop(false)
+    , m_numSent(0)
+    , m_numDropped(0)
+    , m_numBytes(0)
+    , m_linkFree(Clock::now())
+    , m_error()
+    , m_mutex()
+    , m_wake()
+    , m_idle()
+    , m_thread()
+{
+    m_thread = std::thread(&MorphStreamer::run, this);
+}
+
+// Destroy morph streamer
+MorphStreamer::~MorphStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+// Post frame, replacing a waiting one
+bool MorphStreamer::post(const InstrumentMorph::Frame& frame)
+{
+    bool dropped;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_error) {
+            std::exception_ptr error = m_error;
+            m_error = nullptr;
+            std::rethrow_exception(error);
+        }
+        dropped = m_hasPending;
+        if (dropped) {
+            ++m_numDropped;
+        }
+        m_pending = frame;
+        m_hasPending = true;
+    }
+    m_wake.notify_one();
+    return !dropped;
+}
+
+// Wait until all posted frames are sent
+void MorphStreamer::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return (!m_hasPending && !m_busy) || m_error; });
+    if (m_error) {
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+
+    // The device is only done when the link has carried the last byte
+    Clock::time_point linkFree = m_linkFree;
+    lock.unlock();
+    std::this_thread::sleep_until(linkFree);
+}
+
+// Get number of frames sent
+size_t MorphStreamer::getNumSent() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_numSent;
+}
+
+// Get number of frames dropped
+size_t MorphStreamer::getNumDropped() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_numDropped;
+}
+
+// Get number of bytes sent
+size_t MorphStreamer::getNumBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_numBytes;
+}
+
+// Sending thread main loop
+void MorphStreamer::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stop) {
+        m_wake.wait(lock, [this] { return m_hasPending || m_stop; });
+
+        // Take the frame only when the link is free, newer frames posted meanwhile replace it
+        m_wake.wait_until(lock, m_linkFree, [this] { return m_stop; });
+        if (m_stop) {
+            break;
+        }
+        InstrumentMorph::Frame frame = m_pending;
+        m_hasPending = false;
+        m_busy = true;
+        lock.unlock();
+
+        size_t bytes = 0;
+        std::exception_ptr error;
+        try {
+            bytes = send(frame);
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        m_busy = false;
+        if (error) {
+            m_error = error;
+        }
+        else if (bytes > 0) {
+            ++m_numSent;
+            m_numBytes += bytes;
+            Clock::duration transfer = std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(double(bytes) / double(m_linkRate)));
+            m_linkFree = std::max(m_linkFree, Clock::now()) + transfer;
+        }
+        m_idle.notify_all();
+    }
+}
+
+// Send changed blocks of a frame
+size_t MorphStreamer::send(const InstrumentMorph::Frame& frame)
+{
+    using Wersi::SysEx;
+
+    // Send the blocks the ICB links to first, so the ICB never refers to a half updated instrument
+    std::vector<unsigned char> message;
+    size_t bytes = 0;
+    if (!m_hasSent || memcmp(frame.m_wave, m_sent.m_wave, m_waveSize) != 0) {
+        SysEx::BlockType type = m_waveSize < InstrumentMorph::WaveSize ? SysEx::BlockType::RelWaveBlock
+                                                                       : SysEx::BlockType::FixWaveBlock;
+        bytes += SysEx::encodeBlock(m_device, type, m_waveNum, frame.m_wave, uint8_t(m_waveSize), message);
+        m_sender(message);
+        message.clear();
+    }
+    if (!m_hasSent || memcmp(frame.m_vcf, m_sent.m_vcf, InstrumentMorph::VcfSize) != 0) {
+        bytes += SysEx::encodeBlock(m_device, SysEx::BlockType::VcfBlock, m_vcfNum, frame.m_vcf,
+                                    uint8_t(InstrumentMorph::VcfSize), message);
+        m_sender(message);
+        message.clear();
+    }
+    if (!m_hasSent || memcmp(frame.m_icb, m_sent.m_icb, InstrumentMorph::IcbSize) != 0) {
+        bytes += SysEx::encodeBlock(m_device, SysEx::BlockType::IcBlock, m_icbNum, frame.m_icb,
+                                    uint8_t(InstrumentMorph::IcbSize), message);
+        m_sender(message);
+    }
+    m_sent = frame;
+    m_hasSent = true;
+    return bytes;
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
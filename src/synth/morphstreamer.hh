@@ -0,0 +1,185 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <synth/instrumentmorph.hh>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Morph streamer.
+
+  Sends intermediate instruments of an InstrumentMorph to the device as SysEx messages on a thread of its own, no
+  faster than the MIDI link can carry them. Frames are posted to a single slot instead of a queue: a frame posted
+  while the link is still busy replaces the one waiting there, so the device always gets the most recent morph
+  position and its receive buffer never overflows, however fast the position changes. Only blocks that differ from
+  the last frame sent are transmitted, small moves that leave the wave unchanged cost a few ICB and VCF bytes.
+ */
+class MorphStreamer {
+    public:
+        /// Send function, gets one complete SysEx message
+        typedef std::function<void(std::vector<unsigned char>& message)> Sender;
+
+        /**
+          Create morph streamer.
+
+          Starts the sending thread.
+
+          @param[in]    sender      Send function, called from the sending thread
+          @param[in]    device      Device type the messages are created for
+          @param[in]    icbNum      ICB block number to write to
+          @param[in]    vcfNum      VCF block number to write to
+          @param[in]    waveNum     WAVE block number to write to
+          @param[in]    waveSize    Raw WAVE size, see InstrumentMorph::getWaveSize()
+          @param[in]    linkRate    Link rate in bytes per second
+         */
+        MorphStreamer(const Sender& sender, uint8_t device, uint8_t icbNum, uint8_t vcfNum, uint8_t waveNum,
+                      size_t waveSize, size_t linkRate);
+
+        /**
+          Destroy morph streamer.
+
+          Stops the sending thread, a frame still waiting is dropped.
+         */
+        ~MorphStreamer();
+
+        /**
+          Post frame.
+
+          Hands a frame to the sending thread without blocking. If the previous frame hasn't been taken yet, it is
+          replaced and counted as dropped.
+
+          @param[in]    frame       Raw blocks to send
+
+          @return                   False if a waiting frame was dropped
+
+          @exception    Exception   Send function failed for an earlier frame
+         */
+        bool post(const InstrumentMorph::Frame& frame);
+
+        /**
+          Flush.
+
+          Blocks until the last posted frame has been sent and the link is idle again.
+
+          @exception    Exception   Send function failed
+         */
+        void flush();
+
+        /**
+          Get number of frames sent.
+
+          @return                   Number of frames sent
+         */
+        size_t getNumSent() const;
+
+        /**
+          Get number of frames dropped.
+
+          @return                   Number of frames replaced by newer ones before being sent
+         */
+        size_t getNumDropped() const;
+
+        /**
+          Get number of bytes sent.
+
+          @return                   Number of SysEx bytes sent
+         */
+        size_t getNumBytes() const;
+
+    private:
+        typedef std::chrono::steady_clock Clock;    ///< Clock pacing the link
+
+        Sender                  m_sender;       ///< Send function
+        uint8_t                 m_device;       ///< Device type
+        uint8_t                 m_icbNum;       ///< ICB block number
+        uint8_t                 m_vcfNum;       ///< VCF block number
+        uint8_t                 m_waveNum;      ///< WAVE block number
+        size_t                  m_waveSize;     ///< Raw WAVE size
+        size_t                  m_linkRate;     ///< Link rate in bytes per second
+        InstrumentMorph::Frame  m_pending;      ///< Frame waiting to be sent
+        InstrumentMorph::Frame  m_sent;         ///< Last frame sent, only used by the sending thread
+        bool                    m_hasPending;   ///< A frame is waiting
+        bool                    m_hasSent;      ///< A frame has been sent before
+        bool                    m_busy;         ///< The sending thread is sending a frame
+        bool                    m_stop;         ///< The sending thread shall terminate
+        size_t                  m_numSent;      ///< Number of frames sent
+        size_t                  m_numDropped;   ///< Number of frames dropped
+        size_t                  m_numBytes;     ///< Number of bytes sent
+        Clock::time_point       m_linkFree;     ///< Time the link has transmitted all bytes sent
+        std::exception_ptr      m_error;        ///< Exception thrown by the send function
+        mutable std::mutex      m_mutex;        ///< Protects all members shared with the sending thread
+        std::condition_variable m_wake;         ///< Signals a posted frame or stop to the sending thread
+        std::condition_variable m_idle;         ///< Signals a sent frame
+        std::thread             m_thread;       ///< Sending thread
+
+        /**
+          Run sending thread.
+
+          Waits for frames, paces them to the link rate and sends the changed blocks.
+         */
+        void run();
+
+        /**
+          Send frame.
+
+          Encodes the blocks that changed since the last frame and sends them.
+
+          @param[in]    frame       Raw blocks to send
+
+          @return                   Number of bytes sent
+         */
+        size_t send(const InstrumentMorph::Frame& frame);
+
+        MorphStreamer(const MorphStreamer&);                ///< Inhibit copying objects
+        MorphStreamer& operator=(const MorphStreamer&);     ///< Inhibit copying objects
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
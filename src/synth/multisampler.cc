@@ -0,0 +1,110 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+#include <synth/multisampler.hh>
+#include <synth/instrument.hh>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Number of ICB dynamics levels
+static const unsigned NumLevels = 4;
+
+// Velocities per dynamics level
+static const unsigned LevelSize = 32;
+
+// Create multi-sampler
+MultiSampler::MultiSampler(unsigned sampleRate, size_t length, size_t tail)
+    : m_engine(Patch::MaxLayers, float(sampleRate))
+    , m_length(length)
+    , m_left(length + tail)
+    , m_right(length + tail)
+{
+}
+
+// Split keyboard and velocities into regions
+std::vector<MultiSampler::Region> MultiSampler::getRegions(const Patch& patch, const std::vector<uint8_t>& roots)
+{
+    // Mask of playing layers per dynamics level
+    unsigned masks[NumLevels];
+    for (unsigned level = 0; level < NumLevels; ++level) {
+        masks[level] = 0;
+        for (size_t i = 0; i < patch.getNumLayers(); ++i) {
+            if (Patch::isPlaying(patch.getLayer(i), uint8_t(level * LevelSize + 1))) {
+                masks[level] |= 1 << i;
+            }
+        }
+    }
+
+    std::vector<Region> regions;
+    for (size_t i = 0; i < roots.size(); ++i) {
+        uint8_t lowKey = i == 0 ? 0 : uint8_t((roots[i - 1] + roots[i]) / 2 + 1);
+        uint8_t highKey = i + 1 == roots.size() ? 127 : uint8_t((roots[i] + roots[i + 1]) / 2);
+        unsigned level = 0;
+        while (level < NumLevels) {
+            unsigned last = level;
+            while (last + 1 < NumLevels && masks[last + 1] == masks[level]) {
+                ++last;
+            }
+            if (masks[level] != 0) {
+                Region region = {
+                    lowKey, highKey, roots[i], uint8_t(level == 0 ? 1 : level * LevelSize),
+                    uint8_t((last + 1) * LevelSize - 1)
+                };
+                regions.push_back(region);
+            }
+            level = last + 1;
+        }
+    }
+    return regions;
+}
+
+// Render all regions of an instrument
+size_t MultiSampler::render(const std::shared_ptr<const Instrument>& instrument, const std::vector<uint8_t>& roots,
+                            const Sink& sink)
+{
+    size_t total = 0;
+    for (auto& region : getRegions(instrument->getPatch(), roots)) {
+        size_t frames = m_engine.renderNote(instrument, region.m_rootKey, region.m_highVelocity, m_length,
+                                            m_left.data(), m_right.data(), m_left.size());
+        sink(region, m_left.data(), m_right.data(), frames);
+        total += frames;
+    }
+    return total;
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
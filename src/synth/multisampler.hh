@@ -0,0 +1,120 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <common.hh>
+#include <synth/engine.hh>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Multi-sampler.
+
+  Renders an instrument as a set of regions for sample based players. The keyboard is split between the given root
+  notes, each root covering the keys up to half way to its neighbours. Velocities are split at the dynamics levels
+  where the set of layers gated by the ICB dynamics and low/high select changes, so every distinct layer mix is
+  sampled once per root. Regions are rendered at their highest velocity, players scale softer notes down. Each region
+  is handed to a sink as soon as it is rendered, so memory use does not depend on the number of regions.
+ */
+class MultiSampler {
+    public:
+        /// Rendered region
+        struct Region {
+            uint8_t     m_lowKey;       ///< Lowest MIDI note
+            uint8_t     m_highKey;      ///< Highest MIDI note
+            uint8_t     m_rootKey;      ///< Rendered note
+            uint8_t     m_lowVelocity;  ///< Lowest velocity
+            uint8_t     m_highVelocity; ///< Highest and rendered velocity
+        };
+
+        /// Receiver of rendered regions
+        typedef std::function<void(const Region& region, const float* left, const float* right, size_t frames)> Sink;
+
+        /**
+          Create multi-sampler.
+
+          @param[in]    sampleRate  Sample rate in Hz
+          @param[in]    length      Note length in frames
+          @param[in]    tail        Maximum release tail in frames
+         */
+        MultiSampler(unsigned sampleRate, size_t length, size_t tail);
+
+        /**
+          Get regions.
+
+          Returns the regions of a patch, ordered by root note and velocity. Velocity ranges in which no layer plays
+          are left out.
+
+          @param[in]    patch       Patch
+          @param[in]    roots       Root notes in ascending order
+
+          @return                   Regions
+         */
+        static std::vector<Region> getRegions(const Patch& patch, const std::vector<uint8_t>& roots);
+
+        /**
+          Render instrument.
+
+          Renders all regions of an instrument and passes them to the sink.
+
+          @param[in]    instrument  Instrument
+          @param[in]    roots       Root notes in ascending order
+          @param[in]    sink        Receiver of rendered regions
+
+          @return                   Number of rendered frames
+         */
+        size_t render(const std::shared_ptr<const Instrument>& instrument, const std::vector<uint8_t>& roots,
+                      const Sink& sink);
+
+    private:
+        Engine              m_engine;   ///< Render engine
+        size_t              m_length;   ///< Note length in frames
+        std::vector<float>  m_left;     ///< Left samples
+        std::vector<float>  m_right;    ///< Right samples
+
+        MultiSampler(const MultiSampler&);              ///< Inhibit copying objects
+        MultiSampler& operator=(const MultiSampler&);   ///< Inhibit copying objects
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
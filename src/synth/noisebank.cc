@@ -0,0 +1,196 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/noisebank.hh>
+#include <synth/simd.hh>
+#include <cmath>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Pi
+static const float Pi = 3.14159265358979f;
+
+// Wind noise low pass cutoff in Hz
+static const float WindCutoff = 500.0f;
+
+// Patch noise high pass cutoff in Hz
+static const float PatchCutoff = 2000.0f;
+
+// Flute noise band edges relative to the note frequency
+static const float FluteLow = 1.0f;
+static const float FluteHigh = 4.0f;
+
+// Gains bringing the shaped noise types to roughly the level of white noise
+static const float WindGain = 7.5f;
+static const float PatchGain = 1.2f;
+static const float FluteGain = 3.3f;
+
+// Create noise generator bank
+NoiseBank::NoiseBank(size_t numVoices, float sampleRate)
+    : m_sampleRate(sampleRate)
+    , m_state((numVoices + 3) & ~size_t(3), 1)
+    , m_coeff1(m_state.size(), 0.0f)
+    , m_coeff2(m_state.size(), 0.0f)
+    , m_white(m_state.size(), 0.0f)
+    , m_first(m_state.size(), 0.0f)
+    , m_second(m_state.size(), 0.0f)
+    , m_lp1(m_state.size(), 0.0f)
+    , m_lp2(m_state.size(), 0.0f)
+    , m_gain(m_state.size(), 0.0f)
+    , m_active(m_state.size(), 0)
+    , m_groupVoices(m_state.size() / 4, 0)
+{
+}
+
+// Start voice
+void NoiseBank::start(size_t voice, Wersi::Vcf::NoiseType type, float frequency, uint32_t seed, float gain)
+{
+    if (m_active[voice] == 0) {
+        ++m_groupVoices[voice / 4];
+    }
+    m_active[voice] = 1;
+
+    // Scramble the seed, so neighbouring seeds give unrelated sequences, xorshift must not start at zero
+    uint32_t state = seed * 0x9e3779b9u;
+    state ^= state >> 16;
+    state *= 0x85ebca6bu;
+    state ^= state >> 13;
+    m_state[voice] = state != 0 ? state : 0x6d2b79f5u;
+    m_lp1[voice] = 0.0f;
+    m_lp2[voice] = 0.0f;
+
+    switch (type) {
+        case Wersi::Vcf::NoiseType::Wind:
+            m_coeff1[voice] = getCoeff(WindCutoff);
+            m_coeff2[voice] = getCoeff(WindCutoff);
+            m_white[voice] = 0.0f;
+            m_first[voice] = 0.0f;
+            m_second[voice] = WindGain;
+            break;
+        case Wersi::Vcf::NoiseType::Patch:
+            m_coeff1[voice] = getCoeff(PatchCutoff);
+            m_coeff2[voice] = 0.0f;
+            m_white[voice] = PatchGain;
+            m_first[voice] = -PatchGain;
+            m_second[voice] = 0.0f;
+            break;
+        case Wersi::Vcf::NoiseType::Flute:
+            m_coeff1[voice] = getCoeff(frequency * FluteHigh);
+            m_coeff2[voice] = getCoeff(frequency * FluteLow);
+            m_white[voice] = 0.0f;
+            m_first[voice] = FluteGain;
+            m_second[voice] = -FluteGain;
+            break;
+        default:
+            m_coeff1[voice] = 0.0f;
+            m_coeff2[voice] = 0.0f;
+            m_white[voice] = 1.0f;
+            m_first[voice] = 0.0f;
+            m_second[voice] = 0.0f;
+            break;
+    }
+    setGain(voice, gain);
+}
+
+// Change gain
+void NoiseBank::setGain(size_t voice, float gain)
+{
+    m_gain[voice] = gain;
+}
+
+// Stop voice
+void NoiseBank::stop(size_t voice)
+{
+    if (m_active[voice] != 0) {
+        --m_groupVoices[voice / 4];
+        m_active[voice] = 0;
+        m_gain[voice] = 0.0f;
+    }
+}
+
+// Mix noise of all active groups
+void NoiseBank::mix(float* data, size_t frames)
+{
+    for (size_t group = 0; group < m_groupVoices.size(); ++group) {
+        if (m_groupVoices[group] != 0) {
+            mixGroup(group, data + group * frames * 4, frames);
+        }
+    }
+}
+
+// Get one-pole coefficient for cutoff
+float NoiseBank::getCoeff(float cutoff) const
+{
+    float limit = 0.45f * m_sampleRate;
+    return 1.0f - std::exp(-2.0f * Pi * (cutoff < limit ? cutoff : limit) / m_sampleRate);
+}
+
+// Mix noise of the four voices of a group
+void NoiseBank::mixGroup(size_t group, float* data, size_t frames)
+{
+    const size_t base = group * 4;
+    UInt4 state = UInt4::load(&(m_state[base]));
+    Float4 coeff1 = Float4::load(&(m_coeff1[base]));
+    Float4 coeff2 = Float4::load(&(m_coeff2[base]));
+    Float4 gain = Float4::load(&(m_gain[base]));
+    Float4 white = Float4::load(&(m_white[base])) * gain;
+    Float4 first = Float4::load(&(m_first[base])) * gain;
+    Float4 second = Float4::load(&(m_second[base])) * gain;
+    Float4 lp1 = Float4::load(&(m_lp1[base]));
+    Float4 lp2 = Float4::load(&(m_lp2[base]));
+
+    for (size_t frame = 0; frame < frames; ++frame) {
+        // xorshift32
+        state = state ^ state.shiftLeft<13>();
+        state = state ^ state.shiftRight<17>();
+        state = state ^ state.shiftLeft<5>();
+        Float4 noise = state.toUnitFloat();
+
+        lp1 += (noise - lp1) * coeff1;
+        lp2 += (lp1 - lp2) * coeff2;
+        float* ptr = data + frame * 4;
+        (Float4::load(ptr) + noise * white + lp1 * first + lp2 * second).store(ptr);
+    }
+
+    state.store(&(m_state[base]));
+    lp1.store(&(m_lp1[base]));
+    lp2.store(&(m_lp2[base]));
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,178 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <wersi/vcf.hh>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Noise generator bank.
+
+  Generates the VCF noise of a fixed number of voices four at a time, one voice per SIMD lane, using the same
+  group-interleaved layout as OscillatorBank. Each lane runs its own xorshift generator, so the output only depends
+  on the seeds and renders are reproducible. The white noise is shaped per noise type by two one-pole filters whose
+  outputs are blended with per-lane weights, so all types share one branch-free loop:
+
+  - Wind: both filters in series, a dark low pass
+  - Patch: input minus first filter, a bright high pass
+  - Flute: first minus second filter, a band around the note frequency
+ */
+class NoiseBank {
+    public:
+        /**
+          Create noise generator bank.
+
+          Creates a noise generator bank with all voices stopped.
+
+          @param[in]    numVoices   Number of voices, rounded up to a multiple of four
+          @param[in]    sampleRate  Sample rate in Hz
+         */
+        NoiseBank(size_t numVoices, float sampleRate);
+
+        /**
+          Get number of voices.
+
+          Returns the number of voices, which is always a multiple of four.
+
+          @return                   Number of voices
+         */
+        size_t getNumVoices() const {
+            return m_state.size();
+        }
+
+        /**
+          Start voice.
+
+          Starts the noise of a voice. Invalid noise types produce unshaped white noise.
+
+          @param[in]    voice       Voice index
+          @param[in]    type        Noise type
+          @param[in]    frequency   Note frequency in Hz, centers the flute noise band
+          @param[in]    seed        Random seed
+          @param[in]    gain        Output gain
+         */
+        void start(size_t voice, Wersi::Vcf::NoiseType type, float frequency, uint32_t seed, float gain = 1.0f);
+
+        /**
+          Change gain.
+
+          Sets the output gain of a voice.
+
+          @param[in]    voice       Voice index
+          @param[in]    gain        Output gain
+         */
+        void setGain(size_t voice, float gain);
+
+        /**
+          Stop voice.
+
+          Stops the noise of a voice.
+
+          @param[in]    voice       Voice index
+         */
+        void stop(size_t voice);
+
+        /**
+          Check for active voice.
+
+          Returns true if the voice generates noise.
+
+          @param[in]    voice       Voice index
+
+          @return                   True if active
+         */
+        bool isActive(size_t voice) const {
+            return m_active[voice] != 0;
+        }
+
+        /**
+          Mix noise.
+
+          Adds the noise of all active groups to the given buffer, which has the layout written by
+          OscillatorBank::render(). Groups without active voices are left untouched.
+
+          @param[in,out] data       Sample buffer
+          @param[in]    frames      Number of frames to process
+         */
+        void mix(float* data, size_t frames);
+
+    private:
+        float                   m_sampleRate;   ///< Sample rate in Hz
+        std::vector<uint32_t>   m_state;        ///< Generator state per voice
+        std::vector<float>      m_coeff1;       ///< First filter coefficient per voice
+        std::vector<float>      m_coeff2;       ///< Second filter coefficient per voice
+        std::vector<float>      m_white;        ///< Weight of white noise per voice
+        std::vector<float>      m_first;        ///< Weight of first filter output per voice
+        std::vector<float>      m_second;       ///< Weight of second filter output per voice
+        std::vector<float>      m_lp1;          ///< First filter state per voice
+        std::vector<float>      m_lp2;          ///< Second filter state per voice
+        std::vector<float>      m_gain;         ///< Output gain per voice
+        std::vector<uint8_t>    m_active;       ///< Voice active flags
+        std::vector<uint8_t>    m_groupVoices;  ///< Number of active voices per group
+
+        /**
+          Get one-pole coefficient.
+
+          Returns the coefficient of a one-pole low pass with the given cutoff.
+
+          @param[in]    cutoff      Cutoff frequency in Hz
+
+          @return                   Filter coefficient
+         */
+        float getCoeff(float cutoff) const;
+
+        /**
+          Mix group.
+
+          Adds the noise of the four voices of one group.
+
+          @param[in]    group       Group index
+          @param[in,out] data       Sample buffer of the group
+          @param[in]    frames      Number of frames to process
+         */
+        void mixGroup(size_t group, float* data, size_t frames);
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,202 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/oscillatorbank.hh>
+#include <synth/simd.hh>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Table played by stopped voices in active groups
+static const float SilentTable[2] = { 0.0f, 0.0f };
+
+// Raw table played by stopped voices in active groups
+static const uint8_t SilentRawTable[2] = { 128, 128 };
+
+// Create oscillator bank
+template<typename Arith>
+BasicOscillatorBank<Arith>::BasicOscillatorBank(size_t numVoices, float sampleRate)
+    : m_sampleRate(sampleRate)
+    , m_phase((numVoices + 3) & ~size_t(3), 0)
+    , m_increment(m_phase.size(), 0)
+    , m_length(m_phase.size(), Arith::getLength(1))
+    , m_gain(m_phase.size(), 0.0f)
+    , m_targetGain(m_phase.size(), 0.0f)
+    , m_table(m_phase.size(), nullptr)
+    , m_groupVoices(m_phase.size() / 4, 0)
+{
+}
+
+// Start voice
+template<typename Arith>
+void BasicOscillatorBank<Arith>::start(size_t voice, const Sample* table, size_t length, float frequency, float gain)
+{
+    if (m_table[voice] == nullptr) {
+        ++m_groupVoices[voice / 4];
+    }
+    m_table[voice] = table;
+    m_length[voice] = Arith::getLength(length);
+    m_phase[voice] = 0;
+    m_gain[voice] = gain;
+    m_targetGain[voice] = gain;
+    setFrequency(voice, frequency);
+}
+
+// Change table
+template<typename Arith>
+void BasicOscillatorBank<Arith>::setTable(size_t voice, const Sample* table, size_t length)
+{
+    if (m_table[voice] == nullptr) {
+        return;
+    }
+    m_table[voice] = table;
+    m_length[voice] = Arith::getLength(length);
+}
+
+// Change frequency
+template<typename Arith>
+void BasicOscillatorBank<Arith>::setFrequency(size_t voice, float frequency)
+{
+    m_increment[voice] = Arith::getIncrement(frequency / m_sampleRate);
+}
+
+// Change gain
+template<typename Arith>
+void BasicOscillatorBank<Arith>::setGain(size_t voice, float gain)
+{
+    m_targetGain[voice] = gain;
+}
+
+// Stop voice
+template<typename Arith>
+void BasicOscillatorBank<Arith>::stop(size_t voice)
+{
+    if (m_table[voice] != nullptr) {
+        --m_groupVoices[voice / 4];
+        m_table[voice] = nullptr;
+        m_length[voice] = Arith::getLength(1);
+        m_gain[voice] = 0.0f;
+        m_targetGain[voice] = 0.0f;
+    }
+}
+
+// Render all active groups
+template<typename Arith>
+void BasicOscillatorBank<Arith>::render(float* out, size_t frames)
+{
+    for (size_t group = 0; group < m_groupVoices.size(); ++group) {
+        if (m_groupVoices[group] != 0) {
+            renderGroup(group, out + group * frames * 4, frames);
+        }
+    }
+}
+
+// Render the four voices of a group with interpolated float lookup
+template<>
+void BasicOscillatorBank<FloatArith>::renderGroup(size_t group, float* out, size_t frames)
+{
+    size_t base = group * 4;
+    const float* tables[4];
+    for (size_t lane = 0; lane < 4; ++lane) {
+        tables[lane] = m_table[base + lane] != nullptr ? m_table[base + lane] : SilentTable;
+    }
+
+    Float4 phase = Float4::load(&(m_phase[base]));
+    Float4 increment = Float4::load(&(m_increment[base]));
+    Float4 length = Float4::load(&(m_length[base]));
+    Float4 gain = Float4::load(&(m_gain[base]));
+    Float4 target = Float4::load(&(m_targetGain[base]));
+    Float4 step = (target - gain) * Float4(1.0f / float(frames));
+    int32_t index[4];
+    int32_t wrap[4];
+    for (size_t frame = 0; frame < frames; ++frame) {
+        // Interpolated lookup, the guard sample behind each table saves the index wrap
+        Float4 position = phase * length;
+        Float4 fraction = position - position.truncate(index);
+        Float4 a(tables[0][index[0]], tables[1][index[1]], tables[2][index[2]], tables[3][index[3]]);
+        Float4 b(tables[0][index[0] + 1], tables[1][index[1] + 1], tables[2][index[2] + 1], tables[3][index[3] + 1]);
+        gain += step;
+        ((a + (b - a) * fraction) * gain).store(out + frame * 4);
+
+        // Advance and wrap phase
+        phase += increment;
+        phase -= phase.truncate(wrap);
+    }
+    phase.store(&(m_phase[base]));
+    target.store(&(m_gain[base]));
+}
+
+// Render the four voices of a group with integer arithmetic
+template<>
+void BasicOscillatorBank<FixedArith>::renderGroup(size_t group, float* out, size_t frames)
+{
+    size_t base = group * 4;
+    const uint8_t* tables[4];
+    uint32_t phase[4];
+    int32_t gain[4];
+    int32_t step[4];
+    for (size_t lane = 0; lane < 4; ++lane) {
+        tables[lane] = m_table[base + lane] != nullptr ? m_table[base + lane] : SilentRawTable;
+        phase[lane] = m_phase[base + lane];
+        gain[lane] = FixedArith::getGain(m_gain[base + lane]);
+        step[lane] = (FixedArith::getGain(m_targetGain[base + lane]) - gain[lane]) / int32_t(frames);
+    }
+
+    // Products of signed 8 bit samples and gains are exact in float, so only the final scaling rounds
+    const float scale = 1.0f / float(128 << FixedArith::GainBits);
+    for (size_t frame = 0; frame < frames; ++frame) {
+        for (size_t lane = 0; lane < 4; ++lane) {
+            // Unsigned phase overflow wraps the period, the high bits select the sample
+            uint32_t index = uint32_t((uint64_t(phase[lane]) * m_length[base + lane]) >> 32);
+            int32_t sample = int32_t(tables[lane][index]) - 128;
+            gain[lane] += step[lane];
+            out[frame * 4 + lane] = float(sample * gain[lane]) * scale;
+            phase[lane] += m_increment[base + lane];
+        }
+    }
+    for (size_t lane = 0; lane < 4; ++lane) {
+        m_phase[base + lane] = phase[lane];
+        m_gain[base + lane] = m_targetGain[base + lane];
+    }
+}
+
+// Instantiate oscillator banks for all arithmetic policies
+template class BasicOscillatorBank<FloatArith>;
+template class BasicOscillatorBank<FixedArith>;
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,234 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <synth/arith.hh>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Wavetable oscillator bank.
+
+  Renders a fixed number of wavetable oscillators four at a time, with one voice per SIMD lane. Each voice plays a
+  single-period table. Output is written in groups of four voices: for each group, the four lane samples of each
+  frame are stored consecutively, so the following SIMD stages can process the voices of a group without shuffling.
+  Groups without active voices are skipped and left untouched in the output.
+
+  The arithmetic policy selects the render kernel at compile time. With FloatArith, tables are float tables usually
+  taken from a WaveTableSet or WaveMipmap and played with linear interpolation. With FixedArith, tables are the raw
+  bytes of a wave block as returned by WaveTableSet::getRawTable(), played like the DMS slaves do. Both are
+  instantiated in the library, as OscillatorBank and FixedOscillatorBank.
+
+  @tparam       Arith       Arithmetic policy, FloatArith or FixedArith
+ */
+template<typename Arith>
+class BasicOscillatorBank {
+    public:
+        /// Table sample type of the arithmetic policy
+        typedef typename Arith::Sample Sample;
+
+        /**
+          Create oscillator bank.
+
+          Creates an oscillator bank with all voices stopped.
+
+          @param[in]    numVoices   Number of voices, rounded up to a multiple of four
+          @param[in]    sampleRate  Sample rate in Hz
+         */
+        BasicOscillatorBank(size_t numVoices, float sampleRate);
+
+        /**
+          Get number of voices.
+
+          Returns the number of voices, which is always a multiple of four.
+
+          @return                   Number of voices
+         */
+        size_t getNumVoices() const {
+            return m_phase.size();
+        }
+
+        /**
+          Get number of groups.
+
+          Returns the number of four-voice groups.
+
+          @return                   Number of groups
+         */
+        size_t getNumGroups() const {
+            return m_phase.size() / 4;
+        }
+
+        /**
+          Get sample rate.
+
+          Returns the sample rate of the bank.
+
+          @return                   Sample rate in Hz
+         */
+        float getSampleRate() const {
+            return m_sampleRate;
+        }
+
+        /**
+          Start voice.
+
+          Starts a voice playing the given table from its beginning. The table must hold length + 1 samples, the last
+          one repeating the first, and must stay valid while the voice is playing.
+
+          @param[in]    voice       Voice index
+          @param[in]    table       Table samples
+          @param[in]    length      Number of samples of one period
+          @param[in]    frequency   Frequency in Hz
+          @param[in]    gain        Output gain
+         */
+        void start(size_t voice, const Sample* table, size_t length, float frequency, float gain = 1.0f);
+
+        /**
+          Change table.
+
+          Switches a playing voice to another table, keeping its phase.
+
+          @param[in]    voice       Voice index
+          @param[in]    table       Table samples
+          @param[in]    length      Number of samples of one period
+         */
+        void setTable(size_t voice, const Sample* table, size_t length);
+
+        /**
+          Change frequency.
+
+          Sets the frequency of a voice.
+
+          @param[in]    voice       Voice index
+          @param[in]    frequency   Frequency in Hz
+         */
+        void setFrequency(size_t voice, float frequency);
+
+        /**
+          Change gain.
+
+          Sets the output gain of a voice. The gain ramps linearly to the new value over the next rendered block,
+          so envelopes can be applied at block rate without zipper noise.
+
+          @param[in]    voice       Voice index
+          @param[in]    gain        Output gain
+         */
+        void setGain(size_t voice, float gain);
+
+        /**
+          Stop voice.
+
+          Stops a voice, it outputs silence until it is started again.
+
+          @param[in]    voice       Voice index
+         */
+        void stop(size_t voice);
+
+        /**
+          Check for active voice.
+
+          Returns true if the voice is playing.
+
+          @param[in]    voice       Voice index
+
+          @return                   True if playing
+         */
+        bool isActive(size_t voice) const {
+            return m_table[voice] != nullptr;
+        }
+
+        /**
+          Check for active group.
+
+          Returns true if any voice of the given group is playing.
+
+          @param[in]    group       Group index
+
+          @return                   True if any voice is playing
+         */
+        bool isGroupActive(size_t group) const {
+            return m_groupVoices[group] != 0;
+        }
+
+        /**
+          Render voices.
+
+          Renders the given number of frames for all active groups. The output buffer holds getNumGroups() blocks of
+          frames * 4 samples, frame-interleaved per group.
+
+          @param[out]   out         Output buffer
+          @param[in]    frames      Number of frames to render
+         */
+        void render(float* out, size_t frames);
+
+    private:
+        float                               m_sampleRate;   ///< Sample rate in Hz
+        std::vector<typename Arith::Phase>  m_phase;        ///< Phase per voice
+        std::vector<typename Arith::Phase>  m_increment;    ///< Phase increment per sample per voice
+        std::vector<typename Arith::Length> m_length;       ///< Table length per voice
+        std::vector<float>                  m_gain;         ///< Output gain per voice at block start
+        std::vector<float>                  m_targetGain;   ///< Output gain per voice at block end
+        std::vector<const Sample*>          m_table;        ///< Table per voice, null if stopped
+        std::vector<uint8_t>                m_groupVoices;  ///< Number of active voices per group
+
+        /**
+          Render group.
+
+          Renders the four voices of one group.
+
+          @param[in]    group       Group index
+          @param[out]   out         Output buffer of the group
+          @param[in]    frames      Number of frames to render
+         */
+        void renderGroup(size_t group, float* out, size_t frames);
+};
+
+/// Oscillator bank for the render engine
+typedef BasicOscillatorBank<FloatArith> OscillatorBank;
+
+/// Oscillator bank for reference renders
+typedef BasicOscillatorBank<FixedArith> FixedOscillatorBank;
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,118 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/patch.hh>
+#include <wersi/instrumentstore.hh>
+#include <bitset>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Maximum number of layers
+const size_t Patch::MaxLayers;
+
+// Create empty patch
+Patch::Patch()
+    : m_layers()
+    , m_numLayers(0)
+    , m_cut(false)
+{
+}
+
+// Compile patch from ICB chain
+Patch::Patch(Wersi::InstrumentStore& store, uint8_t icb)
+    : m_layers()
+    , m_numLayers(0)
+    , m_cut(false)
+{
+    std::bitset<256> visited;
+    uint8_t block = icb;
+    while (true) {
+        Wersi::Icb* current = store.getIcb(block);
+        if (current == nullptr) {
+            break;
+        }
+        if (visited.test(block) || m_numLayers == MaxLayers) {
+            m_cut = true;
+            break;
+        }
+        visited.set(block);
+
+        Layer& layer = m_layers[m_numLayers++];
+        layer.m_icb         = block;
+        layer.m_vcf         = current->getVcfBlock();
+        layer.m_ampl        = current->getAmplBlock();
+        layer.m_freq        = current->getFreqBlock();
+        layer.m_wave        = current->getWaveBlock();
+        layer.m_dynamics    = current->getDynamics();
+        layer.m_lowSelect   = current->getLowSelect();
+        layer.m_highSelect  = current->getHighSelect();
+        layer.m_transpose   = current->getTranspose();
+        layer.m_detune      = current->getDetune();
+        layer.m_route       = BusMixer::getRoute(*current, store.getVcf(layer.m_vcf));
+        layer.m_wvMode      = current->getWvMode();
+        layer.m_wvLeft      = current->getWvLeft();
+        layer.m_wvRight     = current->getWvRight();
+        layer.m_wvFbFlat    = current->getWvFbFlat();
+        layer.m_wvFbDeep    = current->getWvFbDeep();
+
+        // Block 0 terminates the chain
+        block = current->getNextIcb();
+        if (block == 0) {
+            break;
+        }
+    }
+}
+
+// Check dynamics gate of layer
+bool Patch::isPlaying(const Layer& layer, uint8_t velocity)
+{
+    uint8_t level = uint8_t((velocity & 0x7f) >> 5);
+    if (layer.m_lowSelect && layer.m_highSelect) {
+        return level == layer.m_dynamics;
+    }
+    else if (layer.m_lowSelect) {
+        return level <= layer.m_dynamics;
+    }
+    else if (layer.m_highSelect) {
+        return level >= layer.m_dynamics;
+    }
+    return true;
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,161 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <synth/busmixer.hh>
+#include <wersi/icb.hh>
+
+namespace DMSToolbox {
+
+// Forward declarations
+namespace Wersi {
+class InstrumentStore;
+} // namespace Wersi
+
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Compiled instrument patch.
+
+  A patch holds the layers of an instrument, found by following the next ICB chain from its first ICB. Each layer
+  keeps the block numbers and playing parameters of one ICB, so the note path needs no store access. Chains ending in
+  a cycle are cut before the first repeated ICB, longer chains than MaxLayers are truncated. Patches are plain data
+  and can be copied freely.
+ */
+class Patch {
+    public:
+        /// Maximum number of layers
+        static const size_t MaxLayers = 8;
+
+        /// Layer of a patch, one ICB of the chain
+        struct Layer {
+            uint8_t         m_icb;          ///< ICB block number
+            uint8_t         m_vcf;          ///< VCF block number
+            uint8_t         m_ampl;         ///< AMPL envelope block number
+            uint8_t         m_freq;         ///< FREQ envelope block number
+            uint8_t         m_wave;         ///< Wave block number
+            uint8_t         m_dynamics;     ///< Dynamics threshold 0..3
+            bool            m_lowSelect;    ///< Layer plays at dynamics up to the threshold
+            bool            m_highSelect;   ///< Layer plays at dynamics from the threshold on
+            int8_t          m_transpose;    ///< Transpose in semitones
+            int8_t          m_detune;       ///< Detune in cents
+            BusMixer::Route m_route;        ///< Output route
+            Wersi::Icb::WvMode m_wvMode;    ///< WersiVoice effect mode
+            bool            m_wvLeft;       ///< WersiVoice left output enabled
+            bool            m_wvRight;      ///< WersiVoice right output enabled
+            bool            m_wvFbFlat;     ///< WersiVoice flat feedback enabled
+            bool            m_wvFbDeep;     ///< WersiVoice deep feedback enabled
+        };
+
+        /**
+          Create empty patch.
+
+          Creates a patch without layers.
+         */
+        Patch();
+
+        /**
+          Compile patch.
+
+          Follows the ICB chain from the given ICB and compiles all layers.
+
+          @param[in]    store       Instrument store
+          @param[in]    icb         First ICB block number
+         */
+        Patch(Wersi::InstrumentStore& store, uint8_t icb);
+
+        /**
+          Get number of layers.
+
+          Returns the number of layers.
+
+          @return                   Number of layers
+         */
+        size_t getNumLayers() const {
+            return m_numLayers;
+        }
+
+        /**
+          Get layer.
+
+          Returns a layer of the patch.
+
+          @param[in]    index       Layer index
+
+          @return                   Layer
+         */
+        const Layer& getLayer(size_t index) const {
+            return m_layers[index];
+        }
+
+        /**
+          Check for cut chain.
+
+          Returns true if the ICB chain contained a cycle or was too long and has been cut.
+
+          @return                   True if the chain has been cut
+         */
+        bool isCut() const {
+            return m_cut;
+        }
+
+        /**
+          Check for playing layer.
+
+          Returns true if the dynamics gate of a layer opens for the given velocity. Velocities are mapped to the
+          four dynamics levels of the ICB, a layer with low select plays up to its threshold, with high select from
+          its threshold on, with both exactly at it and with none always.
+
+          @param[in]    layer       Layer
+          @param[in]    velocity    Note velocity 1..127
+
+          @return                   True if the layer plays
+         */
+        static bool isPlaying(const Layer& layer, uint8_t velocity);
+
+    private:
+        Layer       m_layers[MaxLayers];    ///< Layers
+        size_t      m_numLayers;            ///< Number of layers
+        bool        m_cut;                  ///< Chain has been cut
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
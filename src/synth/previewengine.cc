@@ -0,0 +1,292 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/previewengine.hh>
+#include <synth/audiosink.hh>
+#include <exceptions.hh>
+#include <algorithm>
+#include <chrono>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Number of MIDI channels
+const size_t PreviewEngine::NumChannels;
+
+// Frames per render block
+static const size_t BlockSize = Engine::DefaultBlockSize;
+
+// Create preview engine
+PreviewEngine::PreviewEngine(size_t numVoices, float sampleRate, size_t bufferFrames, size_t queueSize,
+                             float engineRate, Resampler::Quality quality)
+    : m_sampleRate(sampleRate)
+    , m_engineRate(engineRate > 0.0f ? engineRate : sampleRate)
+    , m_engine(numVoices, m_engineRate, BlockSize)
+    , m_resampler(m_engineRate != sampleRate ? new Resampler(m_engineRate, sampleRate, quality) : nullptr)
+    , m_maxOutput(m_resampler != nullptr ? m_resampler->getMaxOutput(BlockSize) : BlockSize)
+    , m_ring(std::max(bufferFrames, 2 * m_maxOutput))
+    , m_commands(queueSize)
+    , m_retired(queueSize + NumChannels)
+    , m_graveyard()
+    , m_instruments()
+    , m_left(BlockSize, 0.0f)
+    , m_right(BlockSize, 0.0f)
+    , m_outLeft(m_maxOutput, 0.0f)
+    , m_outRight(m_maxOutput, 0.0f)
+    , m_sinkLeft()
+    , m_sinkRight()
+    , m_sink(nullptr)
+    , m_period(0)
+    , m_renderThread()
+    , m_clockThread()
+    , m_running(false)
+    , m_frames(0)
+    , m_xruns(0)
+    , m_deadlineMisses(0)
+    , m_maxLoad(0.0f)
+{
+}
+
+// Destroy preview engine
+PreviewEngine::~PreviewEngine()
+{
+    stop();
+}
+
+// Start threads
+void PreviewEngine::start(AudioSink* sink, size_t period)
+{
+    if (isRunning()) {
+        return;
+    }
+    m_frames = 0;
+    m_xruns = 0;
+    m_deadlineMisses = 0;
+    m_maxLoad = 0.0f;
+    m_running.store(true, std::memory_order_release);
+    m_renderThread = std::thread(&PreviewEngine::render, this);
+
+    // Start the clock with a full buffer, so the first periods don't underrun
+    while (m_ring.getWritable() >= m_maxOutput) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (sink != nullptr) {
+        m_sink = sink;
+        m_period = period;
+        m_sinkLeft.assign(period, 0.0f);
+        m_sinkRight.assign(period, 0.0f);
+        m_clockThread = std::thread(&PreviewEngine::clock, this);
+    }
+}
+
+// Stop threads
+void PreviewEngine::stop()
+{
+    if (!isRunning()) {
+        return;
+    }
+    m_running.store(false, std::memory_order_release);
+    if (m_clockThread.joinable()) {
+        m_clockThread.join();
+    }
+    m_renderThread.join();
+    m_sink = nullptr;
+}
+
+// Queue instrument change
+bool PreviewEngine::setInstrument(uint8_t channel, const std::shared_ptr<const Instrument>& instrument)
+{
+    return send(Type::SetInstrument, channel & 0x0f, 0, 0, instrument);
+}
+
+// Queue note on
+bool PreviewEngine::noteOn(uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    return send(Type::NoteOn, channel & 0x0f, note, velocity, nullptr);
+}
+
+// Queue note off
+bool PreviewEngine::noteOff(uint8_t channel, uint8_t note)
+{
+    return send(Type::NoteOff, channel & 0x0f, note, 0, nullptr);
+}
+
+// Queue all notes off
+bool PreviewEngine::allNotesOff()
+{
+    return send(Type::AllNotesOff, 0, 0, 0, nullptr);
+}
+
+// Free instruments no longer in use
+void PreviewEngine::collect()
+{
+    InstrumentPtr instrument;
+    while (m_retired.pop(instrument)) {
+        m_graveyard.push_back(instrument);
+    }
+    instrument.reset();
+
+    // The render thread can't get new references to retired instruments, so a single owner stays single
+    m_graveyard.erase(std::remove_if(m_graveyard.begin(), m_graveyard.end(), [](const InstrumentPtr& i) {
+        return i.use_count() == 1;
+    }), m_graveyard.end());
+}
+
+// Take samples from ring buffer
+size_t PreviewEngine::pull(float* left, float* right, size_t frames)
+{
+    size_t count = m_ring.read(left, right, frames);
+    if (count < frames) {
+        std::fill(left + count, left + frames, 0.0f);
+        std::fill(right + count, right + frames, 0.0f);
+        m_xruns.fetch_add(1, std::memory_order_relaxed);
+    }
+    return count;
+}
+
+// Get statistics
+PreviewEngine::Statistics PreviewEngine::getStatistics() const
+{
+    Statistics statistics = {
+        m_frames.load(std::memory_order_relaxed),
+        m_xruns.load(std::memory_order_relaxed),
+        m_deadlineMisses.load(std::memory_order_relaxed),
+        m_maxLoad.load(std::memory_order_relaxed)
+    };
+    return statistics;
+}
+
+// Queue command
+bool PreviewEngine::send(Type type, uint8_t channel, uint8_t note, uint8_t velocity, const InstrumentPtr& instrument)
+{
+    Command command;
+    command.m_type = type;
+    command.m_channel = channel;
+    command.m_note = note;
+    command.m_velocity = velocity;
+    command.m_instrument = instrument;
+    return m_commands.push(command);
+}
+
+// Execute queued commands
+void PreviewEngine::execute()
+{
+    Command command;
+    while (const Command* next = m_commands.front()) {
+        // An instrument change has to retire the old instrument, wait for collect() if that's not possible
+        if (next->m_type == Type::SetInstrument && m_retired.isFull()) {
+            break;
+        }
+        m_commands.pop(command);
+        switch (command.m_type) {
+            case Type::NoteOn:
+                m_engine.noteOn(command.m_channel, command.m_note, command.m_velocity,
+                                m_instruments[command.m_channel]);
+                break;
+            case Type::NoteOff:
+                m_engine.noteOff(command.m_channel, command.m_note);
+                break;
+            case Type::AllNotesOff:
+                m_engine.allNotesOff();
+                break;
+            case Type::SetInstrument:
+                if (m_instruments[command.m_channel] != nullptr) {
+                    m_retired.push(m_instruments[command.m_channel]);
+                }
+                m_instruments[command.m_channel] = std::move(command.m_instrument);
+                break;
+        }
+    }
+}
+
+// Render thread main loop
+void PreviewEngine::render()
+{
+    typedef std::chrono::steady_clock Clock;
+    const double blockTime = double(BlockSize) / m_engineRate;
+    const std::chrono::microseconds idle(std::max(1L, long(blockTime * 0.5e6)));
+    while (m_running.load(std::memory_order_acquire)) {
+        while (m_ring.getWritable() >= m_maxOutput) {
+            execute();
+            Clock::time_point start = Clock::now();
+            m_engine.render(m_left.data(), m_right.data(), BlockSize);
+            size_t frames = BlockSize;
+            if (m_resampler != nullptr) {
+                frames = m_resampler->process(m_left.data(), m_right.data(), BlockSize,
+                                              m_outLeft.data(), m_outRight.data());
+            }
+            float load = float(std::chrono::duration<double>(Clock::now() - start).count() / blockTime);
+            if (load > 1.0f) {
+                m_deadlineMisses.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (load > m_maxLoad.load(std::memory_order_relaxed)) {
+                m_maxLoad.store(load, std::memory_order_relaxed);
+            }
+            if (m_resampler != nullptr) {
+                m_ring.write(m_outLeft.data(), m_outRight.data(), frames);
+            }
+            else {
+                m_ring.write(m_left.data(), m_right.data(), frames);
+            }
+            m_frames.fetch_add(frames, std::memory_order_relaxed);
+        }
+        std::this_thread::sleep_for(idle);
+    }
+}
+
+// Clock thread main loop
+void PreviewEngine::clock()
+{
+    typedef std::chrono::steady_clock Clock;
+    const Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(double(m_period) / m_sampleRate));
+    Clock::time_point next = Clock::now();
+    while (m_running.load(std::memory_order_acquire)) {
+        next += period;
+        std::this_thread::sleep_until(next);
+        pull(m_sinkLeft.data(), m_sinkRight.data(), m_period);
+        try {
+            m_sink->consume(m_sinkLeft.data(), m_sinkRight.data(), m_period);
+        }
+        catch (Exception&) {
+            // Keep the clock running, a failing sink just loses its samples
+        }
+    }
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
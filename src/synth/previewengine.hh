@@ -0,0 +1,302 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <synth/engine.hh>
+#include <synth/ringbuffer.hh>
+#include <synth/resampler.hh>
+#include <synth/spscqueue.hh>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Forward declarations
+class AudioSink;
+
+/**
+  @ingroup synth_group
+
+  Real-time preview engine.
+
+  Runs a render Engine on its own thread for auditioning instruments while they are edited. The controlling thread,
+  usually the GUI, compiles an Instrument from the store it owns and sends it together with note events through a
+  lock-free command queue, so the render thread never touches the store and never waits for a lock. Rendered audio
+  goes into a lock-free ring buffer, from which an audio device takes it with pull(). For testing, a clock thread
+  can drive an AudioSink at the pace of a real device.
+
+  Instruments replaced on the render thread are passed back to the controlling thread through a second queue and
+  freed there by collect(), so rendering does not allocate or free memory once started. Render blocks taking longer
+  than their playback time count as deadline misses, pulls finding too few samples as xruns.
+ */
+class PreviewEngine {
+    public:
+        /// Number of MIDI channels with their own instrument
+        static const size_t NumChannels = 16;
+
+        /// Render statistics
+        struct Statistics {
+            uint64_t    m_frames;           ///< Number of rendered frames
+            uint64_t    m_xruns;            ///< Number of pulls that found too few frames
+            uint64_t    m_deadlineMisses;   ///< Number of blocks rendered slower than real time
+            float       m_maxLoad;          ///< Highest render time of a block relative to its playback time
+        };
+
+        /**
+          Create preview engine.
+
+          Creates the engine in stopped state.
+
+          @param[in]    numVoices   Number of voices
+          @param[in]    sampleRate  Sample rate in Hz
+          @param[in]    bufferFrames    Ring buffer size in frames, rounded up to a power of two, sets the latency
+          @param[in]    queueSize   Maximum number of pending commands
+          @param[in]    engineRate  Sample rate the engine renders at, converted to the sample rate on the render
+                                    thread, 0 to render at the sample rate
+          @param[in]    quality     Sample rate conversion quality
+         */
+        PreviewEngine(size_t numVoices, float sampleRate, size_t bufferFrames = 1024, size_t queueSize = 256,
+                      float engineRate = 0.0f, Resampler::Quality quality = Resampler::Quality::Fast);
+
+        /**
+          Destroy preview engine.
+
+          Stops the threads.
+         */
+        ~PreviewEngine();
+
+        /**
+          Start engine.
+
+          Starts the render thread and waits until the ring buffer has been filled. If a sink is given, a clock
+          thread passes one period to it every period duration.
+
+          @param[in]    sink        Audio sink, null if an audio device calls pull()
+          @param[in]    period      Number of frames per sink period
+         */
+        void start(AudioSink* sink = nullptr, size_t period = 256);
+
+        /**
+          Stop engine.
+
+          Stops the render and clock threads.
+         */
+        void stop();
+
+        /**
+          Check for running engine.
+
+          Returns true if the render thread is running.
+
+          @return                   True if running
+         */
+        bool isRunning() const {
+            return m_running.load(std::memory_order_acquire);
+        }
+
+        /**
+          Set instrument.
+
+          Selects the instrument played on a channel. Sounding notes keep their instrument.
+
+          @param[in]    channel     MIDI channel
+          @param[in]    instrument  Instrument, null to mute the channel
+
+          @return                   False if the command queue is full
+         */
+        bool setInstrument(uint8_t channel, const std::shared_ptr<const Instrument>& instrument);
+
+        /**
+          Note on.
+
+          Starts a note with the instrument of the channel.
+
+          @param[in]    channel     MIDI channel
+          @param[in]    note        MIDI note number
+          @param[in]    velocity    Note velocity 1..127
+
+          @return                   False if the command queue is full
+         */
+        bool noteOn(uint8_t channel, uint8_t note, uint8_t velocity);
+
+        /**
+          Note off.
+
+          Releases a note.
+
+          @param[in]    channel     MIDI channel
+          @param[in]    note        MIDI note number
+
+          @return                   False if the command queue is full
+         */
+        bool noteOff(uint8_t channel, uint8_t note);
+
+        /**
+          All notes off.
+
+          Releases all notes.
+
+          @return                   False if the command queue is full
+         */
+        bool allNotesOff();
+
+        /**
+          Collect replaced instruments.
+
+          Frees instruments no longer used by the render thread. To be called regularly by the controlling thread.
+         */
+        void collect();
+
+        /**
+          Pull samples.
+
+          Takes rendered samples from the ring buffer, to be called by exactly one audio device thread. Missing
+          samples are filled with silence and counted as an xrun.
+
+          @param[out]   left        Left samples
+          @param[out]   right       Right samples
+          @param[in]    frames      Number of frames
+
+          @return                   Number of frames taken from the ring buffer
+         */
+        size_t pull(float* left, float* right, size_t frames);
+
+        /**
+          Get statistics.
+
+          Returns the render statistics since the last start().
+
+          @return                   Statistics
+         */
+        Statistics getStatistics() const;
+
+    private:
+        /// Command type
+        enum class Type {
+            NoteOn,                         ///< Start note
+            NoteOff,                        ///< Release note
+            AllNotesOff,                    ///< Release all notes
+            SetInstrument                   ///< Change channel instrument
+        };
+
+        /// Command from the controlling thread
+        struct Command {
+            Type        m_type;             ///< Command type
+            uint8_t     m_channel;          ///< MIDI channel
+            uint8_t     m_note;             ///< Note number
+            uint8_t     m_velocity;         ///< Note velocity
+            std::shared_ptr<const Instrument> m_instrument;     ///< Instrument for SetInstrument
+
+            /// Create empty command
+            Command() : m_type(Type::NoteOn), m_channel(0), m_note(0), m_velocity(0), m_instrument() {}
+        };
+
+        typedef std::shared_ptr<const Instrument> InstrumentPtr;    ///< Shared instrument pointer
+
+        float                       m_sampleRate;       ///< Sample rate in Hz
+        float                       m_engineRate;       ///< Sample rate of the engine in Hz
+        Engine                      m_engine;           ///< Render engine, used by the render thread only
+        std::unique_ptr<Resampler>  m_resampler;        ///< Sample rate converter, null if not converting
+        size_t                      m_maxOutput;        ///< Maximum number of frames written per block
+        RingBuffer                  m_ring;             ///< Rendered samples
+        SpscQueue<Command>          m_commands;         ///< Commands to the render thread
+        SpscQueue<InstrumentPtr>    m_retired;          ///< Replaced instruments from the render thread
+        std::vector<InstrumentPtr>  m_graveyard;        ///< Retired instruments that may still be playing
+        InstrumentPtr               m_instruments[NumChannels];     ///< Instrument per channel
+        std::vector<float>          m_left;             ///< Left samples of one block
+        std::vector<float>          m_right;            ///< Right samples of one block
+        std::vector<float>          m_outLeft;          ///< Left samples of one converted block
+        std::vector<float>          m_outRight;         ///< Right samples of one converted block
+        std::vector<float>          m_sinkLeft;         ///< Left samples of one sink period
+        std::vector<float>          m_sinkRight;        ///< Right samples of one sink period
+        AudioSink*                  m_sink;             ///< Audio sink driven by the clock thread
+        size_t                      m_period;           ///< Frames per sink period
+        std::thread                 m_renderThread;     ///< Render thread
+        std::thread                 m_clockThread;      ///< Clock thread
+        std::atomic<bool>           m_running;          ///< Threads shall run
+        std::atomic<uint64_t>       m_frames;           ///< Number of rendered frames
+        std::atomic<uint64_t>       m_xruns;            ///< Number of xruns
+        std::atomic<uint64_t>       m_deadlineMisses;   ///< Number of deadline misses
+        std::atomic<float>          m_maxLoad;          ///< Highest block render load
+
+        /**
+          Send command.
+
+          Queues a command for the render thread.
+
+          @param[in]    type        Command type
+          @param[in]    channel     MIDI channel
+          @param[in]    note        Note number
+          @param[in]    velocity    Note velocity
+          @param[in]    instrument  Instrument
+
+          @return                   False if the queue is full
+         */
+        bool send(Type type, uint8_t channel, uint8_t note, uint8_t velocity, const InstrumentPtr& instrument);
+
+        /**
+          Execute commands.
+
+          Executes all queued commands on the render thread.
+         */
+        void execute();
+
+        /**
+          Run render thread.
+
+          Keeps the ring buffer filled until stopped.
+         */
+        void render();
+
+        /**
+          Run clock thread.
+
+          Passes one period to the sink every period duration until stopped.
+         */
+        void clock();
+
+        PreviewEngine(const PreviewEngine&);            ///< Inhibit copying objects
+        PreviewEngine& operator=(const PreviewEngine&); ///< Inhibit copying objects
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
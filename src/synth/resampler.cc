@@ -0,0 +1,206 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+#include <synth/resampler.hh>
+#include <synth/simd.hh>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Filter design per quality preset
+struct Preset {
+    size_t  m_numTaps;      ///< Filter length
+    size_t  m_numPhases;    ///< Number of tabulated fractional positions
+    double  m_beta;         ///< Kaiser window shape
+    double  m_rolloff;      ///< Cutoff relative to the Nyquist frequency
+};
+
+// Presets by quality
+static const Preset Presets[] = {
+    { 16, 128, 6.0, 0.86 },
+    { 32, 256, 8.0, 0.91 },
+    { 64, 512, 10.0, 0.94 }
+};
+
+// Maximum filter length of all presets
+static const size_t MaxTaps = 64;
+
+// Input frames buffered per chunk besides the filter history
+static const size_t ChunkSize = 256;
+
+// Silence fed by flush()
+static const float Zeros[MaxTaps / 2] = { 0.0f };
+
+// Pi
+static const double Pi = 3.14159265358979323846;
+
+// Compute zeroth order modified Bessel function of the first kind
+static double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50 && term > sum * 1e-12; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// Create sample rate converter
+Resampler::Resampler(float inputRate, float outputRate, Quality quality)
+    : m_numTaps(Presets[static_cast<size_t>(quality)].m_numTaps)
+    , m_numPhases(Presets[static_cast<size_t>(quality)].m_numPhases)
+    , m_step(double(inputRate) / double(outputRate))
+    , m_position(0.0)
+    , m_coefs((m_numPhases + 1) * m_numTaps, 0.0f)
+    , m_left(m_numTaps + ChunkSize + 1, 0.0f)
+    , m_right(m_left.size(), 0.0f)
+    , m_buffered(0)
+{
+    // Windowed sinc for every phase, with the cutoff lowered to the output Nyquist frequency when converting down
+    const Preset& preset = Presets[static_cast<size_t>(quality)];
+    double half = double(m_numTaps / 2);
+    double cutoff = std::min(1.0, 1.0 / m_step) * preset.m_rolloff;
+    double norm = besselI0(preset.m_beta);
+    for (size_t phase = 0; phase <= m_numPhases; ++phase) {
+        double fraction = double(phase) / double(m_numPhases);
+        float* coefs = &(m_coefs[phase * m_numTaps]);
+        double sum = 0.0;
+        for (size_t tap = 0; tap < m_numTaps; ++tap) {
+            double distance = double(tap) - (half - 1.0) - fraction;
+            double x = distance / half;
+            double window = x * x < 1.0 ? besselI0(preset.m_beta * std::sqrt(1.0 - x * x)) / norm : 0.0;
+            double arg = Pi * cutoff * distance;
+            double sinc = arg != 0.0 ? std::sin(arg) / arg : 1.0;
+            coefs[tap] = float(sinc * window);
+            sum += sinc * window;
+        }
+
+        // Unity gain at DC for every phase
+        for (size_t tap = 0; tap < m_numTaps; ++tap) {
+            coefs[tap] = float(coefs[tap] / sum);
+        }
+    }
+    reset();
+}
+
+// Get maximum output of a number of input frames
+size_t Resampler::getMaxOutput(size_t frames) const
+{
+    return size_t(std::ceil(double(frames) / m_step)) + 1;
+}
+
+// Convert block of samples
+size_t Resampler::process(const float* inLeft, const float* inRight, size_t frames, float* outLeft, float* outRight)
+{
+    size_t count = 0;
+    while (frames != 0) {
+        size_t chunk = std::min(frames, m_left.size() - m_buffered);
+        memcpy(&(m_left[m_buffered]), inLeft, chunk * sizeof(float));
+        memcpy(&(m_right[m_buffered]), inRight, chunk * sizeof(float));
+        m_buffered += chunk;
+        inLeft += chunk;
+        inRight += chunk;
+        frames -= chunk;
+        count += produce(outLeft + count, outRight + count);
+    }
+    return count;
+}
+
+// Feed silence to produce the remaining output
+size_t Resampler::flush(float* outLeft, float* outRight)
+{
+    return process(Zeros, Zeros, getLatency(), outLeft, outRight);
+}
+
+// Clear history
+void Resampler::reset()
+{
+    // Half a filter of silence precedes the first input frame, which is also the position of the first output frame
+    m_buffered = m_numTaps / 2 - 1;
+    m_position = double(m_buffered);
+    std::fill(m_left.begin(), m_left.begin() + m_buffered, 0.0f);
+    std::fill(m_right.begin(), m_right.begin() + m_buffered, 0.0f);
+}
+
+// Compute output frames the buffered input suffices for
+size_t Resampler::produce(float* outLeft, float* outRight)
+{
+    const size_t half = m_numTaps / 2;
+    size_t count = 0;
+    for (;;) {
+        size_t index = size_t(m_position);
+        if (index + half >= m_buffered) {
+            break;
+        }
+
+        // Interpolate taps between the two nearest phases while summing
+        double phase = (m_position - double(index)) * double(m_numPhases);
+        size_t phaseIndex = std::min(size_t(phase), m_numPhases - 1);
+        Float4 weight(float(phase - double(phaseIndex)));
+        const float* coefs0 = &(m_coefs[phaseIndex * m_numTaps]);
+        const float* coefs1 = coefs0 + m_numTaps;
+        const float* left = &(m_left[index + 1 - half]);
+        const float* right = &(m_right[index + 1 - half]);
+        Float4 sumLeft;
+        Float4 sumRight;
+        for (size_t tap = 0; tap < m_numTaps; tap += Float4::Lanes) {
+            Float4 c0 = Float4::load(coefs0 + tap);
+            Float4 coef = c0 + (Float4::load(coefs1 + tap) - c0) * weight;
+            sumLeft += Float4::load(left + tap) * coef;
+            sumRight += Float4::load(right + tap) * coef;
+        }
+        outLeft[count] = sumLeft.sum();
+        outRight[count] = sumRight.sum();
+        ++count;
+        m_position += m_step;
+    }
+
+    // Keep the history the next output frame needs
+    size_t index = size_t(m_position);
+    size_t drop = std::min(index + 1 - half, m_buffered);
+    memmove(m_left.data(), &(m_left[drop]), (m_buffered - drop) * sizeof(float));
+    memmove(m_right.data(), &(m_right[drop]), (m_buffered - drop) * sizeof(float));
+    m_buffered -= drop;
+    m_position -= double(drop);
+    return count;
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,170 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <common.hh>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Stereo sample rate converter.
+
+  Converts a stream of stereo samples between arbitrary sample rates with a polyphase windowed-sinc filter. The
+  Kaiser-windowed sinc is tabulated for a number of fractional positions (phases) and interpolated linearly between
+  neighbouring phases, so any ratio works without a common divisor of the rates. When converting down, the cutoff
+  is lowered to the output Nyquist frequency. The filter sums run four taps at a time with SIMD. Input can be
+  passed in blocks of any size, no memory is allocated after construction, so the converter can be used on a
+  real-time thread.
+ */
+class Resampler {
+    public:
+        /// Quality preset, trading filter length for speed
+        enum class Quality {
+            Fast,                           ///< 16 taps, about 60 dB stopband attenuation
+            Medium,                         ///< 32 taps, about 80 dB stopband attenuation
+            Best                            ///< 64 taps, about 100 dB stopband attenuation
+        };
+
+        /**
+          Create sample rate converter.
+
+          @param[in]    inputRate   Input sample rate in Hz
+          @param[in]    outputRate  Output sample rate in Hz
+          @param[in]    quality     Quality preset
+         */
+        Resampler(float inputRate, float outputRate, Quality quality = Quality::Medium);
+
+        /**
+          Get number of taps.
+
+          Returns the filter length in input frames.
+
+          @return                   Number of taps
+         */
+        size_t getNumTaps() const {
+            return m_numTaps;
+        }
+
+        /**
+          Get latency.
+
+          Returns how many input frames have to follow an input frame before its output is produced. The output
+          itself is not delayed, it is aligned with the input.
+
+          @return                   Latency in input frames
+         */
+        size_t getLatency() const {
+            return m_numTaps / 2;
+        }
+
+        /**
+          Get maximum output.
+
+          Returns the maximum number of frames process() produces from the given number of input frames.
+
+          @param[in]    frames      Number of input frames
+
+          @return                   Maximum number of output frames
+         */
+        size_t getMaxOutput(size_t frames) const;
+
+        /**
+          Convert samples.
+
+          Consumes a block of input frames and produces all output frames which can be computed so far. The output
+          buffers must hold getMaxOutput() frames.
+
+          @param[in]    inLeft      Left input samples
+          @param[in]    inRight     Right input samples
+          @param[in]    frames      Number of input frames
+          @param[out]   outLeft     Left output samples
+          @param[out]   outRight    Right output samples
+
+          @return                   Number of output frames
+         */
+        size_t process(const float* inLeft, const float* inRight, size_t frames, float* outLeft, float* outRight);
+
+        /**
+          Flush converter.
+
+          Feeds silence to produce the output of the last getLatency() input frames. The output buffers must hold
+          getMaxOutput(getLatency()) frames.
+
+          @param[out]   outLeft     Left output samples
+          @param[out]   outRight    Right output samples
+
+          @return                   Number of output frames
+         */
+        size_t flush(float* outLeft, float* outRight);
+
+        /**
+          Reset converter.
+
+          Clears the history, the next input starts a new stream.
+         */
+        void reset();
+
+    private:
+        size_t              m_numTaps;      ///< Filter length, multiple of four
+        size_t              m_numPhases;    ///< Number of tabulated fractional positions
+        double              m_step;         ///< Input frames per output frame
+        double              m_position;     ///< Input position of next output frame relative to the buffer
+        std::vector<float>  m_coefs;        ///< Filter taps of numPhases + 1 phases
+        std::vector<float>  m_left;         ///< Buffered left input
+        std::vector<float>  m_right;        ///< Buffered right input
+        size_t              m_buffered;     ///< Number of buffered input frames
+
+        /**
+          Produce output.
+
+          Computes all output frames which the buffered input suffices for and drops input which is no longer
+          needed.
+
+          @param[out]   outLeft     Left output samples
+          @param[out]   outRight    Right output samples
+
+          @return                   Number of output frames
+         */
+        size_t produce(float* outLeft, float* outRight);
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,100 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/ringbuffer.hh>
+#include <algorithm>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Round up to power of two
+static size_t roundUp(size_t value)
+{
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+// Create ring buffer
+RingBuffer::RingBuffer(size_t frames)
+    : m_left(roundUp(frames), 0.0f)
+    , m_right(m_left.size(), 0.0f)
+    , m_mask(m_left.size() - 1)
+    , m_written(0)
+    , m_read(0)
+{
+}
+
+// Append samples
+size_t RingBuffer::write(const float* left, const float* right, size_t frames)
+{
+    size_t written = m_written.load(std::memory_order_relaxed);
+    size_t free = m_left.size() - (written - m_read.load(std::memory_order_acquire));
+    frames = std::min(frames, free);
+
+    // Copy in up to two parts around the wrap
+    size_t pos = written & m_mask;
+    size_t first = std::min(frames, m_left.size() - pos);
+    std::copy(left, left + first, m_left.begin() + pos);
+    std::copy(right, right + first, m_right.begin() + pos);
+    std::copy(left + first, left + frames, m_left.begin());
+    std::copy(right + first, right + frames, m_right.begin());
+    m_written.store(written + frames, std::memory_order_release);
+    return frames;
+}
+
+// Remove samples
+size_t RingBuffer::read(float* left, float* right, size_t frames)
+{
+    size_t read = m_read.load(std::memory_order_relaxed);
+    size_t available = m_written.load(std::memory_order_acquire) - read;
+    frames = std::min(frames, available);
+
+    size_t pos = read & m_mask;
+    size_t first = std::min(frames, m_left.size() - pos);
+    std::copy(m_left.begin() + pos, m_left.begin() + pos + first, left);
+    std::copy(m_right.begin() + pos, m_right.begin() + pos + first, right);
+    std::copy(m_left.begin(), m_left.begin() + (frames - first), left + first);
+    std::copy(m_right.begin(), m_right.begin() + (frames - first), right + first);
+    m_read.store(read + frames, std::memory_order_release);
+    return frames;
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
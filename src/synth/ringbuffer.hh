@@ -0,0 +1,137 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <atomic>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Lock-free stereo sample ring buffer.
+
+  Passes stereo samples from a render thread to an audio output without locks. Exactly one thread may write and
+  exactly one thread may read at a time. All memory is allocated on construction.
+ */
+class RingBuffer {
+    public:
+        /**
+          Create ring buffer.
+
+          Allocates the sample memory.
+
+          @param[in]    frames      Capacity in frames, rounded up to a power of two
+         */
+        explicit RingBuffer(size_t frames);
+
+        /**
+          Get capacity.
+
+          Returns the maximum number of buffered frames.
+
+          @return                   Capacity in frames
+         */
+        size_t getCapacity() const {
+            return m_left.size();
+        }
+
+        /**
+          Get readable frames.
+
+          Returns the number of frames that can be read.
+
+          @return                   Number of buffered frames
+         */
+        size_t getReadable() const {
+            return m_written.load(std::memory_order_acquire) - m_read.load(std::memory_order_acquire);
+        }
+
+        /**
+          Get writable frames.
+
+          Returns the number of frames that can be written.
+
+          @return                   Number of free frames
+         */
+        size_t getWritable() const {
+            return m_left.size() - getReadable();
+        }
+
+        /**
+          Write samples.
+
+          Appends as many frames as fit, to be called by the writing thread.
+
+          @param[in]    left        Left samples
+          @param[in]    right       Right samples
+          @param[in]    frames      Number of frames
+
+          @return                   Number of written frames
+         */
+        size_t write(const float* left, const float* right, size_t frames);
+
+        /**
+          Read samples.
+
+          Removes as many frames as available, up to the given number, to be called by the reading thread.
+
+          @param[out]   left        Left samples
+          @param[out]   right       Right samples
+          @param[in]    frames      Number of frames
+
+          @return                   Number of read frames
+         */
+        size_t read(float* left, float* right, size_t frames);
+
+    private:
+        std::vector<float>      m_left;         ///< Left samples, size is a power of two
+        std::vector<float>      m_right;        ///< Right samples
+        size_t                  m_mask;         ///< Frame index mask
+        std::atomic<size_t>     m_written;      ///< Number of written frames, written by the writer
+        std::atomic<size_t>     m_read;         ///< Number of read frames, written by the reader
+
+        RingBuffer(const RingBuffer&);              ///< Inhibit copying objects
+        RingBuffer& operator=(const RingBuffer&);   ///< Inhibit copying objects
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
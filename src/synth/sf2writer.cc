@@ -0,0 +1,360 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+#include <synth/sf2writer.hh>
+#include <synth/wavwriter.hh>
+#include <exceptions.hh>
+#include <algorithm>
+#include <cstring>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Zero sample points required after each sample
+static const size_t Padding = 46;
+
+// Maximum name length without terminating zero
+static const size_t NameSize = 19;
+
+// Generator operators
+static const uint16_t GenPan            = 17;
+static const uint16_t GenReleaseVolEnv  = 38;
+static const uint16_t GenInstrument     = 41;
+static const uint16_t GenKeyRange       = 43;
+static const uint16_t GenVelRange       = 44;
+static const uint16_t GenSampleId       = 53;
+
+// Pan of left and right samples in 0.1% units
+static const int16_t PanLeft = -500;
+static const int16_t PanRight = 500;
+
+// Volume envelope release in timecents, 50 ms to avoid clicks on note off
+static const int16_t Release = -5186;
+
+// Sample types of linked stereo samples
+static const uint16_t RightSample = 2;
+static const uint16_t LeftSample = 4;
+
+// Append little endian 16 bit value
+static void put16(std::vector<uint8_t>& buf, uint16_t value)
+{
+    buf.push_back(uint8_t(value));
+    buf.push_back(uint8_t(value >> 8));
+}
+
+// Append little endian 32 bit value
+static void put32(std::vector<uint8_t>& buf, uint32_t value)
+{
+    put16(buf, uint16_t(value));
+    put16(buf, uint16_t(value >> 16));
+}
+
+// Append four character code
+static void putId(std::vector<uint8_t>& buf, const char* id)
+{
+    buf.insert(buf.end(), id, id + 4);
+}
+
+// Append zero padded name
+static void putName(std::vector<uint8_t>& buf, const std::string& name, size_t size)
+{
+    size_t length = std::min(name.size(), size - 1);
+    buf.insert(buf.end(), name.begin(), name.begin() + length);
+    buf.insert(buf.end(), size - length, 0);
+}
+
+// Append chunk
+static void putChunk(std::vector<uint8_t>& buf, const char* id, const std::vector<uint8_t>& data)
+{
+    putId(buf, id);
+    put32(buf, uint32_t(data.size()));
+    buf.insert(buf.end(), data.begin(), data.end());
+    if (data.size() & 1) {
+        buf.push_back(0);
+    }
+}
+
+// Append generator
+static void putGen(std::vector<uint8_t>& buf, uint16_t oper, uint16_t amount)
+{
+    put16(buf, oper);
+    put16(buf, amount);
+}
+
+// Append range generator
+static void putRange(std::vector<uint8_t>& buf, uint16_t oper, uint8_t low, uint8_t high)
+{
+    putGen(buf, oper, uint16_t(low | (high << 8)));
+}
+
+// Store little endian 32 bit value in file
+static void patch32(std::ofstream& file, std::streamoff pos, uint32_t value)
+{
+    std::vector<uint8_t> buf;
+    put32(buf, value);
+    file.seekp(pos);
+    file.write(reinterpret_cast<const char*>(buf.data()), std::streamsize(buf.size()));
+}
+
+// Create SoundFont file
+Sf2Writer::Sf2Writer(const std::string& filename, const std::string& name)
+    : m_file(filename.c_str(), std::ios::binary | std::ios::trunc)
+    , m_sdta(0)
+    , m_points(0)
+    , m_samples()
+    , m_instruments()
+    , m_buffer()
+    , m_mutex()
+{
+    if (!m_file) {
+        throw SystemException("Unable to create file " + filename);
+    }
+
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> chunk;
+    put16(chunk, 2);
+    put16(chunk, 1);
+    putChunk(data, "ifil", chunk);
+    chunk.clear();
+    putName(chunk, "EMU8000", 8);
+    putChunk(data, "isng", chunk);
+    chunk.clear();
+    putName(chunk, name.substr(0, 255), (std::min(name.size(), size_t(255)) + 2) & ~size_t(1));
+    putChunk(data, "INAM", chunk);
+    chunk.clear();
+    putName(chunk, "DMS-Toolbox", 12);
+    putChunk(data, "ISFT", chunk);
+
+    std::vector<uint8_t> buf;
+    putId(buf, "RIFF");
+    put32(buf, 0);
+    putId(buf, "sfbk");
+    putId(buf, "LIST");
+    put32(buf, uint32_t(data.size() + 4));
+    putId(buf, "INFO");
+    buf.insert(buf.end(), data.begin(), data.end());
+    m_sdta = std::streamoff(buf.size());
+    putId(buf, "LIST");
+    put32(buf, 0);
+    putId(buf, "sdta");
+    putId(buf, "smpl");
+    put32(buf, 0);
+    m_file.write(reinterpret_cast<const char*>(buf.data()), std::streamsize(buf.size()));
+    if (!m_file) {
+        throw SystemException("Unable to write SoundFont file " + filename);
+    }
+}
+
+// Close SoundFont file
+Sf2Writer::~Sf2Writer()
+{
+    try {
+        close();
+    }
+    catch (Exception&) {
+    }
+}
+
+// Append stereo sample
+uint32_t Sf2Writer::addSample(const std::string& name, const float* left, const float* right, size_t frames,
+                              uint32_t sampleRate, uint8_t rootKey)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.is_open()) {
+        throw SystemException("SoundFont file already closed");
+    }
+
+    uint32_t index = uint32_t(m_samples.size() / 2);
+    Sample sample = { name, 0, 0, sampleRate, rootKey };
+    sample.m_start = m_points;
+    writeSamples(left, frames);
+    sample.m_end = sample.m_start + uint32_t(frames);
+    m_samples.push_back(sample);
+    sample.m_start = m_points;
+    writeSamples(right, frames);
+    sample.m_end = sample.m_start + uint32_t(frames);
+    m_samples.push_back(sample);
+    return index;
+}
+
+// Add instrument and preset
+void Sf2Writer::addInstrument(uint16_t preset, const std::string& name, const std::vector<Zone>& zones)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Instrument instrument = { preset, name, zones };
+    m_instruments.push_back(instrument);
+}
+
+// Write headers and close file
+void Sf2Writer::close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.is_open()) {
+        return;
+    }
+
+    writePresets();
+    std::streamoff end = m_file.tellp();
+    uint32_t smplSize = m_points * 2;
+    patch32(m_file, m_sdta + 4, smplSize + 12);
+    patch32(m_file, m_sdta + 16, smplSize);
+    patch32(m_file, 4, uint32_t(end - 8));
+    m_file.close();
+    if (!m_file) {
+        throw SystemException("Unable to write SoundFont file");
+    }
+}
+
+// Write mono sample data
+void Sf2Writer::writeSamples(const float* samples, size_t frames)
+{
+    m_buffer.clear();
+    for (size_t i = 0; i < frames; ++i) {
+        put16(m_buffer, uint16_t(WavWriter::convert(samples[i])));
+    }
+    m_buffer.insert(m_buffer.end(), Padding * 2, 0);
+    m_file.write(reinterpret_cast<const char*>(m_buffer.data()), std::streamsize(m_buffer.size()));
+    if (!m_file) {
+        throw SystemException("Unable to write SoundFont file");
+    }
+    m_points += uint32_t(frames + Padding);
+}
+
+// Write preset, instrument and sample headers
+void Sf2Writer::writePresets()
+{
+    std::stable_sort(m_instruments.begin(), m_instruments.end(),
+                     [](const Instrument& a, const Instrument& b) { return a.m_preset < b.m_preset; });
+
+    // Every preset has a single zone selecting its instrument
+    std::vector<uint8_t> phdr;
+    std::vector<uint8_t> pbag;
+    std::vector<uint8_t> pgen;
+    uint16_t index = 0;
+    for (auto& instrument : m_instruments) {
+        putName(phdr, instrument.m_name, NameSize + 1);
+        put16(phdr, instrument.m_preset % 128);
+        put16(phdr, instrument.m_preset / 128);
+        put16(phdr, index);
+        put32(phdr, 0);
+        put32(phdr, 0);
+        put32(phdr, 0);
+        put16(pbag, index);
+        put16(pbag, 0);
+        putGen(pgen, GenInstrument, index);
+        ++index;
+    }
+    putName(phdr, "EOP", NameSize + 1);
+    put16(phdr, 0);
+    put16(phdr, 0);
+    put16(phdr, index);
+    put32(phdr, 0);
+    put32(phdr, 0);
+    put32(phdr, 0);
+    put16(pbag, index);
+    put16(pbag, 0);
+    putGen(pgen, 0, 0);
+
+    // Every zone becomes a pair of instrument zones, one per channel
+    std::vector<uint8_t> inst;
+    std::vector<uint8_t> ibag;
+    std::vector<uint8_t> igen;
+    uint16_t bag = 0;
+    uint16_t gen = 0;
+    for (auto& instrument : m_instruments) {
+        putName(inst, instrument.m_name, NameSize + 1);
+        put16(inst, bag);
+        for (auto& zone : instrument.m_zones) {
+            for (uint32_t channel = 0; channel < 2; ++channel) {
+                put16(ibag, gen);
+                put16(ibag, 0);
+                putRange(igen, GenKeyRange, zone.m_lowKey, zone.m_highKey);
+                putRange(igen, GenVelRange, zone.m_lowVelocity, zone.m_highVelocity);
+                putGen(igen, GenPan, uint16_t(channel == 0 ? PanLeft : PanRight));
+                putGen(igen, GenReleaseVolEnv, uint16_t(Release));
+                putGen(igen, GenSampleId, uint16_t(zone.m_sample * 2 + channel));
+                gen += 5;
+                ++bag;
+            }
+        }
+    }
+    putName(inst, "EOI", NameSize + 1);
+    put16(inst, bag);
+    put16(ibag, gen);
+    put16(ibag, 0);
+    putGen(igen, 0, 0);
+
+    // Left and right samples are linked to each other
+    std::vector<uint8_t> shdr;
+    for (size_t i = 0; i < m_samples.size(); ++i) {
+        const Sample& sample = m_samples[i];
+        putName(shdr, sample.m_name, NameSize + 1);
+        put32(shdr, sample.m_start);
+        put32(shdr, sample.m_end);
+        put32(shdr, sample.m_start);
+        put32(shdr, sample.m_end);
+        put32(shdr, sample.m_sampleRate);
+        shdr.push_back(sample.m_rootKey);
+        shdr.push_back(0);
+        put16(shdr, uint16_t(i ^ 1));
+        put16(shdr, (i & 1) != 0 ? RightSample : LeftSample);
+    }
+    putName(shdr, "EOS", NameSize + 1);
+    shdr.insert(shdr.end(), 26, 0);
+
+    // Modulator lists only hold their terminator
+    std::vector<uint8_t> mod(10, 0);
+    std::vector<uint8_t> data;
+    putChunk(data, "phdr", phdr);
+    putChunk(data, "pbag", pbag);
+    putChunk(data, "pmod", mod);
+    putChunk(data, "pgen", pgen);
+    putChunk(data, "inst", inst);
+    putChunk(data, "ibag", ibag);
+    putChunk(data, "imod", mod);
+    putChunk(data, "igen", igen);
+    putChunk(data, "shdr", shdr);
+
+    std::vector<uint8_t> buf;
+    putId(buf, "LIST");
+    put32(buf, uint32_t(data.size() + 4));
+    putId(buf, "pdta");
+    buf.insert(buf.end(), data.begin(), data.end());
+    m_file.write(reinterpret_cast<const char*>(buf.data()), std::streamsize(buf.size()));
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,174 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <common.hh>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  SoundFont 2 file writer.
+
+  Writes SoundFont 2.01 banks with one instrument per preset. Sample data is streamed to the file as it is added,
+  only the small preset and sample headers are kept in memory until the file is closed, so banks of any size can
+  be written with constant memory. Stereo samples are stored as linked pairs of mono samples. Samples and
+  instruments may be added from several threads, presets are sorted by number when the file is closed.
+ */
+class Sf2Writer {
+    public:
+        /// Instrument zone playing a stereo sample
+        struct Zone {
+            uint8_t     m_lowKey;       ///< Lowest MIDI note
+            uint8_t     m_highKey;      ///< Highest MIDI note
+            uint8_t     m_lowVelocity;  ///< Lowest velocity
+            uint8_t     m_highVelocity; ///< Highest velocity
+            uint32_t    m_sample;       ///< Stereo sample index returned by addSample()
+        };
+
+        /**
+          Create SoundFont file.
+
+          Creates the file and writes the header.
+
+          @param[in]    filename    File name
+          @param[in]    name        Bank name
+
+          @exception    SystemException     Cannot create the file
+         */
+        Sf2Writer(const std::string& filename, const std::string& name);
+
+        /**
+          Close SoundFont file.
+
+          Completes the file if not done yet.
+         */
+        ~Sf2Writer();
+
+        /**
+          Add stereo sample.
+
+          Appends a stereo sample to the sample data.
+
+          @param[in]    name        Sample name, truncated to 19 characters
+          @param[in]    left        Left samples
+          @param[in]    right       Right samples
+          @param[in]    frames      Number of frames
+          @param[in]    sampleRate  Sample rate in Hz
+          @param[in]    rootKey     MIDI note played at original pitch
+
+          @return                   Stereo sample index
+
+          @exception    SystemException     Write error
+         */
+        uint32_t addSample(const std::string& name, const float* left, const float* right, size_t frames,
+                           uint32_t sampleRate, uint8_t rootKey);
+
+        /**
+          Add instrument.
+
+          Adds an instrument and a preset playing it. Preset numbers from 128 on continue in the following banks.
+
+          @param[in]    preset      Preset number
+          @param[in]    name        Instrument and preset name, truncated to 19 characters
+          @param[in]    zones       Zones of the instrument
+         */
+        void addInstrument(uint16_t preset, const std::string& name, const std::vector<Zone>& zones);
+
+        /**
+          Close SoundFont file.
+
+          Writes the preset and sample headers, completes the chunk sizes and closes the file.
+
+          @exception    SystemException     Write error
+         */
+        void close();
+
+    private:
+        /// Sample header
+        struct Sample {
+            std::string m_name;         ///< Sample name
+            uint32_t    m_start;        ///< First sample point
+            uint32_t    m_end;          ///< Sample point following the sample
+            uint32_t    m_sampleRate;   ///< Sample rate in Hz
+            uint8_t     m_rootKey;      ///< MIDI note played at original pitch
+        };
+
+        /// Instrument
+        struct Instrument {
+            uint16_t            m_preset;   ///< Preset number
+            std::string         m_name;     ///< Instrument name
+            std::vector<Zone>   m_zones;    ///< Zones
+        };
+
+        std::ofstream               m_file;         ///< Output file
+        std::streamoff              m_sdta;         ///< File position of the sample data list
+        uint32_t                    m_points;       ///< Number of sample points written
+        std::vector<Sample>         m_samples;      ///< Mono sample headers, left and right alternating
+        std::vector<Instrument>     m_instruments;  ///< Instruments
+        std::vector<uint8_t>        m_buffer;       ///< Conversion buffer
+        std::mutex                  m_mutex;        ///< Protects all members
+
+        /**
+          Write mono sample data.
+
+          Converts samples and appends them to the file, followed by the zero points required between samples.
+
+          @param[in]    samples     Samples
+          @param[in]    frames      Number of samples
+         */
+        void writeSamples(const float* samples, size_t frames);
+
+        /**
+          Write preset data.
+
+          Writes the preset, instrument and sample header chunks.
+         */
+        void writePresets();
+
+        Sf2Writer(const Sf2Writer&);                ///< Inhibit copying objects
+        Sf2Writer& operator=(const Sf2Writer&);     ///< Inhibit copying objects
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,82 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+#include <synth/sfzwriter.hh>
+#include <exceptions.hh>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Create SFZ file
+SfzWriter::SfzWriter(const std::string& filename, const std::string& name)
+    : m_file(filename.c_str(), std::ios::trunc)
+{
+    if (!m_file) {
+        throw SystemException("Unable to create file " + filename);
+    }
+    m_file << "// " << name << std::endl
+           << "<global>" << std::endl
+           << "loop_mode=no_loop" << std::endl
+           << "ampeg_release=0.05" << std::endl
+           << "amp_veltrack=100" << std::endl;
+}
+
+// Write region
+void SfzWriter::addRegion(const MultiSampler::Region& region, const std::string& sample)
+{
+    m_file << "<region> sample=" << sample
+           << " lokey=" << unsigned(region.m_lowKey) << " hikey=" << unsigned(region.m_highKey)
+           << " pitch_keycenter=" << unsigned(region.m_rootKey)
+           << " lovel=" << unsigned(region.m_lowVelocity) << " hivel=" << unsigned(region.m_highVelocity)
+           << " amp_velcurve_" << unsigned(region.m_lowVelocity) << "="
+           << float(region.m_lowVelocity) / float(region.m_highVelocity)
+           << " amp_velcurve_" << unsigned(region.m_highVelocity) << "=1" << std::endl;
+}
+
+// Close file
+void SfzWriter::close()
+{
+    if (!m_file.is_open()) {
+        return;
+    }
+    m_file.close();
+    if (!m_file) {
+        throw SystemException("Unable to write SFZ file");
+    }
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,95 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <common.hh>
+#include <synth/multisampler.hh>
+#include <fstream>
+#include <string>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  SFZ file writer.
+
+  Writes an SFZ instrument mapping rendered regions to WAV files. Velocity tracking is linear within each region,
+  relative to the velocity it has been rendered at, which matches the engine. Sample paths are written as given,
+  usually relative to the SFZ file.
+ */
+class SfzWriter {
+    public:
+        /**
+          Create SFZ file.
+
+          Creates the file and writes the global settings.
+
+          @param[in]    filename    File name
+          @param[in]    name        Instrument name, written as comment
+
+          @exception    SystemException     Cannot create the file
+         */
+        SfzWriter(const std::string& filename, const std::string& name);
+
+        /**
+          Add region.
+
+          Writes a region playing a sample.
+
+          @param[in]    region      Region
+          @param[in]    sample      Sample file name
+         */
+        void addRegion(const MultiSampler::Region& region, const std::string& sample);
+
+        /**
+          Close SFZ file.
+
+          @exception    SystemException     Write error
+         */
+        void close();
+
+    private:
+        std::ofstream   m_file;     ///< Output file
+
+        SfzWriter(const SfzWriter&);            ///< Inhibit copying objects
+        SfzWriter& operator=(const SfzWriter&); ///< Inhibit copying objects
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
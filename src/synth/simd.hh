@@ -0,0 +1,474 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DMSTOOLBOX_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Vector of four floats.
+
+  Thin wrapper around the SIMD registers used by the renderers, processing four voices in parallel. Uses SSE2 where
+  available and falls back to plain arrays otherwise, so the renderers compile on every platform. Loads and stores
+  are unaligned.
+ */
+class Float4 {
+    public:
+        /// Number of lanes
+        static const size_t Lanes = 4;
+
+        /**
+          Create zero vector.
+
+          Creates a vector with all lanes set to zero.
+         */
+        Float4()
+#ifdef DMSTOOLBOX_SSE2
+            : m_value(_mm_setzero_ps())
+        {
+        }
+#else
+            : m_value()
+        {
+        }
+#endif
+
+        /**
+          Create vector from scalar.
+
+          Creates a vector with all lanes set to the given value.
+
+          @param[in]    value       Lane value
+         */
+        Float4(float value)
+#ifdef DMSTOOLBOX_SSE2
+            : m_value(_mm_set1_ps(value))
+        {
+        }
+#else
+            : m_value()
+        {
+            m_value[0] = m_value[1] = m_value[2] = m_value[3] = value;
+        }
+#endif
+
+        /**
+          Create vector from lanes.
+
+          Creates a vector from four lane values.
+
+          @param[in]    v0          Lane 0 value
+          @param[in]    v1          Lane 1 value
+          @param[in]    v2          Lane 2 value
+          @param[in]    v3          Lane 3 value
+         */
+        Float4(float v0, float v1, float v2, float v3)
+#ifdef DMSTOOLBOX_SSE2
+            : m_value(_mm_setr_ps(v0, v1, v2, v3))
+        {
+        }
+#else
+            : m_value()
+        {
+            m_value[0] = v0;
+            m_value[1] = v1;
+            m_value[2] = v2;
+            m_value[3] = v3;
+        }
+#endif
+
+        /**
+          Load vector.
+
+          Loads four consecutive floats.
+
+          @param[in]    src         Source address
+
+          @return                   Loaded vector
+         */
+        static Float4 load(const float* src) {
+            Float4 result;
+#ifdef DMSTOOLBOX_SSE2
+            result.m_value = _mm_loadu_ps(src);
+#else
+            for (size_t i = 0; i < Lanes; ++i) {
+                result.m_value[i] = src[i];
+            }
+#endif
+            return result;
+        }
+
+        /**
+          Store vector.
+
+          Stores the lanes to four consecutive floats.
+
+          @param[out]   dst         Destination address
+         */
+        void store(float* dst) const {
+#ifdef DMSTOOLBOX_SSE2
+            _mm_storeu_ps(dst, m_value);
+#else
+            for (size_t i = 0; i < Lanes; ++i) {
+                dst[i] = m_value[i];
+            }
+#endif
+        }
+
+        /**
+          Truncate lanes.
+
+          Rounds all lanes towards zero and stores them as integers as well.
+
+          @param[out]   ints        Integer lane values
+
+          @return                   Truncated lanes
+         */
+        Float4 truncate(int32_t* ints) const {
+            Float4 result;
+#ifdef DMSTOOLBOX_SSE2
+            __m128i i = _mm_cvttps_epi32(m_value);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(ints), i);
+            result.m_value = _mm_cvtepi32_ps(i);
+#else
+            for (size_t i = 0; i < Lanes; ++i) {
+                ints[i] = int32_t(m_value[i]);
+                result.m_value[i] = float(ints[i]);
+            }
+#endif
+            return result;
+        }
+
+        /**
+          Get reciprocal.
+
+          Returns 1 / x for all lanes, using the fast estimate refined by one Newton-Raphson step, which is
+          accurate to about 22 bits.
+
+          @return                   Reciprocal lanes
+         */
+        Float4 reciprocal() const {
+            Float4 result;
+#ifdef DMSTOOLBOX_SSE2
+            __m128 estimate = _mm_rcp_ps(m_value);
+            result.m_value = _mm_mul_ps(estimate, _mm_sub_ps(_mm_set1_ps(2.0f), _mm_mul_ps(m_value, estimate)));
+#else
+            for (size_t i = 0; i < Lanes; ++i) {
+                result.m_value[i] = 1.0f / m_value[i];
+            }
+#endif
+            return result;
+        }
+
+        /**
+          Get horizontal sum.
+
+          Returns the sum of all lanes.
+
+          @return                   Sum of lanes
+         */
+        float sum() const {
+            float lanes[Lanes];
+            store(lanes);
+            return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        }
+
+        /// Add vectors
+        friend Float4 operator+(const Float4& a, const Float4& b) {
+            Float4 result;
+#ifdef DMSTOOLBOX_SSE2
+            result.m_value = _mm_add_ps(a.m_value, b.m_value);
+#else
+            for (size_t i = 0; i < Lanes; ++i) {
+                result.m_value[i] = a.m_value[i] + b.m_value[i];
+            }
+#endif
+            return result;
+        }
+
+        /// Subtract vectors
+        friend Float4 operator-(const Float4& a, const Float4& b) {
+            Float4 result;
+#ifdef DMSTOOLBOX_SSE2
+            result.m_value = _mm_sub_ps(a.m_value, b.m_value);
+#else
+            for (size_t i = 0; i < Lanes; ++i) {
+                result.m_value[i] = a.m_value[i] - b.m_value[i];
+            }
+#endif
+            return result;
+        }
+
+        /// Multiply vectors
+        friend Float4 operator*(const Float4& a, const Float4& b) {
+            Float4 result;
+#ifdef DMSTOOLBOX_SSE2
+            result.m_value = _mm_mul_ps(a.m_value, b.m_value);
+#else
+            for (size_t i = 0; i < Lanes; ++i) {
+                result.m_value[i] = a.m_value[i] * b.m_value[i];
+            }
+#endif
+            return result;
+        }
+
+        /// Divide vectors
+        friend Float4 operator/(const Float4& a, const Float4& b) {
+            Float4 result;
+#ifdef DMSTOOLBOX_SSE2
+            result.m_value = _mm_div_ps(a.m_value, b.m_value);
+#else
+            for (size_t i = 0; i < Lanes; ++i) {
+                result.m_value[i] = a.m_value[i] / b.m_value[i];
+            }
+#endif
+            return result;
+        }
+
+        /// Get lane-wise minimum
+        friend Float4 min(const Float4& a, const Float4& b) {
+            Float4 result;
+#ifdef DMSTOOLBOX_SSE2
+            result.m_value = _mm_min_ps(a.m_value, b.m_value);
+#else
+            for (size_t i = 0; i < Lanes; ++i) {
+                result.m_value[i] = a.m_value[i] < b.m_value[i] ? a.m_value[i] : b.m_value[i];
+            }
+#endif
+            return result;
+        }
+
+        /// Get lane-wise maximum
+        friend Float4 max(const Float4& a, const Float4& b) {
+            Float4 result;
+#ifdef DMSTOOLBOX_SSE2
+            result.m_value = _mm_max_ps(a.m_value, b.m_value);
+#else
+            for (size_t i = 0; i < Lanes; ++i) {
+                result.m_value[i] = a.m_value[i] > b.m_value[i] ? a.m_value[i] : b.m_value[i];
+            }
+#endif
+            return result;
+        }
+
+        /// Add vector
+        Float4& operator+=(const Float4& other) {
+            *this = *this + other;
+            return *this;
+        }
+
+        /// Subtract vector
+        Float4& operator-=(const Float4& other) {
+            *this = *this - other;
+            return *this;
+        }
+
+        /// Multiply by vector
+        Float4& operator*=(const Float4& other) {
+            *this = *this * other;
+            return *this;
+        }
+
+    private:
+#ifdef DMSTOOLBOX_SSE2
+        __m128  m_value;                    ///< Lane values
+#else
+        float   m_value[4];                 ///< Lane values
+#endif
+
+        friend class UInt4;
+};
+
+/**
+  @ingroup synth_group
+
+  Vector of four 32-bit unsigned integers.
+
+  Companion of Float4 for integer lane arithmetic, as needed by random number generators.
+ */
+class UInt4 {
+    public:
+        /**
+          Create zero vector.
+
+          Creates a vector with all lanes set to zero.
+         */
+        UInt4()
+#ifdef DMSTOOLBOX_SSE2
+            : m_value(_mm_setzero_si128())
+        {
+        }
+#else
+            : m_value()
+        {
+        }
+#endif
+
+        /**
+          Load vector.
+
+          Loads four consecutive integers.
+
+          @param[in]    src         Source address
+
+          @return                   Loaded vector
+         */
+        static UInt4 load(const uint32_t* src) {
+            UInt4 result;
+#ifdef DMSTOOLBOX_SSE2
+            result.m_value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+#else
+            for (size_t i = 0; i < 4; ++i) {
+                result.m_value[i] = src[i];
+            }
+#endif
+            return result;
+        }
+
+        /**
+          Store vector.
+
+          Stores the lanes to four consecutive integers.
+
+          @param[out]   dst         Destination address
+         */
+        void store(uint32_t* dst) const {
+#ifdef DMSTOOLBOX_SSE2
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), m_value);
+#else
+            for (size_t i = 0; i < 4; ++i) {
+                dst[i] = m_value[i];
+            }
+#endif
+        }
+
+        /**
+          Shift left.
+
+          Shifts all lanes left by a constant number of bits.
+
+          @tparam       Bits        Number of bits
+
+          @return                   Shifted lanes
+         */
+        template<int Bits> UInt4 shiftLeft() const {
+            UInt4 result;
+#ifdef DMSTOOLBOX_SSE2
+            result.m_value = _mm_slli_epi32(m_value, Bits);
+#else
+            for (size_t i = 0; i < 4; ++i) {
+                result.m_value[i] = m_value[i] << Bits;
+            }
+#endif
+            return result;
+        }
+
+        /**
+          Shift right.
+
+          Shifts all lanes right by a constant number of bits, filling in zeros.
+
+          @tparam       Bits        Number of bits
+
+          @return                   Shifted lanes
+         */
+        template<int Bits> UInt4 shiftRight() const {
+            UInt4 result;
+#ifdef DMSTOOLBOX_SSE2
+            result.m_value = _mm_srli_epi32(m_value, Bits);
+#else
+            for (size_t i = 0; i < 4; ++i) {
+                result.m_value[i] = m_value[i] >> Bits;
+            }
+#endif
+            return result;
+        }
+
+        /**
+          Convert to signed unit floats.
+
+          Maps the upper 23 bits of each lane uniformly to -1..1.
+
+          @return                   Float lanes
+         */
+        Float4 toUnitFloat() const {
+            Float4 result;
+#ifdef DMSTOOLBOX_SSE2
+            // Upper bits as mantissa of a float in 1..2
+            __m128i bits = _mm_or_si128(_mm_srli_epi32(m_value, 9), _mm_set1_epi32(0x3f800000));
+            result.m_value = _mm_sub_ps(_mm_mul_ps(_mm_castsi128_ps(bits), _mm_set1_ps(2.0f)), _mm_set1_ps(3.0f));
+#else
+            for (size_t i = 0; i < 4; ++i) {
+                result.m_value[i] = float(m_value[i] >> 9) * (2.0f / 8388608.0f) - 1.0f;
+            }
+#endif
+            return result;
+        }
+
+        /// Exclusive or of vectors
+        friend UInt4 operator^(const UInt4& a, const UInt4& b) {
+            UInt4 result;
+#ifdef DMSTOOLBOX_SSE2
+            result.m_value = _mm_xor_si128(a.m_value, b.m_value);
+#else
+            for (size_t i = 0; i < 4; ++i) {
+                result.m_value[i] = a.m_value[i] ^ b.m_value[i];
+            }
+#endif
+            return result;
+        }
+
+    private:
+#ifdef DMSTOOLBOX_SSE2
+        __m128i     m_value;                ///< Lane values
+#else
+        uint32_t    m_value[4];             ///< Lane values
+#endif
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
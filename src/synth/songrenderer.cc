@@ -0,0 +1,194 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/songrenderer.hh>
+#include <synth/threadpool.hh>
+#include <cmath>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Number of blocks per chunk
+const size_t SongRenderer::ChunkBlocks;
+
+// Number of MIDI channels
+static const size_t NumChannels = 16;
+
+// Frames per block
+static const size_t BlockSize = Engine::DefaultBlockSize;
+
+// Frames per chunk
+static const size_t ChunkSize = SongRenderer::ChunkBlocks * BlockSize;
+
+// Controller numbers of channel mode messages
+static const uint8_t AllSoundOffController = 120;
+static const uint8_t AllNotesOffController = 123;
+
+// Prepare song
+SongRenderer::SongRenderer(const MidiFile& song, const Resolver& resolver, float sampleRate, size_t numVoices)
+    : m_sampleRate(sampleRate)
+    , m_channels()
+    , m_lastBlock(0)
+{
+    std::unique_ptr<Channel> channels[NumChannels];
+    uint8_t programs[NumChannels] = { 0 };
+    for (const auto& i : song.getEvents()) {
+        uint8_t number = i.m_status & 0x0f;
+        uint64_t block = uint64_t(std::floor(i.m_time * sampleRate + 0.5)) / BlockSize;
+        Event event = { block, Type::NoteOn, i.m_data1, i.m_data2, nullptr };
+        switch (i.m_status & 0xf0) {
+            case 0x80:
+                event.m_type = Type::NoteOff;
+                break;
+            case 0x90:
+                event.m_type = i.m_data2 != 0 ? Type::NoteOn : Type::NoteOff;
+                break;
+            case 0xb0:
+                if (i.m_data1 == AllSoundOffController) {
+                    event.m_type = Type::AllSoundOff;
+                }
+                else if (i.m_data1 == AllNotesOffController) {
+                    event.m_type = Type::AllNotesOff;
+                }
+                else {
+                    continue;
+                }
+                break;
+            case 0xc0:
+                event.m_type = Type::Program;
+                programs[number] = i.m_data1;
+                break;
+            default:
+                continue;
+        }
+
+        // Channels are set up with their initial program on their first event
+        std::unique_ptr<Channel>& channel = channels[number];
+        if (channel == nullptr) {
+            channel.reset(new Channel());
+            channel->m_number = number;
+            channel->m_engine.reset(new Engine(numVoices, sampleRate, BlockSize));
+            channel->m_instrument = resolver(number, 0);
+            channel->m_left.resize(ChunkSize);
+            channel->m_right.resize(ChunkSize);
+        }
+        if (event.m_type == Type::Program) {
+            event.m_instrument = resolver(number, programs[number]);
+        }
+        channel->m_events.push_back(event);
+        m_lastBlock = block;
+    }
+
+    for (size_t i = 0; i < NumChannels; ++i) {
+        if (channels[i] != nullptr) {
+            m_channels.push_back(std::move(channels[i]));
+        }
+    }
+}
+
+// Render song
+uint64_t SongRenderer::render(ThreadPool& pool, const Sink& sink, double maxTail)
+{
+    std::vector<float> left(ChunkSize);
+    std::vector<float> right(ChunkSize);
+    uint64_t endBlock = m_lastBlock + 1 + uint64_t(maxTail * m_sampleRate) / BlockSize;
+    uint64_t block = 0;
+    while (block < endBlock) {
+        for (auto& i : m_channels) {
+            Channel* channel = i.get();
+            pool.submit([this, channel, block] { renderChunk(*channel, block); });
+        }
+        pool.wait();
+
+        // Sum in fixed order, floating point addition is not associative
+        std::fill(left.begin(), left.end(), 0.0f);
+        std::fill(right.begin(), right.end(), 0.0f);
+        bool active = false;
+        for (auto& i : m_channels) {
+            for (size_t j = 0; j < ChunkSize; ++j) {
+                left[j] += i->m_left[j];
+                right[j] += i->m_right[j];
+            }
+            active = active || i->m_engine->getNumActive() != 0;
+        }
+
+        // Stop at the first silent chunk after the last event
+        size_t blocks = size_t(std::min(endBlock - block, uint64_t(ChunkBlocks)));
+        block += blocks;
+        sink(left.data(), right.data(), blocks * BlockSize);
+        if (block > m_lastBlock && !active) {
+            break;
+        }
+    }
+    return block * BlockSize;
+}
+
+// Render chunk of channel
+void SongRenderer::renderChunk(Channel& channel, uint64_t firstBlock)
+{
+    for (size_t i = 0; i < ChunkBlocks; ++i) {
+        while (channel.m_next < channel.m_events.size() && channel.m_events[channel.m_next].m_block <= firstBlock + i) {
+            apply(channel, channel.m_events[channel.m_next++]);
+        }
+        channel.m_engine->render(&(channel.m_left[i * BlockSize]), &(channel.m_right[i * BlockSize]), BlockSize);
+    }
+}
+
+// Pass event to engine
+void SongRenderer::apply(Channel& channel, const Event& event)
+{
+    switch (event.m_type) {
+        case Type::NoteOn:
+            channel.m_engine->noteOn(channel.m_number, event.m_note, event.m_velocity, channel.m_instrument);
+            break;
+        case Type::NoteOff:
+            channel.m_engine->noteOff(channel.m_number, event.m_note);
+            break;
+        case Type::Program:
+            channel.m_instrument = event.m_instrument;
+            break;
+        case Type::AllNotesOff:
+            channel.m_engine->allNotesOff();
+            break;
+        case Type::AllSoundOff:
+            channel.m_engine->reset();
+            break;
+    }
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
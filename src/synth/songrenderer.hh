@@ -0,0 +1,164 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <synth/engine.hh>
+#include <synth/midifile.hh>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Forward declarations
+class ThreadPool;
+
+/**
+  @ingroup synth_group
+
+  Offline MIDI song renderer.
+
+  Plays a MidiFile through one render Engine per used MIDI channel, so every channel has its own voice pool and
+  WersiVoice processor like a manual of the organ. The instruments are resolved from the channel programs before
+  rendering starts. Events are quantized to blocks of Engine::DefaultBlockSize frames, and the song is rendered in
+  chunks of several blocks: the channels of a chunk are rendered in parallel on a ThreadPool and then summed in
+  channel order, so the output does not depend on the number of threads or on timing.
+ */
+class SongRenderer {
+    public:
+        /// Returns the instrument for a program on a channel, null to mute
+        typedef std::function<std::shared_ptr<const Instrument>(uint8_t channel, uint8_t program)> Resolver;
+
+        /// Receives rendered stereo samples
+        typedef std::function<void(const float* left, const float* right, size_t frames)> Sink;
+
+        /// Number of blocks rendered per chunk
+        static const size_t ChunkBlocks = 32;
+
+        /**
+          Create song renderer.
+
+          Prepares the events of the song. Channels start with program 0 until a program change is received.
+
+          @param[in]    song        MIDI song
+          @param[in]    resolver    Instrument resolver, only called from the constructor
+          @param[in]    sampleRate  Sample rate in Hz
+          @param[in]    numVoices   Number of voices per channel
+         */
+        SongRenderer(const MidiFile& song, const Resolver& resolver, float sampleRate, size_t numVoices);
+
+        /**
+          Render song.
+
+          Renders the whole song and passes it to the sink chunk by chunk. After the last event, rendering continues
+          until all voices have ended, but not longer than the given tail.
+
+          @param[in]    pool        Thread pool rendering the channels
+          @param[in]    sink        Receiver of the rendered samples
+          @param[in]    maxTail     Maximum length after the last event in seconds
+
+          @return                   Number of rendered frames
+         */
+        uint64_t render(ThreadPool& pool, const Sink& sink, double maxTail);
+
+    private:
+        /// Event type
+        enum class Type {
+            NoteOn,                         ///< Start note
+            NoteOff,                        ///< Release note
+            Program,                        ///< Change instrument
+            AllNotesOff,                    ///< Release all notes
+            AllSoundOff                     ///< Stop all voices
+        };
+
+        /// Event of a channel
+        struct Event {
+            uint64_t    m_block;            ///< Block index the event is applied at
+            Type        m_type;             ///< Event type
+            uint8_t     m_note;             ///< Note number
+            uint8_t     m_velocity;         ///< Note velocity
+            std::shared_ptr<const Instrument> m_instrument; ///< Instrument for program changes
+        };
+
+        /// Render state of a used channel
+        struct Channel {
+            uint8_t                 m_number;       ///< MIDI channel number 0..15
+            std::unique_ptr<Engine> m_engine;       ///< Render engine
+            std::vector<Event>      m_events;       ///< Events ordered by block
+            size_t                  m_next;         ///< Index of the next event to apply
+            std::shared_ptr<const Instrument> m_instrument;     ///< Current instrument
+            std::vector<float>      m_left;         ///< Left samples of the current chunk
+            std::vector<float>      m_right;        ///< Right samples of the current chunk
+
+            /// Create unused channel
+            Channel()
+                : m_number(0), m_engine(), m_events(), m_next(0), m_instrument(), m_left(), m_right() {}
+        };
+
+        float                   m_sampleRate;   ///< Sample rate in Hz
+        std::vector<std::unique_ptr<Channel>> m_channels;   ///< Used channels
+        uint64_t                m_lastBlock;    ///< Block of the last event
+
+        /**
+          Render channel chunk.
+
+          Renders one chunk of a channel, applying its events at their blocks.
+
+          @param[in]    channel     Channel
+          @param[in]    firstBlock  Index of the first block of the chunk
+         */
+        void renderChunk(Channel& channel, uint64_t firstBlock);
+
+        /**
+          Apply event.
+
+          Passes an event to the engine of a channel.
+
+          @param[in]    channel     Channel
+          @param[in]    event       Event
+         */
+        static void apply(Channel& channel, const Event& event);
+
+        SongRenderer(const SongRenderer&);              ///< Inhibit copying objects
+        SongRenderer& operator=(const SongRenderer&);   ///< Inhibit copying objects
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,178 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <atomic>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Lock-free single producer single consumer queue.
+
+  Passes values from one thread to another without locks or allocation. All slots are allocated on construction,
+  pushing copies a value into a slot and popping moves it out, so values like shared pointers can be passed as long
+  as copying them does not allocate. Exactly one thread may push and exactly one thread may pop at a time.
+
+  @tparam       T           Value type, must be default constructible and assignable
+ */
+template<typename T> class SpscQueue {
+    public:
+        /**
+          Create queue.
+
+          Allocates all slots.
+
+          @param[in]    capacity    Maximum number of queued values, rounded up to a power of two
+         */
+        explicit SpscQueue(size_t capacity)
+            : m_slots(roundUp(capacity))
+            , m_mask(m_slots.size() - 1)
+            , m_head(0)
+            , m_tail(0)
+        {
+        }
+
+        /**
+          Get capacity.
+
+          Returns the maximum number of queued values.
+
+          @return                   Capacity
+         */
+        size_t getCapacity() const {
+            return m_slots.size();
+        }
+
+        /**
+          Check for full queue.
+
+          Returns true if no value can be pushed, to be called by the producer.
+
+          @return                   True if full
+         */
+        bool isFull() const {
+            return m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_acquire) == m_slots.size();
+        }
+
+        /**
+          Push value.
+
+          Appends a copy of the value, to be called by the producer.
+
+          @param[in]    value       Value
+
+          @return                   False if the queue is full
+         */
+        bool push(const T& value) {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail - m_head.load(std::memory_order_acquire) == m_slots.size()) {
+                return false;
+            }
+            m_slots[tail & m_mask] = value;
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+          Get first value.
+
+          Returns the value that would be popped next, to be called by the consumer.
+
+          @return                   First value or null if the queue is empty
+         */
+        const T* front() const {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_tail.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+            return &(m_slots[head & m_mask]);
+        }
+
+        /**
+          Pop value.
+
+          Removes the first value, to be called by the consumer.
+
+          @param[out]   value       Value
+
+          @return                   False if the queue is empty
+         */
+        bool pop(T& value) {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            value = std::move(m_slots[head & m_mask]);
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        std::vector<T>          m_slots;        ///< Value slots, size is a power of two
+        size_t                  m_mask;         ///< Slot index mask
+        std::atomic<size_t>     m_head;         ///< Number of popped values, written by the consumer
+        std::atomic<size_t>     m_tail;         ///< Number of pushed values, written by the producer
+
+        /**
+          Round up to power of two.
+
+          Returns the smallest power of two not below the given value.
+
+          @param[in]    value       Value
+
+          @return                   Power of two
+         */
+        static size_t roundUp(size_t value) {
+            size_t result = 1;
+            while (result < value) {
+                result <<= 1;
+            }
+            return result;
+        }
+
+        SpscQueue(const SpscQueue&);                ///< Inhibit copying objects
+        SpscQueue& operator=(const SpscQueue&);     ///< Inhibit copying objects
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
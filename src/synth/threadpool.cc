@@ -0,0 +1,189 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/threadpool.hh>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Pool of the worker running on the current thread, null on other threads
+static thread_local ThreadPool* CurrentPool = nullptr;
+
+// Index of the worker running on the current thread
+static thread_local size_t CurrentWorker = 0;
+
+// Create thread pool
+ThreadPool::ThreadPool(size_t numThreads)
+    : m_queues()
+    , m_threads()
+    , m_mutex()
+    , m_wake()
+    , m_done()
+    , m_queued(0)
+    , m_pending(0)
+    , m_next(0)
+    , m_stop(false)
+    , m_error()
+{
+    if (numThreads == 0) {
+        numThreads = std::thread::hardware_concurrency();
+        if (numThreads == 0) {
+            numThreads = 1;
+        }
+    }
+    for (size_t i = 0; i < numThreads; ++i) {
+        m_queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+    for (size_t i = 0; i < numThreads; ++i) {
+        m_threads.push_back(std::thread(&ThreadPool::run, this, i));
+    }
+}
+
+// Destroy thread pool
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_pending == 0; });
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& i : m_threads) {
+        i.join();
+    }
+}
+
+// Queue job
+void ThreadPool::submit(const Job& job)
+{
+    size_t index;
+    if (CurrentPool == this) {
+        index = CurrentWorker;
+    }
+    else {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        index = m_next;
+        m_next = (m_next + 1) % m_queues.size();
+    }
+
+    // Count the job while its queue is locked, so it can't be taken before
+    {
+        std::lock_guard<std::mutex> lock(m_queues[index]->m_mutex);
+        m_queues[index]->m_jobs.push_back(job);
+        std::lock_guard<std::mutex> counterLock(m_mutex);
+        ++m_queued;
+        ++m_pending;
+    }
+    m_wake.notify_one();
+}
+
+// Wait for completion of all jobs
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_pending == 0; });
+    if (m_error) {
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+// Worker main loop
+void ThreadPool::run(size_t index)
+{
+    CurrentPool = this;
+    CurrentWorker = index;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_queued != 0 || m_stop; });
+            if (m_queued == 0) {
+                return;
+            }
+        }
+
+        // Another worker may have been faster
+        Job job;
+        if (!take(index, job)) {
+            continue;
+        }
+
+        std::exception_ptr error;
+        try {
+            job();
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (error && !m_error) {
+            m_error = error;
+        }
+        if (--m_pending == 0) {
+            m_done.notify_all();
+        }
+    }
+}
+
+// Take own or steal foreign job
+bool ThreadPool::take(size_t index, Job& job)
+{
+    for (size_t i = 0; i < m_queues.size(); ++i) {
+        Queue& queue = *(m_queues[(index + i) % m_queues.size()]);
+        std::lock_guard<std::mutex> lock(queue.m_mutex);
+        if (queue.m_jobs.empty()) {
+            continue;
+        }
+        if (i == 0) {
+            job = queue.m_jobs.back();
+            queue.m_jobs.pop_back();
+        }
+        else {
+            job = queue.m_jobs.front();
+            queue.m_jobs.pop_front();
+        }
+        std::lock_guard<std::mutex> counterLock(m_mutex);
+        --m_queued;
+        return true;
+    }
+    return false;
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
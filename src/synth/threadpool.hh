@@ -0,0 +1,160 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Work-stealing thread pool.
+
+  Runs jobs on a fixed number of worker threads. Every worker has its own job queue: jobs submitted from outside
+  are distributed round-robin, jobs submitted by a running job go to the queue of its worker. A worker takes jobs
+  from the back of its own queue and, when that is empty, steals from the front of the other queues, so uneven job
+  lengths still keep all cores busy. Meant for coarse jobs like rendering a note, each job costs a few lock
+  operations.
+ */
+class ThreadPool {
+    public:
+        /// Job function
+        typedef std::function<void()> Job;
+
+        /**
+          Create thread pool.
+
+          Starts the worker threads.
+
+          @param[in]    numThreads  Number of worker threads, 0 for the number of hardware threads
+         */
+        explicit ThreadPool(size_t numThreads = 0);
+
+        /**
+          Destroy thread pool.
+
+          Waits for all submitted jobs and stops the worker threads.
+         */
+        ~ThreadPool();
+
+        /**
+          Get number of threads.
+
+          Returns the number of worker threads.
+
+          @return                   Number of worker threads
+         */
+        size_t getNumThreads() const {
+            return m_threads.size();
+        }
+
+        /**
+          Submit job.
+
+          Queues a job for execution, may be called from running jobs.
+
+          @param[in]    job         Job function
+         */
+        void submit(const Job& job);
+
+        /**
+          Wait for jobs.
+
+          Blocks until all submitted jobs have been run. If jobs threw exceptions, the first one is rethrown. Must not
+          be called from a running job.
+         */
+        void wait();
+
+    private:
+        /// Job queue of a worker
+        struct Queue {
+            std::deque<Job>     m_jobs;         ///< Queued jobs
+            std::mutex          m_mutex;        ///< Protects the jobs
+
+            /// Create empty queue
+            Queue() : m_jobs(), m_mutex() {}
+        };
+
+        std::vector<std::unique_ptr<Queue>> m_queues;   ///< Job queue per worker
+        std::vector<std::thread>    m_threads;  ///< Worker threads
+        std::mutex                  m_mutex;    ///< Protects counters, flags and error
+        std::condition_variable     m_wake;     ///< Signals queued jobs or stop to idle workers
+        std::condition_variable     m_done;     ///< Signals completion of all jobs
+        size_t                      m_queued;   ///< Number of jobs in all queues
+        size_t                      m_pending;  ///< Number of submitted jobs not yet completed
+        size_t                      m_next;     ///< Queue for the next job submitted from outside
+        bool                        m_stop;     ///< Workers shall terminate
+        std::exception_ptr          m_error;    ///< First exception thrown by a job
+
+        /**
+          Run worker.
+
+          Main loop of a worker thread.
+
+          @param[in]    index       Worker index
+         */
+        void run(size_t index);
+
+        /**
+          Take job.
+
+          Takes the newest job of the own queue or steals the oldest job of another queue.
+
+          @param[in]    index       Worker index
+          @param[out]   job         Taken job
+
+          @return                   True if a job has been taken
+         */
+        bool take(size_t index, Job& job);
+
+        ThreadPool(const ThreadPool&);              ///< Inhibit copying objects
+        ThreadPool& operator=(const ThreadPool&);   ///< Inhibit copying objects
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,356 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/vcfbank.hh>
+#include <synth/simd.hh>
+#include <cmath>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Frames between control points
+const size_t VcfBank::ControlBlock;
+
+// Pi
+static const float Pi = 3.14159265358979f;
+
+// Cutoff range of the VCF frequency value in semitones, each direction from 1 kHz
+static const float CutoffRange = 60.0f;
+
+// Range of the VCF envelope offsets and intensities in semitones, each direction
+static const float EnvelopeRange = 48.0f;
+
+// Shortest and longest VCF envelope segment time in seconds
+static const float MinTime = 0.002f;
+static const float MaxTime = 10.0f;
+
+// State values below this are flushed to zero, avoiding denormals in decaying filters
+static const float StateThreshold = 1e-20f;
+
+// Soft clipper, rational approximation of tanh(2 * x)
+static inline Float4 distort(const Float4& x)
+{
+    Float4 d = min(max(x * Float4(2.0f), Float4(-3.0f)), Float4(3.0f));
+    Float4 d2 = d * d;
+    return d * (Float4(27.0f) + d2) / (Float4(27.0f) + Float4(9.0f) * d2);
+}
+
+// State-variable filter stage, returns the low pass or the peak normalized band pass output per lane
+static inline Float4 filter(const Float4& in, const Float4& a1, const Float4& a2, const Float4& a3,
+                            const Float4& damping, const Float4& lowPass, Float4& ic1, Float4& ic2)
+{
+    Float4 v3 = in - ic2;
+    Float4 v1 = a1 * ic1 + a2 * v3;
+    Float4 v2 = ic2 + a2 * ic1 + a3 * v3;
+    ic1 = Float4(2.0f) * v1 - ic1;
+    ic2 = Float4(2.0f) * v2 - ic2;
+    Float4 band = v1 * damping;
+    return band + (v2 - band) * lowPass;
+}
+
+// Create VCF filter bank
+VcfBank::VcfBank(size_t numVoices, float sampleRate)
+    : m_sampleRate(sampleRate)
+    , m_settings((numVoices + 3) & ~size_t(3), VcfSettings())
+    , m_active(m_settings.size(), 0)
+    , m_released(m_settings.size(), 0)
+    , m_segment(m_settings.size(), Segment::T2End)
+    , m_time(m_settings.size(), 0.0f)
+    , m_key(m_settings.size(), 0.0f)
+    , m_coeff(m_settings.size(), 0.0f)
+    , m_damping(m_settings.size(), 2.0f)
+    , m_lowPass(m_settings.size(), 1.0f)
+    , m_fourPoles(m_settings.size(), 0.0f)
+    , m_drive(m_settings.size(), 0.0f)
+    , m_state(m_settings.size() * 4, 0.0f)
+    , m_groupVoices(m_settings.size() / 4, 0)
+{
+}
+
+// Compile VCF settings
+VcfSettings VcfBank::compile(const Wersi::Vcf& vcf)
+{
+    VcfSettings settings;
+    settings.m_lowPass      = vcf.getLowPass();
+    settings.m_fourPoles    = vcf.getFourPoles();
+    settings.m_distortion   = vcf.getDistortion();
+    settings.m_tracking     = vcf.getTracking();
+    settings.m_cutoff       = float(vcf.getFrequency()) * CutoffRange / 127.0f;
+    settings.m_damping      = 2.0f - 1.95f * float(vcf.getQuality()) / 255.0f;
+    settings.m_mode         = vcf.getEnvelopeMode();
+
+    // Times are exponential over the whole byte range
+    const uint8_t times[2] = { vcf.getT1Time(), vcf.getT2Time() };
+    const int8_t offsets[2] = { vcf.getT1Offset(), vcf.getT2Offset() };
+    const int8_t intensities[2] = { vcf.getT1Intensity(), vcf.getT2Intensity() };
+    for (size_t i = 0; i < 2; ++i) {
+        settings.m_time[i]      = MinTime * std::pow(MaxTime / MinTime, float(times[i]) / 255.0f);
+        settings.m_offset[i]    = float(offsets[i]) * EnvelopeRange / 127.0f;
+        settings.m_intensity[i] = float(intensities[i]) * EnvelopeRange / 127.0f;
+    }
+    return settings;
+}
+
+// Start voice
+void VcfBank::start(size_t voice, const VcfSettings& settings, uint8_t note)
+{
+    if (m_active[voice] == 0) {
+        ++m_groupVoices[voice / 4];
+    }
+    m_settings[voice]   = settings;
+    m_active[voice]     = 1;
+    m_released[voice]   = 0;
+    m_segment[voice]    = Segment::T1;
+    m_time[voice]       = 0.0f;
+    m_key[voice]        = settings.m_tracking ? float(note) - 60.0f : 0.0f;
+    m_damping[voice]    = settings.m_damping;
+    m_lowPass[voice]    = settings.m_lowPass ? 1.0f : 0.0f;
+    m_fourPoles[voice]  = settings.m_fourPoles ? 1.0f : 0.0f;
+    m_drive[voice]      = settings.m_distortion ? 1.0f : 0.0f;
+    m_coeff[voice]      = computeCoeff(voice);
+    for (size_t i = 0; i < 4; ++i) {
+        m_state[i * m_settings.size() + voice] = 0.0f;
+    }
+}
+
+// Release voice
+void VcfBank::release(size_t voice)
+{
+    m_released[voice] = 1;
+}
+
+// Stop voice
+void VcfBank::stop(size_t voice)
+{
+    if (m_active[voice] != 0) {
+        --m_groupVoices[voice / 4];
+        m_active[voice] = 0;
+    }
+}
+
+// Get current cutoff
+float VcfBank::getCutoff(size_t voice) const
+{
+    return std::atan(m_coeff[voice]) * m_sampleRate / Pi;
+}
+
+// Process all active groups
+void VcfBank::process(float* data, size_t frames)
+{
+    const size_t groups = m_groupVoices.size();
+    for (size_t group = 0; group < groups; ) {
+        if (m_groupVoices[group] == 0) {
+            ++group;
+        }
+        else if (group + 1 < groups && m_groupVoices[group + 1] != 0) {
+            processGroups<2>(group, data + group * frames * 4, frames);
+            group += 2;
+        }
+        else {
+            processGroups<1>(group, data + group * frames * 4, frames);
+            ++group;
+        }
+    }
+}
+
+// Get envelope level of voice
+float VcfBank::getLevel(size_t voice) const
+{
+    const VcfSettings& settings = m_settings[voice];
+    switch (m_segment[voice]) {
+        case Segment::T1:
+            return settings.m_offset[0] + settings.m_intensity[0] * m_time[voice] / settings.m_time[0];
+        case Segment::T1End:
+            return settings.m_offset[0] + settings.m_intensity[0];
+        case Segment::T2:
+            return settings.m_offset[1] + settings.m_intensity[1] * m_time[voice] / settings.m_time[1];
+        default:
+            return settings.m_offset[1] + settings.m_intensity[1];
+    }
+}
+
+// Advance envelope of voice
+void VcfBank::advance(size_t voice, float seconds)
+{
+    const VcfSettings& settings = m_settings[voice];
+    Segment& segment = m_segment[voice];
+    float& time = m_time[voice];
+    switch (segment) {
+        case Segment::T1:
+            time += seconds;
+            if (time >= settings.m_time[0]) {
+                time = 0.0f;
+                switch (settings.m_mode) {
+                    case Wersi::Vcf::EnvelopeMode::T1:
+                        segment = Segment::T1End;
+                        break;
+                    case Wersi::Vcf::EnvelopeMode::T1RT2:
+                        segment = m_released[voice] != 0 ? Segment::T2 : Segment::T1End;
+                        break;
+                    default:
+                        segment = Segment::T2;
+                        break;
+                }
+            }
+            break;
+        case Segment::T1End:
+            // Only T1->Release->T2 continues from here
+            if (settings.m_mode == Wersi::Vcf::EnvelopeMode::T1RT2 && m_released[voice] != 0) {
+                segment = Segment::T2;
+                time = 0.0f;
+            }
+            break;
+        case Segment::T2:
+            time += seconds;
+            if (time >= settings.m_time[1]) {
+                time = 0.0f;
+                // The rotor mode alternates between both segments
+                segment = settings.m_mode == Wersi::Vcf::EnvelopeMode::Rotor ? Segment::T1 : Segment::T2End;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Compute filter coefficient for current cutoff
+float VcfBank::computeCoeff(size_t voice) const
+{
+    float semitones = m_settings[voice].m_cutoff + m_key[voice] + getLevel(voice);
+    float cutoff = 1000.0f * std::pow(2.0f, semitones / 12.0f);
+    if (cutoff < 20.0f) {
+        cutoff = 20.0f;
+    }
+    else if (cutoff > 0.45f * m_sampleRate) {
+        cutoff = 0.45f * m_sampleRate;
+    }
+    return std::tan(Pi * cutoff / m_sampleRate);
+}
+
+// Filter the voices of consecutive groups
+template<size_t Width> void VcfBank::processGroups(size_t first, float* data, size_t frames)
+{
+    const size_t lanes = Width * 4;
+    const size_t base = first * 4;
+    const size_t stride = m_settings.size();
+    bool fourPoles = false;
+    bool distortion = false;
+    float wet[lanes];
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        wet[lane] = m_active[base + lane] != 0 ? 1.0f : 0.0f;
+        fourPoles |= m_active[base + lane] != 0 && m_fourPoles[base + lane] != 0.0f;
+        distortion |= m_active[base + lane] != 0 && m_drive[base + lane] != 0.0f;
+    }
+
+    Float4 mix[Width], damping[Width], lowPass[Width], fourPole[Width], drive[Width];
+    Float4 ic1a[Width], ic2a[Width], ic1b[Width], ic2b[Width];
+    for (size_t w = 0; w < Width; ++w) {
+        size_t v = base + w * 4;
+        mix[w] = Float4::load(&(wet[w * 4]));
+        damping[w] = Float4::load(&(m_damping[v]));
+        lowPass[w] = Float4::load(&(m_lowPass[v]));
+        fourPole[w] = Float4::load(&(m_fourPoles[v]));
+        drive[w] = Float4::load(&(m_drive[v]));
+        ic1a[w] = Float4::load(&(m_state[v]));
+        ic2a[w] = Float4::load(&(m_state[stride + v]));
+        ic1b[w] = Float4::load(&(m_state[2 * stride + v]));
+        ic2b[w] = Float4::load(&(m_state[3 * stride + v]));
+    }
+
+    for (size_t done = 0; done < frames; ) {
+        size_t count = frames - done < ControlBlock ? frames - done : ControlBlock;
+
+        // Evaluate envelopes at the next control point, interpolate the coefficient up to there
+        float start[lanes];
+        float step[lanes];
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            size_t voice = base + lane;
+            start[lane] = m_coeff[voice];
+            if (m_active[voice] != 0) {
+                advance(voice, float(count) / m_sampleRate);
+                m_coeff[voice] = computeCoeff(voice);
+            }
+            step[lane] = (m_coeff[voice] - start[lane]) / float(count);
+        }
+        Float4 g[Width], dg[Width];
+        for (size_t w = 0; w < Width; ++w) {
+            g[w] = Float4::load(&(start[w * 4]));
+            dg[w] = Float4::load(&(step[w * 4]));
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t w = 0; w < Width; ++w) {
+                float* ptr = data + (w * frames + done + i) * 4;
+                Float4 in = Float4::load(ptr);
+                Float4 x = in;
+                if (distortion) {
+                    x += (distort(x) - x) * drive[w];
+                }
+                g[w] += dg[w];
+                Float4 a1 = (Float4(1.0f) + g[w] * (g[w] + damping[w])).reciprocal();
+                Float4 a2 = g[w] * a1;
+                Float4 a3 = g[w] * a2;
+                Float4 y = filter(x, a1, a2, a3, damping[w], lowPass[w], ic1a[w], ic2a[w]);
+                if (fourPoles) {
+                    Float4 y2 = filter(y, a1, a2, a3, damping[w], lowPass[w], ic1b[w], ic2b[w]);
+                    y += (y2 - y) * fourPole[w];
+                }
+                (in + (y - in) * mix[w]).store(ptr);
+            }
+        }
+        done += count;
+    }
+
+    for (size_t w = 0; w < Width; ++w) {
+        size_t v = base + w * 4;
+        ic1a[w].store(&(m_state[v]));
+        ic2a[w].store(&(m_state[stride + v]));
+        ic1b[w].store(&(m_state[2 * stride + v]));
+        ic2b[w].store(&(m_state[3 * stride + v]));
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            float& state = m_state[i * stride + base + lane];
+            if (std::fabs(state) < StateThreshold) {
+                state = 0.0f;
+            }
+        }
+    }
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,251 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <wersi/vcf.hh>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Compiled VCF settings.
+
+  The parameters of a Wersi VCF block converted to the units used by VcfBank. Cutoff values are given in semitones
+  relative to 1 kHz, times in seconds. Index 0 of the envelope arrays holds the T1 segment, index 1 the T2 segment.
+ */
+struct VcfSettings {
+    bool                    m_lowPass;      ///< Low pass if true, band pass otherwise
+    bool                    m_fourPoles;    ///< Four poles if true, two poles otherwise
+    bool                    m_distortion;   ///< Input distortion enabled
+    bool                    m_tracking;     ///< Cutoff follows note
+    float                   m_cutoff;       ///< Base cutoff in semitones relative to 1 kHz
+    float                   m_damping;      ///< Filter damping, 2 for no resonance down to self oscillation
+    Wersi::Vcf::EnvelopeMode m_mode;        ///< Envelope mode
+    float                   m_time[2];      ///< Segment times in seconds
+    float                   m_offset[2];    ///< Segment start levels in semitones
+    float                   m_intensity[2]; ///< Segment level changes in semitones
+};
+
+/**
+  @ingroup synth_group
+
+  VCF filter bank.
+
+  Filters a fixed number of voices four at a time, one voice per SIMD lane, using the same group-interleaved layout as
+  OscillatorBank. Two active groups are processed together. Each voice is a state-variable filter with a cascaded second
+  stage for four poles. Cutoff is modulated by the VCF envelope: the T1 and T2 segments are evaluated at a control rate
+  and the filter coefficient is interpolated linearly per sample in between. Low/band pass, pole count and distortion
+  may differ between the lanes of a group, so voices can be assigned freely.
+ */
+class VcfBank {
+    public:
+        /**
+          Create VCF filter bank.
+
+          Creates a filter bank with all voices stopped.
+
+          @param[in]    numVoices   Number of voices, rounded up to a multiple of four
+          @param[in]    sampleRate  Sample rate in Hz
+         */
+        VcfBank(size_t numVoices, float sampleRate);
+
+        /**
+          Compile VCF settings.
+
+          Converts the parameters of a VCF block.
+
+          @param[in]    vcf         VCF block
+
+          @return                   Compiled settings
+         */
+        static VcfSettings compile(const Wersi::Vcf& vcf);
+
+        /**
+          Get number of voices.
+
+          Returns the number of voices, which is always a multiple of four.
+
+          @return                   Number of voices
+         */
+        size_t getNumVoices() const {
+            return m_settings.size();
+        }
+
+        /**
+          Start voice.
+
+          Clears the filter state of the voice and starts its envelope at T1.
+
+          @param[in]    voice       Voice index
+          @param[in]    settings    Compiled VCF settings
+          @param[in]    note        MIDI note number, used for cutoff tracking
+         */
+        void start(size_t voice, const VcfSettings& settings, uint8_t note);
+
+        /**
+          Release voice.
+
+          Signals note-off to the envelope of the voice, which matters for the T1->Release->T2 mode.
+
+          @param[in]    voice       Voice index
+         */
+        void release(size_t voice);
+
+        /**
+          Stop voice.
+
+          Stops filtering the voice, its samples pass unchanged while other voices of its group are active.
+
+          @param[in]    voice       Voice index
+         */
+        void stop(size_t voice);
+
+        /**
+          Check for active voice.
+
+          Returns true if the voice is being filtered.
+
+          @param[in]    voice       Voice index
+
+          @return                   True if active
+         */
+        bool isActive(size_t voice) const {
+            return m_active[voice] != 0;
+        }
+
+        /**
+          Get current cutoff.
+
+          Returns the cutoff frequency of the voice at the last control point.
+
+          @param[in]    voice       Voice index
+
+          @return                   Cutoff frequency in Hz
+         */
+        float getCutoff(size_t voice) const;
+
+        /**
+          Process voices.
+
+          Filters the given number of frames in place. The buffer layout is the one written by
+          OscillatorBank::render(), groups without active voices are left untouched.
+
+          @param[in,out] data       Sample buffer
+          @param[in]    frames      Number of frames to process
+         */
+        void process(float* data, size_t frames);
+
+    private:
+        /// Envelope segment
+        enum class Segment {
+            T1,                             ///< Running T1 segment
+            T1End,                          ///< Holding the T1 end level
+            T2,                             ///< Running T2 segment
+            T2End                           ///< Holding the T2 end level
+        };
+
+        /// Frames between control points
+        static const size_t ControlBlock = 32;
+
+        float                       m_sampleRate;   ///< Sample rate in Hz
+        std::vector<VcfSettings>    m_settings;     ///< Settings per voice
+        std::vector<uint8_t>        m_active;       ///< Voice active flags
+        std::vector<uint8_t>        m_released;     ///< Voice released flags
+        std::vector<Segment>        m_segment;      ///< Envelope segment per voice
+        std::vector<float>          m_time;         ///< Time spent in segment per voice
+        std::vector<float>          m_key;          ///< Tracking offset in semitones per voice
+        std::vector<float>          m_coeff;        ///< Filter coefficient at last control point per voice
+        std::vector<float>          m_damping;      ///< Damping per voice
+        std::vector<float>          m_lowPass;      ///< 1 for low pass, 0 for band pass per voice
+        std::vector<float>          m_fourPoles;    ///< 1 for four poles, 0 for two poles per voice
+        std::vector<float>          m_drive;        ///< 1 for distortion, 0 for clean per voice
+        std::vector<float>          m_state;        ///< Filter state, four values per voice
+        std::vector<uint8_t>        m_groupVoices;  ///< Number of active voices per group
+
+        /**
+          Get envelope level.
+
+          Returns the current VCF envelope level of a voice.
+
+          @param[in]    voice       Voice index
+
+          @return                   Level in semitones
+         */
+        float getLevel(size_t voice) const;
+
+        /**
+          Advance envelope.
+
+          Advances the VCF envelope of a voice.
+
+          @param[in]    voice       Voice index
+          @param[in]    seconds     Time to advance
+         */
+        void advance(size_t voice, float seconds);
+
+        /**
+          Compute coefficient.
+
+          Computes the filter coefficient for the current cutoff of a voice.
+
+          @param[in]    voice       Voice index
+
+          @return                   Filter coefficient
+         */
+        float computeCoeff(size_t voice) const;
+
+        /**
+          Process groups.
+
+          Filters the voices of consecutive groups. Processing two groups at once interleaves two independent
+          filter chains, which hides most of the latency of the recursive filter.
+
+          @tparam       Width       Number of groups
+          @param[in]    first       Index of the first group
+          @param[in,out] data       Sample buffer of the first group
+          @param[in]    frames      Number of frames to process
+         */
+        template<size_t Width> void processGroups(size_t first, float* data, size_t frames);
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,196 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/voiceallocator.hh>
+#include <cmath>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Pitch table bounds
+const int VoiceAllocator::LowestNote;
+const size_t VoiceAllocator::NumNotes;
+
+// Create voice allocator
+VoiceAllocator::VoiceAllocator(size_t numVoices, StealMode mode, float tuning)
+    : m_voices(numVoices, Voice())
+    , m_stealMode(mode)
+    , m_counter(0)
+    , m_numActive(0)
+    , m_notes()
+    , m_detune()
+{
+    for (size_t i = 0; i < NumNotes; ++i) {
+        m_notes[i] = tuning * std::pow(2.0f, (float(int(i) + LowestNote) - 69.0f) / 12.0f);
+    }
+    for (size_t i = 0; i < 256; ++i) {
+        m_detune[i] = std::pow(2.0f, float(int8_t(uint8_t(i))) / 1200.0f);
+    }
+}
+
+// Note on
+size_t VoiceAllocator::noteOn(uint8_t channel, uint8_t note, uint8_t velocity, const Patch& patch, size_t* voices)
+{
+    ++m_counter;
+    size_t started = 0;
+    for (size_t i = 0; i < patch.getNumLayers(); ++i) {
+        const Patch::Layer& layer = patch.getLayer(i);
+        if (!Patch::isPlaying(layer, velocity)) {
+            continue;
+        }
+        size_t index = findVoice(channel, note, layer.m_icb);
+        if (index == m_voices.size()) {
+            continue;
+        }
+
+        Voice& voice = m_voices[index];
+        if (!voice.m_active) {
+            ++m_numActive;
+        }
+        int pitch = int(note) + layer.m_transpose;
+        voice.m_active      = true;
+        voice.m_released    = false;
+        voice.m_channel     = channel;
+        voice.m_note        = note;
+        voice.m_velocity    = velocity;
+        voice.m_pitch       = uint8_t(pitch < 0 ? 0 : (pitch > 127 ? 127 : pitch));
+        voice.m_frequency   = getNoteFrequency(pitch) * m_detune[uint8_t(layer.m_detune)];
+        voice.m_age         = m_counter;
+        voice.m_layer       = layer;
+        voices[started++] = index;
+    }
+    return started;
+}
+
+// Note off
+size_t VoiceAllocator::noteOff(uint8_t channel, uint8_t note, size_t* voices)
+{
+    size_t released = 0;
+    for (size_t i = 0; i < m_voices.size(); ++i) {
+        Voice& voice = m_voices[i];
+        if (voice.m_active && !voice.m_released && voice.m_channel == channel && voice.m_note == note) {
+            voice.m_released = true;
+            voices[released++] = i;
+        }
+    }
+    return released;
+}
+
+// Free voice
+void VoiceAllocator::free(size_t voice)
+{
+    if (m_voices[voice].m_active) {
+        m_voices[voice].m_active = false;
+        --m_numActive;
+    }
+}
+
+// Free all voices
+void VoiceAllocator::reset()
+{
+    for (size_t i = 0; i < m_voices.size(); ++i) {
+        m_voices[i].m_active = false;
+    }
+    m_numActive = 0;
+}
+
+// Get note frequency from pitch table
+float VoiceAllocator::getNoteFrequency(int note) const
+{
+    int index = note - LowestNote;
+    if (index < 0) {
+        index = 0;
+    }
+    else if (index >= int(NumNotes)) {
+        index = int(NumNotes) - 1;
+    }
+    return m_notes[index];
+}
+
+// Find voice for new layer
+size_t VoiceAllocator::findVoice(uint8_t channel, uint8_t note, uint8_t icb) const
+{
+    size_t freeVoice = m_voices.size();
+    size_t victim = m_voices.size();
+    for (size_t i = 0; i < m_voices.size(); ++i) {
+        const Voice& voice = m_voices[i];
+        if (!voice.m_active) {
+            if (freeVoice == m_voices.size()) {
+                freeVoice = i;
+            }
+            continue;
+        }
+
+        // Retrigger the same layer of the same note
+        if (voice.m_channel == channel && voice.m_note == note && voice.m_layer.m_icb == icb
+            && voice.m_age != m_counter) {
+            return i;
+        }
+
+        // Never steal a voice started by the current note
+        if (m_stealMode == StealMode::None || voice.m_age == m_counter) {
+            continue;
+        }
+
+        // Released voices go first, then the steal mode decides
+        if (victim == m_voices.size()) {
+            victim = i;
+            continue;
+        }
+        const Voice& current = m_voices[victim];
+        if (voice.m_released != current.m_released) {
+            if (voice.m_released) {
+                victim = i;
+            }
+        }
+        else if (m_stealMode == StealMode::Quietest && voice.m_velocity != current.m_velocity) {
+            if (voice.m_velocity < current.m_velocity) {
+                victim = i;
+            }
+        }
+        else if (voice.m_age < current.m_age) {
+            victim = i;
+        }
+    }
+    if (freeVoice != m_voices.size()) {
+        return freeVoice;
+    }
+    return victim;
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
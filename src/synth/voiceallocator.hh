@@ -0,0 +1,227 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <synth/patch.hh>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Polyphonic voice allocator.
+
+  Assigns the layers of played notes to a fixed pool of voices. On note-on, every layer of the patch whose dynamics
+  gate opens gets a voice, with its pitch taken from precomputed note and detune tables. If the pool is exhausted,
+  a voice is stolen according to the steal mode; released voices are always stolen before held ones. Replaying a
+  sounding note retriggers its voices instead of allocating new ones. All memory is reserved on construction, so
+  the note functions can be called from an audio callback.
+
+  The allocator only does the bookkeeping: callers start, release and stop the voices of the render banks with the
+  indices it reports, and free voices whose envelopes have finished.
+ */
+class VoiceAllocator {
+    public:
+        /// Steal mode
+        enum class StealMode {
+            None,                           ///< Don't steal, drop layers when the pool is exhausted
+            Oldest,                         ///< Steal the voice started first
+            Quietest                        ///< Steal the voice with the lowest velocity
+        };
+
+        /// State of a voice
+        struct Voice {
+            bool            m_active;       ///< Voice is allocated
+            bool            m_released;     ///< Note-off has been received
+            uint8_t         m_channel;      ///< MIDI channel
+            uint8_t         m_note;         ///< Played MIDI note
+            uint8_t         m_velocity;     ///< Note velocity
+            uint8_t         m_pitch;        ///< Transposed note, clamped to 0..127, selects the wave range
+            float           m_frequency;    ///< Frequency in Hz including transpose and detune
+            uint64_t        m_age;          ///< Note-on counter value at start
+            Patch::Layer    m_layer;        ///< Played layer
+        };
+
+        /**
+          Create voice allocator.
+
+          Creates the voice pool and the pitch tables.
+
+          @param[in]    numVoices   Number of voices
+          @param[in]    mode        Steal mode
+          @param[in]    tuning      Frequency of A4 in Hz
+         */
+        VoiceAllocator(size_t numVoices, StealMode mode = StealMode::Oldest, float tuning = 440.0f);
+
+        /**
+          Get number of voices.
+
+          Returns the size of the voice pool.
+
+          @return                   Number of voices
+         */
+        size_t getNumVoices() const {
+            return m_voices.size();
+        }
+
+        /**
+          Set steal mode.
+
+          Selects how voices are stolen when the pool is exhausted.
+
+          @param[in]    mode        Steal mode
+         */
+        void setStealMode(StealMode mode) {
+            m_stealMode = mode;
+        }
+
+        /**
+          Get voice.
+
+          Returns the state of a voice.
+
+          @param[in]    voice       Voice index
+
+          @return                   Voice state
+         */
+        const Voice& getVoice(size_t voice) const {
+            return m_voices[voice];
+        }
+
+        /**
+          Get number of active voices.
+
+          Returns the number of allocated voices.
+
+          @return                   Number of active voices
+         */
+        size_t getNumActive() const {
+            return m_numActive;
+        }
+
+        /**
+          Note on.
+
+          Allocates voices for all playing layers of the patch. The indices of the started voices are written to the
+          given array, which must hold at least Patch::MaxLayers entries. Stolen or retriggered voices are reported
+          as started, callers simply restart them.
+
+          @param[in]    channel     MIDI channel
+          @param[in]    note        MIDI note number
+          @param[in]    velocity    Note velocity 1..127
+          @param[in]    patch       Played patch
+          @param[out]   voices      Indices of started voices
+
+          @return                   Number of started voices
+         */
+        size_t noteOn(uint8_t channel, uint8_t note, uint8_t velocity, const Patch& patch, size_t* voices);
+
+        /**
+          Note off.
+
+          Marks the voices of a note as released. The indices of the released voices are written to the given array,
+          which must hold at least getNumVoices() entries.
+
+          @param[in]    channel     MIDI channel
+          @param[in]    note        MIDI note number
+          @param[out]   voices      Indices of released voices
+
+          @return                   Number of released voices
+         */
+        size_t noteOff(uint8_t channel, uint8_t note, size_t* voices);
+
+        /**
+          Free voice.
+
+          Returns a voice to the pool, to be called when its amplitude envelope has finished.
+
+          @param[in]    voice       Voice index
+         */
+        void free(size_t voice);
+
+        /**
+          Free all voices.
+
+          Returns all voices to the pool.
+         */
+        void reset();
+
+        /**
+          Get note frequency.
+
+          Returns the frequency of a note from the pitch table.
+
+          @param[in]    note        MIDI note number, may be outside 0..127 after transposing
+
+          @return                   Frequency in Hz
+         */
+        float getNoteFrequency(int note) const;
+
+    private:
+        /// Lowest note of the pitch table, allows transposing note 0 down by 128 semitones
+        static const int LowestNote = -128;
+
+        /// Number of pitch table entries, allows transposing note 127 up by 127 semitones
+        static const size_t NumNotes = 383;
+
+        std::vector<Voice>  m_voices;               ///< Voice pool
+        StealMode           m_stealMode;            ///< Steal mode
+        uint64_t            m_counter;              ///< Note-on counter
+        size_t              m_numActive;            ///< Number of allocated voices
+        float               m_notes[NumNotes];      ///< Frequency per note from LowestNote on
+        float               m_detune[256];          ///< Frequency ratio per detune value, indexed as uint8_t
+
+        /**
+          Find voice.
+
+          Finds a voice for a new layer: a retriggered one, a free one or a stolen one.
+
+          @param[in]    channel     MIDI channel
+          @param[in]    note        MIDI note number
+          @param[in]    icb         ICB of the layer
+
+          @return                   Voice index or getNumVoices() if none is available
+         */
+        size_t findVoice(uint8_t channel, uint8_t note, uint8_t icb) const;
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,354 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/wavefitter.hh>
+#include <synth/wavespectrum.hh>
+#include <synth/threadpool.hh>
+#include <wersi/wave.hh>
+#include <exceptions.hh>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Pi
+static const double Pi = 3.14159265358979323846;
+
+// Lowest and highest detected fundamental in Hz
+static const float MinFrequency = 30.0f;
+static const float MaxFrequency = 2000.0f;
+
+// YIN threshold of the normalized difference accepting a period
+static const float YinThreshold = 0.15f;
+
+// Number of samples the fundamental is detected from, at most
+static const size_t DetectionLength = 16384;
+
+// Analysis frames per thread pool job
+static const size_t JobFrames = 16;
+
+// Frames quieter than this relative to the loudest frame are not used, -40 dB
+static const double SilenceEnergy = 1e-4;
+
+// Factor the normal matrix in place into its lower triangular Cholesky factor
+static void factor(std::vector<double>& matrix, size_t size)
+{
+    // A tiny ridge keeps the factor defined if harmonics close to Nyquist are nearly dependent
+    double ridge = 0.0;
+    for (size_t i = 0; i < size; ++i) {
+        ridge += matrix[i * size + i];
+    }
+    ridge *= 1e-12 / double(size);
+    for (size_t j = 0; j < size; ++j) {
+        double diagonal = matrix[j * size + j] + ridge;
+        for (size_t k = 0; k < j; ++k) {
+            diagonal -= matrix[j * size + k] * matrix[j * size + k];
+        }
+        diagonal = std::sqrt(std::max(diagonal, 1e-30));
+        matrix[j * size + j] = diagonal;
+        for (size_t i = j + 1; i < size; ++i) {
+            double value = matrix[i * size + j];
+            for (size_t k = 0; k < j; ++k) {
+                value -= matrix[i * size + k] * matrix[j * size + k];
+            }
+            matrix[i * size + j] = value / diagonal;
+        }
+    }
+}
+
+// Solve the factored normal equations in place
+static void solve(const std::vector<double>& factored, size_t size, double* values)
+{
+    for (size_t i = 0; i < size; ++i) {
+        for (size_t k = 0; k < i; ++k) {
+            values[i] -= factored[i * size + k] * values[k];
+        }
+        values[i] /= factored[i * size + i];
+    }
+    for (size_t i = size; i-- > 0; ) {
+        for (size_t k = i + 1; k < size; ++k) {
+            values[i] -= factored[k * size + i] * values[k];
+        }
+        values[i] /= factored[i * size + i];
+    }
+}
+
+// Create wave fitter
+WaveFitter::WaveFitter(ThreadPool& pool, const Settings& settings)
+    : m_pool(pool)
+    , m_settings(settings)
+{
+    m_settings.m_periods = std::max(m_settings.m_periods, size_t(2));
+}
+
+// Detect fundamental frequency with YIN
+float WaveFitter::detectFrequency(const float* samples, size_t count, float sampleRate)
+{
+    size_t minLag = std::max(size_t(sampleRate / MaxFrequency), size_t(2));
+    size_t maxLag = size_t(sampleRate / MinFrequency);
+    if (count < 2 * minLag + 2) {
+        return 0.0f;
+    }
+    maxLag = std::min(maxLag, count / 2);
+    size_t window = count - maxLag;
+
+    // Cumulative mean normalized difference, lag 0 is 1 by definition
+    std::vector<float> difference(maxLag + 1, 1.0f);
+    double sum = 0.0;
+    for (size_t lag = 1; lag <= maxLag; ++lag) {
+        double d = 0.0;
+        for (size_t i = 0; i < window; ++i) {
+            double delta = double(samples[i]) - double(samples[i + lag]);
+            d += delta * delta;
+        }
+        sum += d;
+        difference[lag] = sum > 0.0 ? float(d * double(lag) / sum) : 1.0f;
+    }
+
+    // First dip below the threshold, or the deepest one if there is none
+    size_t best = 0;
+    for (size_t lag = minLag; lag < maxLag; ++lag) {
+        if (difference[lag] < YinThreshold) {
+            while (lag + 1 < maxLag && difference[lag + 1] < difference[lag]) {
+                ++lag;
+            }
+            best = lag;
+            break;
+        }
+        if (best == 0 || difference[lag] < difference[best]) {
+            best = lag;
+        }
+    }
+    if (best == 0 || difference[best] > 0.5f) {
+        return 0.0f;
+    }
+
+    // Parabolic interpolation between the neighbouring lags
+    float period = float(best);
+    if (best > 1 && best < maxLag) {
+        float a = difference[best - 1];
+        float b = difference[best];
+        float c = difference[best + 1];
+        float denominator = a - 2.0f * b + c;
+        if (denominator > 0.0f) {
+            period += 0.5f * (a - c) / denominator;
+        }
+    }
+    return sampleRate / period;
+}
+
+// Analyze recording
+WaveFitter::Analysis WaveFitter::analyze(const std::vector<float>& samples, float sampleRate) const
+{
+    size_t begin = std::min(samples.size(), size_t(m_settings.m_start * sampleRate));
+    size_t end = samples.size();
+    if (m_settings.m_length > 0.0f) {
+        end = std::min(end, begin + size_t(m_settings.m_length * sampleRate));
+    }
+
+    Analysis analysis = { m_settings.m_frequency, 0, 0, 0.0f, std::vector<WaveSynthesizer::Harmonic>() };
+    if (analysis.m_frequency <= 0.0f) {
+        analysis.m_frequency = detectFrequency(&(samples[begin]), std::min(end - begin, DetectionLength),
+                                               sampleRate);
+    }
+    if (analysis.m_frequency <= 0.0f) {
+        throw DataFormatException("No fundamental frequency found");
+    }
+    double note = 69.0 + 12.0 * std::log2(double(analysis.m_frequency) / 440.0);
+    analysis.m_note = uint8_t(std::min(std::max(std::floor(note + 0.5), 0.0), 127.0));
+
+    size_t frameLength = size_t(double(m_settings.m_periods) * sampleRate / analysis.m_frequency + 0.5);
+    size_t numHarmonics = std::min(WaveSpectrum::MaxHarmonics - 1, size_t(0.45f * sampleRate / analysis.m_frequency));
+    numHarmonics = std::min(numHarmonics, (frameLength - 1) / 2);
+    if (numHarmonics == 0 || end - begin < frameLength) {
+        throw DataFormatException("Recording too short for analysis");
+    }
+
+    // Cosine and sine of every harmonic, the Hann weighted normal matrix is factored once for all frames
+    const size_t size = 2 * numHarmonics;
+    const double omega = 2.0 * Pi * double(analysis.m_frequency) / double(sampleRate);
+    std::vector<double> weights(frameLength);
+    std::vector<double> basis(size * frameLength);
+    for (size_t n = 0; n < frameLength; ++n) {
+        weights[n] = 0.5 - 0.5 * std::cos(2.0 * Pi * (double(n) + 0.5) / double(frameLength));
+        for (size_t h = 0; h < numHarmonics; ++h) {
+            basis[(2 * h) * frameLength + n] = std::cos(double(h + 1) * omega * double(n));
+            basis[(2 * h + 1) * frameLength + n] = std::sin(double(h + 1) * omega * double(n));
+        }
+    }
+    std::vector<double> normal(size * size);
+    for (size_t i = 0; i < size; ++i) {
+        for (size_t j = 0; j <= i; ++j) {
+            double value = 0.0;
+            for (size_t n = 0; n < frameLength; ++n) {
+                value += weights[n] * basis[i * frameLength + n] * basis[j * frameLength + n];
+            }
+            normal[i * size + j] = value;
+            normal[j * size + i] = value;
+        }
+    }
+    factor(normal, size);
+
+    // Fit all frames in parallel, each job writes its own frames only
+    const size_t hop = frameLength / 2;
+    const size_t numFrames = (end - begin - frameLength) / hop + 1;
+    std::vector<double> coefs(numFrames * size);
+    std::vector<double> energy(numFrames);
+    std::vector<double> explained(numFrames);
+    for (size_t first = 0; first < numFrames; first += JobFrames) {
+        m_pool.submit([&, first] {
+            std::vector<double> weighted(frameLength);
+            size_t last = std::min(first + JobFrames, numFrames);
+            for (size_t frame = first; frame < last; ++frame) {
+                const float* x = &(samples[begin + frame * hop]);
+                double e = 0.0;
+                for (size_t n = 0; n < frameLength; ++n) {
+                    weighted[n] = weights[n] * double(x[n]);
+                    e += weighted[n] * double(x[n]);
+                }
+                double* c = &(coefs[frame * size]);
+                for (size_t i = 0; i < size; ++i) {
+                    const double* row = &(basis[i * frameLength]);
+                    double value = 0.0;
+                    for (size_t n = 0; n < frameLength; ++n) {
+                        value += row[n] * weighted[n];
+                    }
+                    c[i] = value;
+                }
+                std::vector<double> projection(c, c + size);
+                solve(normal, size, c);
+                double fitted = 0.0;
+                for (size_t i = 0; i < size; ++i) {
+                    fitted += projection[i] * c[i];
+                }
+                energy[frame] = e;
+                explained[frame] = fitted;
+            }
+        });
+    }
+    m_pool.wait();
+
+    // Average magnitudes by energy and phases relative to the fundamental over the frames which are not silent
+    double maxEnergy = *std::max_element(energy.begin(), energy.end());
+    std::vector<double> power(numHarmonics + 1, 0.0);
+    std::vector<std::complex<double>> phasors(numHarmonics + 1);
+    double totalEnergy = 0.0;
+    double totalResidual = 0.0;
+    for (size_t frame = 0; frame < numFrames; ++frame) {
+        if (energy[frame] <= maxEnergy * SilenceEnergy || energy[frame] <= 0.0) {
+            continue;
+        }
+        const double* c = &(coefs[frame * size]);
+        double fundamental = -std::atan2(c[1], c[0]);
+        for (size_t h = 1; h <= numHarmonics; ++h) {
+            double magnitude = std::hypot(c[2 * h - 2], c[2 * h - 1]);
+            double phase = -std::atan2(c[2 * h - 1], c[2 * h - 2]) - double(h) * fundamental;
+            power[h] += magnitude * magnitude;
+            phasors[h] += std::polar(magnitude, phase);
+        }
+        totalEnergy += energy[frame];
+        totalResidual += std::max(energy[frame] - explained[frame], 0.0);
+        ++analysis.m_numFrames;
+    }
+    if (analysis.m_numFrames == 0) {
+        throw DataFormatException("Recording is silent");
+    }
+
+    WaveSynthesizer::Harmonic silent = { 0.0f, 0.0f };
+    analysis.m_harmonics.assign(numHarmonics + 1, silent);
+    for (size_t h = 1; h <= numHarmonics; ++h) {
+        analysis.m_harmonics[h].m_magnitude = float(std::sqrt(power[h] / double(analysis.m_numFrames)));
+        analysis.m_harmonics[h].m_phase = float(std::arg(phasors[h]));
+    }
+    analysis.m_residual = float(10.0 * std::log10(std::max(totalResidual / totalEnergy, 1e-12)));
+    return analysis;
+}
+
+// Fit tables and level of wave to analyzed recordings
+void WaveFitter::fit(const std::vector<Analysis>& analyses, WaveSynthesizer::Quantization quantization,
+                     Wersi::Wave& wave)
+{
+    if (analyses.empty()) {
+        return;
+    }
+
+    // Each range takes the recording nearest to its center note
+    std::vector<WaveSynthesizer::Harmonic> sets[WaveTableSet::NumRanges];
+    for (size_t r = 0; r < WaveTableSet::NumRanges; ++r) {
+        double sum = 0.0;
+        size_t count = 0;
+        for (size_t note = 0; note < 128; ++note) {
+            if (static_cast<size_t>(WaveTableSet::getRange(uint8_t(note))) == r) {
+                sum += double(note);
+                ++count;
+            }
+        }
+        double center = count > 0 ? sum / double(count) : double(r * 32);
+        size_t best = 0;
+        for (size_t i = 1; i < analyses.size(); ++i) {
+            if (std::fabs(double(analyses[i].m_note) - center) < std::fabs(double(analyses[best].m_note) - center)) {
+                best = i;
+            }
+        }
+        sets[r] = analyses[best].m_harmonics;
+    }
+    WaveSynthesizer synthesizer(quantization, true);
+    synthesizer.synthesize(sets, wave);
+
+    // Least squares gain from the quantized tables to the recorded level
+    double correlation = 0.0;
+    double norm = 0.0;
+    for (size_t r = 0; r < WaveTableSet::NumRanges; ++r) {
+        WaveTableSet::Range range = static_cast<WaveTableSet::Range>(r);
+        float model[64];
+        WaveSynthesizer::render(sets[r], range, model);
+        const uint8_t* raw = WaveTableSet::getRawTable(wave, range);
+        for (size_t i = 0; i < WaveTableSet::getLength(range); ++i) {
+            double table = (double(raw[i]) - 128.0) / 128.0;
+            correlation += double(model[i]) * table;
+            norm += table * table;
+        }
+    }
+    double level = norm > 0.0 ? 127.0 * correlation / norm : 0.0;
+    wave.setLevel(uint8_t(std::min(std::max(std::floor(level + 0.5), 0.0), 127.0)));
+    wave.update();
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,149 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <synth/wavesynthesizer.hh>
+#include <vector>
+
+namespace DMSToolbox {
+
+// Forward declarations
+namespace Wersi {
+class Wave;
+} // namespace Wersi
+
+namespace Synth {
+
+// Forward declarations
+class ThreadPool;
+
+/**
+  @ingroup synth_group
+
+  Wave fitter.
+
+  Estimates the harmonic spectrum of a recorded note and fits the tables and level of a wave block to it. The steady
+  part of the recording is cut into analysis frames of a few periods, overlapping by half. In each frame, the
+  amplitudes of the cosine and sine components of all harmonics are fitted by weighted least squares with a Hann
+  window. The basis only depends on the fundamental and the frame length, so its normal matrix is factored once and
+  each frame costs a projection and a back substitution, frames are analyzed in parallel on a ThreadPool. Magnitudes
+  are averaged by energy over all frames, phases are taken relative to the fundamental, which makes them independent
+  of the frame position.
+
+  Recordings of notes in different ranges give each range of the wave its own spectrum, ranges without a recording
+  take the one nearest in pitch. The tables are normalized and the wave level is fitted by least squares to the
+  quantized tables, so the wave plays back at the level of the recording.
+ */
+class WaveFitter {
+    public:
+        /// Analysis settings
+        struct Settings {
+            float   m_start;        ///< Start of the analyzed part in seconds, skips the attack
+            float   m_length;       ///< Length of the analyzed part in seconds, 0 up to the end
+            size_t  m_periods;      ///< Periods of the fundamental per analysis frame
+            float   m_frequency;    ///< Fundamental frequency in Hz, 0 to detect it
+        };
+
+        /// Analysis result of one recording
+        struct Analysis {
+            float   m_frequency;    ///< Fundamental frequency in Hz
+            uint8_t m_note;         ///< MIDI note nearest to the fundamental
+            size_t  m_numFrames;    ///< Number of analysis frames used
+            float   m_residual;     ///< Energy not explained by the harmonics relative to the signal in dB
+            std::vector<WaveSynthesizer::Harmonic>  m_harmonics;    ///< Harmonics by number, index 0 is DC
+        };
+
+        /**
+          Create wave fitter.
+
+          @param[in]    pool        Thread pool analyzing the frames
+          @param[in]    settings    Analysis settings
+         */
+        WaveFitter(ThreadPool& pool, const Settings& settings);
+
+        /**
+          Detect fundamental frequency.
+
+          Estimates the fundamental of a periodic signal between 30 Hz and 2 kHz with the YIN difference function.
+
+          @param[in]    samples     Samples
+          @param[in]    count       Number of samples
+          @param[in]    sampleRate  Sample rate in Hz
+
+          @return                   Fundamental frequency in Hz, 0 if the signal is not periodic
+         */
+        static float detectFrequency(const float* samples, size_t count, float sampleRate);
+
+        /**
+          Analyze recording.
+
+          Estimates the harmonic spectrum of a recorded note.
+
+          @param[in]    samples     Mono samples
+          @param[in]    sampleRate  Sample rate in Hz
+
+          @return                   Analysis result
+
+          @exception    DataFormatException No fundamental found or recording too short
+         */
+        Analysis analyze(const std::vector<float>& samples, float sampleRate) const;
+
+        /**
+          Fit wave.
+
+          Synthesizes the tables of a wave block from the analyzed recordings and fits its level. The block is written
+          back with Wave::update().
+
+          @param[in]    analyses    Analysis results, at least one
+          @param[in]    quantization    Quantization of the tables
+          @param[in,out] wave       Wave block
+         */
+        static void fit(const std::vector<Analysis>& analyses, WaveSynthesizer::Quantization quantization,
+                        Wersi::Wave& wave);
+
+    private:
+        ThreadPool&     m_pool;         ///< Thread pool analyzing the frames
+        Settings        m_settings;     ///< Analysis settings
+
+        WaveFitter(const WaveFitter&);              ///< Inhibit copying objects
+        WaveFitter& operator=(const WaveFitter&);   ///< Inhibit copying objects
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
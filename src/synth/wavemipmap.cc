@@ -0,0 +1,131 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/wavemipmap.hh>
+#include <synth/wavespectrum.hh>
+#include <synth/fft.hh>
+#include <wersi/wave.hh>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Table length
+const size_t WaveMipmap::TableLength;
+
+// Create band-limited wave tables
+WaveMipmap::WaveMipmap(const Wersi::Wave& wave)
+    : m_hash(wave.getHash())
+    , m_samples((getFirstTable(WaveTableSet::Range::Soprano) + getNumLevels(WaveTableSet::Range::Soprano))
+                * (TableLength + 1))
+{
+    static const Fft<TableLength> synthesis;
+    const uint8_t* sources[WaveTableSet::NumRanges] = {
+        wave.getBass(), wave.getTenor(), wave.getAlto(), wave.getSoprano()
+    };
+    for (size_t r = 0; r < WaveTableSet::NumRanges; ++r) {
+        WaveTableSet::Range range = static_cast<WaveTableSet::Range>(r);
+        size_t length = WaveTableSet::getLength(range);
+        std::complex<float> bins[WaveSpectrum::MaxHarmonics];
+        WaveSpectrum::analyze(sources[r], length, bins);
+
+        // Resynthesize each level from the truncated spectrum
+        const float scale = float(TableLength) / float(length);
+        for (size_t level = 0; level < getNumLevels(range); ++level) {
+            std::complex<float> data[TableLength];
+            for (size_t h = 1; h <= getMaxHarmonic(range, level); ++h) {
+                data[h] = bins[h] * scale;
+                data[TableLength - h] = std::conj(data[h]);
+            }
+            synthesis.inverse(data);
+            float* table = &(m_samples[(getFirstTable(range) + level) * (TableLength + 1)]);
+            for (size_t i = 0; i < TableLength; ++i) {
+                table[i] = data[i].real();
+            }
+            table[TableLength] = table[0];
+        }
+    }
+}
+
+// Get number of levels
+size_t WaveMipmap::getNumLevels(WaveTableSet::Range range)
+{
+    // One level per power of two from half the table length down to the fundamental
+    size_t levels = 0;
+    for (size_t harmonics = WaveTableSet::getLength(range) / 2; harmonics > 0; harmonics >>= 1) {
+        ++levels;
+    }
+    return levels;
+}
+
+// Get highest harmonic of level
+size_t WaveMipmap::getMaxHarmonic(WaveTableSet::Range range, size_t level)
+{
+    // Level 0 leaves out the Nyquist bin of the original wave, it has no defined phase
+    size_t half = WaveTableSet::getLength(range) / 2;
+    return level == 0 ? half - 1 : half >> level;
+}
+
+// Select level for frequency
+size_t WaveMipmap::getLevel(WaveTableSet::Range range, float increment)
+{
+    size_t levels = getNumLevels(range);
+    for (size_t level = 0; level < levels; ++level) {
+        if (float(getMaxHarmonic(range, level)) * increment < 0.5f) {
+            return level;
+        }
+    }
+    return levels - 1;
+}
+
+// Get table
+const float* WaveMipmap::getTable(WaveTableSet::Range range, size_t level) const
+{
+    return &(m_samples[(getFirstTable(range) + level) * (TableLength + 1)]);
+}
+
+// Get index of level 0 of range
+size_t WaveMipmap::getFirstTable(WaveTableSet::Range range)
+{
+    size_t first = 0;
+    for (size_t r = 0; r < static_cast<size_t>(range); ++r) {
+        first += getNumLevels(static_cast<WaveTableSet::Range>(r));
+    }
+    return first;
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,167 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <synth/wavetableset.hh>
+#include <vector>
+
+namespace DMSToolbox {
+
+// Forward declarations
+namespace Wersi {
+class Wave;
+} // namespace Wersi
+
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Band-limited wave tables.
+
+  Holds band-limited versions of the four PCM waves of a Wersi wave block. For each note range, level 0 contains all
+  harmonics of the original wave and every further level halves the number of harmonics, down to the fundamental
+  alone. All levels are resynthesized from the spectrum of the original wave with TableLength samples, so linear
+  interpolation is accurate and the renderers do nothing but table lookups. The DC component is removed.
+ */
+class WaveMipmap {
+    public:
+        /// Number of samples per table, each table is followed by a copy of its first sample
+        static const size_t TableLength = 256;
+
+        /**
+          Create band-limited wave tables.
+
+          Analyzes the PCM waves of the given wave block and computes all levels.
+
+          @param[in]    wave        Wave block
+         */
+        explicit WaveMipmap(const Wersi::Wave& wave);
+
+        /**
+          Get content hash.
+
+          Returns the content hash of the wave block the tables have been computed from.
+
+          @return                   Content hash
+         */
+        uint64_t getHash() const {
+            return m_hash;
+        }
+
+        /**
+          Get number of levels.
+
+          Returns the number of levels of the given note range.
+
+          @param[in]    range       Note range
+
+          @return                   Number of levels
+         */
+        static size_t getNumLevels(WaveTableSet::Range range);
+
+        /**
+          Get highest harmonic.
+
+          Returns the highest harmonic contained in the given level.
+
+          @param[in]    range       Note range
+          @param[in]    level       Level index
+
+          @return                   Highest harmonic number
+         */
+        static size_t getMaxHarmonic(WaveTableSet::Range range, size_t level);
+
+        /**
+          Select level.
+
+          Returns the first level of the given range without harmonics above the Nyquist frequency. If even the
+          fundamental is too high, the last level is returned.
+
+          @param[in]    range       Note range
+          @param[in]    increment   Fundamental frequency divided by sample rate
+
+          @return                   Level index
+         */
+        static size_t getLevel(WaveTableSet::Range range, float increment);
+
+        /**
+          Get table.
+
+          Returns the samples of the given level.
+
+          @param[in]    range       Note range
+          @param[in]    level       Level index
+
+          @return                   Pointer to TableLength + 1 samples
+         */
+        const float* getTable(WaveTableSet::Range range, size_t level) const;
+
+        /**
+          Get table for frequency.
+
+          Returns the samples of the level suitable for the given frequency.
+
+          @param[in]    range       Note range
+          @param[in]    increment   Fundamental frequency divided by sample rate
+
+          @return                   Pointer to TableLength + 1 samples
+         */
+        const float* getTable(WaveTableSet::Range range, float increment) const {
+            return getTable(range, getLevel(range, increment));
+        }
+
+    private:
+        uint64_t            m_hash;         ///< Content hash of the wave block
+        std::vector<float>  m_samples;      ///< Tables of all ranges and levels
+
+        /**
+          Get first table index.
+
+          Returns the index of level 0 of the given range among all tables.
+
+          @param[in]    range       Note range
+
+          @return                   Table index
+         */
+        static size_t getFirstTable(WaveTableSet::Range range);
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
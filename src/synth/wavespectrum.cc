@@ -0,0 +1,101 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/wavespectrum.hh>
+#include <synth/fft.hh>
+#include <wersi/wave.hh>
+#include <cmath>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Maximum number of harmonics per range
+const size_t WaveSpectrum::MaxHarmonics;
+
+// Transform one PCM wave of fixed length, returns bins 0..N/2
+template<size_t N> static void transform(const uint8_t* wave, std::complex<float>* bins)
+{
+    static const Fft<N> fft;
+    std::complex<float> data[N];
+    for (size_t i = 0; i < N; ++i) {
+        data[i] = std::complex<float>((float(wave[i]) - 128.0f) / 128.0f, 0.0f);
+    }
+    fft.forward(data);
+    for (size_t i = 0; i <= N / 2; ++i) {
+        bins[i] = data[i];
+    }
+}
+
+// Create wave spectrum
+WaveSpectrum::WaveSpectrum(const Wersi::Wave& wave)
+    : m_hash(wave.getHash())
+    , m_magnitude()
+    , m_phase()
+{
+    for (size_t r = 0; r < WaveTableSet::NumRanges; ++r) {
+        WaveTableSet::Range range = static_cast<WaveTableSet::Range>(r);
+        size_t length = WaveTableSet::getLength(range);
+        std::complex<float> bins[MaxHarmonics];
+        analyze(WaveTableSet::getRawTable(wave, range), length, bins);
+
+        // Bins other than DC and Nyquist carry half of the amplitude, the other half is in the mirrored bin
+        for (size_t h = 0; h <= length / 2; ++h) {
+            float scale = (h == 0 || h == length / 2 ? 1.0f : 2.0f) / float(length);
+            m_magnitude[r][h] = std::abs(bins[h]) * scale;
+            m_phase[r][h] = m_magnitude[r][h] > 0.0f ? std::arg(bins[h]) : 0.0f;
+        }
+    }
+}
+
+// Analyze PCM wave of 16, 32 or 64 samples
+void WaveSpectrum::analyze(const uint8_t* wave, size_t length, std::complex<float>* bins)
+{
+    switch (length) {
+        case 64:
+            transform<64>(wave, bins);
+            break;
+        case 32:
+            transform<32>(wave, bins);
+            break;
+        default:
+            transform<16>(wave, bins);
+            break;
+    }
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,148 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <synth/wavetableset.hh>
+#include <complex>
+
+namespace DMSToolbox {
+
+// Forward declarations
+namespace Wersi {
+class Wave;
+} // namespace Wersi
+
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Harmonic spectrum of a wave.
+
+  Holds magnitude and phase of all harmonics of the four PCM waves of a Wersi wave block, harmonic 0 being the DC
+  component and the last one the Nyquist bin. Each wave is a single period, so an FFT of its length yields the
+  harmonics directly, the transforms are specialized at compile time for 16, 32 and 64 samples. Magnitudes are
+  amplitudes of the cosine components with samples mapped from 0..255 to -1..1, so a full-scale sine has magnitude 1.
+  Phases are in radians relative to a cosine starting at the first sample.
+ */
+class WaveSpectrum {
+    public:
+        /// Maximum number of harmonics per range, including DC
+        static const size_t MaxHarmonics = 64 / 2 + 1;
+
+        /**
+          Create wave spectrum.
+
+          Analyzes the PCM waves of the given wave block.
+
+          @param[in]    wave        Wave block
+         */
+        explicit WaveSpectrum(const Wersi::Wave& wave);
+
+        /**
+          Analyze PCM wave.
+
+          Transforms one period of unsigned 8 bit samples and returns the unscaled FFT bins 0..length / 2.
+
+          @param[in]    wave        PCM samples
+          @param[in]    length      Number of samples, 16, 32 or 64
+          @param[out]   bins        length / 2 + 1 FFT bins
+         */
+        static void analyze(const uint8_t* wave, size_t length, std::complex<float>* bins);
+
+        /**
+          Get content hash.
+
+          Returns the content hash of the wave block the spectrum has been computed from.
+
+          @return                   Content hash
+         */
+        uint64_t getHash() const {
+            return m_hash;
+        }
+
+        /**
+          Get number of harmonics.
+
+          Returns the number of harmonics of the given range including DC, which is half the table length plus one.
+
+          @param[in]    range       Note range
+
+          @return                   Number of harmonics
+         */
+        static size_t getNumHarmonics(WaveTableSet::Range range) {
+            return WaveTableSet::getLength(range) / 2 + 1;
+        }
+
+        /**
+          Get magnitude.
+
+          Returns the amplitude of a harmonic.
+
+          @param[in]    range       Note range
+          @param[in]    harmonic    Harmonic number, 0 for DC
+
+          @return                   Amplitude
+         */
+        float getMagnitude(WaveTableSet::Range range, size_t harmonic) const {
+            return m_magnitude[static_cast<size_t>(range)][harmonic];
+        }
+
+        /**
+          Get phase.
+
+          Returns the phase of a harmonic.
+
+          @param[in]    range       Note range
+          @param[in]    harmonic    Harmonic number, 0 for DC
+
+          @return                   Phase in radians -pi..pi
+         */
+        float getPhase(WaveTableSet::Range range, size_t harmonic) const {
+            return m_phase[static_cast<size_t>(range)][harmonic];
+        }
+
+    private:
+        uint64_t    m_hash;                                             ///< Content hash of the wave block
+        float       m_magnitude[WaveTableSet::NumRanges][MaxHarmonics]; ///< Amplitude per range and harmonic
+        float       m_phase[WaveTableSet::NumRanges][MaxHarmonics];     ///< Phase per range and harmonic
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
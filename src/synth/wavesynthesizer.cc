@@ -0,0 +1,162 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/wavesynthesizer.hh>
+#include <synth/fft.hh>
+#include <wersi/wave.hh>
+#include <algorithm>
+#include <cmath>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Largest sample value, samples map from 0..255 to -1..1 like in WaveSpectrum
+static const float FullScale = 127.0f / 128.0f;
+
+// Inverse transform of one table of fixed length
+template<size_t N> static void transform(const std::vector<WaveSynthesizer::Harmonic>& harmonics, float* samples)
+{
+    static const Fft<N> fft;
+    std::complex<float> data[N];
+    size_t count = std::min(harmonics.size(), N / 2 + 1);
+    for (size_t h = 0; h < count; ++h) {
+        const WaveSynthesizer::Harmonic& harmonic = harmonics[h];
+        if (h == 0 || h == N / 2) {
+            data[h] = std::complex<float>(float(N) * harmonic.m_magnitude * std::cos(harmonic.m_phase), 0.0f);
+        }
+        else {
+            data[h] = std::polar(float(N) * 0.5f * harmonic.m_magnitude, harmonic.m_phase);
+            data[N - h] = std::conj(data[h]);
+        }
+    }
+    fft.inverse(data);
+    for (size_t i = 0; i < N; ++i) {
+        samples[i] = data[i].real();
+    }
+}
+
+// Create additive wave synthesizer
+WaveSynthesizer::WaveSynthesizer(Quantization quantization, bool normalize)
+    : m_quantization(quantization)
+    , m_normalize(normalize)
+{
+}
+
+// Synthesize all tables of wave from one harmonic set
+float WaveSynthesizer::synthesize(const std::vector<Harmonic>& harmonics, Wersi::Wave& wave) const
+{
+    const std::vector<Harmonic>* sets[WaveTableSet::NumRanges] = {
+        &harmonics, &harmonics, &harmonics, &harmonics
+    };
+    return synthesizeTables(sets, wave);
+}
+
+// Synthesize all tables of wave from one harmonic set per range
+float WaveSynthesizer::synthesize(const std::vector<Harmonic>* harmonics, Wersi::Wave& wave) const
+{
+    const std::vector<Harmonic>* sets[WaveTableSet::NumRanges] = {
+        &(harmonics[0]), &(harmonics[1]), &(harmonics[2]), &(harmonics[3])
+    };
+    return synthesizeTables(sets, wave);
+}
+
+// Render, normalize and quantize tables of all ranges
+float WaveSynthesizer::synthesizeTables(const std::vector<Harmonic>* const* harmonics, Wersi::Wave& wave) const
+{
+    float tables[WaveTableSet::NumRanges][64];
+    float peak = 0.0f;
+    for (size_t r = 0; r < WaveTableSet::NumRanges; ++r) {
+        WaveTableSet::Range range = static_cast<WaveTableSet::Range>(r);
+        render(*(harmonics[r]), range, tables[r]);
+        for (size_t i = 0; i < WaveTableSet::getLength(range); ++i) {
+            peak = std::max(peak, std::fabs(tables[r][i]));
+        }
+    }
+
+    // One gain for all ranges, so notes keep their level across range boundaries
+    float gain = m_normalize && peak > 0.0f ? FullScale / peak : 1.0f;
+    uint8_t* targets[WaveTableSet::NumRanges] = {
+        wave.getBass(), wave.getTenor(), wave.getAlto(), wave.getSoprano()
+    };
+    for (size_t r = 0; r < WaveTableSet::NumRanges; ++r) {
+        size_t length = WaveTableSet::getLength(static_cast<WaveTableSet::Range>(r));
+        for (size_t i = 0; i < length; ++i) {
+            tables[r][i] *= gain;
+        }
+        quantize(tables[r], length, m_quantization, targets[r]);
+    }
+    wave.update();
+    return gain;
+}
+
+// Render one table from the harmonics it can hold
+void WaveSynthesizer::render(const std::vector<Harmonic>& harmonics, WaveTableSet::Range range, float* samples)
+{
+    switch (WaveTableSet::getLength(range)) {
+        case 64:
+            transform<64>(harmonics, samples);
+            break;
+        case 32:
+            transform<32>(harmonics, samples);
+            break;
+        default:
+            transform<16>(harmonics, samples);
+            break;
+    }
+}
+
+// Quantize one period to unsigned 8 bit samples
+void WaveSynthesizer::quantize(const float* samples, size_t length, Quantization quantization, uint8_t* raw)
+{
+    // The error of the first pass settles the feedback, the second pass around the loop is kept
+    size_t passes = quantization == Quantization::NoiseShaped ? 2 : 1;
+    float error = 0.0f;
+    for (size_t pass = 0; pass < passes; ++pass) {
+        for (size_t i = 0; i < length; ++i) {
+            float target = samples[i] * 128.0f + 128.0f;
+            if (quantization == Quantization::NoiseShaped) {
+                target -= error;
+            }
+            float value = std::min(std::max(std::floor(target + 0.5f), 0.0f), 255.0f);
+            error = std::min(std::max(value - target, -1.0f), 1.0f);
+            raw[i] = uint8_t(value);
+        }
+    }
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
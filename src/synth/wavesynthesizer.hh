@@ -0,0 +1,157 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <synth/wavetableset.hh>
+#include <vector>
+
+namespace DMSToolbox {
+
+// Forward declarations
+namespace Wersi {
+class Wave;
+} // namespace Wersi
+
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Additive wave synthesizer.
+
+  Generates the four PCM waves of a Wersi wave block from harmonic amplitudes and phases, the inverse of
+  WaveSpectrum. Each table is computed by an inverse FFT of its own length, specialized at compile time for 16, 32
+  and 64 points, so harmonics above half the table length are left out automatically and the shorter tables of the
+  higher ranges never alias. The result is quantized to the unsigned 8 bit samples of the wave block, optionally with
+  noise shaping, which moves the quantization error from the low harmonics carrying most of the sound to the highest
+  harmonics of each table.
+ */
+class WaveSynthesizer {
+    public:
+        /// Quantization to 8 bit samples
+        enum class Quantization {
+            Round,                          ///< Round to the nearest value
+            NoiseShaped                     ///< Feed back the error, shaping it towards high harmonics
+        };
+
+        /// Harmonic of a wave
+        struct Harmonic {
+            float   m_magnitude;            ///< Amplitude, a full-scale sine has 1
+            float   m_phase;                ///< Phase in radians relative to a cosine
+        };
+
+        /**
+          Create additive wave synthesizer.
+
+          @param[in]    quantization    Quantization to 8 bit samples
+          @param[in]    normalize       Scale all tables by a common gain, so the loudest one uses the full range
+         */
+        explicit WaveSynthesizer(Quantization quantization = Quantization::Round, bool normalize = false);
+
+        /**
+          Synthesize wave.
+
+          Replaces the four PCM waves of a wave block and writes the block back with Wave::update(), so caches keyed
+          by the content hash pick up the new waves. Level and fixed formant data are left untouched. Samples beyond
+          full scale are clipped unless normalizing.
+
+          @param[in]    harmonics   Harmonics by number, index 0 is the DC component
+          @param[in,out] wave       Wave block
+
+          @return                   Gain applied when normalizing, 1 otherwise
+         */
+        float synthesize(const std::vector<Harmonic>& harmonics, Wersi::Wave& wave) const;
+
+        /**
+          Synthesize wave per range.
+
+          Like synthesize() with a single harmonic set, but each range gets its own harmonics, for instance
+          taken from recordings of notes in that range.
+
+          @param[in]    harmonics   WaveTableSet::NumRanges harmonic sets, one per range in range order
+          @param[in,out] wave       Wave block
+
+          @return                   Gain applied when normalizing, 1 otherwise
+         */
+        float synthesize(const std::vector<Harmonic>* harmonics, Wersi::Wave& wave) const;
+
+        /**
+          Render table.
+
+          Computes one period of a table from the harmonics below its Nyquist frequency, the Nyquist harmonic itself
+          only contributes its cosine part.
+
+          @param[in]    harmonics   Harmonics by number, index 0 is the DC component
+          @param[in]    range       Note range selecting the table length
+          @param[out]   samples     getLength() samples in -1..1 for full scale
+         */
+        static void render(const std::vector<Harmonic>& harmonics, WaveTableSet::Range range, float* samples);
+
+        /**
+          Quantize table.
+
+          Converts one period to unsigned 8 bit samples, clipping at full scale. With noise shaping, the error is
+          fed back around the period, as the table is played as a loop.
+
+          @param[in]    samples     Samples in -1..1 for full scale
+          @param[in]    length      Number of samples
+          @param[in]    quantization    Quantization mode
+          @param[out]   raw         Unsigned 8 bit samples
+         */
+        static void quantize(const float* samples, size_t length, Quantization quantization, uint8_t* raw);
+
+    private:
+        Quantization    m_quantization;     ///< Quantization to 8 bit samples
+        bool            m_normalize;        ///< Normalize tables to full scale
+
+        /**
+          Synthesize tables.
+
+          Renders, normalizes and quantizes the tables of all ranges and updates the wave block.
+
+          @param[in]    harmonics   Harmonic set per range
+          @param[in,out] wave       Wave block
+
+          @return                   Gain applied when normalizing, 1 otherwise
+         */
+        float synthesizeTables(const std::vector<Harmonic>* const* harmonics, Wersi::Wave& wave) const;
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
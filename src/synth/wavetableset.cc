@@ -0,0 +1,137 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/wavetableset.hh>
+#include <wersi/wave.hh>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Table lengths per range
+static const size_t Lengths[] = { 64, 64, 32, 16 };
+
+// Table offsets per range
+static const size_t Offsets[] = { 0, 65, 130, 163 };
+
+// First MIDI note per range, the DMS switches tables every octave starting at C3
+static const uint8_t FirstNotes[] = { 0, 48, 60, 72 };
+
+// Create silent wave table set
+WaveTableSet::WaveTableSet()
+    : m_samples()
+{
+}
+
+// Create wave table set from wave
+WaveTableSet::WaveTableSet(const Wersi::Wave& wave)
+    : m_samples()
+{
+    const uint8_t* sources[NumRanges] = { wave.getBass(), wave.getTenor(), wave.getAlto(), wave.getSoprano() };
+    for (size_t range = 0; range < NumRanges; ++range) {
+        float* table = &(m_samples[Offsets[range]]);
+        for (size_t i = 0; i < Lengths[range]; ++i) {
+            table[i] = (float(sources[range][i]) - 128.0f) / 128.0f;
+        }
+        table[Lengths[range]] = table[0];
+    }
+}
+
+// Get table
+const float* WaveTableSet::getTable(Range range) const
+{
+    return &(m_samples[Offsets[static_cast<size_t>(range)]]);
+}
+
+// Get table length
+size_t WaveTableSet::getLength(Range range)
+{
+    return Lengths[static_cast<size_t>(range)];
+}
+
+// Get raw table of wave block
+const uint8_t* WaveTableSet::getRawTable(const Wersi::Wave& wave, Range range)
+{
+    switch (range) {
+        case Range::Tenor:
+            return wave.getTenor();
+            break;
+        case Range::Alto:
+            return wave.getAlto();
+            break;
+        case Range::Soprano:
+            return wave.getSoprano();
+            break;
+        default:
+            return wave.getBass();
+            break;
+    }
+}
+
+// Get range of note
+WaveTableSet::Range WaveTableSet::getRange(uint8_t note)
+{
+    size_t range = NumRanges - 1;
+    while (range > 0 && note < FirstNotes[range]) {
+        --range;
+    }
+    return static_cast<Range>(range);
+}
+
+// Get range name
+std::string WaveTableSet::getRangeName(Range range)
+{
+    switch (range) {
+        case Range::Bass:
+            return std::string("Bass");
+            break;
+        case Range::Tenor:
+            return std::string("Tenor");
+            break;
+        case Range::Alto:
+            return std::string("Alto");
+            break;
+        case Range::Soprano:
+            return std::string("Soprano");
+            break;
+        default:
+            return std::string();
+            break;
+    }
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
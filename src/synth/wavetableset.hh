@@ -0,0 +1,154 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <string>
+
+namespace DMSToolbox {
+
+// Forward declarations
+namespace Wersi {
+class Wave;
+} // namespace Wersi
+
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  Wave table set.
+
+  Holds the four PCM waves of a Wersi wave block converted to floating point, ready for interpolated lookup. Like
+  the DMS, a note plays one of the tables depending on its range: lower notes use the longer tables with more
+  harmonics, higher notes the shorter ones. Each table is followed by a copy of its first sample, so interpolation
+  never needs to wrap the index.
+ */
+class WaveTableSet {
+    public:
+        /// Note range
+        enum class Range {
+            Bass,                           ///< 64-sample bass wave
+            Tenor,                          ///< 64-sample tenor wave
+            Alto,                           ///< 32-sample alto wave
+            Soprano                         ///< 16-sample soprano wave
+        };
+
+        /// Number of note ranges
+        static const size_t NumRanges = 4;
+
+        /**
+          Create silent wave table set.
+
+          Creates a wave table set with all samples set to zero.
+         */
+        WaveTableSet();
+
+        /**
+          Create wave table set from wave.
+
+          Converts the PCM waves of the given wave block. Samples are mapped from 0..255 to -1..1, the wave level is
+          not applied.
+
+          @param[in]    wave        Wave block to convert
+         */
+        explicit WaveTableSet(const Wersi::Wave& wave);
+
+        /**
+          Get table.
+
+          Returns the samples of the given range, followed by a copy of the first sample.
+
+          @param[in]    range       Note range
+
+          @return                   Pointer to getLength() + 1 samples
+         */
+        const float* getTable(Range range) const;
+
+        /**
+          Get table length.
+
+          Returns the number of samples of one period of the given range.
+
+          @param[in]    range       Note range
+
+          @return                   Number of samples
+         */
+        static size_t getLength(Range range);
+
+        /**
+          Get raw table.
+
+          Returns the unsigned 8 bit samples of the given range as stored in the wave block, for fixed point
+          rendering.
+
+          @param[in]    wave        Wave block
+          @param[in]    range       Note range
+
+          @return                   Pointer to getLength() samples
+         */
+        static const uint8_t* getRawTable(const Wersi::Wave& wave, Range range);
+
+        /**
+          Get range of note.
+
+          Returns the range a MIDI note is played with.
+
+          @param[in]    note        MIDI note number
+
+          @return                   Note range
+         */
+        static Range getRange(uint8_t note);
+
+        /**
+          Get range name.
+
+          Returns the name of the given note range.
+
+          @param[in]    range       Note range
+
+          @return                   Range name
+         */
+        static std::string getRangeName(Range range);
+
+    private:
+        float   m_samples[64 + 1 + 64 + 1 + 32 + 1 + 16 + 1];  ///< Tables of all ranges
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,163 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/wavreader.hh>
+#include <exceptions.hh>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Format tags
+static const uint16_t FormatPcm = 1;
+static const uint16_t FormatFloat = 3;
+static const uint16_t FormatExtensible = 0xfffe;
+
+// Load little endian 16 bit value
+static uint16_t get16(const uint8_t* buf)
+{
+    return uint16_t(buf[0] | (buf[1] << 8));
+}
+
+// Load little endian 32 bit value
+static uint32_t get32(const uint8_t* buf)
+{
+    return uint32_t(get16(buf)) | (uint32_t(get16(buf + 2)) << 16);
+}
+
+// Convert one sample to float
+static float convert(const uint8_t* buf, uint16_t bits, bool isFloat)
+{
+    if (isFloat) {
+        uint32_t raw = get32(buf);
+        float value;
+        memcpy(&value, &raw, sizeof(value));
+        return value;
+    }
+    switch (bits) {
+        case 8:
+            return (float(buf[0]) - 128.0f) / 128.0f;
+        case 16:
+            return float(int16_t(get16(buf))) / 32768.0f;
+        case 24:
+            return float(int32_t((uint32_t(buf[0]) << 8) | (uint32_t(buf[1]) << 16) | (uint32_t(buf[2]) << 24))
+                         / 256) / 8388608.0f;
+        default:
+            return float(int32_t(get32(buf))) / 2147483648.0f;
+    }
+}
+
+// Read WAV file
+WavReader::WavReader(const std::string& filename)
+    : m_sampleRate(0)
+    , m_channels()
+{
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    if (!file) {
+        throw SystemException("Unable to open file " + filename);
+    }
+    std::vector<uint8_t> buf((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (file.bad()) {
+        throw SystemException("Unable to read file " + filename);
+    }
+    if (buf.size() < 12 || memcmp(&(buf[0]), "RIFF", 4) != 0 || memcmp(&(buf[8]), "WAVE", 4) != 0) {
+        throw DataFormatException(filename + " is not a WAV file");
+    }
+
+    // Walk the chunks, they are padded to even sizes
+    const uint8_t* format = nullptr;
+    size_t formatSize = 0;
+    const uint8_t* data = nullptr;
+    size_t dataSize = 0;
+    for (size_t pos = 12; pos + 8 <= buf.size(); ) {
+        size_t size = get32(&(buf[pos + 4]));
+        size_t available = buf.size() - pos - 8;
+        if (memcmp(&(buf[pos]), "fmt ", 4) == 0 && size >= 16 && size <= available) {
+            format = &(buf[pos + 8]);
+            formatSize = size;
+        }
+        else if (memcmp(&(buf[pos]), "data", 4) == 0) {
+            data = &(buf[pos + 8]);
+            dataSize = size < available ? size : available;
+        }
+        pos += 8 + size + (size & 1);
+    }
+    if (format == nullptr || data == nullptr) {
+        throw DataFormatException(filename + " has no format or data chunk");
+    }
+
+    uint16_t tag = get16(format);
+    uint16_t numChannels = get16(format + 2);
+    uint16_t bits = get16(format + 14);
+    if (tag == FormatExtensible && formatSize >= 26) {
+        tag = get16(format + 24);
+    }
+    bool isFloat = tag == FormatFloat;
+    bool valid = isFloat ? bits == 32 : tag == FormatPcm && (bits == 8 || bits == 16 || bits == 24 || bits == 32);
+    if (!valid || numChannels == 0) {
+        throw DataFormatException(filename + " has an unsupported sample format");
+    }
+
+    m_sampleRate = get32(format + 4);
+    size_t sampleSize = bits / 8;
+    size_t frameSize = sampleSize * numChannels;
+    size_t frames = dataSize / frameSize;
+    m_channels.assign(numChannels, std::vector<float>(frames));
+    for (size_t i = 0; i < frames; ++i) {
+        for (size_t c = 0; c < numChannels; ++c) {
+            m_channels[c][i] = convert(data + i * frameSize + c * sampleSize, bits, isFloat);
+        }
+    }
+}
+
+// Get average of all channels
+std::vector<float> WavReader::getMix() const
+{
+    std::vector<float> mix(getNumFrames(), 0.0f);
+    float scale = 1.0f / float(m_channels.size());
+    for (auto& channel : m_channels) {
+        for (size_t i = 0; i < mix.size(); ++i) {
+            mix[i] += channel[i] * scale;
+        }
+    }
+    return mix;
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,131 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <string>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  WAV file reader.
+
+  Reads a whole WAV file into floating point samples, full scale being -1..1. Integer PCM with 8, 16, 24 or 32 bits
+  and 32 bit float samples are supported, also in the extensible format, with any number of channels. Chunks other
+  than the format and the data chunk are skipped.
+ */
+class WavReader {
+    public:
+        /**
+          Read WAV file.
+
+          Reads and converts all samples of the file.
+
+          @param[in]    filename    File name
+
+          @exception    SystemException     Cannot read the file
+          @exception    DataFormatException Not a WAV file or unsupported sample format
+         */
+        explicit WavReader(const std::string& filename);
+
+        /**
+          Get sample rate.
+
+          Returns the sample rate of the file.
+
+          @return                   Sample rate in Hz
+         */
+        uint32_t getSampleRate() const {
+            return m_sampleRate;
+        }
+
+        /**
+          Get number of channels.
+
+          Returns the number of channels of the file.
+
+          @return                   Number of channels
+         */
+        size_t getNumChannels() const {
+            return m_channels.size();
+        }
+
+        /**
+          Get number of frames.
+
+          Returns the number of samples per channel.
+
+          @return                   Number of frames
+         */
+        size_t getNumFrames() const {
+            return m_channels.empty() ? 0 : m_channels[0].size();
+        }
+
+        /**
+          Get channel.
+
+          Returns the samples of one channel.
+
+          @param[in]    channel     Channel index
+
+          @return                   Samples
+         */
+        const std::vector<float>& getChannel(size_t channel) const {
+            return m_channels[channel];
+        }
+
+        /**
+          Get mix.
+
+          Returns the average of all channels.
+
+          @return                   Mono samples
+         */
+        std::vector<float> getMix() const;
+
+    private:
+        uint32_t                        m_sampleRate;   ///< Sample rate in Hz
+        std::vector<std::vector<float>> m_channels;     ///< Samples per channel
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
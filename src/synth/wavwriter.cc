@@ -0,0 +1,160 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/wavwriter.hh>
+#include <exceptions.hh>
+#include <cmath>
+#include <cstring>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Number of channels
+static const uint16_t NumChannels = 2;
+
+// Bytes per frame
+static const uint16_t FrameSize = NumChannels * 2;
+
+// Size of RIFF header
+const size_t WavWriter::HeaderSize;
+
+// Store little endian 16 bit value
+static void put16(uint8_t* buf, uint16_t value)
+{
+    buf[0] = uint8_t(value);
+    buf[1] = uint8_t(value >> 8);
+}
+
+// Store little endian 32 bit value
+static void put32(uint8_t* buf, uint32_t value)
+{
+    put16(buf, uint16_t(value));
+    put16(buf + 2, uint16_t(value >> 16));
+}
+
+// Convert sample to 16 bit
+int16_t WavWriter::convert(float sample)
+{
+    float scaled = std::floor(sample * 32767.0f + 0.5f);
+    if (scaled > 32767.0f) {
+        return 32767;
+    }
+    else if (scaled < -32768.0f) {
+        return -32768;
+    }
+    return int16_t(scaled);
+}
+
+// Create WAV file
+WavWriter::WavWriter(const std::string& filename, uint32_t sampleRate)
+    : m_file(filename.c_str(), std::ios::binary | std::ios::trunc)
+    , m_frames(0)
+    , m_header()
+    , m_buffer()
+{
+    if (!m_file) {
+        throw SystemException("Unable to create file " + filename);
+    }
+
+    uint8_t* buf = m_header;
+    memcpy(buf, "RIFF", 4);
+    memcpy(buf + 8, "WAVEfmt ", 8);
+    put32(buf + 16, 16);
+    put16(buf + 20, 1);
+    put16(buf + 22, NumChannels);
+    put32(buf + 24, sampleRate);
+    put32(buf + 28, sampleRate * FrameSize);
+    put16(buf + 32, FrameSize);
+    put16(buf + 34, 16);
+    memcpy(buf + 36, "data", 4);
+    writeHeader();
+}
+
+// Close WAV file
+WavWriter::~WavWriter()
+{
+    try {
+        close();
+    }
+    catch (Exception&) {
+    }
+}
+
+// Append samples
+void WavWriter::write(const float* left, const float* right, size_t frames)
+{
+    if (!m_file.is_open()) {
+        throw SystemException("WAV file already closed");
+    }
+    m_buffer.resize(frames * FrameSize);
+    uint8_t* buf = m_buffer.data();
+    for (size_t i = 0; i < frames; ++i) {
+        put16(buf + i * FrameSize, uint16_t(convert(left[i])));
+        put16(buf + i * FrameSize + 2, uint16_t(convert(right[i])));
+    }
+    m_file.write(reinterpret_cast<const char*>(buf), std::streamsize(m_buffer.size()));
+    if (!m_file) {
+        throw SystemException("Unable to write WAV file");
+    }
+    m_frames += uint32_t(frames);
+}
+
+// Complete header and close file
+void WavWriter::close()
+{
+    if (!m_file.is_open()) {
+        return;
+    }
+    m_file.seekp(0);
+    writeHeader();
+    m_file.close();
+    if (!m_file) {
+        throw SystemException("Unable to write WAV file");
+    }
+}
+
+// Write RIFF header
+void WavWriter::writeHeader()
+{
+    uint32_t dataSize = m_frames * FrameSize;
+    put32(m_header + 4, uint32_t(HeaderSize - 8) + dataSize);
+    put32(m_header + 40, dataSize);
+    m_file.write(reinterpret_cast<const char*>(m_header), HeaderSize);
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,131 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  WAV file writer.
+
+  Writes stereo 16 bit PCM WAV files from floating point samples. Samples are rounded and clipped to the 16 bit
+  range. The header is written with zero sizes first and completed when the file is closed.
+ */
+class WavWriter {
+    public:
+        /**
+          Create WAV file.
+
+          Creates the file and writes the header.
+
+          @param[in]    filename    File name
+          @param[in]    sampleRate  Sample rate in Hz
+
+          @exception    SystemException     Cannot create the file
+         */
+        WavWriter(const std::string& filename, uint32_t sampleRate);
+
+        /**
+          Close WAV file.
+
+          Completes the header and closes the file if not done yet.
+         */
+        ~WavWriter();
+
+        /**
+          Write samples.
+
+          Appends a block of stereo samples.
+
+          @param[in]    left        Left samples
+          @param[in]    right       Right samples
+          @param[in]    frames      Number of frames
+
+          @exception    SystemException     Write error
+         */
+        void write(const float* left, const float* right, size_t frames);
+
+        /**
+          Close WAV file.
+
+          Completes the header and closes the file.
+
+          @exception    SystemException     Write error
+         */
+        void close();
+
+        /**
+          Convert sample to 16 bit.
+
+          Rounds and clips a floating point sample to the 16 bit range, the same way samples are written to files.
+
+          @param[in]    sample      Sample, full scale is -1..1
+
+          @return                   16 bit sample
+         */
+        static int16_t convert(float sample);
+
+    private:
+        /// Size of the RIFF header in bytes
+        static const size_t HeaderSize = 44;
+
+        std::ofstream           m_file;                 ///< Output file
+        uint32_t                m_frames;               ///< Number of frames written
+        uint8_t                 m_header[HeaderSize];   ///< RIFF header
+        std::vector<uint8_t>    m_buffer;               ///< Conversion buffer
+
+        /**
+          Write header.
+
+          Writes the RIFF header for the current number of frames at the start of the file.
+         */
+        void writeHeader();
+
+        WavWriter(const WavWriter&);            ///< Inhibit copying objects
+        WavWriter& operator=(const WavWriter&); ///< Inhibit copying objects
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
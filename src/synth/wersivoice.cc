@@ -0,0 +1,220 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <synth/wersivoice.hh>
+#include <synth/simd.hh>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace DMSToolbox {
+namespace Synth {
+
+// Mode parameters, times in milliseconds, rates in Hz, phases in periods
+struct ModeParameters {
+    float   m_base[4];                      // Center delay per tap
+    float   m_depth[4];                     // Delay modulation depth per tap
+    float   m_rate[4];                      // LFO rate per tap
+    float   m_phase[4];                     // Initial LFO phase per tap
+    float   m_left[4];                      // Left gain per tap
+    float   m_right[4];                     // Right gain per tap
+    float   m_tremolo;                      // Amplitude modulation depth
+    float   m_dry;                          // Gain of the unprocessed input
+};
+
+// Parameters of all modes, in the order of Icb::WvMode. The rotor uses two taps for the horn and two for the drum,
+// each pair facing opposite directions.
+static const ModeParameters Modes[] = {
+    // Rotor slow
+    { { 1.5f, 1.5f, 2.0f, 2.0f }, { 0.3f, 0.3f, 0.15f, 0.15f }, { 0.8f, 0.8f, 0.7f, 0.7f },
+      { 0.0f, 0.5f, 0.0f, 0.5f }, { 0.7f, 0.15f, 0.45f, 0.2f }, { 0.15f, 0.7f, 0.2f, 0.45f }, 0.3f, 0.0f },
+    // Rotor fast
+    { { 1.5f, 1.5f, 2.0f, 2.0f }, { 0.3f, 0.3f, 0.15f, 0.15f }, { 6.8f, 6.8f, 5.9f, 5.9f },
+      { 0.0f, 0.5f, 0.0f, 0.5f }, { 0.7f, 0.15f, 0.45f, 0.2f }, { 0.15f, 0.7f, 0.2f, 0.45f }, 0.3f, 0.0f },
+    // Flanger
+    { { 2.5f, 2.5f, 0.0f, 0.0f }, { 2.0f, 2.0f, 0.0f, 0.0f }, { 0.2f, 0.2f, 0.0f, 0.0f },
+      { 0.0f, 0.25f, 0.0f, 0.0f }, { 0.7f, 0.0f, 0.0f, 0.0f }, { 0.0f, 0.7f, 0.0f, 0.0f }, 0.0f, 0.7f },
+    // Strings
+    { { 7.0f, 7.0f, 7.0f, 7.0f }, { 1.5f, 1.5f, 0.3f, 0.3f }, { 0.63f, 0.71f, 5.7f, 6.3f },
+      { 0.0f, 0.5f, 0.25f, 0.75f }, { 0.5f, 0.2f, 0.4f, 0.2f }, { 0.2f, 0.5f, 0.2f, 0.4f }, 0.0f, 0.3f },
+    // Chorus
+    { { 12.0f, 12.0f, 12.0f, 0.0f }, { 2.5f, 2.5f, 2.5f, 0.0f }, { 0.5f, 0.63f, 0.77f, 0.0f },
+      { 0.0f, 0.33f, 0.67f, 0.0f }, { 0.6f, 0.2f, 0.4f, 0.0f }, { 0.2f, 0.6f, 0.4f, 0.0f }, 0.0f, 0.7f }
+};
+
+// Feedback amounts of the flat and deep flags, both add up
+static const float FlatFeedback = 0.35f;
+static const float DeepFeedback = 0.5f;
+
+// Longest delay of all modes in seconds, including modulation
+static const float MaxDelay = 0.02f;
+
+// Time constant of rotor speed changes in seconds
+static const float RotorInertia = 0.8f;
+
+// Create WersiVoice processor
+WersiVoice::WersiVoice(float sampleRate)
+    : m_sampleRate(sampleRate)
+    , m_mode(Wersi::Icb::WvMode::Invalid)
+    , m_delay()
+    , m_write(0)
+    , m_phase()
+    , m_rate()
+    , m_targetRate()
+    , m_base()
+    , m_depth()
+    , m_left()
+    , m_right()
+    , m_tremolo(0.0f)
+    , m_dryLeft(0.0f)
+    , m_dryRight(0.0f)
+    , m_feedback(0.0f)
+    , m_feedbackSample(0.0f)
+{
+    size_t size = 1;
+    while (float(size) < MaxDelay * sampleRate + 2.0f) {
+        size <<= 1;
+    }
+    m_delay.resize(size, 0.0f);
+}
+
+// Configure processor
+void WersiVoice::configure(Wersi::Icb::WvMode mode, bool left, bool right, bool fbFlat, bool fbDeep)
+{
+    size_t index = static_cast<size_t>(mode);
+    if (index >= sizeof(Modes) / sizeof(Modes[0])) {
+        m_mode = Wersi::Icb::WvMode::Invalid;
+        memset(m_left, 0, sizeof(m_left));
+        memset(m_right, 0, sizeof(m_right));
+        m_dryLeft = 0.0f;
+        m_dryRight = 0.0f;
+        return;
+    }
+
+    // Keeping the mode or switching between rotor speeds keeps phases and lets the rates glide
+    const ModeParameters& params = Modes[index];
+    bool rotor = mode == Wersi::Icb::WvMode::RotorSlow || mode == Wersi::Icb::WvMode::RotorFast;
+    bool wasRotor = m_mode == Wersi::Icb::WvMode::RotorSlow || m_mode == Wersi::Icb::WvMode::RotorFast;
+    bool keep = mode == m_mode || (rotor && wasRotor);
+    for (size_t i = 0; i < 4; ++i) {
+        m_targetRate[i] = params.m_rate[i] / m_sampleRate;
+        if (!keep) {
+            m_rate[i] = m_targetRate[i];
+            m_phase[i] = params.m_phase[i];
+        }
+        m_base[i] = params.m_base[i] * 0.001f * m_sampleRate;
+        m_depth[i] = params.m_depth[i] * 0.001f * m_sampleRate;
+        m_left[i] = left ? params.m_left[i] : 0.0f;
+        m_right[i] = right ? params.m_right[i] : 0.0f;
+    }
+    m_tremolo = params.m_tremolo;
+    m_dryLeft = left ? params.m_dry : 0.0f;
+    m_dryRight = right ? params.m_dry : 0.0f;
+    m_feedback = (fbFlat ? FlatFeedback : 0.0f) + (fbDeep ? DeepFeedback : 0.0f);
+    m_mode = mode;
+}
+
+// Configure processor from ICB
+void WersiVoice::configure(const Wersi::Icb& icb)
+{
+    configure(icb.getWvMode(), icb.getWvLeft(), icb.getWvRight(), icb.getWvFbFlat(), icb.getWvFbDeep());
+}
+
+// Clear delay line
+void WersiVoice::clear()
+{
+    std::fill(m_delay.begin(), m_delay.end(), 0.0f);
+    m_feedbackSample = 0.0f;
+}
+
+// Process block
+void WersiVoice::process(const float* in, float* left, float* right, size_t frames)
+{
+    if (m_mode == Wersi::Icb::WvMode::Invalid) {
+        return;
+    }
+
+    // Glide rates towards their targets once per block
+    float glide = 1.0f - std::exp(-float(frames) / (RotorInertia * m_sampleRate));
+    for (size_t i = 0; i < 4; ++i) {
+        m_rate[i] += (m_targetRate[i] - m_rate[i]) * glide;
+    }
+
+    const size_t mask = m_delay.size() - 1;
+    float* delay = m_delay.data();
+    Float4 phase = Float4::load(m_phase);
+    Float4 rate = Float4::load(m_rate);
+    Float4 base = Float4::load(m_base);
+    Float4 depth = Float4::load(m_depth);
+    Float4 leftGain = Float4::load(m_left);
+    Float4 rightGain = Float4::load(m_right);
+    Float4 tremolo(m_tremolo);
+    Float4 feedbackTap(m_feedback, 0.0f, 0.0f, 0.0f);
+    Float4 size(float(m_delay.size()));
+    int32_t index[4];
+    int32_t wrap[4];
+    float feedback = m_feedbackSample;
+    for (size_t frame = 0; frame < frames; ++frame) {
+        delay[m_write] = in[frame] + feedback;
+
+        // Parabolic sine of the LFO phases
+        Float4 x = phase * Float4(2.0f) - Float4(1.0f);
+        Float4 lfo = Float4(4.0f) * x * (Float4(1.0f) - max(x, Float4(0.0f) - x));
+
+        // Interpolated taps, read positions are kept positive before wrapping
+        Float4 position = Float4(float(m_write)) + size - base - depth * lfo;
+        Float4 fraction = position - position.truncate(index);
+        Float4 a(delay[index[0] & mask], delay[index[1] & mask], delay[index[2] & mask], delay[index[3] & mask]);
+        Float4 b(delay[(index[0] + 1) & mask], delay[(index[1] + 1) & mask], delay[(index[2] + 1) & mask],
+                 delay[(index[3] + 1) & mask]);
+        Float4 tap = a + (b - a) * fraction;
+        feedback = (tap * feedbackTap).sum();
+        tap *= Float4(1.0f) + tremolo * lfo;
+
+        left[frame] += (tap * leftGain).sum() + m_dryLeft * in[frame];
+        right[frame] += (tap * rightGain).sum() + m_dryRight * in[frame];
+
+        phase += rate;
+        phase -= phase.truncate(wrap);
+        m_write = (m_write + 1) & mask;
+    }
+    phase.store(m_phase);
+    m_feedbackSample = feedback;
+}
+
+} // namespace Synth
+} // namespace DMSToolbox
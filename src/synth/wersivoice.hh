@@ -0,0 +1,143 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <wersi/icb.hh>
+#include <vector>
+
+namespace DMSToolbox {
+namespace Synth {
+
+/**
+  @ingroup synth_group
+
+  WersiVoice effects processor.
+
+  Emulates the WersiVoice processor fed by the WV bus: rotor with slow and fast rotation, flanger, strings ensemble
+  and chorus. All modes are built from one modulated delay line with four taps, processed as one SIMD vector per
+  sample: each lane has its own LFO, delay, amplitude modulation and stereo weights, taken from a per-mode table.
+  The first tap is fed back into the delay line with the amount selected by the flat and deep feedback flags. When
+  the rotor speed changes, the LFO rates glide to the new speed like a real rotor spinning up or down.
+ */
+class WersiVoice {
+    public:
+        /**
+          Create WersiVoice processor.
+
+          Creates a processor with invalid mode, which outputs nothing until configured.
+
+          @param[in]    sampleRate  Sample rate in Hz
+         */
+        explicit WersiVoice(float sampleRate);
+
+        /**
+          Configure processor.
+
+          Selects mode, outputs and feedback. The delay line is always kept. The LFO phases are kept when the mode
+          stays the same or switches between the rotor speeds, so changing outputs, feedback or rotor speed while
+          playing does not click. Other mode changes restart the LFOs and move the taps, which may click.
+
+          @param[in]    mode        Effect mode
+          @param[in]    left        Left output enabled
+          @param[in]    right       Right output enabled
+          @param[in]    fbFlat      Flat feedback enabled
+          @param[in]    fbDeep      Deep feedback enabled
+         */
+        void configure(Wersi::Icb::WvMode mode, bool left, bool right, bool fbFlat, bool fbDeep);
+
+        /**
+          Configure processor from ICB.
+
+          Takes mode, outputs and feedback from the WersiVoice settings of an ICB.
+
+          @param[in]    icb         Instrument control block
+         */
+        void configure(const Wersi::Icb& icb);
+
+        /**
+          Get effect mode.
+
+          Returns the configured effect mode.
+
+          @return                   Effect mode
+         */
+        Wersi::Icb::WvMode getMode() const {
+            return m_mode;
+        }
+
+        /**
+          Clear state.
+
+          Clears the delay line, so no tail of previous input is heard.
+         */
+        void clear();
+
+        /**
+          Process block.
+
+          Processes a block of the WV bus and adds the stereo result to the given outputs.
+
+          @param[in]    in          WV bus samples
+          @param[in,out] left       Left output samples
+          @param[in,out] right      Right output samples
+          @param[in]    frames      Number of frames to process
+         */
+        void process(const float* in, float* left, float* right, size_t frames);
+
+    private:
+        float                   m_sampleRate;   ///< Sample rate in Hz
+        Wersi::Icb::WvMode      m_mode;         ///< Effect mode
+        std::vector<float>      m_delay;        ///< Delay line, size is a power of two
+        size_t                  m_write;        ///< Delay line write position
+        float                   m_phase[4];     ///< LFO phase per tap, 0..1
+        float                   m_rate[4];      ///< Current LFO phase increment per sample per tap
+        float                   m_targetRate[4];    ///< Target LFO phase increment per sample per tap
+        float                   m_base[4];      ///< Center delay in samples per tap
+        float                   m_depth[4];     ///< Delay modulation depth in samples per tap
+        float                   m_left[4];      ///< Left gain per tap
+        float                   m_right[4];     ///< Right gain per tap
+        float                   m_tremolo;      ///< Amplitude modulation depth
+        float                   m_dryLeft;      ///< Left gain of the unprocessed input
+        float                   m_dryRight;     ///< Right gain of the unprocessed input
+        float                   m_feedback;     ///< Feedback of the first tap
+        float                   m_feedbackSample;   ///< Fed back sample, carried across blocks
+};
+
+} // namespace Synth
+} // namespace DMSToolbox
@@ -0,0 +1,210 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <tests/testrunner.hh>
+#include <cowbuffer.hh>
+#include <arena.hh>
+#include <vector>
+
+using namespace std;
+using namespace DMSToolbox;
+using namespace DMSToolbox::Test;
+
+// Size of all test buffers
+static const size_t BufferSize = 256;
+
+// Create buffer with a byte pattern
+static CowBuffer makeBuffer(const shared_ptr<Arena>& arena = shared_ptr<Arena>())
+{
+    vector<uint8_t> raw(BufferSize);
+    for (size_t i = 0; i < raw.size(); ++i) {
+        raw[i] = uint8_t(i);
+    }
+    return CowBuffer(raw.data(), raw.size(), arena);
+}
+
+// Check buffer contents against the byte pattern, with one changed byte
+static bool hasPattern(const CowBuffer& buffer, size_t changed = BufferSize, uint8_t value = 0)
+{
+    vector<uint8_t> out(buffer.size());
+    buffer.copyTo(out.data());
+    for (size_t i = 0; i < out.size(); ++i) {
+        if (out[i] != (i == changed ? value : uint8_t(i))) {
+            return false;
+        }
+    }
+    return out.size() == BufferSize;
+}
+
+// Test that writing a copy leaves the source untouched
+static bool testCopyOnWrite()
+{
+    CowBuffer source = makeBuffer();
+    CowBuffer copy(source);
+    uint8_t value = 0xaa;
+    bool changed = copy.write(10, &value, 1);
+    return changed && hasPattern(source) && hasPattern(copy, 10, 0xaa) && !copy.sharesChunk(source, 10);
+}
+
+// Test that writing unchanged data keeps the storage shared
+static bool testUnchangedWrite()
+{
+    CowBuffer source = makeBuffer();
+    CowBuffer copy(source);
+    source.map(16, 16);
+    copy.map(16, 16);
+    uint8_t value = 20;
+    bool changed = copy.write(20, &value, 1);
+    return !changed && copy.sharesChunk(source, 20) && hasPattern(copy);
+}
+
+// Test that only the chunk holding a written block is copied
+static bool testBlockGranularity()
+{
+    CowBuffer source = makeBuffer();
+    CowBuffer::Ref first = source.map(0, 16);
+    CowBuffer::Ref second = source.map(100, 16);
+    CowBuffer copy(source);
+    first.rebind(copy);
+    uint8_t value = 0x55;
+    bool changed = first.write(&value, 1, 4);
+    return changed && !copy.sharesChunk(source, 4) && copy.sharesChunk(source, 100) && hasPattern(source) &&
+           hasPattern(copy, 4, 0x55) && second.data()[0] == 100;
+}
+
+// Test that mapped blocks are contiguous and overlapping blocks end up in one chunk
+static bool testMapping()
+{
+    CowBuffer buffer = makeBuffer();
+    buffer.map(10, 20);
+    CowBuffer::Ref block = buffer.map(25, 20);
+    size_t chunks = buffer.getNumChunks();
+    const uint8_t* data = block.data();
+    for (size_t i = 0; i < block.size(); ++i) {
+        if (data[i] != uint8_t(25 + i)) {
+            return false;
+        }
+    }
+    return chunks == 3 && buffer.data(10) + 34 == buffer.data(44) && hasPattern(buffer);
+}
+
+// Test reading and writing across chunk boundaries
+static bool testCrossChunkAccess()
+{
+    CowBuffer buffer = makeBuffer();
+    buffer.map(32, 8);
+    buffer.map(40, 8);
+    vector<uint8_t> data(24, 0xff);
+    buffer.write(28, data.data(), data.size());
+    vector<uint8_t> out(32);
+    buffer.read(24, out.data(), out.size());
+    for (size_t i = 0; i < out.size(); ++i) {
+        if (out[i] != (i >= 4 && i < 28 ? 0xff : uint8_t(24 + i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Test that references stay valid when the buffer contents are replaced
+static bool testAssignment()
+{
+    CowBuffer buffer = makeBuffer();
+    CowBuffer::Ref block = buffer.map(64, 8);
+    CowBuffer snapshot(buffer);
+    uint8_t value = 0x12;
+    block.write(&value, 1);
+    bool written = block.data()[0] == 0x12;
+    buffer = snapshot;
+    return written && block.data()[0] == 64 && hasPattern(snapshot);
+}
+
+// Test that accesses beyond the buffer are rejected
+static bool testBounds()
+{
+    CowBuffer buffer = makeBuffer();
+    size_t caught = 0;
+    uint8_t value = 0;
+    try {
+        buffer.map(BufferSize - 4, 8);
+    }
+    catch (DataFormatException&) {
+        ++caught;
+    }
+    try {
+        buffer.write(BufferSize, &value, 1);
+    }
+    catch (DataFormatException&) {
+        ++caught;
+    }
+    try {
+        buffer.read(BufferSize - 1, &value, 2);
+    }
+    catch (DataFormatException&) {
+        ++caught;
+    }
+    return caught == 3;
+}
+
+// Test that copies into another arena allocate new chunks from there
+static bool testArenaCopy()
+{
+    shared_ptr<Arena> arena = make_shared<Arena>(4096);
+    shared_ptr<Arena> other = make_shared<Arena>(4096);
+    CowBuffer source = makeBuffer(arena);
+    source.map(0, 16);
+    CowBuffer copy(source, other);
+    size_t used = other->getUsed();
+    uint8_t value = 0x77;
+    copy.write(0, &value, 1);
+    return copy.getArena() == other && other->getUsed() > used && hasPattern(source) && hasPattern(copy, 0, 0x77);
+}
+
+int main()
+{
+    const TestCase tests[] = {
+        { "copy on write", testCopyOnWrite },
+        { "unchanged write", testUnchangedWrite },
+        { "block granularity", testBlockGranularity },
+        { "mapping", testMapping },
+        { "cross chunk access", testCrossChunkAccess },
+        { "assignment", testAssignment },
+        { "bounds", testBounds },
+        { "arena copy", testArenaCopy }
+    };
+    return runTests(tests, sizeof(tests) / sizeof(tests[0]));
+}
@@ -0,0 +1,166 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <tests/testrunner.hh>
+#include <wersi/envelope.hh>
+#include <cowbuffer.hh>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace DMSToolbox;
+using namespace DMSToolbox::Wersi;
+using namespace DMSToolbox::Test;
+
+// Number of random blocks checked
+static const size_t NumBlocks = 200000;
+
+// FREQ block with attack ramp, sustain, release ramp and a jump back to the sustain
+static const uint8_t Program[] = { 6, 2, 0x01, 0x7f, 0x10, 0x06, 0x01, 0x00, 0x05, 0x03, 0x05 };
+
+// FREQ block size
+static const size_t BlockSize = 32;
+
+// Get block contents
+static vector<uint8_t> getBlock(const CowBuffer& buffer)
+{
+    vector<uint8_t> out(buffer.size());
+    buffer.copyTo(out.data());
+    return out;
+}
+
+// Test that random blocks survive a dissect/update round trip and relocation unchanged
+static bool testRandomRoundTrip()
+{
+    const size_t sizes[] = { 44, 32 };
+    mt19937 random(1);
+    size_t failures = 0;
+    for (size_t n = 0; n < NumBlocks; ++n) {
+        // Mostly small bytes, so most blocks decode to known instructions, with zero padding at the end
+        size_t size = sizes[n % 2];
+        vector<uint8_t> raw(size, 0);
+        size_t used = size_t(random() % (size + 1));
+        for (size_t i = 0; i < used; ++i) {
+            raw[i] = uint8_t(random() % 4 != 0 ? random() % 8 : random() % 256);
+        }
+        raw[0] = uint8_t(random() % (used + 1));
+        raw[1] = uint8_t(random() % (used + 1));
+
+        CowBuffer buffer(raw.data(), size);
+        Envelope envelope(0, buffer.map(0, size), size);
+        envelope.update();
+        bool failed = getBlock(buffer) != raw;
+
+        // Inserting and removing an instruction must give the same block again
+        if (!failed && envelope.canRelocate() && envelope.getProgramSize() < size) {
+            envelope.insertInstruction(0, Envelope::makeInstruction(Envelope::Opcode::Sustain));
+            envelope.removeInstruction(0);
+            envelope.update();
+            failed = getBlock(buffer) != raw;
+        }
+        if (failed) {
+            ++failures;
+        }
+    }
+    if (failures != 0) {
+        cerr << failures << " of " << NumBlocks << " blocks changed" << endl;
+    }
+    return failures == 0;
+}
+
+// Test decoding of a known program
+static bool testDissect()
+{
+    vector<uint8_t> raw(Program, Program + sizeof(Program));
+    raw.resize(BlockSize, 0);
+    CowBuffer buffer(raw.data(), raw.size());
+    Envelope envelope(0, buffer.map(0, BlockSize), BlockSize);
+    const vector<Envelope::Instruction>& program = envelope.getProgram();
+    return program.size() == 4 && program[0].m_opcode == Envelope::Opcode::Ramp &&
+           program[1].m_opcode == Envelope::Opcode::Sustain && program[2].m_opcode == Envelope::Opcode::Ramp &&
+           program[3].m_opcode == Envelope::Opcode::Jump && program[3].m_target == 1 &&
+           envelope.getAttackEntry() == 0 && envelope.getReleaseEntry() == 2 &&
+           envelope.getProgramSize() == sizeof(Program) && envelope.canRelocate();
+}
+
+// Test that inserting an instruction moves all pointers behind it
+static bool testRelocation()
+{
+    vector<uint8_t> raw(Program, Program + sizeof(Program));
+    raw.resize(BlockSize, 0);
+    CowBuffer buffer(raw.data(), raw.size());
+    Envelope envelope(0, buffer.map(0, BlockSize), BlockSize);
+    envelope.insertInstruction(1, Envelope::makeInstruction(Envelope::Opcode::SetLevel, 0x20));
+    envelope.update();
+    const uint8_t expected[] = { 8, 2, 0x01, 0x7f, 0x10, 0x05, 0x20, 0x06, 0x01, 0x00, 0x05, 0x03, 0x07 };
+    vector<uint8_t> inserted(expected, expected + sizeof(expected));
+    inserted.resize(BlockSize, 0);
+    bool moved = getBlock(buffer) == inserted;
+    envelope.removeInstruction(1);
+    envelope.update();
+    return moved && getBlock(buffer) == raw;
+}
+
+// Test that programs with unknown bytes are not relocated
+static bool testUnknownPointers()
+{
+    vector<uint8_t> raw(Program, Program + sizeof(Program));
+    raw.resize(BlockSize, 0);
+    raw[sizeof(Program)] = 0x80;
+    CowBuffer buffer(raw.data(), raw.size());
+    Envelope envelope(0, buffer.map(0, BlockSize), BlockSize);
+    bool caught = false;
+    try {
+        envelope.insertInstruction(0, Envelope::makeInstruction(Envelope::Opcode::Sustain));
+    }
+    catch (DataFormatException&) {
+        caught = true;
+    }
+    envelope.update();
+    return !envelope.canRelocate() && caught && getBlock(buffer) == raw;
+}
+
+int main()
+{
+    const TestCase tests[] = {
+        { "random round trip", testRandomRoundTrip },
+        { "dissect", testDissect },
+        { "relocation", testRelocation },
+        { "unknown pointers", testUnknownPointers }
+    };
+    return runTests(tests, sizeof(tests) / sizeof(tests[0]));
+}
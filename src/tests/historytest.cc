@@ -0,0 +1,245 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <tests/testrunner.hh>
+#include <wersi/history.hh>
+#include <wersi/mk1cartridge.hh>
+#include <wersi/icb.hh>
+#include <wersi/wave.hh>
+#include <memory>
+#include <vector>
+
+using namespace std;
+using namespace DMSToolbox;
+using namespace DMSToolbox::Wersi;
+using namespace DMSToolbox::Test;
+
+// MK1 cartridge size
+static const size_t CartridgeSize = 16384;
+
+// Number of ICBs always present on a MK1 cartridge
+static const size_t NumIcbs = 20;
+
+// Block number of the only VCF, AMPL, FREQ and WAVE block
+static const uint8_t Block = 128;
+
+// Put big endian word into image
+static void putWord(vector<uint8_t>& image, size_t offset, uint16_t value)
+{
+    image[offset] = uint8_t(value >> 8);
+    image[offset + 1] = uint8_t(value);
+}
+
+// Create MK1 cartridge with the fixed ICBs sharing one block of each other type
+static Mk1Cartridge* makeCartridge()
+{
+    // Pointer tables follow the header, the blocks start at 0x100
+    const uint16_t icbTable = 0x0010;
+    const uint16_t vcfTable = 0x0040;
+    const uint16_t amplTable = 0x0042;
+    const uint16_t freqTable = 0x0044;
+    const uint16_t waveTable = 0x0046;
+    const uint16_t icbs = 0x0100;
+    const uint16_t vcf = 0x0300;
+    const uint16_t ampl = 0x0310;
+    const uint16_t freq = 0x0340;
+    const uint16_t wave = 0x0400;
+
+    vector<uint8_t> image(CartridgeSize, 0);
+    putWord(image, 0, 0xffff);
+    putWord(image, 2, icbTable);
+    putWord(image, 4, vcfTable);
+    putWord(image, 6, amplTable);
+    putWord(image, 8, freqTable);
+    putWord(image, 10, waveTable);
+    for (size_t i = 0; i < NumIcbs; ++i) {
+        uint16_t icb = uint16_t(icbs + i * 16);
+        putWord(image, icbTable + i * 2, icb);
+        for (size_t j = 1; j < 5; ++j) {
+            image[icb + j] = Block + 1;
+        }
+        for (size_t j = 10; j < 16; ++j) {
+            image[icb + j] = uint8_t('A' + i);
+        }
+    }
+    putWord(image, vcfTable, vcf);
+    putWord(image, amplTable, ampl);
+    putWord(image, freqTable, freq);
+    putWord(image, waveTable, wave);
+    image[wave] = 0x40;
+
+    uint16_t check = 0;
+    for (size_t i = 0; i < CartridgeSize - 2; ++i) {
+        check += image[i];
+    }
+    putWord(image, CartridgeSize - 2, uint16_t(-check));
+    return new Mk1Cartridge(image.data(), image.size());
+}
+
+// Change wave level in one change batch
+static void setLevel(InstrumentStore& store, uint8_t level)
+{
+    store.beginChanges();
+    Wave* wave = store.getWave(Block);
+    wave->setLevel(level);
+    wave->update();
+    store.markChanged(ChangeSet::BlockType::Wave, Block);
+    store.endChanges();
+}
+
+// Get wave level
+static uint8_t getLevel(InstrumentStore& store)
+{
+    return store.getWave(Block)->getLevel();
+}
+
+// Test that the initial state is the only version
+static bool testInitial()
+{
+    unique_ptr<Mk1Cartridge> store(makeCartridge());
+    History history(*store);
+    return history.getNumVersions() == 1 && history.getVersion() == 0 && !history.canUndo() && !history.canRedo() &&
+           history.getChanges(0).empty();
+}
+
+// Test that every change batch records one version with its changes
+static bool testRecord()
+{
+    unique_ptr<Mk1Cartridge> store(makeCartridge());
+    History history(*store);
+    setLevel(*store, 10);
+    setLevel(*store, 20);
+    const ChangeSet& changes = history.getChanges(2);
+    return history.getNumVersions() == 3 && history.getVersion() == 2 && history.canUndo() && !history.canRedo() &&
+           changes.test(ChangeSet::BlockType::Wave, Block) && !changes.any(ChangeSet::BlockType::Icb);
+}
+
+// Test that undo and redo restore the block contents
+static bool testUndoRedo()
+{
+    unique_ptr<Mk1Cartridge> store(makeCartridge());
+    History history(*store);
+    setLevel(*store, 10);
+    setLevel(*store, 20);
+    history.undo();
+    bool undone = getLevel(*store) == 10 && history.getVersion() == 1;
+    history.undo();
+    bool initial = getLevel(*store) == 0x40 && !history.canUndo();
+    history.undo();
+    history.redo();
+    history.redo();
+    bool redone = getLevel(*store) == 20 && !history.canRedo();
+    return undone && initial && redone && history.getNumVersions() == 3;
+}
+
+// Test that any version can be restored directly
+static bool testJump()
+{
+    unique_ptr<Mk1Cartridge> store(makeCartridge());
+    History history(*store);
+    for (uint8_t level = 1; level <= 5; ++level) {
+        setLevel(*store, level);
+    }
+    history.jump(2);
+    bool back = getLevel(*store) == 2 && history.getVersion() == 2;
+    history.jump(5);
+    bool forward = getLevel(*store) == 5;
+    bool caught = false;
+    try {
+        history.jump(6);
+    }
+    catch (Exception&) {
+        caught = true;
+    }
+    return back && forward && caught && history.getVersion() == 5;
+}
+
+// Test that a change after undo discards the undone versions
+static bool testBranch()
+{
+    unique_ptr<Mk1Cartridge> store(makeCartridge());
+    History history(*store);
+    setLevel(*store, 10);
+    setLevel(*store, 20);
+    history.undo();
+    setLevel(*store, 30);
+    history.undo();
+    bool undone = getLevel(*store) == 10;
+    history.redo();
+    return undone && getLevel(*store) == 30 && history.getNumVersions() == 3 && !history.canRedo();
+}
+
+// Test that the oldest versions are dropped first
+static bool testLimit()
+{
+    unique_ptr<Mk1Cartridge> store(makeCartridge());
+    History history(*store, 3);
+    for (uint8_t level = 1; level <= 5; ++level) {
+        setLevel(*store, level);
+    }
+    history.jump(0);
+    return history.getNumVersions() == 3 && getLevel(*store) == 3 && !history.canUndo();
+}
+
+// Test that restoring leaves the store unchanged for a new history
+static bool testRestoredState()
+{
+    unique_ptr<Mk1Cartridge> store(makeCartridge());
+    vector<uint8_t> initial(CartridgeSize);
+    store->getBuffer().copyTo(initial.data());
+    History history(*store);
+    setLevel(*store, 10);
+    history.undo();
+    vector<uint8_t> restored(CartridgeSize);
+    store->getBuffer().copyTo(restored.data());
+    history.clear();
+    return restored == initial && history.getNumVersions() == 1 && store->getIcb(Block + 1)->getName() == "AAAAAA";
+}
+
+int main()
+{
+    const TestCase tests[] = {
+        { "initial", testInitial },
+        { "record", testRecord },
+        { "undo redo", testUndoRedo },
+        { "jump", testJump },
+        { "branch", testBranch },
+        { "limit", testLimit },
+        { "restored state", testRestoredState }
+    };
+    return runTests(tests, sizeof(tests) / sizeof(tests[0]));
+}
@@ -0,0 +1,188 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <tests/testrunner.hh>
+#include <synth/midifile.hh>
+#include <cmath>
+#include <vector>
+
+using namespace std;
+using namespace DMSToolbox;
+using namespace DMSToolbox::Synth;
+using namespace DMSToolbox::Test;
+
+// Ticks per quarter note of the test files
+static const uint16_t Division = 480;
+
+// Track bytes
+typedef vector<uint8_t> Track;
+
+// Append big endian value
+static void putBigEndian(vector<uint8_t>& data, uint32_t value, size_t bytes)
+{
+    for (size_t i = bytes; i > 0; --i) {
+        data.push_back(uint8_t(value >> ((i - 1) * 8)));
+    }
+}
+
+// Put together MIDI file from tracks
+static vector<uint8_t> makeFile(uint16_t format, uint16_t division, const vector<Track>& tracks)
+{
+    vector<uint8_t> data = { 'M', 'T', 'h', 'd' };
+    putBigEndian(data, 6, 4);
+    putBigEndian(data, format, 2);
+    putBigEndian(data, uint32_t(tracks.size()), 2);
+    putBigEndian(data, division, 2);
+    for (auto& i : tracks) {
+        data.insert(data.end(), { 'M', 'T', 'r', 'k' });
+        putBigEndian(data, uint32_t(i.size()), 4);
+        data.insert(data.end(), i.begin(), i.end());
+    }
+    return data;
+}
+
+// Check if file is rejected
+static bool isRejected(const vector<uint8_t>& data)
+{
+    try {
+        MidiFile file(data.data(), data.size());
+    }
+    catch (DataFormatException&) {
+        return true;
+    }
+    return false;
+}
+
+// Compare times
+static bool isTime(double time, double expected)
+{
+    return fabs(time - expected) < 1.0e-9;
+}
+
+// Test event times at the default tempo, with running status and skipped messages
+static bool testDefaultTempo()
+{
+    // Note on, running status note off after a quarter, program change, system exclusive and end after 2 quarters
+    Track track = {
+        0x00, 0x90, 60, 100,
+        0x83, 0x60, 60, 0,
+        0x00, 0xc1, 5,
+        0x00, 0xf0, 0x03, 0x43, 0x10, 0xf7,
+        0x83, 0x60, 0xff, 0x2f, 0x00
+    };
+    vector<uint8_t> data = makeFile(0, Division, { track });
+    MidiFile file(data.data(), data.size());
+    const vector<MidiFile::Event>& events = file.getEvents();
+    return events.size() == 3 && isTime(events[0].m_time, 0.0) && events[0].m_status == 0x90 &&
+           isTime(events[1].m_time, 0.5) && events[1].m_status == 0x90 && events[1].m_data2 == 0 &&
+           events[2].m_status == 0xc1 && events[2].m_data1 == 5 && events[2].m_data2 == 0 &&
+           isTime(file.getDuration(), 1.0);
+}
+
+// Test that tempo changes of one track apply to the events of all tracks
+static bool testTempoMap()
+{
+    // Tempo track doubles the tempo after one quarter, the note track plays a note every quarter
+    Track tempo = {
+        0x83, 0x60, 0xff, 0x51, 0x03, 0x03, 0xd0, 0x90,
+        0x00, 0xff, 0x2f, 0x00
+    };
+    Track notes = {
+        0x00, 0x90, 60, 100,
+        0x83, 0x60, 0x90, 62, 100,
+        0x83, 0x60, 0x90, 64, 100,
+        0x00, 0xff, 0x2f, 0x00
+    };
+    vector<uint8_t> data = makeFile(1, Division, { tempo, notes });
+    MidiFile file(data.data(), data.size());
+    const vector<MidiFile::Event>& events = file.getEvents();
+    return events.size() == 3 && isTime(events[0].m_time, 0.0) && isTime(events[1].m_time, 0.5) &&
+           isTime(events[2].m_time, 0.75) && events[2].m_data1 == 64 && isTime(file.getDuration(), 0.75);
+}
+
+// Test that events at the same tick keep their track order
+static bool testMerge()
+{
+    Track first = { 0x00, 0x90, 60, 100, 0x10, 0x80, 60, 0, 0x00, 0xff, 0x2f, 0x00 };
+    Track second = { 0x10, 0x91, 67, 100, 0x00, 0xff, 0x2f, 0x00 };
+    vector<uint8_t> data = makeFile(1, Division, { second, first });
+    MidiFile file(data.data(), data.size());
+    const vector<MidiFile::Event>& events = file.getEvents();
+    return events.size() == 3 && events[0].m_status == 0x90 && events[1].m_status == 0x91 &&
+           events[2].m_status == 0x80 && isTime(events[1].m_time, events[2].m_time);
+}
+
+// Test SMPTE time division, tempo changes are ignored
+static bool testSmpte()
+{
+    // 25 frames per second with 40 ticks per frame give 1 ms per tick
+    Track track = {
+        0x00, 0xff, 0x51, 0x03, 0x03, 0xd0, 0x90,
+        0x87, 0x68, 0x90, 60, 100,
+        0x00, 0xff, 0x2f, 0x00
+    };
+    vector<uint8_t> data = makeFile(0, 0xe728, { track });
+    MidiFile file(data.data(), data.size());
+    const vector<MidiFile::Event>& events = file.getEvents();
+    return events.size() == 1 && isTime(events[0].m_time, 1.0);
+}
+
+// Test that invalid files are rejected
+static bool testInvalid()
+{
+    Track track = { 0x00, 0x90, 60, 100, 0x00, 0xff, 0x2f, 0x00 };
+    vector<uint8_t> truncated = makeFile(0, Division, { track });
+    truncated.resize(truncated.size() - 2);
+    vector<uint8_t> noHeader = makeFile(0, Division, { track });
+    noHeader[0] = 'X';
+    Track runningStatus = { 0x00, 60, 100 };
+    return isRejected(truncated) && isRejected(noHeader) && isRejected(makeFile(2, Division, { track })) &&
+           isRejected(makeFile(0, 0, { track })) && isRejected(makeFile(0, 0xe700, { track })) &&
+           isRejected(makeFile(0, Division, { runningStatus }));
+}
+
+int main()
+{
+    const TestCase tests[] = {
+        { "default tempo", testDefaultTempo },
+        { "tempo map", testTempoMap },
+        { "merge", testMerge },
+        { "smpte", testSmpte },
+        { "invalid", testInvalid }
+    };
+    return runTests(tests, sizeof(tests) / sizeof(tests[0]));
+}
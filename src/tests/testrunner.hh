@@ -0,0 +1,92 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <exceptions.hh>
+#include <iostream>
+
+namespace DMSToolbox {
+namespace Test {
+
+/**
+  @ingroup test_group
+
+  Test case.
+
+  A named test function returning true on success. Test executables keep a table of their cases and pass it to
+  runTests().
+ */
+struct TestCase {
+    const char*     m_name;                 ///< Test case name
+    bool            (*m_run)();             ///< Test function
+};
+
+/**
+  Run test cases.
+
+  Runs all given test cases in order and reports the failed ones on stderr. Exceptions escaping a test case count as
+  failures, the remaining cases are run anyway.
+
+  @param[in]    tests       Test cases
+  @param[in]    numTests    Number of test cases
+
+  @return                   Exit code, 0 if all test cases passed, 1 otherwise
+ */
+inline int runTests(const TestCase* tests, size_t numTests)
+{
+    size_t failures = 0;
+    for (size_t i = 0; i < numTests; ++i) {
+        bool passed = false;
+        try {
+            passed = tests[i].m_run();
+        }
+        catch (Exception& e) {
+            std::cerr << tests[i].m_name << ": " << e.what() << std::endl;
+        }
+        if (!passed) {
+            std::cerr << tests[i].m_name << ": failed" << std::endl;
+            ++failures;
+        }
+    }
+    std::cout << numTests - failures << " of " << numTests << " test cases passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
+
+} // namespace Test
+} // namespace DMSToolbox
@@ -0,0 +1,78 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <wersi/changeset.hh>
+
+namespace DMSToolbox {
+namespace Wersi {
+
+// Create empty change set
+ChangeSet::ChangeSet()
+    : m_bitmap()
+{
+}
+
+// Check for empty change set
+bool ChangeSet::empty() const
+{
+    for (size_t i = 0; i < NumBlockTypes; ++i) {
+        if (m_bitmap[i].any()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Clear change set
+void ChangeSet::clear()
+{
+    for (size_t i = 0; i < NumBlockTypes; ++i) {
+        m_bitmap[i].reset();
+    }
+}
+
+// Merge change set
+ChangeSet& ChangeSet::operator|=(const ChangeSet& other)
+{
+    for (size_t i = 0; i < NumBlockTypes; ++i) {
+        m_bitmap[i] |= other.m_bitmap[i];
+    }
+    return *this;
+}
+
+} // namespace Wersi
+} // namespace DMSToolbox
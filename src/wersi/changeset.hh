@@ -0,0 +1,163 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <bitset>
+
+namespace DMSToolbox {
+namespace Wersi {
+
+/**
+  @ingroup wersi_group
+
+  Wersi DMS-System block change set.
+
+  A change set holds one bitmap per block type with one bit per block number. It is used by instrument stores to
+  track modified blocks and to deliver batched change notifications to observers, so only the affected blocks need
+  to be redrawn or sent to a device.
+ */
+class ChangeSet {
+    public:
+        /// Block type
+        enum class BlockType : uint8_t {
+            Icb     = 0,                    ///< Instrument control block
+            Vcf     = 1,                    ///< VCF block
+            Ampl    = 2,                    ///< AMPL envelope block
+            Freq    = 3,                    ///< FREQ envelope block
+            Wave    = 4                     ///< WAVE block
+        };
+
+        /// Number of block types
+        static const size_t NumBlockTypes = 5;
+
+        /// Bitmap type, one bit per block number
+        typedef std::bitset<256> Bitmap;
+
+        /**
+          Create empty change set.
+
+          Creates a change set with no blocks marked.
+         */
+        ChangeSet();
+
+        /**
+          Mark block.
+
+          Marks the given block of the given type as changed.
+
+          @param[in]    type        Block type
+          @param[in]    block       Block number
+         */
+        void set(BlockType type, uint8_t block) {
+            m_bitmap[static_cast<size_t>(type)].set(block);
+        }
+
+        /**
+          Test block.
+
+          Returns true if the given block of the given type is marked as changed.
+
+          @param[in]    type        Block type
+          @param[in]    block       Block number
+
+          @return                   True if block is marked
+         */
+        bool test(BlockType type, uint8_t block) const {
+            return m_bitmap[static_cast<size_t>(type)].test(block);
+        }
+
+        /**
+          Test block type.
+
+          Returns true if any block of the given type is marked as changed.
+
+          @param[in]    type        Block type
+
+          @return                   True if any block of this type is marked
+         */
+        bool any(BlockType type) const {
+            return m_bitmap[static_cast<size_t>(type)].any();
+        }
+
+        /**
+          Get bitmap.
+
+          Returns the bitmap of the given block type.
+
+          @param[in]    type        Block type
+
+          @return                   Bitmap with one bit per block number
+         */
+        const Bitmap& get(BlockType type) const {
+            return m_bitmap[static_cast<size_t>(type)];
+        }
+
+        /**
+          Check for empty change set.
+
+          Returns true if no block of any type is marked.
+
+          @return                   True if change set is empty
+         */
+        bool empty() const;
+
+        /**
+          Clear change set.
+
+          Removes all marks from the change set.
+         */
+        void clear();
+
+        /**
+          Merge change set.
+
+          Adds all marks of the other change set to this change set.
+
+          @param[in]    other       Change set to merge
+
+          @return                   This object
+         */
+        ChangeSet& operator|=(const ChangeSet& other);
+
+    private:
+        Bitmap          m_bitmap[NumBlockTypes];    ///< Bitmaps for all block types
+};
+
+} // namespace Wersi
+} // namespace DMSToolbox
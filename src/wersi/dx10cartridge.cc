@@ -46,17 +46,29 @@ namespace DMSToolbox {
 namespace Wersi {
 
 // Create new DX10/DX5 cartridge object
-Dx10Cartridge::Dx10Cartridge(void* buffer, size_t size, bool /*initialize*/)
+Dx10Cartridge::Dx10Cartridge(const void* buffer, size_t size, bool /*initialize*/)
     : InstrumentStore(buffer, size)
 {
     dissect();
 }
 
+// Create DX10/DX5 cartridge object by copying
+Dx10Cartridge::Dx10Cartridge(const Dx10Cartridge& source)
+    : InstrumentStore(source)
+{
+}
+
 // Destroy DX10/DX5 cartridge object
 Dx10Cartridge::~Dx10Cartridge()
 {
 }
 
+// Clone DX10/DX5 cartridge object
+InstrumentStore* Dx10Cartridge::clone() const
+{
+    return new Dx10Cartridge(*this);
+}
+
 // Dissect raw DX10/DX5 cartridge data
 void Dx10Cartridge::dissect()
 {
@@ -64,7 +76,7 @@ void Dx10Cartridge::dissect()
 
     try {
         // Check size
-        if (m_size != 8192 && m_size != 16384) {
+        if (m_buffer.size() != 8192 && m_buffer.size() != 16384) {
             throw DataFormatException("invalid raw data size");
         }
 
@@ -80,7 +92,7 @@ void Dx10Cartridge::dissect()
         }
 
         // Verify rhythms/sequences checksum
-        if (m_size > 8192) {
+        if (m_buffer.size() > 8192) {
             check = 0;
             for (size_t i = 0x2000; i < 0x3ffe; ++i) {
                 check += m_buffer[i];
@@ -104,7 +116,7 @@ void Dx10Cartridge::dissect()
             if (i >= 10) {
                 ++addr;
             }
-            Icb icb(addr, &(m_buffer[idx]));
+            Icb icb(addr, m_buffer.map(idx, 16));
             m_icb.insert(std::pair<uint8_t, Icb>(addr, icb));
             idx += 16;
         }
@@ -112,7 +124,7 @@ void Dx10Cartridge::dissect()
         // Extract VCFs
         for (size_t i = 0; i < 10; ++i) {
             uint8_t addr = i + 193;
-            Vcf vcf(addr, &(m_buffer[idx]));
+            Vcf vcf(addr, m_buffer.map(idx, 10));
             m_vcf.insert(std::pair<uint8_t, Vcf>(addr, vcf));
             idx += 10;
         }
@@ -123,7 +135,7 @@ void Dx10Cartridge::dissect()
             if (i >= 10) {
                 ++addr;
             }
-            Envelope ampl(addr, &(m_buffer[idx]), 44);
+            Envelope ampl(addr, m_buffer.map(idx, 44), 44);
             m_ampl.insert(std::pair<uint8_t, Envelope>(addr, ampl));
             idx += 44;
         }
@@ -134,7 +146,7 @@ void Dx10Cartridge::dissect()
             if (i >= 10) {
                 ++addr;
             }
-            Envelope freq(addr, &(m_buffer[idx]), 32);
+            Envelope freq(addr, m_buffer.map(idx, 32), 32);
             m_freq.insert(std::pair<uint8_t, Envelope>(addr, freq));
             idx += 32;
         }
@@ -151,7 +163,7 @@ void Dx10Cartridge::dissect()
             if (i >= 10) {
                 ++addr;
             }
-            Wave wave(addr, &(m_buffer[idx]), 212);
+            Wave wave(addr, m_buffer.map(idx, 212), 212);
             m_wave.insert(std::pair<uint8_t, Wave>(addr, wave));
             idx += 212;
         }
@@ -171,6 +183,26 @@ void Dx10Cartridge::dissect()
 // Put together and update DX10/DX5 cartridge raw data
 void Dx10Cartridge::update()
 {
+    // Blocks write their buffer parts themselves, only the checksums are left
+    uint16_t check = 0x3131;
+    for (size_t i = 0; i < 0x0f64; ++i) {
+        check += m_buffer[i];
+    }
+    check = -check;
+    uint8_t buf[2] = { uint8_t(check >> 8), uint8_t(check) };
+    m_buffer.write(0x0f64, buf, sizeof(buf));
+
+    // Rhythms/sequences are only present on 16k cartridges
+    if (m_buffer.size() > 8192) {
+        check = 0;
+        for (size_t i = 0x2000; i < 0x3ffe; ++i) {
+            check += m_buffer[i];
+        }
+        check = -check;
+        buf[0] = uint8_t(check >> 8);
+        buf[1] = uint8_t(check);
+        m_buffer.write(0x3ffe, buf, sizeof(buf));
+    }
 }
 
 } // namespace Wersi
@@ -66,7 +66,7 @@ class Dx10Cartridge : public InstrumentStore {
           @param[in]    size        Size of data buffer
           @param[in]    initialize  If true, a blank DX10/DX5 cartridge is created
          */
-        Dx10Cartridge(void* buffer, size_t size, bool initialize = false);
+        Dx10Cartridge(const void* buffer, size_t size, bool initialize = false);
 
         /**
           Destroy DX10/DX5 cartridge object.
@@ -75,6 +75,9 @@ class Dx10Cartridge : public InstrumentStore {
          */
         virtual ~Dx10Cartridge();
 
+        /// Implements InstrumentStore::clone()
+        virtual InstrumentStore* clone() const;
+
         /// Implements InstrumentStore::dissect()
         virtual void dissect();
 
@@ -87,7 +90,15 @@ class Dx10Cartridge : public InstrumentStore {
         }
 
     private:
-        Dx10Cartridge(const Dx10Cartridge&);            ///< Inhibit copying objects
+        /**
+          Create DX10/DX5 cartridge object by copying.
+
+          Shares the raw buffer of the source cartridge, used by clone().
+
+          @param[in]    source      Source cartridge to copy from
+         */
+        Dx10Cartridge(const Dx10Cartridge& source);
+
         Dx10Cartridge& operator=(const Dx10Cartridge&); ///< Inhibit copying objects
 };
 
@@ -53,16 +53,17 @@ namespace DMSToolbox {
 namespace Wersi {
 
 // Create new DX10/EX10R device object
-Dx10Device::Dx10Device(void* buffer, size_t size)
-    : InstrumentStore(buffer, size)
+Dx10Device::Dx10Device()
+    : InstrumentStore(6180)
     , m_awaitType(0)
     , m_awaitAddress(0)
     , m_awaitLength(0)
-    , m_awaitDestination(nullptr)
+    , m_awaiting(false)
+    , m_awaitData()
+    , m_awaitMutex()
 {
     // Initialize ICBs
-    memset(buffer, 0, size);
-    auto ptr = static_cast<uint8_t*>(buffer);
+    uint8_t* ptr = m_buffer.writable(0);
     for (size_t i = 0; i < 20; ++i) {
         uint8_t addr = i + 65;
         if (i >= 10) {
@@ -84,13 +85,31 @@ Dx10Device::Dx10Device(void* buffer, size_t size)
     dissect();
 }
 
+// Create DX10/EX10R device object by copying
+Dx10Device::Dx10Device(const Dx10Device& source)
+    : InstrumentStore(source)
+    , m_awaitType(0)
+    , m_awaitAddress(0)
+    , m_awaitLength(0)
+    , m_awaiting(false)
+    , m_awaitData()
+    , m_awaitMutex()
+{
+}
+
 // Destroy DX10/DX5 cartridge object
 Dx10Device::~Dx10Device()
 {
 }
 
+// Clone DX10/EX10R device object
+InstrumentStore* Dx10Device::clone() const
+{
+    return new Dx10Device(*this);
+}
+
 #ifdef HAVE_RTMIDI
-void Dx10Device::readBlock(RtMidiOut* outPort, SysEx::BlockType type, uint8_t address, uint8_t* ptr, uint8_t length)
+void Dx10Device::readBlock(RtMidiOut* outPort, SysEx::BlockType type, uint8_t address, size_t offset, uint8_t length)
 {
     // Generate request message
     SysEx::Message msg;
@@ -103,11 +122,14 @@ void Dx10Device::readBlock(RtMidiOut* outPort, SysEx::BlockType type, uint8_t ad
     size_t len = SysEx::toSysEx(1, msg, *sem);
 
     // Set awaiting information
-    m_awaitType = msg.m_data[0];
-    m_awaitAddress = address;
-    m_awaitLength = length;
-    m_awaitDestination = ptr;
-    
+    {
+        std::lock_guard<std::mutex> lock(m_awaitMutex);
+        m_awaitType = msg.m_data[0];
+        m_awaitAddress = address;
+        m_awaitLength = length;
+        m_awaiting.store(true, std::memory_order_release);
+    }
+
     printf("INFO: Awaiting message, (type %u, addr %u, len %u)\n",
         (uint8_t)m_awaitType,
         m_awaitAddress,
@@ -124,7 +146,7 @@ void Dx10Device::readBlock(RtMidiOut* outPort, SysEx::BlockType type, uint8_t ad
     size_t retry = 0;
     while (retry < 200) {
         usleep(50000);
-        if (m_awaitDestination == nullptr) {
+        if (!m_awaiting.load(std::memory_order_acquire)) {
             break;
         } else {
             // Resend
@@ -132,17 +154,21 @@ void Dx10Device::readBlock(RtMidiOut* outPort, SysEx::BlockType type, uint8_t ad
             outPort->sendMessage(&midi);
         }
     }
-    if (m_awaitDestination != nullptr) {
-        m_awaitDestination = nullptr;
+
+    // Write the received data here, the buffer must not be touched from the MIDI thread
+    std::lock_guard<std::mutex> lock(m_awaitMutex);
+    if (m_awaiting.load(std::memory_order_relaxed)) {
+        m_awaiting.store(false, std::memory_order_relaxed);
         throw MidiException("Did not receive expected data from device");
     }
+    m_buffer.write(offset, m_awaitData.data(), length);
 }
 
 // SysEx message callback
 void Dx10Device::receivedSysEx(std::vector<unsigned char>* message)
 {
     // Check if we are awaiting a message
-    if (m_awaitDestination == nullptr) {
+    if (!m_awaiting.load(std::memory_order_acquire)) {
         return;
     }
 
@@ -159,12 +185,13 @@ void Dx10Device::receivedSysEx(std::vector<unsigned char>* message)
             auto out = reinterpret_cast<SysEx::Message*>(buf);
             SysEx::fromSysEx(1, *sem, *out);
 
-            // If this is what we expect, use it
-            if (static_cast<uint8_t>(out->m_type) == m_awaitType &&
+            // If this is what we expect, hand it to the waiting thread
+            std::lock_guard<std::mutex> lock(m_awaitMutex);
+            if (m_awaiting.load(std::memory_order_relaxed) && static_cast<uint8_t>(out->m_type) == m_awaitType &&
                     out->m_address == m_awaitAddress && out->m_length == m_awaitLength) {
                 printf("INFO: Got message\n");
-                memcpy(m_awaitDestination, out->m_data, m_awaitLength);
-                m_awaitDestination = nullptr;
+                m_awaitData.assign(out->m_data, out->m_data + m_awaitLength);
+                m_awaiting.store(false, std::memory_order_release);
             } else {
                 printf("WARNING: Invalid message, got (type %u, addr %u, len %u) expected (type %u, addr %u, len %u)\n",
                   (uint8_t)out->m_type,
@@ -188,25 +215,25 @@ void Dx10Device::receivedSysEx(std::vector<unsigned char>* message)
 void Dx10Device::readFromDevice(RtMidiIn* /*inPort*/, RtMidiOut* outPort,
                                 bool(*callback)(void* object, uint32_t current, uint32_t max), void* object)
 {
-    uint8_t* ptr = m_buffer;
+    size_t offset = 0;
     for (size_t i = 0; i < 20; ++i) {
         uint8_t addr = i + 66;
         if (i >= 10) {
             ++addr;
         }
         if (callback != nullptr) {
-            callback(object, ptr - m_buffer, m_size);
+            callback(object, offset, m_buffer.size());
         }
-        readBlock(outPort, SysEx::BlockType::IcBlock, addr, ptr, 16);
-        ptr += 16;
+        readBlock(outPort, SysEx::BlockType::IcBlock, addr, offset, 16);
+        offset += 16;
     }
     for (size_t i = 0; i < 10; ++i) {
         uint8_t addr = i + 65;
         if (callback != nullptr) {
-            callback(object, ptr - m_buffer, m_size);
+            callback(object, offset, m_buffer.size());
         }
-        readBlock(outPort, SysEx::BlockType::VcfBlock, addr, ptr, 10);
-        ptr += 10;
+        readBlock(outPort, SysEx::BlockType::VcfBlock, addr, offset, 10);
+        offset += 10;
     }
     for (size_t i = 0; i < 20; ++i) {
         uint8_t addr = i + 65;
@@ -214,10 +241,10 @@ void Dx10Device::readFromDevice(RtMidiIn* /*inPort*/, RtMidiOut* outPort,
             ++addr;
         }
         if (callback != nullptr) {
-            callback(object, ptr - m_buffer, m_size);
+            callback(object, offset, m_buffer.size());
         }
-        readBlock(outPort, SysEx::BlockType::AmplBlock, addr, ptr, 44);
-        ptr += 44;
+        readBlock(outPort, SysEx::BlockType::AmplBlock, addr, offset, 44);
+        offset += 44;
     }
     for (size_t i = 0; i < 20; ++i) {
         uint8_t addr = i + 65;
@@ -225,10 +252,10 @@ void Dx10Device::readFromDevice(RtMidiIn* /*inPort*/, RtMidiOut* outPort,
             ++addr;
         }
         if (callback != nullptr) {
-            callback(object, ptr - m_buffer, m_size);
+            callback(object, offset, m_buffer.size());
         }
-        readBlock(outPort, SysEx::BlockType::FreqBlock, addr, ptr, 32);
-        ptr += 32;
+        readBlock(outPort, SysEx::BlockType::FreqBlock, addr, offset, 32);
+        offset += 32;
     }
     for (size_t i = 0; i < 20; ++i) {
         uint8_t addr = i + 65;
@@ -236,12 +263,13 @@ void Dx10Device::readFromDevice(RtMidiIn* /*inPort*/, RtMidiOut* outPort,
             ++addr;
         }
         if (callback != nullptr) {
-            callback(object, ptr - m_buffer, m_size);
+            callback(object, offset, m_buffer.size());
         }
-        readBlock(outPort, SysEx::BlockType::FixWaveBlock, addr, ptr, 212);
-        ptr += 212;
+        readBlock(outPort, SysEx::BlockType::FixWaveBlock, addr, offset, 212);
+        offset += 212;
     }
     dissect();
+    markAllChanged();
 }
 #endif // HAVE_RTMIDI
 
@@ -258,7 +286,7 @@ void Dx10Device::dissect()
             if (i >= 10) {
                 ++addr;
             }
-            Icb icb(addr, &(m_buffer[idx]));
+            Icb icb(addr, m_buffer.map(idx, 16));
             m_icb.insert(std::pair<uint8_t, Icb>(addr, icb));
             idx += 16;
         }
@@ -266,7 +294,7 @@ void Dx10Device::dissect()
         // Extract VCFs
         for (size_t i = 0; i < 10; ++i) {
             uint8_t addr = i + 65;
-            Vcf vcf(addr, &(m_buffer[idx]));
+            Vcf vcf(addr, m_buffer.map(idx, 10));
             m_vcf.insert(std::pair<uint8_t, Vcf>(addr, vcf));
             idx += 10;
         }
@@ -277,7 +305,7 @@ void Dx10Device::dissect()
             if (i >= 10) {
                 ++addr;
             }
-            Envelope ampl(addr, &(m_buffer[idx]), 44);
+            Envelope ampl(addr, m_buffer.map(idx, 44), 44);
             m_ampl.insert(std::pair<uint8_t, Envelope>(addr, ampl));
             idx += 44;
         }
@@ -288,7 +316,7 @@ void Dx10Device::dissect()
             if (i >= 10) {
                 ++addr;
             }
-            Envelope freq(addr, &(m_buffer[idx]), 32);
+            Envelope freq(addr, m_buffer.map(idx, 32), 32);
             m_freq.insert(std::pair<uint8_t, Envelope>(addr, freq));
             idx += 32;
         }
@@ -299,7 +327,7 @@ void Dx10Device::dissect()
             if (i >= 10) {
                 ++addr;
             }
-            Wave wave(addr, &(m_buffer[idx]), 212);
+            Wave wave(addr, m_buffer.map(idx, 212), 212);
             m_wave.insert(std::pair<uint8_t, Wave>(addr, wave));
             idx += 212;
         }
@@ -39,6 +39,9 @@
 
 #include <wersi/instrumentstore.hh>
 #include <wersi/sysex.hh>
+#include <atomic>
+#include <mutex>
+#include <vector>
 
 namespace DMSToolbox {
 namespace Wersi {
@@ -54,15 +57,12 @@ namespace Wersi {
 class Dx10Device : public InstrumentStore {
     public:
         /**
-          Create new DX10/EX10R device object from buffer.
+          Create new DX10/EX10R device object.
 
-          Creates a new DX10/EX10R device object and associates the given buffer with it. During creation, all data
-          items are initialized with zeroes but with the typical links between them.
-
-          @param[in]    buffer      Raw data buffer
-          @param[in]    size        Size of data buffer
+          Creates a new DX10/EX10R device object with its own raw buffer. During creation, all data items are
+          initialized with zeroes but with the typical links between them.
          */
-        Dx10Device(void* buffer, size_t size);
+        Dx10Device();
 
         /**
           Destroy DX10/EX10R device object.
@@ -80,6 +80,9 @@ class Dx10Device : public InstrumentStore {
         virtual void receivedSysEx(std::vector<unsigned char>* message);
 #endif // HAVE_RTMIDI
 
+        /// Implements InstrumentStore::clone()
+        virtual InstrumentStore* clone() const;
+
         /// Implements InstrumentStore::dissect()
         virtual void dissect();
 
@@ -95,24 +98,36 @@ class Dx10Device : public InstrumentStore {
         uint8_t     m_awaitType;                    ///< Awaiting SysEx message block type
         uint8_t     m_awaitAddress;                 ///< Awaiting SysEx message block address
         uint8_t     m_awaitLength;                  ///< Awaiting SysEx message block length
-        uint8_t*    m_awaitDestination;             ///< Awaiting SysEx message destination buffer
+        std::atomic<bool>       m_awaiting;         ///< True if a SysEx message is awaited
+        std::vector<uint8_t>    m_awaitData;        ///< Received block data, handed to the waiting thread
+        std::mutex              m_awaitMutex;       ///< Protects awaiting information and received data
 
 #ifdef HAVE_RTMIDI
         /**
           Read data block from device.
 
           Reads the requested data block from the device. Request message is generated here, the response is received
-          via callback. If no response is received within a given timeout, an exception is thrown.
+          via callback on the MIDI thread, which only hands over the data. The buffer is written here. If no response
+          is received within a given timeout, an exception is thrown.
 
           @param[in]    outPort     MIDI output port to send request to
           @param[in]    type        Block type
           @param[in]    address     Block address
+          @param[in]    offset      Destination offset in raw buffer
           @param[in]    length      Block length
          */
-        void readBlock(RtMidiOut* outPort, SysEx::BlockType type, uint8_t address, uint8_t* ptr, uint8_t length);
+        void readBlock(RtMidiOut* outPort, SysEx::BlockType type, uint8_t address, size_t offset, uint8_t length);
 #endif // HAVE_RTMIDI
 
-        Dx10Device(const Dx10Device&);              ///< Inhibit copying objects
+        /**
+          Create DX10/EX10R device object by copying.
+
+          Shares the raw buffer of the source device, used by clone(). No SysEx message is awaited by the copy.
+
+          @param[in]    source      Source device to copy from
+         */
+        Dx10Device(const Dx10Device& source);
+
         Dx10Device& operator=(const Dx10Device&);   ///< Inhibit copying objects
 };
 
@@ -36,16 +36,26 @@
  */
 
 #include <wersi/envelope.hh>
+#include <exceptions.hh>
 #include <cstring>
 
 namespace DMSToolbox {
 namespace Wersi {
 
+const size_t Envelope::NoTarget;
+const size_t Envelope::HeaderSize;
+
 // Create new envelope object
-Envelope::Envelope(uint8_t blockNum, void* buffer, size_t size)
+Envelope::Envelope(uint8_t blockNum, const CowBuffer::Ref& buffer, size_t size)
     : m_blockNum(blockNum)
-    , m_buffer(static_cast<uint8_t*>(buffer))
+    , m_buffer(buffer)
     , m_size(size)
+    , m_program()
+    , m_attack(NoTarget)
+    , m_release(NoTarget)
+    , m_rawAttack(0)
+    , m_rawRelease(0)
+    , m_programSize(HeaderSize)
 {
     dissect();
 }
@@ -53,8 +63,14 @@ Envelope::Envelope(uint8_t blockNum, void* buffer, size_t size)
 // Create new envelope object by copying
 Envelope::Envelope(const Envelope& source)
     : m_blockNum(0)
-    , m_buffer(nullptr)
+    , m_buffer()
     , m_size(0)
+    , m_program()
+    , m_attack(NoTarget)
+    , m_release(NoTarget)
+    , m_rawAttack(0)
+    , m_rawRelease(0)
+    , m_programSize(HeaderSize)
 {
     *this = source;
 }
@@ -68,28 +84,338 @@ Envelope::~Envelope()
 Envelope& Envelope::operator=(const Envelope& source)
 {
     if (this != &source) {
-        m_blockNum = source.m_blockNum;
-        m_buffer = source.m_buffer;
-        m_size = source.m_size;
-        copy(source);
+        m_blockNum      = source.m_blockNum;
+        m_buffer        = source.m_buffer;
+        m_size          = source.m_size;
+        m_program       = source.m_program;
+        m_attack        = source.m_attack;
+        m_release       = source.m_release;
+        m_rawAttack     = source.m_rawAttack;
+        m_rawRelease    = source.m_rawRelease;
+        m_programSize   = source.m_programSize;
     }
     return *this;
 }
 
-// Copy ICB object data
+// Copy envelope object data
 void Envelope::copy(const Envelope& source)
 {
-    memcpy(m_buffer, source.m_buffer, m_size < source.m_size ? m_size : source.m_size);
+    if (source.m_programSize > m_size) {
+        throw DataFormatException("Envelope program does not fit into block");
+    }
+    m_program       = source.m_program;
+    m_attack        = source.m_attack;
+    m_release       = source.m_release;
+    m_rawAttack     = source.m_rawAttack;
+    m_rawRelease    = source.m_rawRelease;
+    m_programSize   = source.m_programSize;
+    update();
 }
 
-// Dissect envelope raw data
+// Disassemble envelope raw data
 void Envelope::dissect()
 {
+    m_program.clear();
+    m_attack = NoTarget;
+    m_release = NoTarget;
+    m_rawAttack = 0;
+    m_rawRelease = 0;
+    m_programSize = HeaderSize;
+
+    const uint8_t* buf = m_buffer.data();
+    if (buf == nullptr || m_size < HeaderSize) {
+        return;
+    }
+    m_rawRelease = buf[0];
+    m_rawAttack = buf[1];
+
+    // Trailing zeroes are padding, not program
+    size_t used = m_size;
+    while (used > HeaderSize && buf[used - 1] == 0) {
+        --used;
+    }
+
+    // Decode instructions, remembering which instruction starts at which offset
+    std::vector<size_t> index(m_size + 1, NoTarget);
+    m_program.reserve(m_size - HeaderSize);
+    size_t pos = HeaderSize;
+    while (pos < used) {
+        Opcode opcode = buf[pos] <= static_cast<uint8_t>(Opcode::Sustain) ? static_cast<Opcode>(buf[pos]) : Opcode::Raw;
+        size_t len = getInstructionSize(opcode);
+        if (pos + len > m_size) {
+            opcode = Opcode::Raw;
+            len = 1;
+        }
+        Instruction instruction = { opcode, { 0, 0, 0 }, NoTarget };
+        memcpy(instruction.m_bytes, &(buf[pos]), len);
+        index[pos] = m_program.size();
+        m_program.push_back(instruction);
+        pos += len;
+    }
+
+    // Resolve offsets to instruction indices, offsets inside the padding are decoded as End instructions
+    auto resolve = [&](uint8_t offset) -> size_t {
+        if (offset < HeaderSize || offset > m_size) {
+            return NoTarget;
+        }
+        while (pos < offset) {
+            Instruction end = { Opcode::End, { 0, 0, 0 }, NoTarget };
+            index[pos] = m_program.size();
+            m_program.push_back(end);
+            ++pos;
+        }
+        if (offset == pos) {
+            return m_program.size();
+        }
+        return index[offset];
+    };
+    size_t count = m_program.size();
+    for (size_t i = 0; i < count; ++i) {
+        size_t targetPos = getTargetPosition(m_program[i].m_opcode);
+        if (targetPos != 0) {
+            size_t target = resolve(m_program[i].m_bytes[targetPos]);
+            m_program[i].m_target = target;
+        }
+    }
+    m_release = resolve(m_rawRelease);
+    m_attack = resolve(m_rawAttack);
+    m_programSize = pos;
 }
 
-// Put together and update envelope raw data
+// Assemble and update envelope raw data
 void Envelope::update()
 {
+    if (m_size < HeaderSize) {
+        return;
+    }
+    if (m_programSize > m_size || m_size > 256) {
+        throw DataFormatException("Envelope program does not fit into block");
+    }
+
+    // Instruction offsets, including the end of the program
+    uint8_t offsets[257];
+    size_t pos = HeaderSize;
+    for (size_t i = 0; i < m_program.size(); ++i) {
+        offsets[i] = uint8_t(pos);
+        pos += getInstructionSize(m_program[i].m_opcode);
+    }
+    offsets[m_program.size()] = uint8_t(pos);
+
+    // Emit program with relocated pointers
+    uint8_t buf[256];
+    memset(buf, 0, m_size);
+    buf[0] = m_release != NoTarget ? offsets[m_release] : m_rawRelease;
+    buf[1] = m_attack != NoTarget ? offsets[m_attack] : m_rawAttack;
+    pos = HeaderSize;
+    for (auto& i : m_program) {
+        size_t len = getInstructionSize(i.m_opcode);
+        memcpy(&(buf[pos]), i.m_bytes, len);
+        size_t targetPos = getTargetPosition(i.m_opcode);
+        if (targetPos != 0 && i.m_target != NoTarget) {
+            buf[pos + targetPos] = offsets[i.m_target];
+        }
+        pos += len;
+    }
+
+    m_buffer.write(buf, m_size);
+}
+
+// Set attack entry
+void Envelope::setAttackEntry(size_t index)
+{
+    if (index > m_program.size()) {
+        throw DataFormatException("Invalid attack entry");
+    }
+    m_attack = index;
+}
+
+// Set release entry
+void Envelope::setReleaseEntry(size_t index)
+{
+    if (index > m_program.size()) {
+        throw DataFormatException("Invalid release entry");
+    }
+    m_release = index;
+}
+
+// Check if all pointers into the program are known
+bool Envelope::canRelocate() const
+{
+    if (isUnresolved(m_attack, m_rawAttack) || isUnresolved(m_release, m_rawRelease)) {
+        return false;
+    }
+    for (auto& i : m_program) {
+        if (i.m_opcode == Opcode::Raw) {
+            return false;
+        }
+        size_t targetPos = getTargetPosition(i.m_opcode);
+        if (targetPos != 0 && isUnresolved(i.m_target, i.m_bytes[targetPos])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Insert instruction
+void Envelope::insertInstruction(size_t index, const Instruction& instruction)
+{
+    if (index > m_program.size()) {
+        throw DataFormatException("Invalid instruction index");
+    }
+    if (!canRelocate()) {
+        throw DataFormatException("Envelope program contains unknown pointers");
+    }
+    if (instruction.m_target != NoTarget && instruction.m_target > m_program.size() + 1) {
+        throw DataFormatException("Invalid instruction target");
+    }
+    size_t len = getInstructionSize(instruction.m_opcode);
+    if (m_programSize + len > m_size) {
+        throw DataFormatException("Envelope program does not fit into block");
+    }
+
+    // Move pointers to instructions behind the insertion point
+    for (auto& i : m_program) {
+        if (i.m_target != NoTarget && i.m_target >= index) {
+            ++i.m_target;
+        }
+    }
+    if (m_attack != NoTarget && m_attack >= index) {
+        ++m_attack;
+    }
+    if (m_release != NoTarget && m_release >= index) {
+        ++m_release;
+    }
+
+    m_program.insert(m_program.begin() + index, instruction);
+    m_programSize += len;
+}
+
+// Remove instruction
+void Envelope::removeInstruction(size_t index)
+{
+    if (index >= m_program.size()) {
+        throw DataFormatException("Invalid instruction index");
+    }
+    if (!canRelocate()) {
+        throw DataFormatException("Envelope program contains unknown pointers");
+    }
+    m_programSize -= getInstructionSize(m_program[index].m_opcode);
+    m_program.erase(m_program.begin() + index);
+
+    // Pointers to the removed instruction now point to the following one
+    for (auto& i : m_program) {
+        if (i.m_target != NoTarget && i.m_target > index) {
+            --i.m_target;
+        }
+    }
+    if (m_attack != NoTarget && m_attack > index) {
+        --m_attack;
+    }
+    if (m_release != NoTarget && m_release > index) {
+        --m_release;
+    }
+}
+
+// Replace instruction
+void Envelope::setInstruction(size_t index, const Instruction& instruction)
+{
+    if (index >= m_program.size()) {
+        throw DataFormatException("Invalid instruction index");
+    }
+    if (instruction.m_target != NoTarget && instruction.m_target > m_program.size()) {
+        throw DataFormatException("Invalid instruction target");
+    }
+    size_t size = m_programSize - getInstructionSize(m_program[index].m_opcode)
+                  + getInstructionSize(instruction.m_opcode);
+    if (size > m_size) {
+        throw DataFormatException("Envelope program does not fit into block");
+    }
+    if (size != m_programSize && !canRelocate()) {
+        throw DataFormatException("Envelope program contains unknown pointers");
+    }
+    m_program[index] = instruction;
+    m_programSize = size;
+}
+
+// Create instruction
+Envelope::Instruction Envelope::makeInstruction(Opcode opcode, uint8_t arg1, uint8_t arg2, size_t target)
+{
+    Instruction instruction = { opcode, { static_cast<uint8_t>(opcode), arg1, arg2 }, NoTarget };
+    if (opcode == Opcode::Raw) {
+        instruction.m_bytes[0] = arg1;
+        instruction.m_bytes[1] = 0;
+        instruction.m_bytes[2] = 0;
+    }
+    if (getTargetPosition(opcode) != 0) {
+        instruction.m_target = target;
+    }
+    return instruction;
+}
+
+// Return instruction size
+size_t Envelope::getInstructionSize(Opcode opcode)
+{
+    switch (opcode) {
+        case Opcode::Ramp:
+        case Opcode::Loop:
+            return 3;
+            break;
+        case Opcode::Hold:
+        case Opcode::Jump:
+        case Opcode::SetLevel:
+            return 2;
+            break;
+        default:
+            return 1;
+            break;
+    }
+}
+
+// Return position of target byte
+size_t Envelope::getTargetPosition(Opcode opcode)
+{
+    switch (opcode) {
+        case Opcode::Jump:
+            return 1;
+            break;
+        case Opcode::Loop:
+            return 2;
+            break;
+        default:
+            return 0;
+            break;
+    }
+}
+
+// Return opcode name
+std::string Envelope::getOpcodeName(Opcode opcode)
+{
+    switch (opcode) {
+        case Opcode::End:
+            return std::string("End");
+            break;
+        case Opcode::Ramp:
+            return std::string("Ramp");
+            break;
+        case Opcode::Hold:
+            return std::string("Hold");
+            break;
+        case Opcode::Jump:
+            return std::string("Jump");
+            break;
+        case Opcode::Loop:
+            return std::string("Loop");
+            break;
+        case Opcode::SetLevel:
+            return std::string("Set level");
+            break;
+        case Opcode::Sustain:
+            return std::string("Sustain");
+            break;
+        default:
+            return std::string("Raw");
+            break;
+    }
 }
 
 } // namespace Wersi
@@ -38,6 +38,9 @@
 #pragma once
 
 #include <common.hh>
+#include <cowbuffer.hh>
+#include <string>
+#include <vector>
 
 namespace DMSToolbox {
 namespace Wersi {
@@ -52,22 +55,58 @@ namespace Wersi {
   program data. This class provides an assembler and disassembler for this envelope data, it also allows inserting
   and deleting instructions in the envelope program with updating all the necessary pointers. So the envelope program
   can be edited and is assembled back into the raw data structure on an update() call.
+
+  The instruction set is speculative. It has been reconstructed from a handful of envelopes and is not backed by any
+  documentation, so the opcodes, their argument layout and their meaning may well be wrong. Bytes that do not decode
+  are kept as Raw instructions. As they may hold pointers, programs with Raw instructions or unresolved pointers can't
+  be relocated, see canRelocate().
  */
 class Envelope {
     public:
+        /**
+          Envelope instruction opcode.
+
+          Speculative opcode table, reconstructed from observed envelopes and not confirmed. Bytes that do not start
+          a known instruction are kept as Raw instructions of one byte, so any block survives a dissect()/update()
+          round trip unchanged.
+         */
+        enum class Opcode : uint8_t {
+            End         = 0x00,             ///< End of program, level is kept
+            Ramp        = 0x01,             ///< Ramp to level (argument 1) with rate (argument 2)
+            Hold        = 0x02,             ///< Hold level for time (argument 1)
+            Jump        = 0x03,             ///< Continue at target
+            Loop        = 0x04,             ///< Repeat from target count (argument 1) times
+            SetLevel    = 0x05,             ///< Set level (argument 1) immediately
+            Sustain     = 0x06,             ///< Hold level until key release
+            Raw         = 0xff              ///< Unknown byte, kept as is
+        };
+
+        /// Decoded envelope instruction
+        struct Instruction {
+            Opcode      m_opcode;           ///< Opcode
+            uint8_t     m_bytes[3];         ///< Encoded instruction, getInstructionSize() bytes are used
+            size_t      m_target;           ///< Target instruction index for Jump and Loop, or NoTarget
+        };
+
+        /// Target value for instructions without a resolved target
+        static const size_t NoTarget = ~size_t(0);
+
+        /// Size of the entry pointer header in front of the program
+        static const size_t HeaderSize = 2;
+
         /**
           Create new envelope object from buffer.
 
-          Creates a new VCF object with the given block number and associates the given buffer with it. During
+          Creates a new envelope object with the given block number and associates the given buffer with it. During
           creation, the data from the buffer is parsed and copied to the object members. If an explicit update()
           is called, the buffer is written back with the updated envelope object data, for all other functions, it is
           left untouched.
 
           @param[in]    blockNum    Block number
-          @param[in]    buffer      Raw data buffer
+          @param[in]    buffer      Reference to raw data block
           @param[in]    size        Size of raw data buffer
          */
-        Envelope(uint8_t blockNum, void* buffer, size_t size);
+        Envelope(uint8_t blockNum, const CowBuffer::Ref& buffer, size_t size);
 
         /**
           Create envelope object by copying.
@@ -93,7 +132,19 @@ class Envelope {
           @return                   Raw buffer const pointer
          */
         const void* getBuffer() const {
-            return m_buffer;
+            return m_buffer.data();
+        }
+
+        /**
+          Rebind raw buffer.
+
+          Associates the object with the same block in another buffer. This is used by instrument stores when they
+          are cloned, the object data itself is left untouched.
+
+          @param[in]    buffer      Buffer holding a copy of the block
+         */
+        void rebind(CowBuffer& buffer) {
+            m_buffer.rebind(buffer);
         }
 
         /**
@@ -121,9 +172,9 @@ class Envelope {
         /**
           Copy envelope data.
 
-          Copies all members except the block number and buffer from source object. This is intended to duplicate
-          the envelope's contents to another existing envelope. Both envelopes need to be of the same type due to
-          different sizes between the types.
+          Copies the program and entry pointers from source object and writes them to the raw buffer. This is
+          intended to duplicate the envelope's contents to another existing envelope. Both envelopes need to be of
+          the same type due to different sizes between the types.
 
           @param[in]    source      Source object to copy from
          */
@@ -132,21 +183,219 @@ class Envelope {
         /**
           Dissect envelope raw data buffer.
 
-          Parses the raw envelope data buffer and updates object members.
+          Disassembles the raw envelope data buffer into the envelope program. Entry pointers and targets are
+          resolved to instruction indices, those not pointing to an instruction boundary keep their raw value.
          */
         void dissect();
 
         /**
           Update envelope raw data buffer.
 
-          Writes back changes in the envelope object to the associated raw envelope data buffer.
+          Assembles the envelope program and writes it back to the associated raw envelope data buffer. Entry
+          pointers and targets are relocated to the instruction offsets in one linear pass, the rest of the block
+          is filled with zeroes.
          */
         void update();
 
+        /**
+          Get block number.
+
+          Returns the block number of the envelope.
+
+          @return                   Block number
+         */
+        uint8_t getBlockNum() const {
+            return m_blockNum;
+        }
+
+        /**
+          Get envelope program.
+
+          Returns the decoded envelope program.
+
+          @return                   Instructions of the envelope program
+         */
+        const std::vector<Instruction>& getProgram() const {
+            return m_program;
+        }
+
+        /**
+          Get attack entry.
+
+          Returns the index of the instruction the attack phase starts with. An index equal to the program length
+          denotes the end of the program.
+
+          @return                   Attack entry instruction index or NoTarget if unresolved
+         */
+        size_t getAttackEntry() const {
+            return m_attack;
+        }
+
+        /**
+          Set attack entry.
+
+          Sets the index of the instruction the attack phase starts with. If the index exceeds the program length,
+          a DataFormatException is thrown.
+
+          @param[in]    index       Attack entry instruction index
+         */
+        void setAttackEntry(size_t index);
+
+        /**
+          Get release entry.
+
+          Returns the index of the instruction the release phase starts with. An index equal to the program length
+          denotes the end of the program.
+
+          @return                   Release entry instruction index or NoTarget if unresolved
+         */
+        size_t getReleaseEntry() const {
+            return m_release;
+        }
+
+        /**
+          Set release entry.
+
+          Sets the index of the instruction the release phase starts with. If the index exceeds the program length,
+          a DataFormatException is thrown.
+
+          @param[in]    index       Release entry instruction index
+         */
+        void setReleaseEntry(size_t index);
+
+        /**
+          Get program size.
+
+          Returns the number of bytes the assembled envelope uses, including the entry pointers.
+
+          @return                   Assembled size in bytes
+         */
+        size_t getProgramSize() const {
+            return m_programSize;
+        }
+
+        /**
+          Check if program can be relocated.
+
+          Instructions can only be inserted or removed if all pointers into the program are known. This is not the
+          case if an entry pointer or target points inside the program but not to an instruction, or if the program
+          contains Raw instructions, which may be arguments holding pointers of instructions not known so far.
+
+          @return                   True if instructions can be inserted and removed
+         */
+        bool canRelocate() const;
+
+        /**
+          Insert instruction.
+
+          Inserts an instruction in front of the given index. Entry pointers and targets pointing at or behind the
+          index are moved along, so they keep pointing to the same instructions. If the assembled program would
+          exceed the block size or the program can't be relocated, a DataFormatException is thrown and the program
+          is left unchanged.
+
+          @param[in]    index       Instruction index to insert at, may be the program length to append
+          @param[in]    instruction Instruction to insert
+         */
+        void insertInstruction(size_t index, const Instruction& instruction);
+
+        /**
+          Remove instruction.
+
+          Removes the instruction at the given index. Entry pointers and targets pointing to the removed instruction
+          point to the following instruction afterwards. If the index is invalid or the program can't be relocated,
+          a DataFormatException is thrown.
+
+          @param[in]    index       Instruction index to remove
+         */
+        void removeInstruction(size_t index);
+
+        /**
+          Replace instruction.
+
+          Replaces the instruction at the given index, keeping all entry pointers and targets. If the index is
+          invalid, the assembled program would exceed the block size or the instruction size changes while the
+          program can't be relocated, a DataFormatException is thrown.
+
+          @param[in]    index       Instruction index to replace
+          @param[in]    instruction New instruction
+         */
+        void setInstruction(size_t index, const Instruction& instruction);
+
+        /**
+          Create instruction.
+
+          Creates an instruction with the given opcode and arguments. For Jump and Loop, the target is given as
+          instruction index, the encoded target byte is filled in by update().
+
+          @param[in]    opcode      Opcode, Raw creates a single unknown byte with the value of arg1
+          @param[in]    arg1        First argument
+          @param[in]    arg2        Second argument
+          @param[in]    target      Target instruction index for Jump and Loop
+
+          @return                   Instruction
+         */
+        static Instruction makeInstruction(Opcode opcode, uint8_t arg1 = 0, uint8_t arg2 = 0,
+                                           size_t target = NoTarget);
+
+        /**
+          Get instruction size.
+
+          Returns the encoded size of an instruction with the given opcode.
+
+          @param[in]    opcode      Opcode
+
+          @return                   Size in bytes
+         */
+        static size_t getInstructionSize(Opcode opcode);
+
+        /**
+          Get opcode name.
+
+          Returns the mnemonic of the given opcode.
+
+          @param[in]    opcode      Opcode
+
+          @return                   Opcode name
+         */
+        static std::string getOpcodeName(Opcode opcode);
+
     private:
         uint8_t         m_blockNum;         ///< Block number
-        uint8_t*        m_buffer;           ///< Associated raw buffer
+        CowBuffer::Ref  m_buffer;           ///< Associated raw buffer
         size_t          m_size;             ///< Size of associated raw buffer
+
+        std::vector<Instruction> m_program; ///< Decoded envelope program
+        size_t          m_attack;           ///< Attack entry instruction index
+        size_t          m_release;          ///< Release entry instruction index
+        uint8_t         m_rawAttack;        ///< Raw attack pointer, used if unresolved
+        uint8_t         m_rawRelease;       ///< Raw release pointer, used if unresolved
+        size_t          m_programSize;      ///< Assembled size including entry pointers
+
+        /**
+          Get target byte position.
+
+          Returns the position of the target byte inside an encoded instruction.
+
+          @param[in]    opcode      Opcode
+
+          @return                   Byte position or 0 if the instruction has no target
+         */
+        static size_t getTargetPosition(Opcode opcode);
+
+        /**
+          Check for unresolved pointer.
+
+          Checks if a raw pointer points inside the program without being resolved to an instruction. Pointers in
+          front of or behind the program don't move on relocation.
+
+          @param[in]    resolved    Resolved instruction index or NoTarget
+          @param[in]    raw         Raw pointer value
+
+          @return                   True if the pointer is unresolved
+         */
+        bool isUnresolved(size_t resolved, uint8_t raw) const {
+            return resolved == NoTarget && raw >= HeaderSize && raw < m_programSize;
+        }
 };
 
 } // namespace Wersi
@@ -0,0 +1,132 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#include <wersi/history.hh>
+#include <exceptions.hh>
+
+namespace DMSToolbox {
+namespace Wersi {
+
+// Create history
+History::History(InstrumentStore& store, size_t maxVersions)
+    : m_store(store)
+    , m_versions()
+    , m_current(0)
+    , m_maxVersions(maxVersions > 0 ? maxVersions : 1)
+    , m_restoring(false)
+{
+    clear();
+    m_store.addObserver(this);
+}
+
+// Destroy history
+History::~History()
+{
+    m_store.removeObserver(this);
+}
+
+// Record version after store change
+void History::storeChanged(InstrumentStore& /*store*/, const ChangeSet& changes)
+{
+    if (m_restoring) {
+        return;
+    }
+
+    // A new change discards all versions that have been undone
+    m_versions.erase(m_versions.begin() + m_current + 1, m_versions.end());
+    Version version = { m_store.getBuffer(), changes };
+    m_versions.push_back(version);
+    while (m_versions.size() > m_maxVersions) {
+        m_versions.pop_front();
+    }
+    m_current = m_versions.size() - 1;
+}
+
+// Undo last change
+void History::undo()
+{
+    if (canUndo()) {
+        jump(m_current - 1);
+    }
+}
+
+// Redo change
+void History::redo()
+{
+    if (canRedo()) {
+        jump(m_current + 1);
+    }
+}
+
+// Restore version
+void History::jump(size_t version)
+{
+    if (version >= m_versions.size()) {
+        throw Exception("Invalid history version");
+    }
+    m_restoring = true;
+    try {
+        m_store.restore(m_versions[version].m_buffer);
+    }
+    catch (...) {
+        m_restoring = false;
+        throw;
+    }
+    m_restoring = false;
+    m_current = version;
+}
+
+// Get changes of version
+const ChangeSet& History::getChanges(size_t version) const
+{
+    if (version >= m_versions.size()) {
+        throw Exception("Invalid history version");
+    }
+    return m_versions[version].m_changes;
+}
+
+// Clear history
+void History::clear()
+{
+    m_versions.clear();
+    Version version = { m_store.getBuffer(), ChangeSet() };
+    m_versions.push_back(version);
+    m_current = 0;
+}
+
+} // namespace Wersi
+} // namespace DMSToolbox
@@ -0,0 +1,187 @@
+// vim:set ts=4 sw=4 et cin:
+
+/*
+  DMS-Toolbox - an editor, librarian and converter for the Wersi DMS system
+  (C) 2015 Michael Kukat <michael_AT_mik-music.org>
+
+  This file is part of DMS-Toolbox.
+
+  DMS-Toolbox is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  DMS-Toolbox is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with DMS-Toolbox.  If not, see <http://www.gnu.org/licenses/>.
+
+  Diese Datei ist Teil von DMS-Toolbox.
+
+  DMS-Toolbox ist Freie Software: Sie können es unter den Bedingungen
+  der GNU General Public License, wie von der Free Software Foundation,
+  Version 3 der Lizenz oder (nach Ihrer Wahl) jeder späteren
+  veröffentlichten Version, weiterverbreiten und/oder modifizieren.
+
+  DMS-Toolbox wird in der Hoffnung, dass es nützlich sein wird, aber
+  OHNE JEDE GEWÄHELEISTUNG, bereitgestellt; sogar ohne die implizite
+  Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
+  Siehe die GNU General Public License für weitere Details.
+
+  Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
+  Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common.hh>
+#include <cowbuffer.hh>
+#include <wersi/changeset.hh>
+#include <wersi/instrumentstore.hh>
+#include <deque>
+
+namespace DMSToolbox {
+namespace Wersi {
+
+/**
+  @ingroup wersi_group
+
+  Undo/redo history of an instrument store.
+
+  The history observes an instrument store and records a version after each change notification, so every change
+  batch becomes one undo step. Versions are copy-on-write snapshots of the store's raw buffer: unchanged blocks are
+  shared between all versions and the store, so a step only costs the blocks changed in it. Any version can be
+  restored directly, only the blocks differing from the current state are dissected again. Blocks only held by
+  versions stay allocated in the store's arena, so the number of versions kept bounds its growth.
+ */
+class History : public InstrumentStore::Observer {
+    public:
+        /**
+          Create history.
+
+          Creates a history for the given instrument store and records its current state as the first version. The
+          store must outlive the history.
+
+          @param[in]    store       Instrument store to track
+          @param[in]    maxVersions Maximum number of versions kept, the oldest versions are dropped first
+         */
+        History(InstrumentStore& store, size_t maxVersions = 256);
+
+        /**
+          Destroy history.
+
+          Stops tracking the instrument store and releases all versions.
+         */
+        virtual ~History();
+
+        /// Implements InstrumentStore::Observer::storeChanged()
+        virtual void storeChanged(InstrumentStore& store, const ChangeSet& changes);
+
+        /**
+          Check for undo.
+
+          Returns true if there is a version before the current one.
+
+          @return                   True if undo() is possible
+         */
+        bool canUndo() const {
+            return m_current > 0;
+        }
+
+        /**
+          Check for redo.
+
+          Returns true if there is a version after the current one.
+
+          @return                   True if redo() is possible
+         */
+        bool canRedo() const {
+            return m_current + 1 < m_versions.size();
+        }
+
+        /**
+          Undo last change.
+
+          Restores the previous version, if any.
+         */
+        void undo();
+
+        /**
+          Redo change.
+
+          Restores the next version, if any.
+         */
+        void redo();
+
+        /**
+          Jump to version.
+
+          Restores the given version. If the version does not exist, an Exception is thrown.
+
+          @param[in]    version     Version index, 0 is the oldest version kept
+         */
+        void jump(size_t version);
+
+        /**
+          Get current version.
+
+          Returns the index of the version the store currently represents.
+
+          @return                   Current version index
+         */
+        size_t getVersion() const {
+            return m_current;
+        }
+
+        /**
+          Get number of versions.
+
+          Returns the number of versions kept.
+
+          @return                   Number of versions
+         */
+        size_t getNumVersions() const {
+            return m_versions.size();
+        }
+
+        /**
+          Get changes of version.
+
+          Returns the blocks changed by the step leading to the given version. If the version does not exist, an
+          Exception is thrown.
+
+          @param[in]    version     Version index
+
+          @return                   Changed blocks
+         */
+        const ChangeSet& getChanges(size_t version) const;
+
+        /**
+          Clear history.
+
+          Drops all versions and records the current state of the store as the only version.
+         */
+        void clear();
+
+    private:
+        /// Recorded version
+        struct Version {
+            CowBuffer   m_buffer;                   ///< Snapshot of the store raw buffer
+            ChangeSet   m_changes;                  ///< Blocks changed by the step leading to this version
+        };
+
+        InstrumentStore&    m_store;                ///< Tracked instrument store
+        std::deque<Version> m_versions;             ///< Recorded versions, oldest first
+        size_t              m_current;              ///< Index of current version
+        size_t              m_maxVersions;          ///< Maximum number of versions kept
+        bool                m_restoring;            ///< True while a version is restored
+
+        History(const History&);                    ///< Inhibit copying objects
+        History& operator=(const History&);         ///< Inhibit copying objects
+};
+
+} // namespace Wersi
+} // namespace DMSToolbox
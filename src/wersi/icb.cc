@@ -41,9 +41,9 @@ namespace DMSToolbox {
 namespace Wersi {
 
 // Create new ICB object
-Icb::Icb(uint8_t blockNum, void* buffer)
+Icb::Icb(uint8_t blockNum, const CowBuffer::Ref& buffer)
     : m_blockNum(blockNum)
-    , m_buffer(static_cast<uint8_t*>(buffer))
+    , m_buffer(buffer)
     , m_nextIcb(0)
     , m_vcfBlock(0)
     , m_amplBlock(0)
@@ -73,7 +73,7 @@ Icb::Icb(uint8_t blockNum, void* buffer)
 // Create ICB object by copying
 Icb::Icb(const Icb& source)
     : m_blockNum(0)
-    , m_buffer(nullptr)
+    , m_buffer()
     , m_nextIcb(0)
     , m_vcfBlock(0)
     , m_amplBlock(0)
@@ -147,66 +147,69 @@ void Icb::copy(const Icb& source)
 // Disssect ICB raw data
 void Icb::dissect()
 {
-    m_nextIcb       = m_buffer[0];
-    m_vcfBlock      = m_buffer[1];
-    m_amplBlock     = m_buffer[2];
-    m_freqBlock     = m_buffer[3];
-    m_waveBlock     = m_buffer[4];
-    m_dynamics      = m_buffer[5] & 3;
-    m_lowSelect     = (m_buffer[5] & 0x04) != 0;
-    m_highSelect    = (m_buffer[5] & 0x08) != 0;
+    const uint8_t* buf = m_buffer.data();
+    m_nextIcb       = buf[0];
+    m_vcfBlock      = buf[1];
+    m_amplBlock     = buf[2];
+    m_freqBlock     = buf[3];
+    m_waveBlock     = buf[4];
+    m_dynamics      = buf[5] & 3;
+    m_lowSelect     = (buf[5] & 0x04) != 0;
+    m_highSelect    = (buf[5] & 0x08) != 0;
     // Unknown bits 4-7, bit 7 = fixed pitch?
-    m_left          = (m_buffer[6] & 0x01) != 0;
-    m_right         = (m_buffer[6] & 0x02) != 0;
-    m_bright        = (m_buffer[6] & 0x04) != 0;
-    m_vcf           = (m_buffer[6] & 0x08) != 0;
-    m_wv            = (m_buffer[6] & 0x10) != 0;
+    m_left          = (buf[6] & 0x01) != 0;
+    m_right         = (buf[6] & 0x02) != 0;
+    m_bright        = (buf[6] & 0x04) != 0;
+    m_vcf           = (buf[6] & 0x08) != 0;
+    m_wv            = (buf[6] & 0x10) != 0;
     // Unknown bits 5-7
-    m_transpose     = int8_t(m_buffer[7]);
-    m_detune        = int8_t(m_buffer[8]);
-    m_wvMode        = static_cast<WvMode>(m_buffer[9] & 7);
-    m_wvLeft        = (m_buffer[9] & 0x08) != 0;
-    m_wvRight       = (m_buffer[9] & 0x10) != 0;
+    m_transpose     = int8_t(buf[7]);
+    m_detune        = int8_t(buf[8]);
+    m_wvMode        = static_cast<WvMode>(buf[9] & 7);
+    m_wvLeft        = (buf[9] & 0x08) != 0;
+    m_wvRight       = (buf[9] & 0x10) != 0;
     // Unknown bit 5
-    m_wvFbFlat      = (m_buffer[9] & 0x40) != 0;
-    m_wvFbDeep      = (m_buffer[9] & 0x80) != 0;
-    m_name          = std::string(reinterpret_cast<char*>(&(m_buffer[10])), 6);
+    m_wvFbFlat      = (buf[9] & 0x40) != 0;
+    m_wvFbDeep      = (buf[9] & 0x80) != 0;
+    m_name          = std::string(reinterpret_cast<const char*>(&(buf[10])), 6);
 
     // Unknown bits
-    m_unknownBits   = ((m_buffer[5] & 0xf0 >> 4)) | ((m_buffer[6] & 0xe0) >> 1) | ((m_buffer[9] & 0x20) << 2);
+    m_unknownBits   = ((buf[5] & 0xf0 >> 4)) | ((buf[6] & 0xe0) >> 1) | ((buf[9] & 0x20) << 2);
 }
 
 // Put together and update ICB raw data
 void Icb::update()
 {
-    m_buffer[0] = m_nextIcb;
-    m_buffer[1] = m_vcfBlock;
-    m_buffer[2] = m_amplBlock;
-    m_buffer[3] = m_freqBlock;
-    m_buffer[4] = m_waveBlock;
-    m_buffer[5] = (m_dynamics   & 3) |
-                  (m_lowSelect  ? 0x04 : 0x00) |
-                  (m_highSelect ? 0x08 : 0x00);
-    m_buffer[6] = (m_left       ? 0x01 : 0x00) |
-                  (m_right      ? 0x02 : 0x00) |
-                  (m_bright     ? 0x04 : 0x00) |
-                  (m_vcf        ? 0x08 : 0x00) |
-                  (m_wv         ? 0x10 : 0x00);
-    m_buffer[7] = uint8_t(m_transpose);
-    m_buffer[8] = uint8_t(m_detune);
-    m_buffer[9] = (static_cast<uint8_t>(m_wvMode) & 7) |
-                  (m_wvLeft     ? 0x08 : 0x00) |
-                  (m_wvRight    ? 0x10 : 0x00) |
-                  (m_wvFbFlat   ? 0x40 : 0x00) |
-                  (m_wvFbDeep   ? 0x80 : 0x00);
+    uint8_t buf[16];
+    buf[0] = m_nextIcb;
+    buf[1] = m_vcfBlock;
+    buf[2] = m_amplBlock;
+    buf[3] = m_freqBlock;
+    buf[4] = m_waveBlock;
+    buf[5] = (m_dynamics   & 3) |
+             (m_lowSelect  ? 0x04 : 0x00) |
+             (m_highSelect ? 0x08 : 0x00);
+    buf[6] = (m_left       ? 0x01 : 0x00) |
+             (m_right      ? 0x02 : 0x00) |
+             (m_bright     ? 0x04 : 0x00) |
+             (m_vcf        ? 0x08 : 0x00) |
+             (m_wv         ? 0x10 : 0x00);
+    buf[7] = uint8_t(m_transpose);
+    buf[8] = uint8_t(m_detune);
+    buf[9] = (static_cast<uint8_t>(m_wvMode) & 7) |
+             (m_wvLeft     ? 0x08 : 0x00) |
+             (m_wvRight    ? 0x10 : 0x00) |
+             (m_wvFbFlat   ? 0x40 : 0x00) |
+             (m_wvFbDeep   ? 0x80 : 0x00);
     std::string name(m_name);
     name.append("      ");
-    m_buffer[10] = name[0];
-    m_buffer[11] = name[1];
-    m_buffer[12] = name[2];
-    m_buffer[13] = name[3];
-    m_buffer[14] = name[4];
-    m_buffer[15] = name[5];
+    buf[10] = name[0];
+    buf[11] = name[1];
+    buf[12] = name[2];
+    buf[13] = name[3];
+    buf[14] = name[4];
+    buf[15] = name[5];
+    m_buffer.write(buf, sizeof(buf));
 }
 
 // Return WersiVoice mode name
@@ -38,6 +38,7 @@
 #pragma once
 
 #include <common.hh>
+#include <cowbuffer.hh>
 #include <string>
 
 namespace DMSToolbox {
@@ -72,9 +73,9 @@ class Icb {
           left untouched.
 
           @param[in]    blockNum    Block number
-          @param[in]    buffer      Raw data buffer
+          @param[in]    buffer      Reference to raw data block
          */
-        Icb(uint8_t blockNum, void* buffer);
+        Icb(uint8_t blockNum, const CowBuffer::Ref& buffer);
 
         /**
           Create ICB object by copying.
@@ -100,7 +101,19 @@ class Icb {
           @return                   Raw buffer const pointer
          */
         const void* getBuffer() const {
-            return m_buffer;
+            return m_buffer.data();
+        }
+
+        /**
+          Rebind raw buffer.
+
+          Associates the object with the same block in another buffer. This is used by instrument stores when they
+          are cloned, the object data itself is left untouched.
+
+          @param[in]    buffer      Buffer holding a copy of the block
+         */
+        void rebind(CowBuffer& buffer) {
+            m_buffer.rebind(buffer);
         }
 
         /**
@@ -448,7 +461,7 @@ class Icb {
 
     private:
         uint8_t         m_blockNum;         ///< Block number
-        uint8_t*        m_buffer;           ///< Associated raw buffer
+        CowBuffer::Ref  m_buffer;           ///< Associated raw buffer
 
         uint8_t         m_nextIcb;          ///< Next ICB pointer (for layering), 0 on last one
         uint8_t         m_vcfBlock;         ///< VCF block pointer
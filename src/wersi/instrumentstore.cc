@@ -41,6 +41,7 @@
 #include <wersi/envelope.hh>
 #include <wersi/wave.hh>
 #include <exceptions.hh>
+#include <algorithm>
 
 #ifdef HAVE_RTMIDI
 #include <RtMidi.h>
@@ -49,18 +50,56 @@
 namespace DMSToolbox {
 namespace Wersi {
 
+// Arena capacity on top of the raw buffer size, for block objects, chunk tables and copies of edited blocks, also
+// the initial capacity of clones, which share the raw buffer
+static const size_t ArenaHeadroom = 32768;
+
 // Create new instrument store
-InstrumentStore::InstrumentStore(void* buffer, size_t size)
-    : m_buffer(static_cast<uint8_t*>(buffer))
-    , m_size(size)
-    , m_icb()
-    , m_vcf()
-    , m_ampl()
-    , m_freq()
-    , m_wave()
+InstrumentStore::InstrumentStore(const void* buffer, size_t size)
+    : m_arena(std::make_shared<Arena>(size + ArenaHeadroom))
+    , m_buffer(buffer, size, m_arena)
+    , m_icb(IcbMap::key_compare(), IcbMap::allocator_type(m_arena))
+    , m_vcf(VcfMap::key_compare(), VcfMap::allocator_type(m_arena))
+    , m_ampl(EnvelopeMap::key_compare(), EnvelopeMap::allocator_type(m_arena))
+    , m_freq(EnvelopeMap::key_compare(), EnvelopeMap::allocator_type(m_arena))
+    , m_wave(WaveMap::key_compare(), WaveMap::allocator_type(m_arena))
+    , m_dirty()
+    , m_observers()
+    , m_batchDepth(0)
 {
 }
 
+// Create new empty instrument store
+InstrumentStore::InstrumentStore(size_t size)
+    : m_arena(std::make_shared<Arena>(size + ArenaHeadroom))
+    , m_buffer(size, m_arena)
+    , m_icb(IcbMap::key_compare(), IcbMap::allocator_type(m_arena))
+    , m_vcf(VcfMap::key_compare(), VcfMap::allocator_type(m_arena))
+    , m_ampl(EnvelopeMap::key_compare(), EnvelopeMap::allocator_type(m_arena))
+    , m_freq(EnvelopeMap::key_compare(), EnvelopeMap::allocator_type(m_arena))
+    , m_wave(WaveMap::key_compare(), WaveMap::allocator_type(m_arena))
+    , m_dirty()
+    , m_observers()
+    , m_batchDepth(0)
+{
+}
+
+// Create instrument store by copying
+InstrumentStore::InstrumentStore(const InstrumentStore& source)
+    : m_arena(std::make_shared<Arena>(ArenaHeadroom))
+    , m_buffer(source.m_buffer, m_arena)
+    , m_icb(source.m_icb, IcbMap::allocator_type(m_arena))
+    , m_vcf(source.m_vcf, VcfMap::allocator_type(m_arena))
+    , m_ampl(source.m_ampl, EnvelopeMap::allocator_type(m_arena))
+    , m_freq(source.m_freq, EnvelopeMap::allocator_type(m_arena))
+    , m_wave(source.m_wave, WaveMap::allocator_type(m_arena))
+    , m_dirty()
+    , m_observers()
+    , m_batchDepth(0)
+{
+    rebindLists();
+}
+
 // Destroy instrument store
 InstrumentStore::~InstrumentStore()
 {
@@ -69,6 +108,8 @@ InstrumentStore::~InstrumentStore()
 // Copy instrument store contents
 void InstrumentStore::copyContents(const InstrumentStore& source)
 {
+    ChangeBatch batch(*this);
+
     // Copy ICBs
     for (auto& i : source) {
         Icb* icb = getIcb(i.first - 128);
@@ -82,6 +123,7 @@ void InstrumentStore::copyContents(const InstrumentStore& source)
             icb->setFreqBlock(icb->getFreqBlock() - 128);
             icb->setWaveBlock(icb->getWaveBlock() - 128);
             icb->update();
+            markChanged(ChangeSet::BlockType::Icb, i.first - 128);
         }
     }
 
@@ -92,6 +134,8 @@ void InstrumentStore::copyContents(const InstrumentStore& source)
         auto dst = getVcf(addr);
         if (src != nullptr && dst != nullptr) {
             dst->copy(*src);
+            dst->update();
+            markChanged(ChangeSet::BlockType::Vcf, addr);
         }
     }
 
@@ -105,6 +149,7 @@ void InstrumentStore::copyContents(const InstrumentStore& source)
         auto dst = getAmpl(addr);
         if (src != nullptr && dst != nullptr) {
             dst->copy(*src);
+            markChanged(ChangeSet::BlockType::Ampl, addr);
         }
     }
 
@@ -118,6 +163,7 @@ void InstrumentStore::copyContents(const InstrumentStore& source)
         auto dst = getFreq(addr);
         if (src != nullptr && dst != nullptr) {
             dst->copy(*src);
+            markChanged(ChangeSet::BlockType::Freq, addr);
         }
     }
 
@@ -131,10 +177,60 @@ void InstrumentStore::copyContents(const InstrumentStore& source)
         auto dst = getWave(addr);
         if (src != nullptr && dst != nullptr) {
             dst->copy(*src);
+            dst->update();
+            markChanged(ChangeSet::BlockType::Wave, addr);
+        }
+    }
+}
+
+// Collect block locations
+template <typename Map>
+void InstrumentStore::collectBlocks(const Map& map, std::vector<const void*>& blocks)
+{
+    for (auto& i : map) {
+        blocks.push_back(i.second.getBuffer());
+    }
+}
+
+// Dissect blocks moved to other storage
+template <typename Map>
+void InstrumentStore::restoreBlocks(Map& map, ChangeSet::BlockType type,
+                                    std::vector<const void*>::const_iterator& blocks)
+{
+    for (auto& i : map) {
+        if (i.second.getBuffer() != *blocks) {
+            i.second.dissect();
+            markChanged(type, i.first);
         }
+        ++blocks;
     }
 }
 
+// Restore raw buffer from snapshot
+void InstrumentStore::restore(const CowBuffer& buffer)
+{
+    if (buffer.size() != m_buffer.size()) {
+        throw DataFormatException("Snapshot size does not match instrument store");
+    }
+
+    // Remember block locations, a block is unchanged if its storage is still the same after the swap
+    std::vector<const void*> blocks;
+    collectBlocks(m_icb, blocks);
+    collectBlocks(m_vcf, blocks);
+    collectBlocks(m_ampl, blocks);
+    collectBlocks(m_freq, blocks);
+    collectBlocks(m_wave, blocks);
+
+    ChangeBatch batch(*this);
+    m_buffer = buffer;
+    auto i = blocks.cbegin();
+    restoreBlocks(m_icb, ChangeSet::BlockType::Icb, i);
+    restoreBlocks(m_vcf, ChangeSet::BlockType::Vcf, i);
+    restoreBlocks(m_ampl, ChangeSet::BlockType::Ampl, i);
+    restoreBlocks(m_freq, ChangeSet::BlockType::Freq, i);
+    restoreBlocks(m_wave, ChangeSet::BlockType::Wave, i);
+}
+
 #ifdef HAVE_RTMIDI
 // Read instrument store contents from device
 void InstrumentStore::readFromDevice(RtMidiIn* /*inPort*/, RtMidiOut* /*outPort*/,
@@ -151,25 +247,25 @@ void InstrumentStore::receivedSysEx(std::vector<unsigned char>* /*message*/)
 #endif // HAVE_RTMIDI
 
 // Return begin iterator to ICB map
-std::map<uint8_t, Icb>::iterator InstrumentStore::begin()
+InstrumentStore::IcbMap::iterator InstrumentStore::begin()
 {
     return m_icb.begin();
 }
 
 // Return const begin iterator to ICB map
-std::map<uint8_t, Icb>::const_iterator InstrumentStore::begin() const
+InstrumentStore::IcbMap::const_iterator InstrumentStore::begin() const
 {
     return m_icb.begin();
 }
 
 // Return end iterator to ICB map
-std::map<uint8_t, Icb>::iterator InstrumentStore::end()
+InstrumentStore::IcbMap::iterator InstrumentStore::end()
 {
     return m_icb.end();
 }
 
 // Return const end iterator to ICB map
-std::map<uint8_t, Icb>::const_iterator InstrumentStore::end() const
+InstrumentStore::IcbMap::const_iterator InstrumentStore::end() const
 {
     return m_icb.end();
 }
@@ -234,6 +330,88 @@ Wave* InstrumentStore::getWave(uint8_t block)
     }
 }
 
+// Add observer
+void InstrumentStore::addObserver(Observer* observer)
+{
+    if (std::find(m_observers.begin(), m_observers.end(), observer) == m_observers.end()) {
+        m_observers.push_back(observer);
+    }
+}
+
+// Remove observer
+void InstrumentStore::removeObserver(Observer* observer)
+{
+    auto i = std::find(m_observers.begin(), m_observers.end(), observer);
+    if (i != m_observers.end()) {
+        m_observers.erase(i);
+    }
+}
+
+// Mark block as changed
+void InstrumentStore::markChanged(ChangeSet::BlockType type, uint8_t block)
+{
+    m_dirty.set(type, block);
+    if (m_batchDepth == 0) {
+        notifyObservers();
+    }
+}
+
+// Mark all blocks as changed
+void InstrumentStore::markAllChanged()
+{
+    for (auto& i : m_icb) {
+        m_dirty.set(ChangeSet::BlockType::Icb, i.first);
+    }
+    for (auto& i : m_vcf) {
+        m_dirty.set(ChangeSet::BlockType::Vcf, i.first);
+    }
+    for (auto& i : m_ampl) {
+        m_dirty.set(ChangeSet::BlockType::Ampl, i.first);
+    }
+    for (auto& i : m_freq) {
+        m_dirty.set(ChangeSet::BlockType::Freq, i.first);
+    }
+    for (auto& i : m_wave) {
+        m_dirty.set(ChangeSet::BlockType::Wave, i.first);
+    }
+    if (m_batchDepth == 0) {
+        notifyObservers();
+    }
+}
+
+// Begin change batch
+void InstrumentStore::beginChanges()
+{
+    ++m_batchDepth;
+}
+
+// End change batch
+void InstrumentStore::endChanges()
+{
+    if (m_batchDepth > 0) {
+        --m_batchDepth;
+    }
+    if (m_batchDepth == 0) {
+        notifyObservers();
+    }
+}
+
+// Deliver dirty blocks to observers
+void InstrumentStore::notifyObservers()
+{
+    if (m_dirty.empty()) {
+        return;
+    }
+
+    // Observers may add or remove observers or cause new changes, so work on copies
+    ChangeSet changes(m_dirty);
+    m_dirty.clear();
+    std::vector<Observer*> observers(m_observers);
+    for (auto& i : observers) {
+        i->storeChanged(*this, changes);
+    }
+}
+
 // Clear all lists
 void InstrumentStore::clearLists()
 {
@@ -244,5 +422,25 @@ void InstrumentStore::clearLists()
     m_wave.clear();
 }
 
+// Rebind all lists to own buffer
+void InstrumentStore::rebindLists()
+{
+    for (auto& i : m_icb) {
+        i.second.rebind(m_buffer);
+    }
+    for (auto& i : m_vcf) {
+        i.second.rebind(m_buffer);
+    }
+    for (auto& i : m_ampl) {
+        i.second.rebind(m_buffer);
+    }
+    for (auto& i : m_freq) {
+        i.second.rebind(m_buffer);
+    }
+    for (auto& i : m_wave) {
+        i.second.rebind(m_buffer);
+    }
+}
+
 } // namespace Wersi
 } // namespace DMSToolbox
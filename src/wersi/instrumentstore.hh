@@ -38,6 +38,9 @@
 #pragma once
 
 #include <common.hh>
+#include <arena.hh>
+#include <cowbuffer.hh>
+#include <wersi/changeset.hh>
 #include <map>
 #include <vector>
 
@@ -61,21 +64,109 @@ class Wave;
 
   Wersi DMS-System instrument store.
 
-  This is the general interface of an instrument store for the Wersi DMS-System.
+  This is the general interface of an instrument store for the Wersi DMS-System. Each store owns an arena holding
+  its raw buffer and all dissected block objects, so the store and its children are released together and the
+  memory used by a store can be queried with getArena(). Clones have arenas of their own, only the raw buffer
+  parts still shared with a clone keep the arena they were allocated from alive.
  */
 class InstrumentStore {
     public:
+        /// ICB map type
+        typedef std::map<uint8_t, Icb, std::less<uint8_t>, ArenaAllocator<std::pair<const uint8_t, Icb>>> IcbMap;
+
+        /// VCF map type
+        typedef std::map<uint8_t, Vcf, std::less<uint8_t>, ArenaAllocator<std::pair<const uint8_t, Vcf>>> VcfMap;
+
+        /// Envelope map type
+        typedef std::map<uint8_t, Envelope, std::less<uint8_t>,
+                         ArenaAllocator<std::pair<const uint8_t, Envelope>>> EnvelopeMap;
+
+        /// WAVE map type
+        typedef std::map<uint8_t, Wave, std::less<uint8_t>, ArenaAllocator<std::pair<const uint8_t, Wave>>> WaveMap;
+
+        /**
+          Instrument store observer.
+
+          Observers registered with an instrument store are notified about changed blocks. Changes are collected in
+          the store's dirty bitmaps and delivered as one batched change set.
+         */
+        class Observer {
+            public:
+                /**
+                  Destroy observer.
+
+                  Destroys the observer.
+                 */
+                virtual ~Observer() {
+                }
+
+                /**
+                  Store changed notification.
+
+                  Called after blocks of the instrument store have been changed.
+
+                  @param[in]    store       Instrument store that has been changed
+                  @param[in]    changes     Set of changed blocks
+                 */
+                virtual void storeChanged(InstrumentStore& store, const ChangeSet& changes) = 0;
+        };
+
+        /**
+          Change batch guard.
+
+          Collects all changes done during the lifetime of this object into one notification. Batches may be nested,
+          observers are notified when the outermost batch ends.
+         */
+        class ChangeBatch {
+            public:
+                /**
+                  Begin change batch.
+
+                  Begins a change batch on the given instrument store.
+
+                  @param[in]    store       Instrument store to collect changes for
+                 */
+                ChangeBatch(InstrumentStore& store)
+                    : m_store(store) {
+                    m_store.beginChanges();
+                }
+
+                /**
+                  End change batch.
+
+                  Ends the change batch, notifying observers if this is the outermost batch.
+                 */
+                ~ChangeBatch() {
+                    m_store.endChanges();
+                }
+
+            private:
+                InstrumentStore&    m_store;                ///< Instrument store collecting changes
+
+                ChangeBatch(const ChangeBatch&);            ///< Inhibit copying objects
+                ChangeBatch& operator=(const ChangeBatch&); ///< Inhibit copying objects
+        };
+
         /**
           Create new instrument store.
 
-          Creates a new instrument store. If an explicit update() is called, the update() method of all contained
-          objects is called to update their part of the buffer, then the store raw buffer is updated with this new
-          information.
+          Creates a new instrument store holding a copy of the given raw data in its arena. If an explicit update()
+          is called, the update() method of all contained objects is called to update their part of the buffer, then
+          the store raw buffer is updated with this new information. The caller keeps ownership of the given buffer.
 
           @param[in]    buffer      Raw data buffer
           @param[in]    size        Raw data buffer size
          */
-        InstrumentStore(void* buffer, size_t size);
+        InstrumentStore(const void* buffer, size_t size);
+
+        /**
+          Create new empty instrument store.
+
+          Creates a new instrument store with a zero-filled raw buffer of the given size in its arena.
+
+          @param[in]    size        Raw data buffer size
+         */
+        explicit InstrumentStore(size_t size);
 
         /**
           Destroy instrument store.
@@ -85,13 +176,26 @@ class InstrumentStore {
         virtual ~InstrumentStore();
 
         /**
-          Get buffer pointer.
+          Clone instrument store.
+
+          Creates a copy of the instrument store. The raw buffer is shared copy-on-write between both stores, so this
+          is O(1) in the buffer size, blocks are only duplicated when one of the stores writes them. The clone gets
+          its own arena for its block objects and the blocks it writes, shared blocks stay in the arena of the
+          store that allocated them until neither store uses them anymore. Observers and pending changes are not
+          copied.
+
+          @return                   New instrument store, to be deleted by the caller
+         */
+        virtual InstrumentStore* clone() const = 0;
+
+        /**
+          Get buffer.
 
-          Return raw buffer pointer.
+          Return copy-on-write raw buffer.
 
-          @return                   Raw buffer pointer
+          @return                   Raw buffer
          */
-        virtual void* getBuffer() {
+        const CowBuffer& getBuffer() const {
             return m_buffer;
         }
 
@@ -102,10 +206,34 @@ class InstrumentStore {
 
           @return                   Raw buffer size
          */
-        virtual size_t getBufferSize() {
-            return m_size;
+        virtual size_t getBufferSize() const {
+            return m_buffer.size();
+        }
+
+        /**
+          Get arena.
+
+          Returns the arena holding the raw buffer and all block objects of this store, e.g. to query its memory
+          usage.
+
+          @return                   Arena of this store
+         */
+        const Arena& getArena() const {
+            return *m_arena;
         }
 
+        /**
+          Restore raw buffer.
+
+          Replaces the raw buffer with a snapshot previously taken from getBuffer() of this store. Only blocks whose
+          storage differs from the current buffer are dissected again and reported as changed, so restoring is
+          proportional to the number of changed blocks. If the snapshot size does not match, a DataFormatException
+          is thrown.
+
+          @param[in]    buffer      Snapshot to restore
+         */
+        void restore(const CowBuffer& buffer);
+
         /**
           Copy instrument store contents.
 
@@ -170,7 +298,7 @@ class InstrumentStore {
 
           @return                   Iterator to the beginning of the ICB map
          */
-        std::map<uint8_t, Icb>::iterator begin();
+        IcbMap::iterator begin();
 
         /**
           Get const iterator to beginning of ICB map.
@@ -179,7 +307,7 @@ class InstrumentStore {
 
           @return                   Iterator to the beginning of the ICB map
          */
-        std::map<uint8_t, Icb>::const_iterator begin() const;
+        IcbMap::const_iterator begin() const;
 
         /**
           Get iterator to end of ICB map.
@@ -188,7 +316,7 @@ class InstrumentStore {
 
           @return                   Iterator to the end of the ICB map
          */
-        std::map<uint8_t, Icb>::iterator end();
+        IcbMap::iterator end();
 
         /**
           Get const iterator to end of ICB map.
@@ -197,7 +325,7 @@ class InstrumentStore {
 
           @return                   Iterator to the end of the ICB map
          */
-        std::map<uint8_t, Icb>::const_iterator end() const;
+        IcbMap::const_iterator end() const;
 
         /**
           Get ICB by block number.
@@ -254,15 +382,83 @@ class InstrumentStore {
          */
         Wave* getWave(uint8_t block);
 
+        /**
+          Add observer.
+
+          Registers an observer to be notified about changed blocks. The observer must be removed before it is
+          destroyed.
+
+          @param[in]    observer    Observer to add
+         */
+        void addObserver(Observer* observer);
+
+        /**
+          Remove observer.
+
+          Unregisters a previously added observer.
+
+          @param[in]    observer    Observer to remove
+         */
+        void removeObserver(Observer* observer);
+
+        /**
+          Mark block as changed.
+
+          Sets the dirty bit for the given block. Unless a change batch is active, observers are notified
+          immediately.
+
+          @param[in]    type        Block type
+          @param[in]    block       Block number
+         */
+        void markChanged(ChangeSet::BlockType type, uint8_t block);
+
+        /**
+          Mark all blocks as changed.
+
+          Sets the dirty bits for all blocks currently contained in the instrument store, usually after the whole
+          store has been reloaded. Unless a change batch is active, observers are notified immediately.
+         */
+        void markAllChanged();
+
+        /**
+          Begin change batch.
+
+          Suppresses notifications until the matching endChanges() call. Calls may be nested.
+         */
+        void beginChanges();
+
+        /**
+          End change batch.
+
+          Ends a change batch started with beginChanges(). If this was the outermost batch, all collected changes
+          are delivered to the observers.
+         */
+        void endChanges();
+
+        /**
+          Get dirty blocks.
+
+          Returns the set of blocks changed since the last notification.
+
+          @return                   Dirty block bitmaps
+         */
+        const ChangeSet& getDirty() const {
+            return m_dirty;
+        }
+
     protected:
-        uint8_t*                    m_buffer;               ///< Raw data buffer
-        size_t                      m_size;                 ///< Raw data buffer size
+        std::shared_ptr<Arena>      m_arena;                ///< Arena holding buffer and block objects
+        CowBuffer                   m_buffer;               ///< Raw data buffer
+
+        IcbMap                      m_icb;                  ///< ICB data
+        VcfMap                      m_vcf;                  ///< VCF data
+        EnvelopeMap                 m_ampl;                 ///< AMPL data
+        EnvelopeMap                 m_freq;                 ///< FREQ data
+        WaveMap                     m_wave;                 ///< WAVE data
 
-        std::map<uint8_t, Icb>      m_icb;                  ///< ICB data
-        std::map<uint8_t, Vcf>      m_vcf;                  ///< VCF data
-        std::map<uint8_t, Envelope> m_ampl;                 ///< AMPL data
-        std::map<uint8_t, Envelope> m_freq;                 ///< FREQ data
-        std::map<uint8_t, Wave>     m_wave;                 ///< WAVE data
+        ChangeSet                   m_dirty;                ///< Blocks changed since last notification
+        std::vector<Observer*>      m_observers;            ///< Registered observers
+        size_t                      m_batchDepth;           ///< Nesting depth of active change batches
 
         /**
           Clear all lists.
@@ -271,8 +467,55 @@ class InstrumentStore {
          */
         void clearLists();
 
+        /**
+          Rebind all lists.
+
+          Associates all contained objects with this store's raw buffer, after the lists have been copied from
+          another store.
+         */
+        void rebindLists();
+
+        /**
+          Collect block locations.
+
+          Appends the raw data pointers of all blocks in the given map, used by restore().
+
+          @param[in]    map         Block map
+          @param[out]   blocks      Raw data pointers
+         */
+        template <typename Map>
+        static void collectBlocks(const Map& map, std::vector<const void*>& blocks);
+
+        /**
+          Restore blocks.
+
+          Dissects all blocks in the given map whose raw data pointer differs from the one collected before, and
+          marks them as changed. Used by restore().
+
+          @param[in]    map         Block map
+          @param[in]    type        Block type of the map
+          @param[in]    blocks      Iterator to the collected raw data pointers, advanced on return
+         */
+        template <typename Map>
+        void restoreBlocks(Map& map, ChangeSet::BlockType type, std::vector<const void*>::const_iterator& blocks);
+
+        /**
+          Create instrument store by copying.
+
+          Shares the raw buffer of the source store and copies all contained objects. Used by clone() implementations.
+
+          @param[in]    source      Source instrument store to copy from
+         */
+        InstrumentStore(const InstrumentStore& source);
+
+        /**
+          Notify observers.
+
+          Delivers the collected dirty blocks to all observers and clears the dirty bitmaps.
+         */
+        void notifyObservers();
+
     private:
-        InstrumentStore(const InstrumentStore&);            ///< Inhibit copying objects
         InstrumentStore& operator=(const InstrumentStore&); ///< Inhibit copying objects
 };
 
@@ -48,23 +48,40 @@ namespace DMSToolbox {
 namespace Wersi {
 
 // Create new MK1 cartridge object
-Mk1Cartridge::Mk1Cartridge(void* buffer, bool /*initialize*/)
-    : InstrumentStore(buffer, 16384)
+Mk1Cartridge::Mk1Cartridge(const void* buffer, size_t size, bool /*initialize*/)
+    : InstrumentStore(buffer, size)
 {
     dissect();
 }
 
+// Create MK1 cartridge object by copying
+Mk1Cartridge::Mk1Cartridge(const Mk1Cartridge& source)
+    : InstrumentStore(source)
+{
+}
+
 // Destroy MK1 cartridge object
 Mk1Cartridge::~Mk1Cartridge()
 {
 }
 
+// Clone MK1 cartridge object
+InstrumentStore* Mk1Cartridge::clone() const
+{
+    return new Mk1Cartridge(*this);
+}
+
 // Dissect raw MK1 cartridge data
 void Mk1Cartridge::dissect()
 {
     clearLists();
 
     try {
+        // Check size
+        if (m_buffer.size() != 16384) {
+            throw DataFormatException("invalid raw data size");
+        }
+
         // Check header bytes
         uint16_t dummy = (m_buffer[0] << 8) | m_buffer[1];
         if (dummy != 0xffff) {
@@ -119,7 +136,7 @@ void Mk1Cartridge::dissect()
             if (idx >= 0x3ffe) {
                 throw DataFormatException("invalid ICB pointer");
             }
-            Icb icb(current, &(m_buffer[idx]));
+            Icb icb(current, m_buffer.map(idx, 16));
             m_icb.insert(pair<uint8_t, Icb>(current, icb));
             uint8_t tmp = icb.getNextIcb();
             if (tmp > maxIcb) {
@@ -152,7 +169,7 @@ void Mk1Cartridge::dissect()
             if (idx >= 0x3ffe) {
                 throw DataFormatException("invalid VCF pointer");
             }
-            Vcf vcf(current, &(m_buffer[idx]));
+            Vcf vcf(current, m_buffer.map(idx, 10));
             m_vcf.insert(pair<uint8_t, Vcf>(current, vcf));
             ++current;
         }
@@ -165,7 +182,7 @@ void Mk1Cartridge::dissect()
             if (idx >= 0x3ffe) {
                 throw DataFormatException("invalid AMPL pointer");
             }
-            Envelope ampl(current, &(m_buffer[idx]), 44);
+            Envelope ampl(current, m_buffer.map(idx, 44), 44);
             m_ampl.insert(pair<uint8_t, Envelope>(current, ampl));
             ++current;
         }
@@ -178,7 +195,7 @@ void Mk1Cartridge::dissect()
             if (idx >= 0x3ffe) {
                 throw DataFormatException("invalid FREQ pointer");
             }
-            Envelope freq(current, &(m_buffer[idx]), 32);
+            Envelope freq(current, m_buffer.map(idx, 32), 32);
             m_freq.insert(pair<uint8_t, Envelope>(current, freq));
             ++current;
         }
@@ -191,7 +208,8 @@ void Mk1Cartridge::dissect()
             if (idx >= 0x3ffe) {
                 throw DataFormatException("invalid WAVE pointer");
             }
-            Wave wave(current, &(m_buffer[idx]), (m_buffer[idx] & 0x80) == 0 ? 177 : 212);
+            size_t size = (m_buffer[idx] & 0x80) == 0 ? 177 : 212;
+            Wave wave(current, m_buffer.map(idx, size), size);
             m_wave.insert(pair<uint8_t, Wave>(current, wave));
             ++current;
         }
@@ -206,6 +224,14 @@ void Mk1Cartridge::dissect()
 // Put together and update MK1 cartridge raw data
 void Mk1Cartridge::update()
 {
+    // Blocks write their buffer parts themselves, only the checksum is left
+    uint16_t check = 0;
+    for (size_t i = 0; i < 0x3ffe; ++i) {
+        check += m_buffer[i];
+    }
+    check = -check;
+    uint8_t buf[2] = { uint8_t(check >> 8), uint8_t(check) };
+    m_buffer.write(0x3ffe, buf, sizeof(buf));
 }
 
 } // namespace Wersi
@@ -63,9 +63,10 @@ class Mk1Cartridge : public InstrumentStore {
           @todo implement double buffering for this
 
           @param[in]    buffer      Raw data buffer
+          @param[in]    size        Size of data buffer
           @param[in]    initialize  If true, a blank MK1 cartridge is created
          */
-        Mk1Cartridge(void* buffer, bool initialize = false);
+        Mk1Cartridge(const void* buffer, size_t size, bool initialize = false);
 
         /**
           Destroy MK1 cartridge object.
@@ -74,6 +75,9 @@ class Mk1Cartridge : public InstrumentStore {
          */
         virtual ~Mk1Cartridge();
 
+        /// Implements InstrumentStore::clone()
+        virtual InstrumentStore* clone() const;
+
         /// Implements InstrumentStore::dissect()
         virtual void dissect();
 
@@ -86,7 +90,15 @@ class Mk1Cartridge : public InstrumentStore {
         }
 
     private:
-        Mk1Cartridge(const Mk1Cartridge&);              ///< Inhibit copying objects
+        /**
+          Create MK1 cartridge object by copying.
+
+          Shares the raw buffer of the source cartridge, used by clone().
+
+          @param[in]    source      Source cartridge to copy from
+         */
+        Mk1Cartridge(const Mk1Cartridge& source);
+
         Mk1Cartridge& operator=(const Mk1Cartridge&);   ///< Inhibit copying objects
 };
 
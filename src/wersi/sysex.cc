@@ -47,6 +47,12 @@
 namespace DMSToolbox {
 namespace Wersi {
 
+// Largest raw block, a FIXWAVE block
+static const uint8_t MaxBlockLength = 212;
+
+// Definitions of constants used by reference
+const size_t SysEx::LinkRate;
+
 // Convert byte to two SysEx bytes
 inline void byteToSysEx(uint8_t type, uint8_t byte, uint8_t& lo, uint8_t& hi)
 {
@@ -102,127 +108,69 @@ void SysEx::fromSysEx(uint8_t device, const SysExMessage& sysEx, Message& messag
     }
 }
 
-#ifdef HAVE_RTMIDI
-// Send ICB to device
-void SysEx::sendIcb(RtMidiOut* midi, uint8_t type, uint8_t blockNum, const Icb& icb)
+// Encode raw block as complete SysEx message
+size_t SysEx::encodeBlock(uint8_t device, BlockType type, uint8_t blockNum, const void* data, uint8_t length,
+                          std::vector<unsigned char>& out)
 {
+    if (length > MaxBlockLength) {
+        throw MidiException("Block too large for SysEx message");
+    }
+
     // Construct raw message
-    uint8_t buf[sizeof(Message) + 15];
+    uint8_t buf[sizeof(Message) + MaxBlockLength - 1];
     auto msg = reinterpret_cast<Message*>(buf);
-    msg->m_type = BlockType::IcBlock;
+    msg->m_type = type;
     msg->m_address = blockNum;
-    msg->m_length = 16;
-    memcpy(msg->m_data, icb.getBuffer(), 16);
-
-    // Convert to SysEx message
-    uint8_t out[sizeof(SysExMessage) + 32];
-    auto omsg = reinterpret_cast<SysExMessage*>(out);
-    size_t length = toSysEx(type, *msg, *omsg);
+    msg->m_length = length;
+    memcpy(msg->m_data, data, length);
+
+    // Convert to SysEx message and append it
+    uint8_t sysEx[sizeof(SysExMessage) + 2 * MaxBlockLength];
+    size_t size = toSysEx(device, *msg, *reinterpret_cast<SysExMessage*>(sysEx));
+    out.insert(out.end(), sysEx, sysEx + size);
+    return size;
+}
 
-    // Create MIDI message vector and send it
+#ifdef HAVE_RTMIDI
+// Send ICB to device
+void SysEx::sendIcb(RtMidiOut* midi, uint8_t type, uint8_t blockNum, const Icb& icb)
+{
     std::vector<unsigned char> data;
-    for (size_t i = 0; i < length; ++i) {
-        data.push_back(out[i]);
-    }
+    encodeBlock(type, BlockType::IcBlock, blockNum, icb.getBuffer(), 16, data);
     midi->sendMessage(&data);
 }
 
 // Send VCF to device
 void SysEx::sendVcf(RtMidiOut* midi, uint8_t type, uint8_t blockNum, const Vcf& vcf)
 {
-    // Construct raw message
-    uint8_t buf[sizeof(Message) + 9];
-    auto msg = reinterpret_cast<Message*>(buf);
-    msg->m_type = BlockType::VcfBlock;
-    msg->m_address = blockNum;
-    msg->m_length = 10;
-    memcpy(msg->m_data, vcf.getBuffer(), 10);
-
-    // Convert to SysEx message
-    uint8_t out[sizeof(SysExMessage) + 20];
-    auto omsg = reinterpret_cast<SysExMessage*>(out);
-    size_t length = toSysEx(type, *msg, *omsg);
-
-    // Create MIDI message vector and send it
     std::vector<unsigned char> data;
-    for (size_t i = 0; i < length; ++i) {
-        data.push_back(out[i]);
-    }
+    encodeBlock(type, BlockType::VcfBlock, blockNum, vcf.getBuffer(), 10, data);
     midi->sendMessage(&data);
 }
 
 // Send AMPL to device
 void SysEx::sendAmpl(RtMidiOut* midi, uint8_t type, uint8_t blockNum, const Envelope& ampl)
 {
-    // Construct raw message
-    uint8_t buf[sizeof(Message) + 43];
-    auto msg = reinterpret_cast<Message*>(buf);
-    msg->m_type = BlockType::AmplBlock;
-    msg->m_address = blockNum;
-    msg->m_length = ampl.getBufferSize();
-    memcpy(msg->m_data, ampl.getBuffer(), msg->m_length);
-
-    // Convert to SysEx message
-    uint8_t out[sizeof(SysExMessage) + 88];
-    auto omsg = reinterpret_cast<SysExMessage*>(out);
-    size_t length = toSysEx(type, *msg, *omsg);
-
-    // Create MIDI message vector and send it
     std::vector<unsigned char> data;
-    for (size_t i = 0; i < length; ++i) {
-        data.push_back(out[i]);
-    }
+    encodeBlock(type, BlockType::AmplBlock, blockNum, ampl.getBuffer(), uint8_t(ampl.getBufferSize()), data);
     midi->sendMessage(&data);
 }
 
 // Send FREQ to device
 void SysEx::sendFreq(RtMidiOut* midi, uint8_t type, uint8_t blockNum, const Envelope& freq)
 {
-    // Construct raw message
-    uint8_t buf[sizeof(Message) + 31];
-    auto msg = reinterpret_cast<Message*>(buf);
-    msg->m_type = BlockType::FreqBlock;
-    msg->m_address = blockNum;
-    msg->m_length = freq.getBufferSize();
-    memcpy(msg->m_data, freq.getBuffer(), msg->m_length);
-
-    // Convert to SysEx message
-    uint8_t out[sizeof(SysExMessage) + 64];
-    auto omsg = reinterpret_cast<SysExMessage*>(out);
-    size_t length = toSysEx(type, *msg, *omsg);
-
-    // Create MIDI message vector and send it
     std::vector<unsigned char> data;
-    for (size_t i = 0; i < length; ++i) {
-        data.push_back(out[i]);
-    }
+    encodeBlock(type, BlockType::FreqBlock, blockNum, freq.getBuffer(), uint8_t(freq.getBufferSize()), data);
     midi->sendMessage(&data);
 }
 
 // Send WAVE to device
 void SysEx::sendWave(RtMidiOut* midi, uint8_t type, uint8_t blockNum, const Wave& wave)
 {
-    // Construct raw message
-    uint8_t buf[sizeof(Message) + 211];
-    auto msg = reinterpret_cast<Message*>(buf);
-    msg->m_type = BlockType::FixWaveBlock;
-    msg->m_address = blockNum;
-    msg->m_length = wave.getBufferSize();
-    if (msg->m_length < 212) {
-        msg->m_type = BlockType::RelWaveBlock;
-    }
-    memcpy(msg->m_data, wave.getBuffer(), msg->m_length);
-
-    // Convert to SysEx message
-    uint8_t out[sizeof(SysExMessage) + 424];
-    auto omsg = reinterpret_cast<SysExMessage*>(out);
-    size_t length = toSysEx(type, *msg, *omsg);
-
-    // Create MIDI message vector and send it
+    size_t length = wave.getBufferSize();
+    BlockType blockType = length < 212 ? BlockType::RelWaveBlock : BlockType::FixWaveBlock;
     std::vector<unsigned char> data;
-    for (size_t i = 0; i < length; ++i) {
-        data.push_back(out[i]);
-    }
+    encodeBlock(type, blockType, blockNum, wave.getBuffer(), uint8_t(length), data);
     midi->sendMessage(&data);
 }
 
@@ -38,6 +38,7 @@
 #pragma once
 
 #include <common.hh>
+#include <vector>
 
 #ifdef HAVE_RTMIDI
 #include <RtMidi.h>
@@ -60,6 +61,9 @@ class Wave;
  */
 class SysEx {
     public:
+        /// MIDI link rate in bytes per second (31250 baud, 10 bits per byte)
+        static const size_t LinkRate = 3125;
+
         /// Message type
         enum class BlockType : uint8_t {
             RequestBlock    = 'r',          ///< Request block from instrument
@@ -124,6 +128,24 @@ class SysEx {
          */
         static void fromSysEx(uint8_t device, const SysExMessage& sysEx, Message& message);
 
+        /**
+          Encode block as SysEx message.
+
+          Converts the raw data of a block to a complete SysEx message and appends it to the output vector, ready to
+          be sent to the device.
+
+          @param[in]        device      Device type to create message for
+          @param[in]        type        Block type
+          @param[in]        blockNum    Block number
+          @param[in]        data        Raw block data
+          @param[in]        length      Raw block length, at most 212 bytes
+          @param[in,out]    out         Output vector to append the message to
+
+          @return                       Length of the appended message
+         */
+        static size_t encodeBlock(uint8_t device, BlockType type, uint8_t blockNum, const void* data, uint8_t length,
+                                  std::vector<unsigned char>& out);
+
 #ifdef HAVE_RTMIDI
         /**
           Send ICB to device.
@@ -41,9 +41,9 @@ namespace DMSToolbox {
 namespace Wersi {
 
 // Create new VCF object
-Vcf::Vcf(uint8_t blockNum, void* buffer)
+Vcf::Vcf(uint8_t blockNum, const CowBuffer::Ref& buffer)
     : m_blockNum(blockNum)
-    , m_buffer(static_cast<uint8_t*>(buffer))
+    , m_buffer(buffer)
     , m_left(false)
     , m_right(false)
     , m_lowPass(false)
@@ -71,7 +71,7 @@ Vcf::Vcf(uint8_t blockNum, void* buffer)
 // Create VCF object by copying
 Vcf::Vcf(const Vcf& source)
     : m_blockNum(0)
-    , m_buffer(nullptr)
+    , m_buffer()
     , m_left(false)
     , m_right(false)
     , m_lowPass(false)
@@ -141,53 +141,58 @@ void Vcf::copy(const Vcf& source)
 // Dissect VCF raw data
 void Vcf::dissect()
 {
-    m_left          = (m_buffer[0] & 0x01) != 0;
-    m_right         = (m_buffer[0] & 0x02) != 0;
-    m_lowPass       = (m_buffer[0] & 0x04) != 0;
-    m_fourPoles     = (m_buffer[0] & 0x08) != 0;
-    m_wv            = (m_buffer[0] & 0x10) != 0;
-    m_noise         = (m_buffer[0] & 0x20) != 0;
-    m_distortion    = (m_buffer[0] & 0x40) != 0;
+    const uint8_t* buf = m_buffer.data();
+    m_left          = (buf[0] & 0x01) != 0;
+    m_right         = (buf[0] & 0x02) != 0;
+    m_lowPass       = (buf[0] & 0x04) != 0;
+    m_fourPoles     = (buf[0] & 0x08) != 0;
+    m_wv            = (buf[0] & 0x10) != 0;
+    m_noise         = (buf[0] & 0x20) != 0;
+    m_distortion    = (buf[0] & 0x40) != 0;
     // Bit 7 unknown
-    m_frequency     = int8_t(m_buffer[1]);
-    m_quality       = m_buffer[2];
+    m_frequency     = int8_t(buf[1]);
+    m_quality       = buf[2];
     // Bits 0-1 unknown
-    m_noiseType     = static_cast<NoiseType>((m_buffer[3] & 0x0c) >> 2);
-    m_retrigger     = (m_buffer[3] & 0x10) != 0;
-    m_envMode       = static_cast<EnvelopeMode>((m_buffer[3] & 0x60) >> 5);
-    m_tracking      = (m_buffer[3] & 0x80) != 0;
-    m_t1Time        = m_buffer[4];
-    m_t2Time        = m_buffer[5];
-    m_t1Intensity   = int8_t(m_buffer[6]);
-    m_t1Offset      = int8_t(m_buffer[7]);
-    m_t2Intensity   = int8_t(m_buffer[8]);
-    m_t2Offset      = int8_t(m_buffer[9]);
-
-    m_unknownBits   = (m_buffer[3] & 0x03) | (m_buffer[0] & 0x80);
+    m_noiseType     = static_cast<NoiseType>((buf[3] & 0x0c) >> 2);
+    m_retrigger     = (buf[3] & 0x10) != 0;
+    m_envMode       = static_cast<EnvelopeMode>((buf[3] & 0x60) >> 5);
+    m_tracking      = (buf[3] & 0x80) != 0;
+    m_t1Time        = buf[4];
+    m_t2Time        = buf[5];
+    m_t1Intensity   = int8_t(buf[6]);
+    m_t1Offset      = int8_t(buf[7]);
+    m_t2Intensity   = int8_t(buf[8]);
+    m_t2Offset      = int8_t(buf[9]);
+
+    m_unknownBits   = (buf[3] & 0x03) | (buf[0] & 0x80);
 }
 
 // Put together and update VCF raw data
 void Vcf::update()
 {
-    m_buffer[0] = (m_left       ? 0x01 : 0x00) |
-                  (m_right      ? 0x02 : 0x00) |
-                  (m_lowPass    ? 0x04 : 0x00) |
-                  (m_fourPoles  ? 0x08 : 0x00) |
-                  (m_wv         ? 0x10 : 0x00) |
-                  (m_noise      ? 0x20 : 0x00) |
-                  (m_distortion ? 0x40 : 0x00);
-    m_buffer[1] = uint8_t(m_frequency);
-    m_buffer[2] = m_quality;
-    m_buffer[3] = ((static_cast<uint8_t>(m_noiseType) & 3) << 2) |
-                  (m_retrigger  ? 0x10 : 0x00) |
-                  ((static_cast<uint8_t>(m_envMode) & 3) << 5) |
-                  (m_lowPass    ? 0x80 : 0x00);
-    m_buffer[4] = m_t1Time;
-    m_buffer[5] = m_t2Time;
-    m_buffer[6] = uint8_t(m_t1Intensity);
-    m_buffer[7] = uint8_t(m_t1Offset);
-    m_buffer[8] = uint8_t(m_t2Intensity);
-    m_buffer[9] = uint8_t(m_t2Offset);
+    uint8_t buf[10];
+    buf[0] = (m_left       ? 0x01 : 0x00) |
+             (m_right      ? 0x02 : 0x00) |
+             (m_lowPass    ? 0x04 : 0x00) |
+             (m_fourPoles  ? 0x08 : 0x00) |
+             (m_wv         ? 0x10 : 0x00) |
+             (m_noise      ? 0x20 : 0x00) |
+             (m_distortion ? 0x40 : 0x00) |
+             (m_unknownBits & 0x80);
+    buf[1] = uint8_t(m_frequency);
+    buf[2] = m_quality;
+    buf[3] = ((static_cast<uint8_t>(m_noiseType) & 3) << 2) |
+             (m_retrigger  ? 0x10 : 0x00) |
+             ((static_cast<uint8_t>(m_envMode) & 3) << 5) |
+             (m_tracking   ? 0x80 : 0x00) |
+             (m_unknownBits & 0x03);
+    buf[4] = m_t1Time;
+    buf[5] = m_t2Time;
+    buf[6] = uint8_t(m_t1Intensity);
+    buf[7] = uint8_t(m_t1Offset);
+    buf[8] = uint8_t(m_t2Intensity);
+    buf[9] = uint8_t(m_t2Offset);
+    m_buffer.write(buf, sizeof(buf));
 }
 
 // Return noise type name
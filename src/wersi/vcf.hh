@@ -38,6 +38,7 @@
 #pragma once
 
 #include <common.hh>
+#include <cowbuffer.hh>
 #include <string>
 
 namespace DMSToolbox {
@@ -77,9 +78,9 @@ class Vcf {
           left untouched.
 
           @param[in]    blockNum    Block number
-          @param[in]    buffer      Raw data buffer
+          @param[in]    buffer      Reference to raw data block
          */
-        Vcf(uint8_t blockNum, void* buffer);
+        Vcf(uint8_t blockNum, const CowBuffer::Ref& buffer);
 
         /**
           Create VCF object by copying.
@@ -105,7 +106,19 @@ class Vcf {
           @return                   Raw buffer const pointer
          */
         const void* getBuffer() const {
-            return m_buffer;
+            return m_buffer.data();
+        }
+
+        /**
+          Rebind raw buffer.
+
+          Associates the object with the same block in another buffer. This is used by instrument stores when they
+          are cloned, the object data itself is left untouched.
+
+          @param[in]    buffer      Buffer holding a copy of the block
+         */
+        void rebind(CowBuffer& buffer) {
+            m_buffer.rebind(buffer);
         }
 
         /**
@@ -387,7 +400,7 @@ class Vcf {
 
     private:
         uint8_t         m_blockNum;         ///< Block number
-        uint8_t*        m_buffer;           ///< Associated raw buffer
+        CowBuffer::Ref  m_buffer;           ///< Associated raw buffer
 
         bool            m_left;             ///< Left VCF output enabled
         bool            m_right;            ///< Right VCF output enabled
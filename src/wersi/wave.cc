@@ -36,6 +36,7 @@
  */
 
 #include <wersi/wave.hh>
+#include <exceptions.hh>
 #include <cstring>
 
 #ifdef WIN32
@@ -45,11 +46,15 @@
 namespace DMSToolbox {
 namespace Wersi {
 
+// Number of fixed formant bands
+const size_t Wave::NumFormants;
+
 // Create new wave object
-Wave::Wave(uint8_t blockNum, void* buffer, size_t size)
+Wave::Wave(uint8_t blockNum, const CowBuffer::Ref& buffer, size_t size)
     : m_blockNum(blockNum)
-    , m_buffer(static_cast<uint8_t*>(buffer))
+    , m_buffer(buffer)
     , m_size(size)
+    , m_hash(Hash::Seed)
     , m_fixedFormants(false)
     , m_level(0)
     , m_bassWave()
@@ -57,6 +62,8 @@ Wave::Wave(uint8_t blockNum, void* buffer, size_t size)
     , m_altoWave()
     , m_sopranoWave()
     , m_fixFormData()
+    , m_dryLevel(0)
+    , m_formants()
 {
     dissect();
 }
@@ -64,8 +71,9 @@ Wave::Wave(uint8_t blockNum, void* buffer, size_t size)
 // Create wave object by copying
 Wave::Wave(const Wave& source)
     : m_blockNum(0)
-    , m_buffer(nullptr)
+    , m_buffer()
     , m_size(0)
+    , m_hash(Hash::Seed)
     , m_fixedFormants(false)
     , m_level(0)
     , m_bassWave()
@@ -73,6 +81,8 @@ Wave::Wave(const Wave& source)
     , m_altoWave()
     , m_sopranoWave()
     , m_fixFormData()
+    , m_dryLevel(0)
+    , m_formants()
 {
     *this = source;
 }
@@ -89,6 +99,7 @@ Wave& Wave::operator=(const Wave& source)
         m_blockNum      = source.m_blockNum;
         m_buffer        = source.m_buffer;
         m_size          = source.m_size;
+        m_hash          = source.m_hash;
         copy(source);
     }
     return *this;
@@ -135,9 +146,12 @@ void Wave::copy(const Wave& source)
     if (m_size > 211) {
         if (source.m_size > 211) {
             memcpy(m_fixFormData, source.m_fixFormData, sizeof(m_fixFormData));
+            m_dryLevel = source.m_dryLevel;
+            memcpy(m_formants,    source.m_formants,    sizeof(m_formants));
         }
         else {
             memset(m_fixFormData, 0,                    sizeof(m_fixFormData));
+            decodeFormants();
         }
     }
 }
@@ -145,67 +159,96 @@ void Wave::copy(const Wave& source)
 // Dissect raw wave data
 void Wave::dissect()
 {
-    m_level         = m_buffer[0] & 0x7f;
-    m_fixedFormants = (m_buffer[0] & 0x80) != 0;
+    const uint8_t* buf = m_buffer.data();
+    m_hash          = Hash::compute(buf, m_size);
+    m_level         = buf[0] & 0x7f;
+    m_fixedFormants = (buf[0] & 0x80) != 0;
 
     if (m_size > 64) {
-        memcpy(m_bassWave, &(m_buffer[1]), sizeof(m_bassWave));
+        memcpy(m_bassWave, &(buf[1]), sizeof(m_bassWave));
     }
     else {
         memset(m_bassWave, 0, sizeof(m_bassWave));
     }
 
     if (m_size > 128) {
-        memcpy(m_tenorWave, &(m_buffer[65]), sizeof(m_tenorWave));
+        memcpy(m_tenorWave, &(buf[65]), sizeof(m_tenorWave));
     }
     else {
         memset(m_tenorWave, 0, sizeof(m_tenorWave));
     }
 
     if (m_size > 160) {
-        memcpy(m_altoWave, &(m_buffer[129]), sizeof(m_altoWave));
+        memcpy(m_altoWave, &(buf[129]), sizeof(m_altoWave));
     }
     else {
         memset(m_altoWave, 0, sizeof(m_altoWave));
     }
 
     if (m_size > 176) {
-        memcpy(m_sopranoWave, &(m_buffer[161]), sizeof(m_sopranoWave));
+        memcpy(m_sopranoWave, &(buf[161]), sizeof(m_sopranoWave));
     }
     else {
         memset(m_sopranoWave, 0, sizeof(m_sopranoWave));
     }
 
     if (m_size > 211) {
-        memcpy(m_fixFormData, &(m_buffer[177]), sizeof(m_fixFormData));
+        memcpy(m_fixFormData, &(buf[177]), sizeof(m_fixFormData));
     }
     else {
         memset(m_fixFormData, 0, sizeof(m_fixFormData));
     }
+    decodeFormants();
 }
 
 // Put together and update wave raw data
 void Wave::update()
 {
-    m_buffer[0] = (m_level & 0x7f) | (m_fixedFormants ? 0x80 : 0x00);
+    uint8_t buf[212];
+    memcpy(buf, m_buffer.data(), m_size);
+    buf[0] = (m_level & 0x7f) | (m_fixedFormants ? 0x80 : 0x00);
     if (m_size > 64) {
-        memcpy(&(m_buffer[1]), m_bassWave, sizeof(m_bassWave));
+        memcpy(&(buf[1]), m_bassWave, sizeof(m_bassWave));
     }
 
     if (m_size > 128) {
-        memcpy(&(m_buffer[65]), m_tenorWave, sizeof(m_tenorWave));
+        memcpy(&(buf[65]), m_tenorWave, sizeof(m_tenorWave));
     }
 
     if (m_size > 160) {
-        memcpy(&(m_buffer[129]), m_altoWave, sizeof(m_altoWave));
+        memcpy(&(buf[129]), m_altoWave, sizeof(m_altoWave));
     }
 
     if (m_size > 176) {
-        memcpy(&(m_buffer[161]), m_sopranoWave, sizeof(m_sopranoWave));
+        memcpy(&(buf[161]), m_sopranoWave, sizeof(m_sopranoWave));
     }
 
     if (m_size > 211) {
-        memcpy(&(m_buffer[177]), m_fixFormData, sizeof(m_fixFormData));
+        memcpy(&(buf[177]), m_fixFormData, sizeof(m_fixFormData));
+    }
+
+    m_hash = Hash::compute(buf, m_size);
+    m_buffer.write(buf, m_size);
+}
+
+// Set fixed formants state
+void Wave::setFixedFormants(bool fixedFormants)
+{
+    if (fixedFormants && m_size <= 211) {
+        throw DataFormatException("Wave block too small for fixed formants");
+    }
+    m_fixedFormants = fixedFormants;
+}
+
+// Decode fixed formant bands from fixed formant data
+void Wave::decodeFormants()
+{
+    m_dryLevel = m_fixFormData[0] & 0x7f;
+    for (size_t i = 0; i < NumFormants; ++i) {
+        const uint8_t* band = &(m_fixFormData[1 + 4 * i]);
+        m_formants[i].m_frequency = uint16_t((band[0] << 8) | band[1]);
+        m_formants[i].m_width     = band[2];
+        m_formants[i].m_level     = band[3] & 0x7f;
     }
 }
 
@@ -38,6 +38,8 @@
 #pragma once
 
 #include <common.hh>
+#include <cowbuffer.hh>
+#include <hash.hh>
 
 namespace DMSToolbox {
 namespace Wersi {
@@ -50,9 +52,32 @@ namespace Wersi {
   Wersi wave data can have two different types - relative formants and fixed formants. At the moment, only relative
   formants are completely understood, they consists of four simple PCM waves for different note ranges. Assuming that
   this behavior is similar for fixed format waves, the class provides access to those waves.
+
+  Fixed formant waves carry 35 additional bytes, which are decoded as a dry level followed by NumFormants bands at
+  fixed frequencies which do not follow the played note:
+
+  | Offset | Size | Contents                                                 |
+  |--------|------|----------------------------------------------------------|
+  | 0      | 1    | Level of the unfiltered wave, 0..127                      |
+  | 1      | 32   | Eight bands: frequency in Hz (big endian), width, level   |
+  | 33     | 2    | Unknown, preserved                                        |
+
+  This layout is inferred and has not been confirmed against the instrument. Therefore the decoded bands are
+  read-only, update() writes the fixed formant data back as it has been read, and the synthesizer only renders them
+  when built with the EXPERIMENTAL_FORMANTS option.
  */
 class Wave {
     public:
+        /// Band of a fixed formant wave
+        struct Formant {
+            uint16_t    m_frequency;        ///< Center frequency in Hz, 0 if unused
+            uint8_t     m_width;            ///< Bandwidth in units of 10 Hz
+            uint8_t     m_level;            ///< Band level 0..127
+        };
+
+        /// Number of fixed formant bands
+        static const size_t NumFormants = 8;
+
         /**
           Create new wave object from buffer.
 
@@ -62,10 +87,10 @@ class Wave {
           left untouched.
 
           @param[in]    blockNum    Block number
-          @param[in]    buffer      Raw data buffer
+          @param[in]    buffer      Reference to raw data block
           @param[in]    size        Size of raw data buffer
          */
-        Wave(uint8_t blockNum, void* buffer, size_t size);
+        Wave(uint8_t blockNum, const CowBuffer::Ref& buffer, size_t size);
 
         /**
           Create wave object by copying.
@@ -91,7 +116,19 @@ class Wave {
           @return                   Raw buffer const pointer
          */
         const void* getBuffer() const {
-            return m_buffer;
+            return m_buffer.data();
+        }
+
+        /**
+          Rebind raw buffer.
+
+          Associates the object with the same block in another buffer. This is used by instrument stores when they
+          are cloned, the object data itself is left untouched.
+
+          @param[in]    buffer      Buffer holding a copy of the block
+         */
+        void rebind(CowBuffer& buffer) {
+            m_buffer.rebind(buffer);
         }
 
         /**
@@ -142,6 +179,18 @@ class Wave {
          */
         void update();
 
+        /**
+          Get content hash.
+
+          Returns the hash of the raw block data as of the last dissect() or update(). Derived data like band-limited
+          tables is cached by this hash, so it is recomputed whenever the wave has been changed.
+
+          @return                   Content hash
+         */
+        uint64_t getHash() const {
+            return m_hash;
+        }
+
         /**
           Get fixed formants state.
 
@@ -153,6 +202,40 @@ class Wave {
             return m_fixedFormants;
         }
 
+        /**
+          Set fixed formants state.
+
+          Switches between a relative formants and a fixed formants wave. If the block is too small to hold fixed
+          formant data, switching to fixed formants throws a DataFormatException.
+
+          @param[in]    fixedFormants   True for fixed formants wave
+         */
+        void setFixedFormants(bool fixedFormants);
+
+        /**
+          Get dry level.
+
+          Returns the level of the unfiltered wave of a fixed formants wave.
+
+          @return                   Dry level 0..127
+         */
+        uint8_t getDryLevel() const {
+            return m_dryLevel;
+        }
+
+        /**
+          Get fixed formant.
+
+          Returns a band of a fixed formants wave.
+
+          @param[in]    index       Band index 0..NumFormants-1
+
+          @return                   Formant band
+         */
+        const Formant& getFormant(size_t index) const {
+            return m_formants[index];
+        }
+
         /**
           Get wave level.
 
@@ -164,6 +247,17 @@ class Wave {
             return m_level;
         }
 
+        /**
+          Set wave level.
+
+          Sets the wave level.
+
+          @param[in]    level       Wave level 0..127
+         */
+        void setLevel(uint8_t level) {
+            m_level = level & 0x7f;
+        }
+
         /**
           Get bass wave.
 
@@ -175,6 +269,17 @@ class Wave {
             return m_bassWave;
         }
 
+        /**
+          Get bass wave.
+
+          Returns a const pointer to the 64-byte bass wave.
+
+          @return                   Const pointer to 64-byte bass wave
+         */
+        const uint8_t* getBass() const {
+            return m_bassWave;
+        }
+
         /**
           Get tenor wave.
 
@@ -186,6 +291,17 @@ class Wave {
             return m_tenorWave;
         }
 
+        /**
+          Get tenor wave.
+
+          Returns a const pointer to the 64-byte tenor wave.
+
+          @return                   Const pointer to 64-byte tenor wave
+         */
+        const uint8_t* getTenor() const {
+            return m_tenorWave;
+        }
+
         /**
           Get also wave.
 
@@ -197,6 +313,17 @@ class Wave {
             return m_altoWave;
         }
 
+        /**
+          Get alto wave.
+
+          Returns a const pointer to the 32-byte alto wave.
+
+          @return                   Const pointer to 32-byte alto wave
+         */
+        const uint8_t* getAlto() const {
+            return m_altoWave;
+        }
+
         /**
           Get soprano wave.
 
@@ -208,10 +335,22 @@ class Wave {
             return m_sopranoWave;
         }
 
+        /**
+          Get soprano wave.
+
+          Returns a const pointer to the 16-byte soprano wave.
+
+          @return                   Const pointer to 16-byte soprano wave
+         */
+        const uint8_t* getSoprano() const {
+            return m_sopranoWave;
+        }
+
     private:
         uint8_t         m_blockNum;         ///< Block number
-        uint8_t*        m_buffer;           ///< Associated raw buffer
+        CowBuffer::Ref  m_buffer;           ///< Associated raw buffer
         size_t          m_size;             ///< Size of associated raw buffer
+        uint64_t        m_hash;             ///< Hash of raw block data
 
         bool            m_fixedFormants;    ///< True if wave is using fixed formants
         uint8_t         m_level;            ///< Wave level
@@ -220,6 +359,15 @@ class Wave {
         uint8_t         m_altoWave[32];     ///< Alto wave
         uint8_t         m_sopranoWave[16];  ///< Soprano wave
         uint8_t         m_fixFormData[35];  ///< Fixed formant data
+        uint8_t         m_dryLevel;         ///< Unfiltered level of fixed formants wave
+        Formant         m_formants[NumFormants];    ///< Decoded fixed formant bands
+
+        /**
+          Decode fixed formants.
+
+          Parses the fixed formant data into the dry level and bands.
+         */
+        void decodeFormants();
 };
 
 } // namespace Wersi